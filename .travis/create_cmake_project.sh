@@ -18,6 +18,7 @@ cmake3 .. -DCMAKE_BUILD_TYPE=Release \
           -DENABLE_CACHE_OPTIMIZATION=ON \
           -DENABLE_GSL_CONTRACTS=OFF \
           -DENABLE_LOGS=ON \
+          -DENABLE_TRACING=ON \
           -DENABLE_UNIT_TESTS=ON \
           -DENABLE_DOCUMENTATION=ON
 cd ..
\ No newline at end of file
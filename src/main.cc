@@ -19,9 +19,14 @@
  * along with Sirius.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <cstdio>
+
+#include <algorithm>
+#include <chrono>
 #include <exception>
 #include <future>
 #include <iostream>
+#include <sstream>
 #include <stdexcept>
 #include <string>
 #include <system_error>
@@ -30,15 +35,27 @@
 
 #include <cxxopts.hpp>
 
+#include <cpl_vsi.h>
+
 #include "sirius/exception.h"
 #include "sirius/frequency_resampler_factory.h"
 #include "sirius/image_streamer.h"
 #include "sirius/sirius.h"
 
+#include "sirius/gdal/block_grid.h"
+#include "sirius/gdal/block_journal.h"
+#include "sirius/gdal/output_options.h"
+#include "sirius/gdal/shard.h"
 #include "sirius/gdal/wrapper.h"
 
+#include "sirius/utils/batch_manifest.h"
 #include "sirius/utils/log.h"
+#include "sirius/utils/memory_budget.h"
 #include "sirius/utils/numeric.h"
+#include "sirius/utils/pipeline_metrics.h"
+#include "sirius/utils/system_resources.h"
+#include "sirius/utils/thread_pool.h"
+#include "sirius/utils/trace.h"
 
 struct CliParameters {
     // status
@@ -50,8 +67,14 @@ struct CliParameters {
     std::string input_image_path;
     std::string output_image_path;
 
+    // batch mode
+    std::string batch_manifest_path;
+
     // general options
     std::string verbosity_level = "info";
+    unsigned int cpu_count = 0;
+    std::string memory_limit;
+    sirius::utils::SystemResources system_resources;
 
     // resampling options
     std::string resampling_ratio = "1:1";
@@ -68,10 +91,34 @@ struct CliParameters {
     int stream_block_height = 256;
     int stream_block_width = 256;
     bool stream_no_block_resizing = false;
+    bool stream_pad_edge_blocks = false;
     bool filter_normalize = false;
     int hot_point_x = -1;
     int hot_point_y = -1;
-    unsigned int stream_parallel_workers = std::thread::hardware_concurrency();
+    unsigned int stream_parallel_workers = 0;
+    bool stream_parallel_workers_set = false;
+    std::string stream_max_memory;
+    bool stream_checkpoint = false;
+    int stream_checkpoint_interval = 30;
+    std::string metrics_report_path;
+    int metrics_interval = 0;
+    std::string trace_path;
+
+    // sharding options
+    std::string shard;
+    int shard_index = 0;
+    int shard_count = 0;
+    std::string window;
+    sirius::gdal::ImageWindow output_window;
+    std::string assembled_image_path;
+    std::vector<std::string> shard_paths;
+
+    // output options
+    sirius::gdal::OutputOptions output_options;
+    std::string output_format = "GTiff";
+    std::string output_type = "Float32";
+    std::string gdal_cache_max;
+    std::size_t gdal_cache_max_size = 0;
 
     bool HasStreamMode() const {
         return stream_mode && stream_block_height > 0 && stream_block_width > 0;
@@ -80,17 +127,47 @@ struct CliParameters {
     sirius::Size GetStreamBlockSize() const {
         return {stream_block_height, stream_block_width};
     }
+
+    bool HasBlockSelection() const {
+        return shard_count > 0 || !output_window.IsEmpty();
+    }
 };
 
+// fraction of the memory limit used as default memory budget of stream mode
+constexpr double kDefaultMemoryBudgetRatio = 0.8;
+
+using BatchEntries = std::vector<sirius::utils::BatchEntry>;
+
 CliParameters GetCliParameters(int argc, const char* argv[]);
 void RunRegularMode(const sirius::IFrequencyResampler& frequency_resampler,
-                    const sirius::Filter& filter,
+                    std::future<sirius::Filter> filter_future,
                     const sirius::ZoomRatio& zoom_ratio,
-                    const CliParameters& params);
+                    const CliParameters& params, const BatchEntries& entries);
 void RunStreamMode(const sirius::IFrequencyResampler& frequency_resampler,
-                   const sirius::Filter& filter,
+                   std::future<sirius::Filter> filter_future,
                    const sirius::ZoomRatio& zoom_ratio,
-                   const CliParameters& params);
+                   const CliParameters& params, const BatchEntries& entries,
+                   const std::string& resampling_description);
+sirius::utils::PipelineMetricsSnapshot StreamImage(
+      const sirius::IFrequencyResampler& frequency_resampler,
+      const sirius::Filter& filter, const sirius::ZoomRatio& zoom_ratio,
+      const CliParameters& params, const sirius::utils::BatchEntry& entry,
+      const std::string& resampling_description);
+std::string DescribeResampling(
+      const CliParameters& params,
+      sirius::ImageDecompositionPolicies image_decomposition_policy,
+      sirius::FrequencyZoomStrategies zoom_strategy);
+void LogMetrics(const sirius::utils::PipelineMetricsSnapshot& metrics);
+sirius::gdal::ImageWindow ComputeStreamBlockRange(
+      const CliParameters& params, const std::string& input_path,
+      const sirius::Size& block_size,
+      const sirius::FilterMetadata& filter_metadata,
+      const sirius::ZoomRatio& zoom_ratio);
+int RunAssembleShards(const CliParameters& params);
+void HandleImageError(const sirius::utils::BatchEntry& entry,
+                      const std::exception& e, std::size_t image_count,
+                      std::size_t& failed_image_count);
+void CheckBatchErrors(std::size_t image_count, std::size_t failed_image_count);
 
 int main(int argc, const char* argv[]) {
     CliParameters params = GetCliParameters(argc, argv);
@@ -99,21 +176,122 @@ int main(int argc, const char* argv[]) {
         return params.help_requested ? 0 : 1;
     }
 
-    if (params.input_image_path.empty() || params.output_image_path.empty()) {
+    if (!params.assembled_image_path.empty()) {
+        return RunAssembleShards(params);
+    }
+
+    bool has_batch_manifest = !params.batch_manifest_path.empty();
+    if (has_batch_manifest && (!params.input_image_path.empty() ||
+                               !params.output_image_path.empty())) {
+        std::cerr << params.help_message << std::endl;
+        std::cerr << "sirius: input and output arguments cannot be used with "
+                     "a batch manifest"
+                  << std::endl;
+        return 1;
+    }
+    if (!has_batch_manifest && (params.input_image_path.empty() ||
+                                params.output_image_path.empty())) {
         std::cerr << params.help_message << std::endl;
         std::cerr << "sirius: input and/or output arguments are missing"
                   << std::endl;
         return 1;
     }
+    if (!params.shard_paths.empty()) {
+        std::cerr << params.help_message << std::endl;
+        std::cerr << "sirius: too many positional arguments" << std::endl;
+        return 1;
+    }
+    if (params.HasBlockSelection() && !params.HasStreamMode()) {
+        std::cerr << "sirius: --shard and --window require stream mode"
+                  << std::endl;
+        return 1;
+    }
+    if (params.shard_count > 0 && !params.output_window.IsEmpty()) {
+        std::cerr << "sirius: --shard and --window cannot be used together"
+                  << std::endl;
+        return 1;
+    }
+    if (params.stream_checkpoint && !params.HasStreamMode()) {
+        std::cerr << "sirius: --checkpoint requires stream mode" << std::endl;
+        return 1;
+    }
+    if (params.stream_checkpoint_interval < 0) {
+        std::cerr << "sirius: checkpoint interval must be positive"
+                  << std::endl;
+        return 1;
+    }
+    if ((!params.metrics_report_path.empty() || params.metrics_interval > 0) &&
+        !params.HasStreamMode()) {
+        std::cerr << "sirius: --metrics-report and --metrics-interval "
+                     "require stream mode"
+                  << std::endl;
+        return 1;
+    }
+    if (params.metrics_interval < 0) {
+        std::cerr << "sirius: metrics interval must be positive" << std::endl;
+        return 1;
+    }
+    if (!params.trace_path.empty() && !params.HasStreamMode()) {
+        std::cerr << "sirius: --trace requires stream mode" << std::endl;
+        return 1;
+    }
 
     sirius::utils::SetVerbosityLevel(params.verbosity_level);
 
     LOG("sirius", info, "Sirius {} - {}", sirius::kVersion, sirius::kGitCommit);
 
+    // size the shared thread pool on the CPUs available to the process
+    const auto& system_resources = params.system_resources;
+    if (system_resources.cpu_quota > 0.) {
+        LOG("sirius", info,
+            "available CPUs: {}{} (host CPUs: {}, cgroup v{} CPU quota: "
+            "{:.2f})",
+            system_resources.cpu_count, params.cpu_count > 0 ? " (set)" : "",
+            system_resources.host_cpu_count, system_resources.cgroup_version,
+            system_resources.cpu_quota);
+    } else {
+        LOG("sirius", info, "available CPUs: {}{} (host CPUs: {})",
+            system_resources.cpu_count, params.cpu_count > 0 ? " (set)" : "",
+            system_resources.host_cpu_count);
+    }
+    if (system_resources.memory_limit > 0) {
+        LOG("sirius", info,
+            "memory limit: {:.1f} MB{} (host memory: {:.1f} MB)",
+            system_resources.memory_limit / (1024. * 1024.),
+            params.memory_limit.empty() ? "" : " (set)",
+            system_resources.physical_memory / (1024. * 1024.));
+    } else {
+        LOG("sirius", info, "memory limit: none (host memory: {:.1f} MB)",
+            system_resources.physical_memory / (1024. * 1024.));
+    }
+    sirius::utils::ThreadPool::SetDefaultThreadCount(
+          system_resources.cpu_count);
+
+    if (params.gdal_cache_max_size > 0) {
+        sirius::gdal::SetBlockCacheMaxSize(params.gdal_cache_max_size);
+    }
+
     try {
+        // a single image is a batch of one image
+        BatchEntries entries = {
+              {params.input_image_path, params.output_image_path}};
+        if (has_batch_manifest) {
+            entries =
+                  sirius::utils::LoadBatchManifest(params.batch_manifest_path);
+            LOG("sirius", info, "batch manifest '{}': {} images",
+                params.batch_manifest_path, entries.size());
+            if (entries.empty()) {
+                return 0;
+            }
+        }
+
         auto zoom_ratio = sirius::ZoomRatio::Create(params.resampling_ratio);
         LOG("sirius", info, "resampling ratio: {}:{}",
             zoom_ratio.input_resolution(), zoom_ratio.output_resolution());
+        LOG("sirius", info, "output: {} {} (scale: {}, offset: {})",
+            params.output_options.format,
+            GDALGetDataTypeName(params.output_options.data_type),
+            params.output_options.scale, params.output_options.offset);
 
         // filter parameters
         sirius::PaddingType padding_type = sirius::PaddingType::kMirrorPadding;
@@ -128,13 +306,9 @@ int main(int argc, const char* argv[]) {
             LOG("sirius", info, "filter: normalize");
         }
 
-        sirius::Filter filter;
-        if (!params.filter_path.empty()) {
+        bool has_filter = !params.filter_path.empty();
+        if (has_filter) {
             LOG("sirius", info, "filter path: {}", params.filter_path);
-            sirius::Point hp(params.hot_point_x, params.hot_point_y);
-            filter = sirius::Filter::Create(
-                  sirius::gdal::LoadImage(params.filter_path), zoom_ratio, hp,
-                  padding_type, params.filter_normalize);
         }
 
         // resampling parameters
@@ -153,14 +327,14 @@ int main(int argc, const char* argv[]) {
 
         if (zoom_ratio.ratio() > 1) {
             // choose the upsampling algorithm only if ratio > 1
-            if (params.upsample_periodization && !filter.IsLoaded()) {
+            if (params.upsample_periodization && !has_filter) {
                 LOG("sirius", error,
                     "filter is required with periodization upsampling");
                 return 1;
-            } else if (params.upsample_zero_padding || !filter.IsLoaded()) {
+            } else if (params.upsample_zero_padding || !has_filter) {
                 LOG("sirius", info, "upsampling: zero padding");
                 zoom_strategy = sirius::FrequencyZoomStrategies::kZeroPadding;
-                if (filter.IsLoaded()) {
+                if (has_filter) {
                     LOG("sirius", warn,
                         "filter will be used with zero padding upsampling");
                 }
@@ -173,10 +347,31 @@ int main(int argc, const char* argv[]) {
         auto frequency_resampler = sirius::FrequencyResamplerFactory::Create(
               image_decomposition_policy, zoom_strategy);
 
+        // prepare the filter in the background while the input is loaded.
+        //   The filter is shared by all the images of a batch.
+        // task captures its parameters by value since it may outlive them
+        //   on error
+        sirius::Point hp(params.hot_point_x, params.hot_point_y);
+        auto filter_future = sirius::utils::ThreadPool::Instance().Submit(
+              [filter_path = params.filter_path, zoom_ratio, hp, padding_type,
+               normalize = params.filter_normalize]() {
+                  if (filter_path.empty()) {
+                      return sirius::Filter();
+                  }
+                  return sirius::Filter::Create(
+                        sirius::gdal::LoadImage(filter_path), zoom_ratio, hp,
+                        padding_type, normalize);
+              });
+
         if (!params.HasStreamMode()) {
-            RunRegularMode(*frequency_resampler, filter, zoom_ratio, params);
+            RunRegularMode(*frequency_resampler, std::move(filter_future),
+                           zoom_ratio, params, entries);
         } else {
-            RunStreamMode(*frequency_resampler, filter, zoom_ratio, params);
+            RunStreamMode(*frequency_resampler, std::move(filter_future),
+                          zoom_ratio, params, entries,
+                          DescribeResampling(params,
+                                             image_decomposition_policy,
+                                             zoom_strategy));
         }
     } catch (const std::exception& e) {
         std::cerr << "sirius: exception while computing resampling: "
@@ -188,47 +383,271 @@ int main(int argc, const char* argv[]) {
 }
 
 void RunRegularMode(const sirius::IFrequencyResampler& frequency_resampler,
-                    const sirius::Filter& filter,
+                    std::future<sirius::Filter> filter_future,
                     const sirius::ZoomRatio& zoom_ratio,
-                    const CliParameters& params) {
+                    const CliParameters& params, const BatchEntries& entries) {
     LOG("sirius", info, "regular mode");
-    auto input_image = sirius::gdal::LoadImage(params.input_image_path);
-    LOG("sirius", info, "input image '{}' ({}x{})", params.input_image_path,
-        input_image.size.row, input_image.size.col);
-
-    auto resampled_geo_ref = sirius::gdal::ComputeResampledGeoReference(
-          params.input_image_path, zoom_ratio);
-
-    auto resampled_image = frequency_resampler.Compute(
-          zoom_ratio, input_image, filter.padding(), filter);
-    LOG("sirius", info, "resampled image '{}' ({}x{})",
-        params.output_image_path, resampled_image.size.row,
-        resampled_image.size.col);
-    sirius::gdal::SaveImage(resampled_image, params.output_image_path,
-                            resampled_geo_ref);
+    auto& thread_pool = sirius::utils::ThreadPool::Instance();
+
+    struct InputImage {
+        std::vector<sirius::Image> bands;
+        sirius::gdal::GeoReference resampled_geo_ref;
+    };
+    // load tasks capture their parameters by value since they may outlive
+    //   them on error
+    auto load_image = [zoom_ratio](const sirius::utils::BatchEntry& entry) {
+        InputImage input_image;
+        input_image.bands = sirius::gdal::LoadImageBands(entry.input_path);
+        input_image.resampled_geo_ref =
+              sirius::gdal::ComputeResampledGeoReference(entry.input_path,
+                                                         zoom_ratio);
+        LOG("sirius", info, "input image '{}' ({}x{}, {} bands)",
+            entry.input_path, input_image.bands.front().size.row,
+            input_image.bands.front().size.col, input_image.bands.size());
+        return input_image;
+    };
+
+    // images are pipelined: the next input is loaded and the previous output
+    //   is saved by the thread pool while the current image is resampled.
+    //   The first input is loaded concurrently with filter preparation.
+    auto next_image_future = thread_pool.Submit(
+          [load_image, entry = entries.front()]() {
+              return load_image(entry);
+          });
+    auto filter = filter_future.get();
+
+    // bands share the image size, hence the FFTW plans and the filter
+    //   spectrum. Other bands are resampled by the thread pool.
+    auto compute_band = [&frequency_resampler, &zoom_ratio,
+                         &filter](const sirius::Image& band) {
+        return frequency_resampler.Compute(zoom_ratio, band, filter.padding(),
+                                           filter);
+    };
+    auto compute_image = [&thread_pool,
+                          &compute_band](const InputImage& input_image) {
+        const auto& input_bands = input_image.bands;
+        std::vector<std::future<sirius::Image>> band_futures;
+        for (std::size_t i = 1; i < input_bands.size(); ++i) {
+            const auto& band = input_bands[i];
+            band_futures.push_back(thread_pool.Submit(
+                  [&compute_band, &band]() { return compute_band(band); }));
+        }
+        std::vector<sirius::Image> resampled_bands;
+        std::exception_ptr error;
+        try {
+            resampled_bands.push_back(compute_band(input_bands.front()));
+        } catch (...) {
+            error = std::current_exception();
+        }
+        for (auto& band_future : band_futures) {
+            thread_pool.Wait(band_future);
+            try {
+                resampled_bands.push_back(band_future.get());
+            } catch (...) {
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        return resampled_bands;
+    };
+
+    std::size_t failed_image_count = 0;
+    std::future<void> save_future;
+    std::size_t save_index = 0;
+    auto wait_save = [&]() {
+        if (!save_future.valid()) {
+            return;
+        }
+        thread_pool.Wait(save_future);
+        try {
+            save_future.get();
+        } catch (const std::exception& e) {
+            HandleImageError(entries[save_index], e, entries.size(),
+                             failed_image_count);
+        }
+    };
+
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+        const auto& entry = entries[i];
+        try {
+            thread_pool.Wait(next_image_future);
+            auto input_image = next_image_future.get();
+            if (i + 1 < entries.size()) {
+                next_image_future = thread_pool.Submit(
+                      [load_image, next_entry = entries[i + 1]]() {
+                          return load_image(next_entry);
+                      });
+            }
+
+            auto resampled_bands = compute_image(input_image);
+            LOG("sirius", info, "resampled image '{}' ({}x{}, {} bands)",
+                entry.output_path, resampled_bands.front().size.row,
+                resampled_bands.front().size.col, resampled_bands.size());
+
+            // at most one output is pending
+            wait_save();
+            save_index = i;
+            save_future = thread_pool.Submit(
+                  [output_path = entry.output_path,
+                   output_options = params.output_options,
+                   resampled_bands = std::move(resampled_bands),
+                   geo_ref = std::move(input_image.resampled_geo_ref)]() {
+                      sirius::gdal::SaveImage(resampled_bands, output_path,
+                                              geo_ref, output_options);
+                  });
+        } catch (const std::exception& e) {
+            // the next input is loaded even if this image failed
+            if (i + 1 < entries.size() && !next_image_future.valid()) {
+                next_image_future = thread_pool.Submit(
+                      [load_image, next_entry = entries[i + 1]]() {
+                          return load_image(next_entry);
+                      });
+            }
+            HandleImageError(entry, e, entries.size(), failed_image_count);
+        }
+    }
+    wait_save();
+    CheckBatchErrors(entries.size(), failed_image_count);
 }
 
 void RunStreamMode(const sirius::IFrequencyResampler& frequency_resampler,
-                   const sirius::Filter& filter,
+                   std::future<sirius::Filter> filter_future,
                    const sirius::ZoomRatio& zoom_ratio,
-                   const CliParameters& params) {
+                   const CliParameters& params, const BatchEntries& entries,
+                   const std::string& resampling_description) {
     LOG("sirius", info, "streaming mode");
+    auto filter = filter_future.get();
+
+    // a stream already overlaps reads, computations and writes of its
+    //   blocks: images are streamed one after the other
+#ifdef SIRIUS_ENABLE_TRACING
+    if (!params.trace_path.empty()) {
+        sirius::utils::TraceRecorder::Instance().Start();
+    }
+#endif  // SIRIUS_ENABLE_TRACING
+
+    std::size_t failed_image_count = 0;
+    std::vector<sirius::utils::MetricsReportEntry> metrics_entries;
+    for (const auto& entry : entries) {
+        try {
+            auto metrics =
+                  StreamImage(frequency_resampler, filter, zoom_ratio, params,
+                              entry, resampling_description);
+            metrics_entries.push_back(
+                  {entry.input_path, entry.output_path, std::move(metrics)});
+        } catch (const std::exception& e) {
+            HandleImageError(entry, e, entries.size(), failed_image_count);
+        }
+    }
+    // report covers the images resampled before a failure
+    if (!params.metrics_report_path.empty()) {
+        sirius::utils::WriteMetricsReport(params.metrics_report_path,
+                                          metrics_entries);
+    }
+#ifdef SIRIUS_ENABLE_TRACING
+    if (!params.trace_path.empty()) {
+        auto& trace_recorder = sirius::utils::TraceRecorder::Instance();
+        trace_recorder.Stop();
+        trace_recorder.Write(params.trace_path);
+    }
+#endif  // SIRIUS_ENABLE_TRACING
+    CheckBatchErrors(entries.size(), failed_image_count);
+}
+
+sirius::utils::PipelineMetricsSnapshot StreamImage(
+      const sirius::IFrequencyResampler& frequency_resampler,
+      const sirius::Filter& filter, const sirius::ZoomRatio& zoom_ratio,
+      const CliParameters& params, const sirius::utils::BatchEntry& entry,
+      const std::string& resampling_description) {
+    unsigned int cpu_count = params.system_resources.cpu_count;
+    // 0 parallel worker means all the available CPUs
     unsigned int max_parallel_workers =
-          std::max(std::min(params.stream_parallel_workers,
-                            std::thread::hardware_concurrency()),
-                   1u);
+          params.stream_parallel_workers == 0
+                ? cpu_count
+                : std::max(std::min(params.stream_parallel_workers, cpu_count),
+                           1u);
     auto stream_block_size = params.GetStreamBlockSize();
+    unsigned int max_pending_blocks = max_parallel_workers;
 
-    // improve stream_block_size if requested or required
-    if (!zoom_ratio.IsRealZoom()) {
-        if (!params.stream_no_block_resizing) {
-            stream_block_size = sirius::utils::GenerateDyadicSize(
-                  stream_block_size, zoom_ratio.input_resolution(),
-                  filter.padding_size());
-            LOG("sirius", warn, "stream block resized to dyadic size: {}x{}",
-                stream_block_size.row, stream_block_size.col);
+    // memory budget is requested or derived from the memory limit
+    bool is_memory_budget_requested = !params.stream_max_memory.empty();
+    std::size_t max_memory = 0;
+    if (is_memory_budget_requested) {
+        max_memory = sirius::utils::ParseMemorySize(params.stream_max_memory);
+    } else if (params.system_resources.memory_limit > 0) {
+        max_memory = static_cast<std::size_t>(
+              params.system_resources.memory_limit * kDefaultMemoryBudgetRatio);
+    }
+    sirius::Size image_size(0, 0);
+    int input_pixel_size = sizeof(double);
+    int band_count = 1;
+    if (max_memory > 0) {
+        auto input_dataset = sirius::gdal::LoadDataset(entry.input_path);
+        image_size = {input_dataset->GetRasterYSize(),
+                      input_dataset->GetRasterXSize()};
+        input_pixel_size = GDALGetDataTypeSizeBytes(
+              input_dataset->GetRasterBand(1)->GetRasterDataType());
+        band_count = input_dataset->GetRasterCount();
+    }
+    sirius::utils::StreamMemoryModel memory_model(
+          image_size, zoom_ratio, filter.padding_size(), filter.IsLoaded(),
+          params.stream_pad_edge_blocks,
+          GDALGetDataTypeSizeBytes(params.output_options.data_type),
+          input_pixel_size, band_count);
+
+    // shards and windows select blocks of the grid: the block size must not
+    //   depend on the resources of the host, which may differ between the
+    //   hosts computing the shards of an image
+    bool is_block_size_fixed = params.HasBlockSelection();
+
+    // memory budget drives block size (unless fixed), workers and pending
+    //   blocks
+    auto tune_stream_parameters = [&]() {
+        unsigned int max_workers =
+              params.stream_parallel_workers_set ? max_parallel_workers
+                                                 : cpu_count;
+        sirius::utils::StreamParameters stream_parameters;
+        if (is_block_size_fixed) {
+            stream_parameters = sirius::utils::TuneStreamWorkers(
+                  memory_model, max_memory, max_workers, stream_block_size);
+        } else {
+            sirius::Size alignment(1, 1);
+            if (!params.stream_no_block_resizing) {
+                alignment =
+                      sirius::gdal::GetNativeBlockSize(entry.input_path);
+            }
+            stream_parameters = sirius::utils::TuneStreamParameters(
+                  memory_model, max_memory, max_workers, alignment,
+                  !params.stream_no_block_resizing);
         }
-    } else {
+        stream_block_size = stream_parameters.block_size;
+        max_parallel_workers = stream_parameters.parallel_workers;
+        max_pending_blocks = stream_parameters.max_pending_blocks;
+        LOG("sirius", info,
+            "memory budget {:.1f} MB: block {}x{}, {} parallel workers, {} "
+            "pending blocks (predicted peak memory: {:.1f} MB)",
+            max_memory / (1024. * 1024.), stream_block_size.row,
+            stream_block_size.col, max_parallel_workers, max_pending_blocks,
+            stream_parameters.peak_memory / (1024. * 1024.));
+    };
+
+    // improve stream_block_size if requested or required
+    if (is_memory_budget_requested && !is_block_size_fixed) {
+        tune_stream_parameters();
+    } else if (!params.stream_no_block_resizing) {
+        // align blocks on input tiles so that tiles are decoded once
+        auto native_block_size =
+              sirius::gdal::GetNativeBlockSize(entry.input_path);
+        stream_block_size = sirius::utils::GenerateFFTFriendlySize(
+              stream_block_size, zoom_ratio, filter.padding_size(),
+              native_block_size);
+        LOG("sirius", warn, "stream block resized to FFT friendly size: {}x{}",
+            stream_block_size.row, stream_block_size.col);
+    } else if (zoom_ratio.IsRealZoom()) {
         // real zoom needs specific block size (row and col should be multiple
         // of input resolution and output resolution)
         stream_block_size = sirius::utils::GenerateZoomCompliantSize(
@@ -236,10 +655,195 @@ void RunStreamMode(const sirius::IFrequencyResampler& frequency_resampler,
         LOG("sirius", warn, "stream block resized to comply with zoom: {}x{}",
             stream_block_size.row, stream_block_size.col);
     }
+
+    if (is_memory_budget_requested && is_block_size_fixed) {
+        tune_stream_parameters();
+    } else if (!is_memory_budget_requested && max_memory > 0) {
+        auto peak_memory = memory_model.PeakMemory(
+              stream_block_size, max_parallel_workers, max_pending_blocks);
+        if (peak_memory > max_memory) {
+            LOG("sirius", warn,
+                "predicted peak memory ({:.1f} MB) exceeds {:.0f}% of the "
+                "memory limit, stream parameters are tuned to fit",
+                peak_memory / (1024. * 1024.),
+                100. * kDefaultMemoryBudgetRatio);
+            tune_stream_parameters();
+        }
+    }
+    auto block_range =
+          ComputeStreamBlockRange(params, entry.input_path, stream_block_size,
+                                  filter.Metadata(), zoom_ratio);
+    sirius::gdal::CheckpointOptions checkpoint_options;
+    if (params.stream_checkpoint) {
+        checkpoint_options.journal_path = entry.output_path + ".journal";
+        checkpoint_options.interval =
+              std::chrono::seconds(params.stream_checkpoint_interval);
+        checkpoint_options.resampling_description = resampling_description;
+    }
+
     sirius::ImageStreamer streamer(
-          params.input_image_path, params.output_image_path, stream_block_size,
-          zoom_ratio, filter.Metadata(), max_parallel_workers);
+          entry.input_path, entry.output_path, stream_block_size,
+          zoom_ratio, filter.Metadata(), max_parallel_workers,
+          params.stream_pad_edge_blocks, max_pending_blocks,
+          params.output_options, block_range, checkpoint_options);
+    if (params.metrics_interval > 0) {
+        streamer.SetMetricsCallback(
+              LogMetrics, std::chrono::seconds(params.metrics_interval));
+    }
     streamer.Stream(frequency_resampler, filter);
+    return streamer.Metrics();
+}
+
+std::string DescribeResampling(
+      const CliParameters& params,
+      sirius::ImageDecompositionPolicies image_decomposition_policy,
+      sirius::FrequencyZoomStrategies zoom_strategy) {
+    std::ostringstream description;
+    description << "decomposition="
+                << static_cast<int>(image_decomposition_policy)
+                << " strategy=" << static_cast<int>(zoom_strategy);
+    if (params.filter_path.empty()) {
+        description << " filter=none";
+        return description.str();
+    }
+    // filter file is identified by its path, size and modification time
+    description << " filter=" << params.filter_path;
+    ::VSIStatBufL filter_stat;
+    if (::VSIStatL(params.filter_path.c_str(), &filter_stat) == 0) {
+        description << " filter_size=" << filter_stat.st_size
+                    << " filter_mtime=" << filter_stat.st_mtime;
+    }
+    description << " hot_point=" << params.hot_point_x << ","
+                << params.hot_point_y
+                << " normalize=" << params.filter_normalize;
+    return description.str();
+}
+
+void LogMetrics(const sirius::utils::PipelineMetricsSnapshot& metrics) {
+    using sirius::utils::PipelineStage;
+    LOG("sirius", info,
+        "{:.1f} s: {} blocks written ({:.1f} blocks/s, read {:.1f} MB/s, "
+        "write {:.1f} MB/s), {:.1f} computing and {:.1f} waiting blocks on "
+        "average, read p90 {:.2f} ms, write p90 {:.2f} ms",
+        metrics.elapsed_s, metrics.written_block_count,
+        metrics.BlocksPerSecond(), metrics.ReadMBPerSecond(),
+        metrics.WriteMBPerSecond(), metrics.input_occupancy.mean_blocks,
+        metrics.output_occupancy.mean_blocks,
+        metrics.Stage(PipelineStage::kRead).PercentileMs(90.),
+        metrics.Stage(PipelineStage::kWrite).PercentileMs(90.));
+}
+
+sirius::gdal::ImageWindow ComputeStreamBlockRange(
+      const CliParameters& params, const std::string& input_path,
+      const sirius::Size& block_size,
+      const sirius::FilterMetadata& filter_metadata,
+      const sirius::ZoomRatio& zoom_ratio) {
+    if (!params.HasBlockSelection()) {
+        return {};
+    }
+
+    auto input_dataset = sirius::gdal::LoadDataset(input_path);
+    sirius::Size image_size(input_dataset->GetRasterYSize(),
+                            input_dataset->GetRasterXSize());
+    sirius::gdal::BlockGrid block_grid(
+          image_size, block_size, filter_metadata.margin_size,
+          filter_metadata.padding_type, params.stream_pad_edge_blocks);
+    auto grid_size = block_grid.GridSize();
+    if (params.shard_count > 0) {
+        auto block_range = block_grid.ComputeShardRange(
+              params.shard_index - 1, params.shard_count);
+        LOG("sirius", info, "shard {}/{}: block rows {} to {} of {}",
+            params.shard_index, params.shard_count, block_range.row,
+            block_range.row + block_range.size.row - 1, grid_size.row);
+        return block_range;
+    }
+
+    // output pixels of the window are computed from these input pixels
+    const auto& output_window = params.output_window;
+    auto output_size = image_size * zoom_ratio.ratio();
+    if (output_window.row < 0 || output_window.col < 0 ||
+        output_window.row + output_window.size.row > output_size.row ||
+        output_window.col + output_window.size.col > output_size.col) {
+        throw sirius::Exception("window is outside the resampled image");
+    }
+    int input_resolution = zoom_ratio.input_resolution();
+    int output_resolution = zoom_ratio.output_resolution();
+    auto to_input = [input_resolution, output_resolution](int position) {
+        return static_cast<int>(static_cast<long long>(position) *
+                                output_resolution / input_resolution);
+    };
+    int end_row = std::min(
+          to_input(output_window.row + output_window.size.row - 1) + 1,
+          image_size.row);
+    int end_col = std::min(
+          to_input(output_window.col + output_window.size.col - 1) + 1,
+          image_size.col);
+    sirius::gdal::ImageWindow input_window;
+    input_window.row = to_input(output_window.row);
+    input_window.col = to_input(output_window.col);
+    input_window.size = {end_row - input_window.row,
+                         end_col - input_window.col};
+    auto block_range = block_grid.ComputeCoveringRange(input_window);
+    LOG("sirius", info,
+        "window {}x{} at ({},{}): {}x{} blocks from block ({},{}) of {}x{}",
+        output_window.size.row, output_window.size.col, output_window.row,
+        output_window.col, block_range.size.row, block_range.size.col,
+        block_range.row, block_range.col, grid_size.row, grid_size.col);
+    return block_range;
+}
+
+int RunAssembleShards(const CliParameters& params) {
+    sirius::utils::SetVerbosityLevel(params.verbosity_level);
+
+    // shards are all the positional arguments
+    std::vector<std::string> shard_paths;
+    for (const auto& path :
+         {params.input_image_path, params.output_image_path}) {
+        if (!path.empty()) {
+            shard_paths.push_back(path);
+        }
+    }
+    shard_paths.insert(shard_paths.end(), params.shard_paths.begin(),
+                       params.shard_paths.end());
+    if (shard_paths.empty()) {
+        std::cerr << "sirius: no shard to assemble" << std::endl;
+        return 1;
+    }
+
+    try {
+        sirius::gdal::AssembleShards(shard_paths, params.assembled_image_path,
+                                     params.output_options);
+    } catch (const std::exception& e) {
+        std::cerr << "sirius: exception while assembling shards: " << e.what()
+                  << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+void HandleImageError(const sirius::utils::BatchEntry& entry,
+                      const std::exception& e, std::size_t image_count,
+                      std::size_t& failed_image_count) {
+    if (image_count == 1) {
+        throw;
+    }
+    // a failed image does not stop the batch
+    ++failed_image_count;
+    LOG("sirius", error, "cannot resample image '{}' into '{}': {}",
+        entry.input_path, entry.output_path, e.what());
+}
+
+void CheckBatchErrors(std::size_t image_count,
+                      std::size_t failed_image_count) {
+    if (image_count > 1) {
+        LOG("sirius", info, "batch: {} images resampled, {} failed",
+            image_count - failed_image_count, failed_image_count);
+    }
+    if (failed_image_count > 0) {
+        throw sirius::Exception(std::to_string(failed_image_count) + " of " +
+                                std::to_string(image_count) +
+                                " images could not be resampled");
+    }
 }
 
 CliParameters GetCliParameters(int argc, const char* argv[]) {
@@ -253,19 +857,35 @@ CliParameters GetCliParameters(int argc, const char* argv[]) {
     cxxopts::Options options(argv[0], description.str());
     options.positional_help("input-image output-image").show_positional_help();
 
+    params.system_resources = sirius::utils::DetectSystemResources();
     auto max_threads_string =
-          std::to_string(std::thread::hardware_concurrency());
+          std::to_string(params.system_resources.cpu_count);
     std::stringstream stream_parallel_workers_desc;
     stream_parallel_workers_desc
           << "Parallel workers used to compute resampling ("
-          << max_threads_string << " max)";
+          << max_threads_string
+          << " max, 0: all the available CPUs)";
 
     // clang-format off
     options.add_options("")
         ("h,help", "Show help")
         ("v,verbosity",
          "Set verbosity level (trace,debug,info,warn,err,critical,off)",
-         cxxopts::value(params.verbosity_level)->default_value("info"));
+         cxxopts::value(params.verbosity_level)->default_value("info"))
+        ("cpus",
+         "Number of CPUs available to Sirius "
+         "(default: host CPUs limited by the cgroup CPU quota and cpuset)",
+         cxxopts::value(params.cpu_count))
+        ("memory-limit",
+         "Memory limit (ex: 8G) used to derive the default memory budget of "
+         "stream mode (default: cgroup memory limit)",
+         cxxopts::value(params.memory_limit))
+        ("batch",
+         "Manifest of the images to resample with the same parameters, one "
+         "input and output pair per line. Filter, FFT plans and threads are "
+         "shared and, in regular mode, the next input is loaded while the "
+         "current image is resampled",
+         cxxopts::value(params.batch_manifest_path));
 
     options.add_options("resampling")
         ("r,resampling-ratio", "Resampling ratio as input:output, "
@@ -316,20 +936,120 @@ CliParameters GetCliParameters(int argc, const char* argv[]) {
         ("no-block-resizing",
          "Disable block resizing optimization",
          cxxopts::value(params.stream_no_block_resizing))
+        ("pad-edge-blocks",
+         "Pad edge blocks to the stream block size so that all blocks share "
+         "the same FFT plans and filter spectrum",
+         cxxopts::value(params.stream_pad_edge_blocks))
         ("parallel-workers", stream_parallel_workers_desc.str(),
          cxxopts::value(params.stream_parallel_workers)
-            ->default_value("1")
-            ->implicit_value("1"));
+            ->default_value("0")
+            ->implicit_value("0"))
+        ("max-memory",
+         "Memory budget of stream mode (ex: 512M, 4G). Block size, parallel "
+         "workers (up to --parallel-workers if set) and pending blocks are "
+         "selected to fit in this budget",
+         cxxopts::value(params.stream_max_memory))
+        ("checkpoint",
+         "Journal the written blocks in OUTPUT.journal. A stopped job run "
+         "again with the same parameters resumes from its last checkpoint",
+         cxxopts::value(params.stream_checkpoint))
+        ("checkpoint-interval",
+         "Minimal time between two checkpoints in seconds",
+         cxxopts::value(params.stream_checkpoint_interval)
+            ->default_value("30"))
+        ("metrics-report",
+         "Write the stage latencies, throughputs, queue occupancy and cache "
+         "hits of the stream in a JSON report",
+         cxxopts::value(params.metrics_report_path))
+        ("metrics-interval",
+         "Log live stream metrics every N seconds (0: disabled)",
+         cxxopts::value(params.metrics_interval)->default_value("0"));
+#ifdef SIRIUS_ENABLE_TRACING
+    options.add_options("streaming")
+        ("trace",
+         "Write the begin and end events of the block stages of each thread "
+         "in a Chrome trace JSON file",
+         cxxopts::value(params.trace_path));
+#endif  // SIRIUS_ENABLE_TRACING
+
+    options.add_options("sharding")
+        ("shard",
+         "Resample only the i-th of N shards (i/N, 1 <= i <= N) of the "
+         "block rows in stream mode. The output image only covers the shard",
+         cxxopts::value(params.shard))
+        ("window",
+         "Resample only the stream blocks covering a window of the resampled "
+         "image (row,col,height,width in output pixels)",
+         cxxopts::value(params.window))
+        ("assemble-shards",
+         "Assemble the shards given as positional arguments into this image "
+         "(a VRT if its extension is .vrt)",
+         cxxopts::value(params.assembled_image_path));
+
+    options.add_options("output")
+        ("output-format",
+         "Output format (GTiff, ENVI). ENVI outputs are raw files written "
+         "concurrently by the stream workers",
+         cxxopts::value(params.output_format)->default_value("GTiff"))
+        ("output-type",
+         "Output data type (UInt8, UInt16, Int16, Float32, Float64). Integer "
+         "outputs are rounded and all outputs are saturated to the type range",
+         cxxopts::value(params.output_type)->default_value("Float32"))
+        ("scale",
+         "Scale applied to the resampled pixels before conversion to the "
+         "output data type",
+         cxxopts::value(params.output_options.scale)->default_value("1"))
+        ("offset",
+         "Offset added to the scaled pixels before conversion to the output "
+         "data type",
+         cxxopts::value(params.output_options.offset)->default_value("0"))
+        ("tiled",
+         "Write a tiled GeoTIFF (default: strips)",
+         cxxopts::value(params.output_options.tiled))
+        ("tile-width",
+         "Width of an output tile, multiple of 16 "
+         "(default: output block width in stream mode, 256 otherwise)",
+         cxxopts::value(params.output_options.tile_size.col))
+        ("tile-height",
+         "Height of an output tile, multiple of 16 "
+         "(default: output block height in stream mode, 256 otherwise)",
+         cxxopts::value(params.output_options.tile_size.row))
+        ("compress",
+         "Compression codec (LZW, DEFLATE, ZSTD, LZMA, ...) "
+         "(default: no compression)",
+         cxxopts::value(params.output_options.compression))
+        ("compress-level",
+         "Compression level of DEFLATE, ZSTD or LZMA "
+         "(default: codec default)",
+         cxxopts::value(params.output_options.compression_level))
+        ("predictor",
+         "Compression predictor (1: none, 2: horizontal, 3: floating point)",
+         cxxopts::value(params.output_options.predictor))
+        ("bigtiff",
+         "Write a BigTIFF file (YES, NO, IF_NEEDED, IF_SAFER) "
+         "(default: IF_SAFER if compressed, IF_NEEDED otherwise)",
+         cxxopts::value(params.output_options.bigtiff))
+        ("compress-threads",
+         "Threads compressing the output blocks "
+         "(default: all the available CPUs)",
+         cxxopts::value(params.output_options.compression_threads))
+        ("gdal-cache-max",
+         "Size of the GDAL block cache (ex: 256M) "
+         "(default: GDAL_CACHEMAX)",
+         cxxopts::value(params.gdal_cache_max));
 
     options.add_options("positional arguments")
         ("i,input", "Input image", cxxopts::value(params.input_image_path))
-        ("o,output", "Output image", cxxopts::value(params.output_image_path));
+        ("o,output", "Output image", cxxopts::value(params.output_image_path))
+        ("shard-paths", "Other shards to assemble",
+         cxxopts::value(params.shard_paths));
     // clang-format on
 
-    options.parse_positional({"input", "output"});
+    options.parse_positional({"input", "output", "shard-paths"});
 
     params.help_message =
-          options.help({"", "resampling", "filter", "streaming"});
+          options.help({"", "resampling", "filter", "streaming", "sharding",
+                        "output"});
 
     try {
         auto result = options.parse(argc, argv);
@@ -338,9 +1058,61 @@ CliParameters GetCliParameters(int argc, const char* argv[]) {
             params.help_requested = true;
             return params;
         }
+        params.stream_parallel_workers_set =
+              result.count("parallel-workers") > 0;
+        if (params.cpu_count > 0) {
+            params.system_resources.cpu_count = params.cpu_count;
+        }
+        if (!params.memory_limit.empty()) {
+            params.system_resources.memory_limit =
+                  sirius::utils::ParseMemorySize(params.memory_limit);
+        }
+
+        params.output_options.format =
+              sirius::gdal::ParseOutputFormat(params.output_format);
+        params.output_options.data_type =
+              sirius::gdal::ParseOutputDataType(params.output_type);
+        // a missing tile dimension takes the value of the other one
+        auto& tile_size = params.output_options.tile_size;
+        if (tile_size.row <= 0) {
+            tile_size.row = tile_size.col;
+        } else if (tile_size.col <= 0) {
+            tile_size.col = tile_size.row;
+        }
+        if (params.output_options.compression_threads == 0) {
+            params.output_options.compression_threads =
+                  params.system_resources.cpu_count;
+        }
+        if (!params.shard.empty()) {
+            char trailing_char = 0;
+            if (std::sscanf(params.shard.c_str(), "%d/%d%c",
+                            &params.shard_index, &params.shard_count,
+                            &trailing_char) != 2 ||
+                params.shard_count <= 0 || params.shard_index <= 0 ||
+                params.shard_index > params.shard_count) {
+                throw std::invalid_argument("invalid shard '" + params.shard +
+                                            "'");
+            }
+        }
+        if (!params.window.empty()) {
+            auto& window = params.output_window;
+            char trailing_char = 0;
+            if (std::sscanf(params.window.c_str(), "%d,%d,%d,%d%c",
+                            &window.row, &window.col, &window.size.row,
+                            &window.size.col, &trailing_char) != 4 ||
+                window.IsEmpty()) {
+                throw std::invalid_argument("invalid window '" +
+                                            params.window + "'");
+            }
+        }
+        if (!params.gdal_cache_max.empty()) {
+            params.gdal_cache_max_size =
+                  sirius::utils::ParseMemorySize(params.gdal_cache_max);
+        }
     } catch (const std::exception& e) {
         std::cerr << "sirius: cannot parse command line: " << e.what()
                   << std::endl;
+        params.parsed = false;
         return params;
     }
 
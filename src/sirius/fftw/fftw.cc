@@ -86,6 +86,14 @@ PlanSPtr Fftw::GetComplexToRealPlan(const Size& size, fftw_complex* in,
     return c2r_plan;
 }
 
+utils::CacheStatistics Fftw::PlanCacheStatistics() const {
+    auto statistics = r2c_plans_.Statistics();
+    auto c2r_statistics = c2r_plans_.Statistics();
+    statistics.hit_count += c2r_statistics.hit_count;
+    statistics.miss_count += c2r_statistics.miss_count;
+    return statistics;
+}
+
 PlanSPtr Fftw::CreateC2RPlan(const Size& size, fftw_complex* in, double* out) {
     std::lock_guard<std::mutex> lock(plan_mutex_);
     PlanSPtr c2r_plan(
@@ -83,6 +83,12 @@ class Fftw {
     PlanSPtr GetComplexToRealPlan(const Size& size, fftw_complex* in,
                                   double* out);
 
+    /**
+     * \brief Get the hits and misses of the r2c and c2r plan caches
+     * \return cache statistics
+     */
+    utils::CacheStatistics PlanCacheStatistics() const;
+
   private:
     Fftw() = default;
 
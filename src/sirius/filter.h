@@ -144,6 +144,17 @@ class Filter {
     fftw::ComplexUPtr Process(const Size& image_size,
                               fftw::ComplexUPtr image_fft) const;
 
+    /**
+     * \brief Get the hits and misses of the filter FFT cache
+     * \return cache statistics, empty if the filter is not loaded
+     */
+    utils::CacheStatistics FFTCacheStatistics() const {
+        if (filter_fft_cache_ == nullptr) {
+            return {};
+        }
+        return filter_fft_cache_->Statistics();
+    }
+
   private:
     static Filter CreateZoomInFilter(Image filter_image,
                                      const ZoomRatio& zoom_ratio,
@@ -0,0 +1,269 @@
+/**
+ * Copyright (C) 2018 CS - Systemes d'Information (CS-SI)
+ *
+ * This file is part of Sirius
+ *
+ *     https://github.com/CS-SI/SIRIUS
+ *
+ * Sirius is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sirius is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Sirius.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "sirius/gdal/block_grid.h"
+
+#include <algorithm>
+#include <string>
+
+#include "sirius/exception.h"
+
+#include "sirius/gdal/error_code.h"
+
+#include "sirius/utils/log.h"
+
+namespace sirius {
+namespace gdal {
+
+BlockGrid::BlockGrid(const sirius::Size& image_size,
+                     const sirius::Size& block_size,
+                     const sirius::Size& block_margin_size,
+                     PaddingType block_padding_type, bool pad_edge_blocks)
+    : image_size_(image_size),
+      block_size_(block_size),
+      block_margin_size_(block_margin_size),
+      block_padding_type_(block_padding_type),
+      pad_edge_blocks_(pad_edge_blocks) {
+    if (block_size_.row <= 0 || block_size_.col <= 0) {
+        LOG("input_stream", error, "invalid block size");
+        throw sirius::Exception("invalid block size");
+    }
+
+    grid_size_.row = ComputeAxisBlockCount(image_size_.row, block_size_.row,
+                                           block_margin_size_.row);
+    grid_size_.col = ComputeAxisBlockCount(image_size_.col, block_size_.col,
+                                           block_margin_size_.col);
+}
+
+int BlockGrid::ComputeAxisPosition(int i, int block_size, int margin_size) {
+    // first block starts on the image edge (its margin is padding), next
+    //   blocks start margin_size pixels before the area they cover
+    if (i == 0) {
+        return 0;
+    }
+    return block_size - margin_size + (i - 1) * block_size;
+}
+
+int BlockGrid::ComputeAxisBlockCount(int image_size, int block_size,
+                                     int margin_size) {
+    // last block is the first one which covers the end of the image
+    int count = 1;
+    while (ComputeAxisPosition(count - 1, block_size, margin_size) <
+           image_size - block_size - margin_size) {
+        ++count;
+    }
+    return count;
+}
+
+BlockGeometry BlockGrid::GetBlockGeometry(int block_index,
+                                          std::error_code& ec) const {
+    if (block_index < 0 || block_index >= BlockCount()) {
+        LOG("input_stream", error, "block index {} is out of range [0, {})",
+            block_index, BlockCount());
+        ec = make_error_code(CPLE_ObjectNull);
+        return {};
+    }
+
+    int w = image_size_.col;
+    int h = image_size_.row;
+    int row_idx = ComputeAxisPosition(block_index / grid_size_.col,
+                                      block_size_.row, block_margin_size_.row);
+    int col_idx = ComputeAxisPosition(block_index % grid_size_.col,
+                                      block_size_.col, block_margin_size_.col);
+    int padded_block_w = block_size_.col + 2 * block_margin_size_.col;
+    int padded_block_h = block_size_.row + 2 * block_margin_size_.row;
+
+    if (padded_block_w > w || padded_block_h > h) {
+        LOG("input_stream", critical,
+            "requested block size ({}x{}) is bigger than source image ({}x{}). "
+            "You should use regular processing",
+            padded_block_w, padded_block_h, w, h);
+        ec = make_error_code(CPLE_ObjectNull);
+        return {};
+    }
+
+    // resize block if needed
+    if (row_idx + padded_block_h > h) {
+        // assign size that can be read
+        padded_block_h -= (row_idx + padded_block_h - h);
+
+        if (padded_block_h < block_margin_size_.row) {
+            LOG("input_stream", error,
+                "block at coordinates ({}, {}) cannot be read because "
+                "available reading height {} is less than margin size {}",
+                row_idx, col_idx, padded_block_h, block_margin_size_.row);
+            ec = make_error_code(CPLE_ObjectNull);
+            return {};
+        }
+
+        if (padded_block_h > block_margin_size_.row + block_size_.row) {
+            // bottom margin is partly read. add missing margin
+            padded_block_h +=
+                  (row_idx + block_size_.row + 2 * block_margin_size_.row - h);
+        } else {
+            padded_block_h += block_margin_size_.row;
+        }
+    }
+    if (col_idx + padded_block_w > w) {
+        padded_block_w -= (col_idx + padded_block_w - w);
+
+        if (padded_block_w < block_margin_size_.col) {
+            LOG("input_stream", error,
+                "block at coordinates {}, {}, cannot be read because available "
+                "reading width {} is less than margin size {}",
+                row_idx, col_idx, padded_block_w, block_margin_size_.col);
+            ec = make_error_code(CPLE_ObjectNull);
+            return {};
+        }
+
+        if (padded_block_w > block_size_.col + block_margin_size_.col) {
+            padded_block_w +=
+                  (col_idx + block_size_.col + 2 * block_margin_size_.col - w);
+        } else {
+            padded_block_w += block_margin_size_.col;
+        }
+    }
+
+    BlockGeometry geometry;
+    geometry.padding.type = block_padding_type_;
+    int w_to_read = padded_block_w;
+    int h_to_read = padded_block_h;
+    // top padding needed
+    if (row_idx == 0) {
+        geometry.padding.top = block_margin_size_.row;
+        h_to_read -= block_margin_size_.row;
+    }
+
+    // bottom padding needed
+    bool is_bottom_block =
+          (row_idx >= (h - block_size_.row - 2 * block_margin_size_.row));
+    if (is_bottom_block) {
+        geometry.padding.bottom = block_margin_size_.row;
+        h_to_read -= (row_idx + padded_block_h - h);
+    }
+
+    // left padding needed
+    if (col_idx == 0) {
+        geometry.padding.left = block_margin_size_.col;
+        w_to_read -= block_margin_size_.col;
+    }
+
+    // right padding needed
+    bool is_right_block =
+          (col_idx >= (w - block_size_.col - 2 * block_margin_size_.col));
+    if (is_right_block) {
+        geometry.padding.right = block_margin_size_.col;
+        w_to_read -= (col_idx + padded_block_w - w);
+    }
+
+    if (pad_edge_blocks_) {
+        // extend bottom and right padding so that edge blocks share the
+        // nominal padded size (and so FFT plans and filter FFT caches).
+        // Extra rows and cols are removed by the resampler with the padding.
+        int missing_rows =
+              block_size_.row + 2 * block_margin_size_.row -
+              (h_to_read + geometry.padding.top + geometry.padding.bottom);
+        int missing_cols =
+              block_size_.col + 2 * block_margin_size_.col -
+              (w_to_read + geometry.padding.left + geometry.padding.right);
+        if (is_bottom_block && missing_rows > 0) {
+            geometry.padding.bottom += missing_rows;
+        }
+        if (is_right_block && missing_cols > 0) {
+            geometry.padding.right += missing_cols;
+        }
+    }
+
+    geometry.read_row_idx = row_idx;
+    geometry.read_col_idx = col_idx;
+    geometry.read_size = {h_to_read, w_to_read};
+    geometry.row_idx = (row_idx == 0) ? 0 : row_idx + block_margin_size_.row;
+    geometry.col_idx = (col_idx == 0) ? 0 : col_idx + block_margin_size_.col;
+
+    ec = make_error_code(CPLE_None);
+    return geometry;
+}
+
+ImageWindow BlockGrid::ComputeShardRange(int shard_index,
+                                         int shard_count) const {
+    if (shard_count <= 0 || shard_index < 0 || shard_index >= shard_count) {
+        throw sirius::Exception("invalid shard " + std::to_string(shard_index) +
+                                "/" + std::to_string(shard_count));
+    }
+    int first_row = grid_size_.row * shard_index / shard_count;
+    int last_row = grid_size_.row * (shard_index + 1) / shard_count;
+    if (first_row == last_row) {
+        throw sirius::Exception(
+              "shard " + std::to_string(shard_index) + "/" +
+              std::to_string(shard_count) + " has no block row (" +
+              std::to_string(grid_size_.row) + " block rows)");
+    }
+    ImageWindow range;
+    range.row = first_row;
+    range.col = 0;
+    range.size = {last_row - first_row, grid_size_.col};
+    return range;
+}
+
+ImageWindow BlockGrid::ComputeCoveringRange(const ImageWindow& window) const {
+    if (window.IsEmpty() || window.row < 0 || window.col < 0 ||
+        window.row + window.size.row > image_size_.row ||
+        window.col + window.size.col > image_size_.col) {
+        throw sirius::Exception("window is outside the image");
+    }
+    // content of the i-th block starts at i * block_size, the last block
+    //   covers the end of the image
+    int window_last_row = window.row + window.size.row - 1;
+    int window_last_col = window.col + window.size.col - 1;
+    int first_row = std::min(window.row / block_size_.row, grid_size_.row - 1);
+    int last_row =
+          std::min(window_last_row / block_size_.row, grid_size_.row - 1);
+    int first_col = std::min(window.col / block_size_.col, grid_size_.col - 1);
+    int last_col =
+          std::min(window_last_col / block_size_.col, grid_size_.col - 1);
+    ImageWindow range;
+    range.row = first_row;
+    range.col = first_col;
+    range.size = {last_row - first_row + 1, last_col - first_col + 1};
+    return range;
+}
+
+ImageWindow BlockGrid::ComputeRangeArea(const ImageWindow& block_range) const {
+    if (block_range.IsEmpty()) {
+        ImageWindow area;
+        area.size = image_size_;
+        return area;
+    }
+    int last_row = block_range.row + block_range.size.row;
+    int last_col = block_range.col + block_range.size.col;
+    int end_row = (last_row >= grid_size_.row) ? image_size_.row
+                                               : last_row * block_size_.row;
+    int end_col = (last_col >= grid_size_.col) ? image_size_.col
+                                               : last_col * block_size_.col;
+    ImageWindow area;
+    area.row = block_range.row * block_size_.row;
+    area.col = block_range.col * block_size_.col;
+    area.size = {end_row - area.row, end_col - area.col};
+    return area;
+}
+
+}  // namespace gdal
+}  // namespace sirius
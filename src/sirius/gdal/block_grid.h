@@ -0,0 +1,169 @@
+/**
+ * Copyright (C) 2018 CS - Systemes d'Information (CS-SI)
+ *
+ * This file is part of Sirius
+ *
+ *     https://github.com/CS-SI/SIRIUS
+ *
+ * Sirius is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sirius is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Sirius.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SIRIUS_GDAL_BLOCK_GRID_H_
+#define SIRIUS_GDAL_BLOCK_GRID_H_
+
+#include <system_error>
+
+#include "sirius/image.h"
+#include "sirius/types.h"
+
+namespace sirius {
+namespace gdal {
+
+/**
+ * \brief Geometry of a stream block in the input image
+ */
+struct BlockGeometry {
+    /// top left corner of the region to read
+    int read_row_idx = 0;
+    int read_col_idx = 0;
+    /// size of the region to read
+    sirius::Size read_size;
+    /// position of the block in the input image (see StreamBlock)
+    int row_idx = 0;
+    int col_idx = 0;
+    /// padding to apply on the read region
+    Padding padding;
+};
+
+/**
+ * \brief Rectangular window of an image or of a block grid
+ */
+struct ImageWindow {
+    /// top left corner of the window
+    int row = 0;
+    int col = 0;
+    /// window size, an empty window stands for the whole image or grid
+    sirius::Size size;
+
+    bool IsEmpty() const { return size.row <= 0 || size.col <= 0; }
+};
+
+/**
+ * \brief Split an image into overlapping stream blocks
+ *
+ * Blocks are indexed in row major order. Each block covers block_size pixels
+ *   of the image plus block_margin_size pixels on each side, either read from
+ *   the image or generated by padding on the image edges.
+ *
+ * The geometry of a block only depends on its index so that blocks can be
+ *   read in any order or concurrently.
+ *
+ * A range of blocks (window of the grid) can be streamed alone: blocks keep
+ *   the margins read from the image around the range, so that images
+ *   resampled by range can be assembled without seams.
+ */
+class BlockGrid {
+  public:
+    /**
+     * \brief Instanciate a block grid
+     * \param image_size input image size
+     * \param block_size blocks size
+     * \param block_margin_size block margin size
+     * \param block_padding_type block padding type
+     * \param pad_edge_blocks pad bottom and right edge blocks so that every
+     *        padded block has the nominal size (block + 2 * margins)
+     */
+    BlockGrid(const sirius::Size& image_size, const sirius::Size& block_size,
+              const sirius::Size& block_margin_size,
+              PaddingType block_padding_type, bool pad_edge_blocks = false);
+
+    /**
+     * \brief Size of the blocks (without margins)
+     * \return block size
+     */
+    sirius::Size BlockSize() const { return block_size_; }
+
+    /**
+     * \brief Number of blocks in each direction
+     * \return grid size
+     */
+    sirius::Size GridSize() const { return grid_size_; }
+
+    /**
+     * \brief Number of blocks
+     * \return block count
+     */
+    int BlockCount() const { return grid_size_.CellCount(); }
+
+    /**
+     * \brief Compute the geometry of a block
+     * \param block_index index of the block in row major order
+     * \param ec error code if the block cannot be read
+     * \return block geometry
+     */
+    BlockGeometry GetBlockGeometry(int block_index, std::error_code& ec) const;
+
+    /**
+     * \brief Range of contiguous block rows of a shard
+     *
+     * Block rows are evenly split between the shards
+     *
+     * \param shard_index shard index in [0, shard_count)
+     * \param shard_count number of shards
+     * \return block range of the shard
+     * \throw sirius::Exception if the shard is invalid or has no block row
+     */
+    ImageWindow ComputeShardRange(int shard_index, int shard_count) const;
+
+    /**
+     * \brief Range of the blocks which cover an image window
+     * \param window window of the image
+     * \return block range
+     * \throw sirius::Exception if the window is outside the image
+     */
+    ImageWindow ComputeCoveringRange(const ImageWindow& window) const;
+
+    /**
+     * \brief Image area covered by a range of blocks (margins excluded)
+     * \param block_range block range, the whole grid if empty
+     * \return image window
+     */
+    ImageWindow ComputeRangeArea(const ImageWindow& block_range) const;
+
+  private:
+    /**
+     * \brief Index of the first image pixel read by the i-th block of an
+     *   axis (margin included)
+     */
+    static int ComputeAxisPosition(int i, int block_size, int margin_size);
+
+    /**
+     * \brief Number of blocks along an axis
+     */
+    static int ComputeAxisBlockCount(int image_size, int block_size,
+                                     int margin_size);
+
+  private:
+    sirius::Size image_size_;
+    sirius::Size block_size_;
+    sirius::Size block_margin_size_;
+    PaddingType block_padding_type_;
+    bool pad_edge_blocks_;
+    sirius::Size grid_size_;
+};
+
+}  // namespace gdal
+}  // namespace sirius
+
+#endif  // SIRIUS_GDAL_BLOCK_GRID_H_
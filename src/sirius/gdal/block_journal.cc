@@ -0,0 +1,214 @@
+/**
+ * Copyright (C) 2018 CS - Systemes d'Information (CS-SI)
+ *
+ * This file is part of Sirius
+ *
+ *     https://github.com/CS-SI/SIRIUS
+ *
+ * Sirius is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sirius is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Sirius.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "sirius/gdal/block_journal.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif  // _WIN32
+
+#include "sirius/exception.h"
+
+#include "sirius/utils/log.h"
+
+namespace sirius {
+namespace gdal {
+
+namespace {
+
+constexpr char kJournalHeader[] = "SIRIUS_BLOCK_JOURNAL 1";
+
+std::chrono::steady_clock::rep Now() {
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+}
+
+}  // namespace
+
+BlockJournal::BlockJournal(const std::string& path,
+                           const std::string& job_description,
+                           int block_count,
+                           std::chrono::seconds checkpoint_interval)
+    : path_(path),
+      job_description_(job_description),
+      checkpoint_interval_(checkpoint_interval),
+      completed_blocks_(block_count, false),
+      last_checkpoint_(Now()) {
+    if (Load()) {
+        file_ = std::fopen(path_.c_str(), "ab");
+        if (file_ == nullptr) {
+            throw sirius::Exception("cannot open block journal '" + path_ +
+                                    "': " + std::strerror(errno));
+        }
+        LOG("block_journal", info,
+            "resume from journal '{}': {} of {} blocks already written",
+            path_, completed_block_count_, block_count);
+        return;
+    }
+    Create();
+}
+
+BlockJournal::~BlockJournal() {
+    if (file_ != nullptr) {
+        std::fclose(file_);
+    }
+}
+
+bool BlockJournal::Load() {
+    std::ifstream journal(path_, std::ios::binary);
+    if (!journal) {
+        return false;
+    }
+    std::string content((std::istreambuf_iterator<char>(journal)),
+                        std::istreambuf_iterator<char>());
+    // last line is ignored if it has no end of line: the job may have been
+    //   killed while writing it
+    content.erase(content.find_last_of('\n') + 1);
+
+    std::istringstream lines(content);
+    std::string header;
+    std::string job_description;
+    std::string block_count;
+    std::getline(lines, header);
+    std::getline(lines, job_description);
+    std::getline(lines, block_count);
+    if (header != kJournalHeader || job_description != job_description_ ||
+        block_count != std::to_string(completed_blocks_.size())) {
+        LOG("block_journal", warn,
+            "journal '{}' belongs to another job, it is restarted", path_);
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(lines, line)) {
+        std::size_t end = 0;
+        int block_index = -1;
+        try {
+            block_index = std::stoi(line, &end);
+        } catch (const std::exception&) {
+            end = 0;
+        }
+        if (end != line.size() || block_index < 0 ||
+            block_index >= static_cast<int>(completed_blocks_.size())) {
+            LOG("block_journal", warn,
+                "journal '{}' is corrupted, it is restarted", path_);
+            completed_blocks_.assign(completed_blocks_.size(), false);
+            completed_block_count_ = 0;
+            return false;
+        }
+        if (!completed_blocks_[block_index]) {
+            completed_blocks_[block_index] = true;
+            ++completed_block_count_;
+        }
+    }
+    return true;
+}
+
+void BlockJournal::Create() {
+    if (file_ != nullptr) {
+        std::fclose(file_);
+    }
+    file_ = std::fopen(path_.c_str(), "wb");
+    if (file_ == nullptr) {
+        throw sirius::Exception("cannot create block journal '" + path_ +
+                                "': " + std::strerror(errno));
+    }
+    std::string header = std::string(kJournalHeader) + "\n" +
+                         job_description_ + "\n" +
+                         std::to_string(completed_blocks_.size()) + "\n";
+    std::fwrite(header.data(), 1, header.size(), file_);
+    if (Commit({})) {
+        throw sirius::Exception("cannot write block journal '" + path_ + "'");
+    }
+    LOG("block_journal", info, "written blocks are journaled in '{}'", path_);
+}
+
+void BlockJournal::Reset() {
+    completed_blocks_.assign(completed_blocks_.size(), false);
+    completed_block_count_ = 0;
+    committed_block_count_ = 0;
+    Create();
+}
+
+void BlockJournal::MarkWritten(int block_index) {
+    std::lock_guard<std::mutex> lock(written_blocks_mutex_);
+    written_blocks_.push_back(block_index);
+}
+
+std::vector<int> BlockJournal::TakeWrittenBlocks() {
+    std::vector<int> block_indices;
+    std::lock_guard<std::mutex> lock(written_blocks_mutex_);
+    block_indices.swap(written_blocks_);
+    return block_indices;
+}
+
+bool BlockJournal::IsCheckpointDue() const {
+    return std::chrono::steady_clock::duration(Now() - last_checkpoint_) >=
+           checkpoint_interval_;
+}
+
+std::error_code BlockJournal::Commit(const std::vector<int>& block_indices) {
+    if (file_ == nullptr) {
+        return std::make_error_code(std::errc::bad_file_descriptor);
+    }
+    last_checkpoint_ = Now();
+    std::string entries;
+    for (int block_index : block_indices) {
+        entries += std::to_string(block_index) + "\n";
+    }
+    if (std::fwrite(entries.data(), 1, entries.size(), file_) !=
+              entries.size() ||
+        std::fflush(file_) != 0) {
+        return std::error_code(errno, std::system_category());
+    }
+#ifndef _WIN32
+    if (::fsync(::fileno(file_)) != 0) {
+        return std::error_code(errno, std::system_category());
+    }
+#endif  // _WIN32
+    committed_block_count_ += static_cast<int>(block_indices.size());
+    LOG("block_journal", debug, "checkpoint of {} blocks ({} of {} blocks)",
+        block_indices.size(), completed_block_count_ + committed_block_count_,
+        completed_blocks_.size());
+    return {};
+}
+
+void BlockJournal::Remove() {
+    if (file_ != nullptr) {
+        std::fclose(file_);
+        file_ = nullptr;
+    }
+    if (std::remove(path_.c_str()) != 0) {
+        LOG("block_journal", warn, "cannot remove journal '{}': {}", path_,
+            std::strerror(errno));
+        return;
+    }
+    LOG("block_journal", debug, "journal '{}' removed", path_);
+}
+
+}  // namespace gdal
+}  // namespace sirius
@@ -0,0 +1,183 @@
+/**
+ * Copyright (C) 2018 CS - Systemes d'Information (CS-SI)
+ *
+ * This file is part of Sirius
+ *
+ *     https://github.com/CS-SI/SIRIUS
+ *
+ * Sirius is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sirius is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Sirius.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SIRIUS_GDAL_BLOCK_JOURNAL_H_
+#define SIRIUS_GDAL_BLOCK_JOURNAL_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace sirius {
+namespace gdal {
+
+/**
+ * \brief Checkpoint options of a stream
+ */
+struct CheckpointOptions {
+    /// journal of the written blocks, no checkpoint if empty
+    std::string journal_path;
+    /// minimal time between two checkpoints
+    std::chrono::seconds interval{30};
+    /// resampling parameters unknown to the stream (filter identity, image
+    /// decomposition, zoom strategy), added to the job description
+    std::string resampling_description;
+};
+
+/**
+ * \brief Journal of the blocks written in an output image
+ *
+ * Blocks are marked as written once their pixels are handed over to the
+ *   output file. A checkpoint appends them to the journal and syncs it to
+ *   disk, after the output file has been flushed and synced: the journal
+ *   only lists blocks whose pixels are on disk and a job killed at any time,
+ *   or whose node is lost, can resume from its last checkpoint. Outputs on
+ *   GDAL virtual file systems are flushed but cannot be synced.
+ *
+ * The journal starts with a description of the job (input, block grid,
+ *   output, ...). A journal of another job is not resumed.
+ *
+ * MarkWritten, TakeWrittenBlocks and IsCheckpointDue are thread safe.
+ */
+class BlockJournal {
+  public:
+    /**
+     * \brief Open a journal, resume it if it describes the same job
+     * \param path journal path
+     * \param job_description one line description of the job
+     * \param block_count number of blocks of the stream
+     * \param checkpoint_interval minimal time between two checkpoints
+     * \throw sirius::Exception if the journal cannot be written
+     */
+    BlockJournal(const std::string& path, const std::string& job_description,
+                 int block_count,
+                 std::chrono::seconds checkpoint_interval =
+                       std::chrono::seconds(30));
+
+    ~BlockJournal();
+
+    BlockJournal(const BlockJournal&) = delete;
+    BlockJournal& operator=(const BlockJournal&) = delete;
+    BlockJournal(BlockJournal&&) = delete;
+    BlockJournal& operator=(BlockJournal&&) = delete;
+
+    const std::string& Path() const { return path_; }
+
+    /**
+     * \brief Blocks written by previous runs, indexed by block
+     */
+    const std::vector<bool>& CompletedBlocks() const {
+        return completed_blocks_;
+    }
+
+    /**
+     * \brief Block was written by a previous run
+     */
+    bool IsCompleted(int block_index) const {
+        return completed_blocks_[block_index];
+    }
+
+    /**
+     * \brief Number of blocks written by previous runs
+     */
+    int CompletedBlockCount() const { return completed_block_count_; }
+
+    /**
+     * \brief Every block is written and checkpointed
+     */
+    bool IsComplete() const {
+        return completed_block_count_ + committed_block_count_ ==
+               static_cast<int>(completed_blocks_.size());
+    }
+
+    /**
+     * \brief Forget the blocks of previous runs and restart the journal
+     * \throw sirius::Exception if the journal cannot be written
+     */
+    void Reset();
+
+    /**
+     * \brief Mark a block as written in the output file
+     * \param block_index block index
+     */
+    void MarkWritten(int block_index);
+
+    /**
+     * \brief Blocks marked as written since the last call
+     *
+     * Blocks are taken before the output file is flushed so that every
+     *   taken block is on disk once the flush is done
+     *
+     * \return block indices
+     */
+    std::vector<int> TakeWrittenBlocks();
+
+    /**
+     * \brief Checkpoint interval has elapsed since the last checkpoint
+     */
+    bool IsCheckpointDue() const;
+
+    /**
+     * \brief Append blocks to the journal and sync it to disk
+     * \param block_indices blocks whose pixels are on disk
+     * \return error code if the journal could not be written
+     */
+    std::error_code Commit(const std::vector<int>& block_indices);
+
+    /**
+     * \brief Remove the journal of a completed output
+     */
+    void Remove();
+
+  private:
+    /**
+     * \brief Load the blocks of a journal of the same job
+     * \return false if there is no journal of this job
+     */
+    bool Load();
+
+    /**
+     * \brief Create the journal file and write its header
+     */
+    void Create();
+
+  private:
+    std::string path_;
+    std::string job_description_;
+    std::chrono::steady_clock::duration checkpoint_interval_;
+    std::FILE* file_ = nullptr;
+    std::vector<bool> completed_blocks_;
+    int completed_block_count_ = 0;
+    int committed_block_count_ = 0;
+
+    std::mutex written_blocks_mutex_;
+    std::vector<int> written_blocks_;
+    std::atomic<std::chrono::steady_clock::rep> last_checkpoint_;
+};
+
+}  // namespace gdal
+}  // namespace sirius
+
+#endif  // SIRIUS_GDAL_BLOCK_JOURNAL_H_
@@ -21,6 +21,9 @@
 
 #include "sirius/gdal/input_stream.h"
 
+#include <algorithm>
+#include <iterator>
+
 #include "sirius/exception.h"
 #include "sirius/types.h"
 
@@ -35,117 +38,214 @@ namespace gdal {
 InputStream::InputStream(const std::string& image_path,
                          const sirius::Size& block_size,
                          const sirius::Size& block_margin_size,
-                         PaddingType block_padding_type)
-    : input_dataset_(gdal::LoadDataset(image_path)),
-      block_size_(block_size),
-      block_margin_size_(block_margin_size),
-      block_padding_type_(block_padding_type),
-      is_ended_(false),
-      row_idx_(0),
-      col_idx_(0) {
-    if (block_size_.row <= 0 || block_size_.col <= 0) {
-        LOG("input_stream", error, "invalid block size");
-        throw sirius::Exception("invalid block size");
-    }
-
-    LOG("input_stream", info, "input image '{}' ({}x{})", image_path,
-        input_dataset_->GetRasterYSize(), input_dataset_->GetRasterXSize());
+                         PaddingType block_padding_type,
+                         bool pad_edge_blocks,
+                         const ImageWindow& block_range)
+    : image_path_(image_path),
+      input_dataset_(gdal::LoadDataset(image_path)),
+      image_size_(input_dataset_->GetRasterYSize(),
+                  input_dataset_->GetRasterXSize()),
+      band_count_(input_dataset_->GetRasterCount()),
+      data_type_(input_dataset_->GetRasterBand(1)->GetRasterDataType()),
+      pixel_size_(GDALGetDataTypeSizeBytes(data_type_)),
+      block_grid_(image_size_, block_size, block_margin_size,
+                  block_padding_type, pad_edge_blocks),
+      block_range_(block_range) {
+    auto grid_size = block_grid_.GridSize();
+    if (block_range_.IsEmpty()) {
+        block_range_ = ImageWindow();
+        block_range_.size = grid_size;
+    } else if (block_range_.row < 0 || block_range_.col < 0 ||
+               block_range_.row + block_range_.size.row > grid_size.row ||
+               block_range_.col + block_range_.size.col > grid_size.col) {
+        throw sirius::Exception("block range is outside the block grid");
+    } else {
+        LOG("input_stream", info,
+            "block range: {}x{} blocks from block ({},{}) of {}x{} blocks",
+            block_range_.size.row, block_range_.size.col, block_range_.row,
+            block_range_.col, grid_size.row, grid_size.col);
+    }
+    block_indices_.resize(BlockCount());
+    for (int i = 0; i < BlockCount(); ++i) {
+        block_indices_[i] = i;
+    }
+
+    int native_block_w = 0;
+    int native_block_h = 0;
+    input_dataset_->GetRasterBand(1)->GetBlockSize(&native_block_w,
+                                                   &native_block_h);
+    LOG("input_stream", info,
+        "input image '{}' ({}x{}, {} bands, {}, blocks of {}x{})",
+        image_path, image_size_.row, image_size_.col, band_count_,
+        GDALGetDataTypeName(data_type_), native_block_h, native_block_w);
+    idle_datasets_.push_back(input_dataset_.get());
+
+    is_mapped_ = true;
+    for (int band = 1; band <= band_count_ && is_mapped_; ++band) {
+        mapped_bands_.push_back(std::make_unique<MappedRasterBand>(
+              input_dataset_->GetRasterBand(band)));
+        is_mapped_ = mapped_bands_.back()->IsMapped();
+    }
+    if (is_mapped_) {
+        LOG("input_stream", info, "input image is memory mapped");
+    } else if (block_margin_size.row > 0 || block_margin_size.col > 0) {
+        InitializeStripCache();
+    }
 }
 
-StreamBlock InputStream::Read(std::error_code& ec) {
-    if (is_ended_) {
-        ec = make_error_code(CPLE_ObjectNull);
-        return {};
+InputStream::~InputStream() {
+    std::size_t requested_pixel_count = requested_pixel_count_;
+    std::size_t read_pixel_count = read_pixel_count_;
+    if (requested_pixel_count == 0) {
+        return;
     }
+    std::size_t saved_pixel_count =
+          requested_pixel_count > read_pixel_count
+                ? requested_pixel_count - read_pixel_count
+                : 0;
+    LOG("input_stream", info,
+        "read {} pixels for {} requested pixels (saved {:.1f} MB of I/O, "
+        "{:.1f}%)",
+        read_pixel_count, requested_pixel_count,
+        saved_pixel_count * pixel_size_ / (1024. * 1024.),
+        100. * saved_pixel_count / requested_pixel_count);
+}
 
-    int w = input_dataset_->GetRasterXSize();
-    int h = input_dataset_->GetRasterYSize();
-    int padded_block_w = block_size_.col + 2 * block_margin_size_.col;
-    int padded_block_h = block_size_.row + 2 * block_margin_size_.row;
+void InputStream::InitializeStripCache() {
+    strip_height_ = block_grid_.BlockSize().row;
+    int strip_count = (image_size_.row + strip_height_ - 1) / strip_height_;
+    strip_use_counts_.assign(strip_count, 0);
 
-    if (padded_block_w > w || padded_block_h > h) {
-        LOG("input_stream", critical,
-            "requested block size ({}x{}) is bigger than source image ({}x{}). "
-            "You should use regular processing",
-            padded_block_w, padded_block_h, w, h);
-        ec = make_error_code(CPLE_ObjectNull);
-        return {};
+    // only the streamed blocks of the range use strips
+    std::vector<int> row_block_counts(block_range_.size.row, 0);
+    for (int block_index : block_indices_) {
+        ++row_block_counts[block_index / block_range_.size.col];
     }
+    auto grid_size = block_grid_.GridSize();
 
-    // resize block if needed
-    if (row_idx_ + padded_block_h > h) {
-        // assign size that can be read
-        padded_block_h -= (row_idx_ + padded_block_h - h);
+    // read windows of the corner blocks of the range bound the strips
+    std::error_code first_ec;
+    auto first_geometry = block_grid_.GetBlockGeometry(
+          block_range_.row * grid_size.col + block_range_.col, first_ec);
+    std::error_code last_ec;
+    auto last_geometry = block_grid_.GetBlockGeometry(
+          (block_range_.row + block_range_.size.row - 1) * grid_size.col +
+                block_range_.col + block_range_.size.col - 1,
+          last_ec);
+    if (first_ec || last_ec) {
+        // error will be reported when reading the block
+        strip_use_counts_.clear();
+        use_strip_cache_ = false;
+        return;
+    }
+    strip_window_.row = first_geometry.read_row_idx;
+    strip_window_.col = first_geometry.read_col_idx;
+    strip_window_.size = {
+          last_geometry.read_row_idx + last_geometry.read_size.row -
+                strip_window_.row,
+          last_geometry.read_col_idx + last_geometry.read_size.col -
+                strip_window_.col};
 
-        if (padded_block_h < block_margin_size_.row) {
-            LOG("input_stream", error,
-                "block at coordinates ({}, {}) cannot be read because "
-                "available reading height {} is less than margin size {}",
-                row_idx_, col_idx_, padded_block_h, block_margin_size_.row);
-            ec = make_error_code(CPLE_ObjectNull);
-            return {};
+    for (int row = 0; row < block_range_.size.row; ++row) {
+        if (row_block_counts[row] == 0) {
+            continue;
         }
-
-        if (padded_block_h > block_margin_size_.row + block_size_.row) {
-            // bottom margin is partly read. add missing margin
-            padded_block_h +=
-                  (row_idx_ + block_size_.row + 2 * block_margin_size_.row - h);
-        } else {
-            padded_block_h += block_margin_size_.row;
+        // read rows of a block do not depend on its column
+        std::error_code ec;
+        auto geometry = block_grid_.GetBlockGeometry(
+              (block_range_.row + row) * grid_size.col + block_range_.col,
+              ec);
+        if (ec) {
+            // error will be reported when reading the block
+            strip_use_counts_.clear();
+            use_strip_cache_ = false;
+            return;
+        }
+        if (geometry.read_size.row <= 0) {
+            continue;
+        }
+        int first_strip = geometry.read_row_idx / strip_height_;
+        int last_strip = (geometry.read_row_idx + geometry.read_size.row - 1) /
+                         strip_height_;
+        for (int i = first_strip; i <= last_strip; ++i) {
+            strip_use_counts_[i] += row_block_counts[row];
         }
     }
-    if (col_idx_ + padded_block_w > w) {
-        padded_block_w -= (col_idx_ + padded_block_w - w);
 
-        if (padded_block_w < block_margin_size_.col) {
-            LOG("ReadBlock", error,
-                "block at coordinates {}, {}, cannot be read because available "
-                "reading width {} is less than margin size {}",
-                row_idx_, col_idx_, padded_block_w, block_margin_size_.col);
-            ec = make_error_code(CPLE_ObjectNull);
-            return {};
-        }
+    use_strip_cache_ = true;
+    LOG("input_stream", debug,
+        "strip cache enabled (strips of {} rows, columns {} to {})",
+        strip_height_, strip_window_.col,
+        strip_window_.col + strip_window_.size.col - 1);
+}
 
-        if (padded_block_w > block_size_.col + block_margin_size_.col) {
-            padded_block_w +=
-                  (col_idx_ + block_size_.col + 2 * block_margin_size_.col - w);
-        } else {
-            padded_block_w += block_margin_size_.col;
+void InputStream::SkipBlocks(const std::vector<bool>& skipped_blocks) {
+    block_indices_.clear();
+    for (int i = 0; i < BlockCount(); ++i) {
+        if (i >= static_cast<int>(skipped_blocks.size()) ||
+            !skipped_blocks[i]) {
+            block_indices_.push_back(i);
         }
     }
-    Padding block_padding;
-    block_padding.type = block_padding_type_;
-    int w_to_read = padded_block_w;
-    int h_to_read = padded_block_h;
-    // top padding needed
-    if (row_idx_ == 0) {
-        block_padding.top = block_margin_size_.row;
-        h_to_read -= block_margin_size_.row;
+    LOG("input_stream", info, "{} of {} blocks are skipped",
+        BlockCount() - StreamedBlockCount(), BlockCount());
+    if (use_strip_cache_) {
+        InitializeStripCache();
     }
+}
 
-    // bottom padding needed
-    if (row_idx_ >= (h - block_size_.row - 2 * block_margin_size_.row)) {
-        block_padding.bottom = block_margin_size_.row;
-        h_to_read -= (row_idx_ + padded_block_h - h);
+StreamBlock InputStream::Read(std::error_code& ec) {
+    int i = next_block_index_++;
+    if (i >= StreamedBlockCount()) {
+        ec = make_error_code(CPLE_ObjectNull);
+        return {};
     }
+    return Read(block_indices_[i], ec);
+}
 
-    // left padding needed
-    if (col_idx_ == 0) {
-        block_padding.left = block_margin_size_.col;
-        w_to_read -= block_margin_size_.col;
+StreamBlock InputStream::Read(int block_index, std::error_code& ec) {
+    if (block_index < 0 || block_index >= BlockCount()) {
+        LOG("input_stream", error, "block index {} is out of range [0, {})",
+            block_index, BlockCount());
+        ec = make_error_code(CPLE_ObjectNull);
+        return {};
     }
-
-    // right padding needed
-    if (col_idx_ >= (w - block_size_.col - 2 * block_margin_size_.col)) {
-        block_padding.right = block_margin_size_.col;
-        w_to_read -= (col_idx_ + padded_block_w - w);
+    // index of the block in the whole grid
+    int grid_index =
+          (block_range_.row + block_index / block_range_.size.col) *
+                block_grid_.GridSize().col +
+          block_range_.col + block_index % block_range_.size.col;
+    auto geometry = block_grid_.GetBlockGeometry(grid_index, ec);
+    if (ec) {
+        return {};
     }
 
-    Image output_buffer({h_to_read, w_to_read});
+    std::vector<Image> band_images;
+    std::vector<double*> band_buffers;
+    for (int band = 0; band < band_count_; ++band) {
+        band_images.emplace_back(geometry.read_size);
+        band_buffers.push_back(band_images.back().data.data());
+    }
+    std::size_t pixel_count = geometry.read_size.CellCount() * band_count_;
+    requested_pixel_count_ += pixel_count;
 
-    CPLErr err = input_dataset_->GetRasterBand(1)->RasterIO(
-          GF_Read, col_idx_, row_idx_, w_to_read, h_to_read,
-          output_buffer.data.data(), w_to_read, h_to_read, GDT_Float64, 0, 0);
+    CPLErr err = CE_None;
+    if (is_mapped_) {
+        for (int band = 0; band < band_count_; ++band) {
+            // read-ahead of this block row and the next one
+            mapped_bands_[band]->WillNeed(
+                  geometry.read_row_idx,
+                  geometry.read_size.row + block_grid_.BlockSize().row);
+            mapped_bands_[band]->ReadWindow(
+                  geometry.read_row_idx, geometry.read_col_idx,
+                  geometry.read_size, band_buffers[band]);
+        }
+        read_pixel_count_ += pixel_count;
+    } else if (use_strip_cache_) {
+        err = ReadFromStrips(geometry, band_buffers);
+    } else {
+        err = ReadFromDataset(geometry, band_buffers);
+    }
 
     if (err) {
         LOG("input_stream", error,
@@ -154,38 +254,162 @@ StreamBlock InputStream::Read(std::error_code& ec) {
         return {};
     }
 
-    int block_row_idx = (row_idx_ == 0) ? 0 : row_idx_ + block_margin_size_.row;
-    int block_col_idx = (col_idx_ == 0) ? 0 : col_idx_ + block_margin_size_.col;
+    StreamBlock output_block(std::move(band_images.front()),
+                             geometry.row_idx, geometry.col_idx,
+                             geometry.padding);
+    output_block.extra_buffers.assign(
+          std::make_move_iterator(band_images.begin() + 1),
+          std::make_move_iterator(band_images.end()));
+    output_block.index = block_index;
+
+    LOG("input_stream", debug, "reading block of size {}x{} at ({},{})",
+        output_block.buffer.size.row, output_block.buffer.size.col,
+        output_block.row_idx, output_block.col_idx);
 
-    StreamBlock output_block(std::move(output_buffer), block_row_idx,
-                             block_col_idx, block_padding);
+    ec = make_error_code(CPLE_None);
+    return output_block;
+}
 
-    if (((row_idx_ + padded_block_h - block_margin_size_.row) >= h) &&
-        ((col_idx_ + padded_block_w - block_margin_size_.col) >= w)) {
-        is_ended_ = true;
+CPLErr InputStream::ReadFromDataset(const BlockGeometry& geometry,
+                                    const std::vector<double*>& band_buffers) {
+    GDALDataset* dataset = AcquireDataset();
+    CPLErr err = CE_None;
+    if (band_count_ == 1) {
+        err = gdal::ReadWindow(dataset->GetRasterBand(1),
+                               geometry.read_row_idx, geometry.read_col_idx,
+                               geometry.read_size, band_buffers.front());
+    } else {
+        // all the bands are read at once in the native data type, then
+        //   converted into the band buffers
+        std::size_t band_size =
+              geometry.read_size.CellCount() * pixel_size_;
+        std::vector<GByte> buffer(band_size * band_count_);
+        err = gdal::ReadWindow(dataset, geometry.read_row_idx,
+                               geometry.read_col_idx, geometry.read_size,
+                               buffer.data(), data_type_);
+        for (int band = 0; err == CE_None && band < band_count_; ++band) {
+            GDALCopyWords(buffer.data() + band * band_size, data_type_,
+                          pixel_size_, band_buffers[band], GDT_Float64,
+                          sizeof(double), geometry.read_size.CellCount());
+        }
     }
+    ReleaseDataset(dataset);
+    read_pixel_count_ += geometry.read_size.CellCount() * band_count_;
+    return err;
+}
+
+CPLErr InputStream::ReadFromStrips(const BlockGeometry& geometry,
+                                   const std::vector<double*>& band_buffers) {
+    int row_begin = geometry.read_row_idx;
+    int row_end = row_begin + geometry.read_size.row;
+    int first_strip = row_begin / strip_height_;
+    int last_strip = (row_end - 1) / strip_height_;
 
-    if (col_idx_ >= w - block_size_.col - block_margin_size_.col) {
-        col_idx_ = 0;
-        if (row_idx_ == 0) {
-            row_idx_ += block_size_.row - block_margin_size_.row;
-        } else {
-            row_idx_ += block_size_.row;
+    CPLErr err = CE_None;
+    for (int i = first_strip; i <= last_strip; ++i) {
+        if (err == CE_None) {
+            auto strip = AcquireStrip(i);
+            err = strip->err;
+            if (err == CE_None) {
+                int copy_begin = std::max(row_begin, strip->first_row);
+                int copy_end =
+                      std::min(row_end, strip->first_row + strip->row_count);
+                for (int row = copy_begin; row < copy_end; ++row) {
+                    std::size_t src_offset =
+                          (static_cast<std::size_t>(row - strip->first_row) *
+                                 strip_window_.size.col +
+                           geometry.read_col_idx - strip_window_.col) *
+                          pixel_size_;
+                    std::size_t dst_offset =
+                          static_cast<std::size_t>(row - row_begin) *
+                          geometry.read_size.col;
+                    for (int band = 0; band < band_count_; ++band) {
+                        GByte* src = strip->data.data() +
+                                     band * strip->band_size + src_offset;
+                        GDALCopyWords(src, data_type_, pixel_size_,
+                                      band_buffers[band] + dst_offset,
+                                      GDT_Float64, sizeof(double),
+                                      geometry.read_size.col);
+                    }
+                }
+            }
         }
-    } else {
-        if (col_idx_ == 0) {
-            col_idx_ += block_size_.col - block_margin_size_.col;
-        } else {
-            col_idx_ += block_size_.col;
+        // release even on error so that the strip is dropped after its last
+        //   use
+        ReleaseStrip(i);
+    }
+    return err;
+}
+
+std::shared_ptr<InputStream::Strip> InputStream::AcquireStrip(
+      int strip_index) {
+    std::shared_ptr<Strip> strip;
+    {
+        std::lock_guard<std::mutex> lock(strip_mutex_);
+        auto& cached_strip = strips_[strip_index];
+        if (!cached_strip) {
+            cached_strip = std::make_shared<Strip>();
         }
+        strip = cached_strip;
     }
 
-    LOG("input_stream", debug, "reading block of size {}x{} at ({},{})",
-        output_block.buffer.size.row, output_block.buffer.size.col,
-        output_block.row_idx, output_block.col_idx);
+    // first reader loads the strip, the other ones wait for it
+    std::lock_guard<std::mutex> lock(strip->mutex);
+    if (!strip->is_loaded) {
+        // strip rows out of the strip window are not read by any block
+        int first_row =
+              std::max(strip_index * strip_height_, strip_window_.row);
+        int end_row = std::min((strip_index + 1) * strip_height_,
+                               strip_window_.row + strip_window_.size.row);
+        sirius::Size strip_size(end_row - first_row, strip_window_.size.col);
+        strip->first_row = first_row;
+        strip->row_count = strip_size.row;
+        strip->band_size = strip_size.CellCount() * pixel_size_;
+        strip->data.resize(strip->band_size * band_count_);
 
-    ec = make_error_code(CPLE_None);
-    return output_block;
+        GDALDataset* dataset = AcquireDataset();
+        strip->err =
+              gdal::ReadWindow(dataset, first_row, strip_window_.col,
+                               strip_size, strip->data.data(), data_type_);
+        ReleaseDataset(dataset);
+        strip->is_loaded = true;
+        read_pixel_count_ += strip_size.CellCount() * band_count_;
+        LOG("input_stream", trace, "load strip {} ({} rows from row {})",
+            strip_index, strip_size.row, first_row);
+    }
+    return strip;
+}
+
+void InputStream::ReleaseStrip(int strip_index) {
+    std::lock_guard<std::mutex> lock(strip_mutex_);
+    if (--strip_use_counts_[strip_index] <= 0) {
+        strips_.erase(strip_index);
+    }
+}
+
+GDALDataset* InputStream::AcquireDataset() {
+    {
+        std::lock_guard<std::mutex> lock(dataset_mutex_);
+        if (!idle_datasets_.empty()) {
+            GDALDataset* dataset = idle_datasets_.back();
+            idle_datasets_.pop_back();
+            return dataset;
+        }
+    }
+
+    // open outside of the lock, opening a dataset can be slow
+    auto dataset = gdal::LoadDataset(image_path_);
+    GDALDataset* dataset_ptr = dataset.get();
+    std::lock_guard<std::mutex> lock(dataset_mutex_);
+    reader_datasets_.push_back(std::move(dataset));
+    LOG("input_stream", debug, "open reader dataset handle #{}",
+        reader_datasets_.size());
+    return dataset_ptr;
+}
+
+void InputStream::ReleaseDataset(GDALDataset* dataset) {
+    std::lock_guard<std::mutex> lock(dataset_mutex_);
+    idle_datasets_.push_back(dataset);
 }
 
 }  // namespace gdal
@@ -22,19 +22,65 @@
 #ifndef SIRIUS_GDAL_INPUT_STREAM_H_
 #define SIRIUS_GDAL_INPUT_STREAM_H_
 
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <system_error>
+#include <vector>
 
 #include "sirius/image.h"
 #include "sirius/types.h"
 
+#include "sirius/gdal/block_grid.h"
+#include "sirius/gdal/mapped_raster_band.h"
 #include "sirius/gdal/stream_block.h"
 #include "sirius/gdal/types.h"
 
 namespace sirius {
 namespace gdal {
 
+/**
+ * \brief Input stream I/O statistics
+ */
+struct InputStreamStatistics {
+    /// pixels of the read windows of the blocks (margins included)
+    std::size_t requested_pixel_count = 0;
+    /// pixels actually read from the dataset
+    std::size_t read_pixel_count = 0;
+    /// size of a pixel in the native data type of the image (bytes)
+    std::size_t pixel_size = 0;
+};
+
 /**
  * \brief Stream an image in block
+ *
+ * Read methods are thread safe: concurrent readers get distinct blocks and
+ *   read them with their own dataset handle so that decompression of the
+ *   input image can run in parallel.
+ *
+ * If blocks have margins, the image is read by strips of one block height
+ *   which are kept in memory as long as a block row needs them. Strips only
+ *   cover the read windows of the streamed blocks (margins included).
+ *   Each source pixel is read once from the dataset and block margins shared
+ *   by neighbor blocks are copied from memory. Strips are kept in the native
+ *   data type of the image and converted to double by the block readers.
+ *
+ * Uncompressed raw images (ENVI, ...) are memory mapped instead: blocks are
+ *   copied straight from the page cache by the readers, with read-ahead
+ *   advice on the rows of the next block row, and neither dataset handles
+ *   nor strips are needed.
+ *
+ * All the bands of a multi-band image are read at once: a block holds one
+ *   image per band and strips hold the rows of every band.
+ *
+ * The stream can be restricted to a range of the block grid (shard). Blocks
+ *   are then indexed in the range, and strips only cover the rows and the
+ *   columns read by the blocks of the range.
+ *
+ * Blocks already written by a previous run of a resumed job can be skipped:
+ *   they are not returned by Read and their strips are not read.
  */
 class InputStream {
   public:
@@ -44,12 +90,18 @@ class InputStream {
      * \param block_size blocks size
      * \param block_margin_size block margin size
      * \param block_padding_type block padding type
+     * \param pad_edge_blocks pad bottom and right edge blocks so that every
+     *        padded block has the nominal size (block + 2 * margins)
+     * \param block_range range of the block grid to stream, the whole grid
+     *        if empty
+     * \throw sirius::Exception if the block range is outside the grid
      */
     InputStream(const std::string& image_path, const sirius::Size& block_size,
                 const sirius::Size& block_margin_size,
-                PaddingType block_padding_type);
+                PaddingType block_padding_type, bool pad_edge_blocks = false,
+                const ImageWindow& block_range = {});
 
-    ~InputStream() = default;
+    ~InputStream();
 
     InputStream(const InputStream&) = delete;
     InputStream& operator=(const InputStream&) = delete;
@@ -60,32 +112,173 @@ class InputStream {
      * \brief Get the size of the input file
      * \return input file size
      */
-    sirius::Size Size() {
-        return {input_dataset_->GetRasterYSize(),
-                input_dataset_->GetRasterXSize()};
+    sirius::Size Size() const { return image_size_; }
+
+    /**
+     * \brief Get the number of bands of the input file
+     * \return band count
+     */
+    int BandCount() const { return band_count_; }
+
+    /**
+     * \brief Get the number of blocks of the stream
+     * \return block count
+     */
+    int BlockCount() const { return block_range_.size.CellCount(); }
+
+    /**
+     * \brief Number of blocks of the stream in each direction
+     * \return grid size
+     */
+    sirius::Size GridSize() const { return block_range_.size; }
+
+    /**
+     * \brief Get the number of blocks returned by Read, skipped blocks
+     *   excluded
+     * \return streamed block count
+     */
+    int StreamedBlockCount() const {
+        return static_cast<int>(block_indices_.size());
     }
 
     /**
-     * \brief Read a block from the image
+     * \brief Skip blocks, must be called before reading the first block
+     * \param skipped_blocks blocks to skip, indexed by block
+     */
+    void SkipBlocks(const std::vector<bool>& skipped_blocks);
+
+    /**
+     * \brief Range of the block grid streamed
+     * \return block range
+     */
+    ImageWindow BlockRange() const { return block_range_; }
+
+    /**
+     * \brief Image area covered by the streamed blocks (margins excluded)
+     * \return image window
+     */
+    ImageWindow Area() const {
+        return block_grid_.ComputeRangeArea(block_range_);
+    }
+
+    /**
+     * \brief Read the next block from the image
      * \param ec error code if operation failed
      * \return block read
      */
     StreamBlock Read(std::error_code& ec);
 
+    /**
+     * \brief Read a block from the image
+     * \param block_index index of the block in the stream (row major order)
+     * \param ec error code if operation failed
+     * \return block read
+     */
+    StreamBlock Read(int block_index, std::error_code& ec);
+
     /**
      * \brief Indicate end of image
      * \return boolean if end is reached
      */
-    bool IsAtEnd() { return is_ended_; }
+    bool IsAtEnd() const {
+        return next_block_index_ >= StreamedBlockCount();
+    }
+
+    /**
+     * \brief Get I/O statistics
+     * \return pixels requested by blocks and pixels read from the dataset
+     */
+    InputStreamStatistics Statistics() const {
+        return {requested_pixel_count_, read_pixel_count_,
+                static_cast<std::size_t>(pixel_size_)};
+    }
+
+  private:
+    /**
+     * \brief Strip of the image, restricted to the strip window
+     */
+    struct Strip {
+        std::mutex mutex;
+        bool is_loaded = false;
+        CPLErr err = CE_None;
+        /// image rows of the strip
+        int first_row = 0;
+        int row_count = 0;
+        /// pixels in the native data type of the image, band after band
+        std::vector<GByte> data;
+        /// bytes of a band
+        std::size_t band_size = 0;
+    };
+
+    /**
+     * \brief Count how many blocks use each strip and compute the strip
+     *   window
+     */
+    void InitializeStripCache();
+
+    /**
+     * \brief Copy a block read window of every band from the cached strips
+     *
+     * Pixels are converted from the native data type during the copy, by
+     *   the thread which reads the block
+     */
+    CPLErr ReadFromStrips(const BlockGeometry& geometry,
+                          const std::vector<double*>& band_buffers);
+
+    /**
+     * \brief Read a block read window of every band with a dataset handle
+     */
+    CPLErr ReadFromDataset(const BlockGeometry& geometry,
+                           const std::vector<double*>& band_buffers);
+
+    /**
+     * \brief Get a strip, load it from the dataset if needed
+     */
+    std::shared_ptr<Strip> AcquireStrip(int strip_index);
+
+    /**
+     * \brief Release a strip used by a block, drop it after its last use
+     */
+    void ReleaseStrip(int strip_index);
+
+    /**
+     * \brief Get an idle dataset handle, open a new one if none is available
+     */
+    GDALDataset* AcquireDataset();
+
+    void ReleaseDataset(GDALDataset* dataset);
 
   private:
+    std::string image_path_;
     gdal::DatasetUPtr input_dataset_;
-    sirius::Size block_size_{256, 256};
-    sirius::Size block_margin_size_;
-    PaddingType block_padding_type_;
-    bool is_ended_ = false;
-    int row_idx_ = 0;
-    int col_idx_ = 0;
+    sirius::Size image_size_;
+    int band_count_;
+    GDALDataType data_type_;
+    int pixel_size_;
+    BlockGrid block_grid_;
+    ImageWindow block_range_;
+    // blocks returned by Read, in order
+    std::vector<int> block_indices_;
+    std::atomic<int> next_block_index_{0};
+    // memory mapped bands, used if every band is mapped
+    std::vector<std::unique_ptr<MappedRasterBand>> mapped_bands_;
+    bool is_mapped_ = false;
+
+    // dataset handles opened for concurrent readers
+    std::mutex dataset_mutex_;
+    std::vector<gdal::DatasetUPtr> reader_datasets_;
+    std::vector<GDALDataset*> idle_datasets_;
+    // rolling strip cache
+    bool use_strip_cache_ = false;
+    int strip_height_ = 0;
+    // image area read by the blocks of the range, strips are cut to it
+    ImageWindow strip_window_;
+    std::mutex strip_mutex_;
+    std::map<int, std::shared_ptr<Strip>> strips_;
+    std::vector<int> strip_use_counts_;
+
+    std::atomic<std::size_t> requested_pixel_count_{0};
+    std::atomic<std::size_t> read_pixel_count_{0};
 };
 
 }  // namespace gdal
@@ -0,0 +1,95 @@
+/**
+ * Copyright (C) 2018 CS - Systemes d'Information (CS-SI)
+ *
+ * This file is part of Sirius
+ *
+ *     https://github.com/CS-SI/SIRIUS
+ *
+ * Sirius is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sirius is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Sirius.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "sirius/gdal/mapped_raster_band.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif  // _WIN32
+
+#include "sirius/utils/log.h"
+
+namespace sirius {
+namespace gdal {
+
+MappedRasterBand::MappedRasterBand(GDALRasterBand* band)
+    : data_type_(band->GetRasterDataType()),
+      size_(band->GetYSize(), band->GetXSize()) {
+    // only map the file itself, GDAL default implementation emulates the
+    //   mapping with page faults and RasterIO
+    char* options[] = {const_cast<char*>("USE_DEFAULT_IMPLEMENTATION=NO"),
+                       nullptr};
+    VirtualMemUPtr virtual_mem(band->GetVirtualMemAuto(
+          GF_Read, &pixel_space_, &line_space_, options));
+    if (virtual_mem == nullptr ||
+        !::CPLVirtualMemIsFileMapping(virtual_mem.get())) {
+        LOG("mapped_raster_band", debug, "band cannot be memory mapped");
+        return;
+    }
+
+    data_ = static_cast<const GByte*>(
+          ::CPLVirtualMemGetAddr(virtual_mem.get()));
+    virtual_mem_ = std::move(virtual_mem);
+    LOG("mapped_raster_band", debug,
+        "band is memory mapped (pixel space: {}, line space: {})",
+        pixel_space_, line_space_);
+}
+
+void MappedRasterBand::WillNeed(int row_idx, int row_count) const {
+#ifndef _WIN32
+    row_count = std::min(row_count, size_.row - row_idx);
+    if (!IsMapped() || row_idx < 0 || row_count <= 0) {
+        return;
+    }
+    // advice range must start on a page boundary
+    static const auto page_size =
+          static_cast<std::uintptr_t>(::sysconf(_SC_PAGESIZE));
+    auto begin = reinterpret_cast<std::uintptr_t>(data_ +
+                                                  row_idx * line_space_);
+    auto end = begin + static_cast<std::uintptr_t>(row_count * line_space_);
+    begin -= begin % page_size;
+    ::posix_madvise(reinterpret_cast<void*>(begin), end - begin,
+                    POSIX_MADV_WILLNEED);
+#else
+    (void)row_idx;
+    (void)row_count;
+#endif  // _WIN32
+}
+
+void MappedRasterBand::ReadWindow(int row_idx, int col_idx, const Size& size,
+                                  double* buffer) const {
+    for (int row = 0; row < size.row; ++row) {
+        const GByte* src =
+              data_ + (row_idx + row) * line_space_ +
+              static_cast<GIntBig>(col_idx) * pixel_space_;
+        ::GDALCopyWords(const_cast<GByte*>(src), data_type_, pixel_space_,
+                        buffer + static_cast<std::size_t>(row) * size.col,
+                        GDT_Float64, sizeof(double), size.col);
+    }
+}
+
+}  // namespace gdal
+}  // namespace sirius
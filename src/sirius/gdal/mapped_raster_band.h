@@ -0,0 +1,96 @@
+/**
+ * Copyright (C) 2018 CS - Systemes d'Information (CS-SI)
+ *
+ * This file is part of Sirius
+ *
+ *     https://github.com/CS-SI/SIRIUS
+ *
+ * Sirius is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sirius is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Sirius.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef SIRIUS_GDAL_MAPPED_RASTER_BAND_H_
+#define SIRIUS_GDAL_MAPPED_RASTER_BAND_H_
+
+#include "sirius/types.h"
+
+#include "sirius/gdal/types.h"
+
+namespace sirius {
+namespace gdal {
+
+/**
+ * \brief Read only memory mapping of a raster band
+ *
+ * Uncompressed raw rasters (ENVI, EHdr, ...) stored in the native byte order
+ *   are mapped in memory with GDAL virtual memory. Windows are then copied
+ *   from the page cache and converted to double by the calling thread,
+ *   without RasterIO calls nor GDAL block cache, so that any thread can read
+ *   concurrently.
+ *
+ * Other rasters are not mapped (IsMapped returns false).
+ */
+class MappedRasterBand {
+  public:
+    /**
+     * \brief Map a raster band
+     * \param band band to map, its dataset must outlive the mapping
+     */
+    explicit MappedRasterBand(GDALRasterBand* band);
+
+    ~MappedRasterBand() = default;
+    MappedRasterBand(const MappedRasterBand&) = delete;
+    MappedRasterBand& operator=(const MappedRasterBand&) = delete;
+    MappedRasterBand(MappedRasterBand&&) = delete;
+    MappedRasterBand& operator=(MappedRasterBand&&) = delete;
+
+    /**
+     * \brief Band is mapped in memory
+     * \return true if windows can be read from the mapping
+     */
+    bool IsMapped() const { return virtual_mem_ != nullptr; }
+
+    /**
+     * \brief Advise the kernel that rows will be read soon
+     *
+     * Starts the read-ahead of the rows from the file into the page cache
+     *
+     * \param row_idx first row
+     * \param row_count number of rows
+     */
+    void WillNeed(int row_idx, int row_count) const;
+
+    /**
+     * \brief Copy a window of the band converted to double
+     * \param row_idx first row of the window
+     * \param col_idx first col of the window
+     * \param size window size
+     * \param buffer output buffer of size.row x size.col pixels
+     */
+    void ReadWindow(int row_idx, int col_idx, const Size& size,
+                    double* buffer) const;
+
+  private:
+    VirtualMemUPtr virtual_mem_;
+    const GByte* data_{nullptr};
+    GDALDataType data_type_{GDT_Unknown};
+    int pixel_space_{0};
+    GIntBig line_space_{0};
+    Size size_;
+};
+
+}  // namespace gdal
+}  // namespace sirius
+
+#endif  // SIRIUS_GDAL_MAPPED_RASTER_BAND_H_
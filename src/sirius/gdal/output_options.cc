@@ -0,0 +1,231 @@
+/**
+ * Copyright (C) 2018 CS - Systemes d'Information (CS-SI)
+ *
+ * This file is part of Sirius
+ *
+ *     https://github.com/CS-SI/SIRIUS
+ *
+ * Sirius is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sirius is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Sirius.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "sirius/gdal/output_options.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <limits>
+
+#include <gdal.h>
+
+#include "sirius/exception.h"
+
+#include "sirius/utils/log.h"
+
+namespace sirius {
+namespace gdal {
+
+namespace {
+
+// GTiff tile dimensions must be multiples of this value
+constexpr int kTileSizeMultiple = 16;
+
+std::string ToUpper(std::string value) {
+    std::transform(value.begin(), value.end(), value.begin(),
+                   [](unsigned char c) { return std::toupper(c); });
+    return value;
+}
+
+template <typename T>
+void ConvertPixels(const Image& image, double scale, double offset,
+                   std::uint8_t* output_data) {
+    // saturation of floating point types avoids infinite values
+    constexpr double kMin = std::numeric_limits<T>::lowest();
+    constexpr double kMax = std::numeric_limits<T>::max();
+    constexpr bool kIsInteger = std::numeric_limits<T>::is_integer;
+    bool is_identity = scale == 1. && offset == 0.;
+
+    T* output_pixels = reinterpret_cast<T*>(output_data);
+    for (std::size_t i = 0; i < image.data.size(); ++i) {
+        double value = image.data[i];
+        if (!is_identity) {
+            value = value * scale + offset;
+        }
+        if (kIsInteger) {
+            if (std::isnan(value)) {
+                value = 0.;
+            }
+            value = std::round(value);
+        }
+        output_pixels[i] =
+              static_cast<T>(std::min(std::max(value, kMin), kMax));
+    }
+}
+
+}  // namespace
+
+std::string ParseOutputFormat(const std::string& format_name) {
+    auto name = ToUpper(format_name);
+    if (name == "GTIFF") {
+        return "GTiff";
+    } else if (name == "ENVI") {
+        return "ENVI";
+    }
+    throw Exception("unsupported output format '" + format_name + "'");
+}
+
+bool IsRawFormat(const OutputOptions& options) {
+    return ToUpper(options.format) == "ENVI";
+}
+
+GDALDataType ParseOutputDataType(const std::string& data_type_name) {
+    auto name = ToUpper(data_type_name);
+    if (name == "UINT8" || name == "BYTE") {
+        return GDT_Byte;
+    } else if (name == "UINT16") {
+        return GDT_UInt16;
+    } else if (name == "INT16") {
+        return GDT_Int16;
+    } else if (name == "FLOAT32") {
+        return GDT_Float32;
+    } else if (name == "FLOAT64") {
+        return GDT_Float64;
+    }
+    throw Exception("unsupported output data type '" + data_type_name + "'");
+}
+
+void ConvertToOutputType(const Image& image, const OutputOptions& options,
+                         std::vector<std::uint8_t>& output_data) {
+    output_data.resize(image.data.size() *
+                       GDALGetDataTypeSizeBytes(options.data_type));
+    ConvertToOutputType(image, options, output_data.data());
+}
+
+void ConvertToOutputType(const Image& image, const OutputOptions& options,
+                         std::uint8_t* output_data) {
+    switch (options.data_type) {
+        case GDT_Byte:
+            ConvertPixels<std::uint8_t>(image, options.scale, options.offset,
+                                        output_data);
+            break;
+        case GDT_UInt16:
+            ConvertPixels<std::uint16_t>(image, options.scale, options.offset,
+                                         output_data);
+            break;
+        case GDT_Int16:
+            ConvertPixels<std::int16_t>(image, options.scale, options.offset,
+                                        output_data);
+            break;
+        case GDT_Float32:
+            ConvertPixels<float>(image, options.scale, options.offset,
+                                 output_data);
+            break;
+        case GDT_Float64:
+            ConvertPixels<double>(image, options.scale, options.offset,
+                                  output_data);
+            break;
+        default:
+            throw Exception("unsupported output data type");
+    }
+}
+
+std::vector<std::string> GenerateCreationOptions(const OutputOptions& options) {
+    std::vector<std::string> creation_options;
+
+    if (IsRawFormat(options)) {
+        if (options.tiled || !options.compression.empty() ||
+            options.predictor > 0 || !options.bigtiff.empty()) {
+            LOG("output_options", warn,
+                "layout and compression options are ignored by {} outputs",
+                options.format);
+        }
+        return creation_options;
+    }
+
+    if (options.tiled) {
+        creation_options.emplace_back("TILED=YES");
+        if (options.tile_size.row > 0 && options.tile_size.col > 0) {
+            if (options.tile_size.row % kTileSizeMultiple != 0 ||
+                options.tile_size.col % kTileSizeMultiple != 0) {
+                throw Exception("tile dimensions must be multiples of " +
+                                std::to_string(kTileSizeMultiple));
+            }
+            creation_options.emplace_back(
+                  "BLOCKXSIZE=" + std::to_string(options.tile_size.col));
+            creation_options.emplace_back(
+                  "BLOCKYSIZE=" + std::to_string(options.tile_size.row));
+        }
+    }
+
+    auto compression = ToUpper(options.compression);
+    bool is_compressed = !compression.empty() && compression != "NONE";
+    if (is_compressed) {
+        creation_options.emplace_back("COMPRESS=" + compression);
+        if (options.compression_level > 0) {
+            std::string level = std::to_string(options.compression_level);
+            if (compression == "DEFLATE") {
+                creation_options.emplace_back("ZLEVEL=" + level);
+            } else if (compression == "ZSTD") {
+                creation_options.emplace_back("ZSTD_LEVEL=" + level);
+            } else if (compression == "LZMA") {
+                creation_options.emplace_back("LZMA_PRESET=" + level);
+            } else {
+                LOG("output_options", warn,
+                    "compression level is ignored by {}", compression);
+            }
+        }
+        if (options.predictor > 0) {
+            if (options.predictor > 3) {
+                throw Exception("predictor must be 1, 2 or 3");
+            }
+            creation_options.emplace_back(
+                  "PREDICTOR=" + std::to_string(options.predictor));
+        }
+        if (options.compression_threads > 1) {
+            creation_options.emplace_back(
+                  "NUM_THREADS=" +
+                  std::to_string(options.compression_threads));
+        }
+    } else if (options.predictor > 0 || options.compression_level > 0) {
+        LOG("output_options", warn,
+            "predictor and compression level require a compression codec");
+    }
+
+    if (!options.bigtiff.empty()) {
+        creation_options.emplace_back("BIGTIFF=" + ToUpper(options.bigtiff));
+    } else if (is_compressed) {
+        // the final size of a compressed file is unknown at creation
+        creation_options.emplace_back("BIGTIFF=IF_SAFER");
+    }
+
+    return creation_options;
+}
+
+Size ComputeTileSize(const Size& output_block_size) {
+    if (output_block_size.row <= 0 || output_block_size.col <= 0 ||
+        output_block_size.row % kTileSizeMultiple != 0 ||
+        output_block_size.col % kTileSizeMultiple != 0) {
+        return {0, 0};
+    }
+    return output_block_size;
+}
+
+void SetBlockCacheMaxSize(std::size_t max_size) {
+    LOG("output_options", debug, "GDAL block cache: {:.1f} MB",
+        max_size / (1024. * 1024.));
+    ::GDALSetCacheMax64(static_cast<GIntBig>(max_size));
+}
+
+}  // namespace gdal
+}  // namespace sirius
@@ -0,0 +1,168 @@
+/**
+ * Copyright (C) 2018 CS - Systemes d'Information (CS-SI)
+ *
+ * This file is part of Sirius
+ *
+ *     https://github.com/CS-SI/SIRIUS
+ *
+ * Sirius is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sirius is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Sirius.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef SIRIUS_GDAL_OUTPUT_OPTIONS_H_
+#define SIRIUS_GDAL_OUTPUT_OPTIONS_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <string>
+#include <vector>
+
+#include <gdal.h>
+
+#include "sirius/image.h"
+#include "sirius/types.h"
+
+namespace sirius {
+namespace gdal {
+
+/**
+ * \brief Output format, data type, layout and compression
+ */
+struct OutputOptions {
+    /// GDAL driver of the output image: GTiff, or ENVI (raw pixels and a
+    ///   header file) which is written with positional writes in stream mode
+    std::string format{"GTiff"};
+
+    /// output pixel type (Byte, UInt16, Int16, Float32 or Float64)
+    GDALDataType data_type{GDT_Float32};
+
+    /// output pixels are resampled pixels * scale + offset
+    double scale{1.};
+    double offset{0.};
+
+    /// write tiles instead of strips
+    bool tiled{false};
+
+    /// tile size, default tile size if empty (stream mode uses the output
+    ///   block size)
+    Size tile_size{0, 0};
+
+    /// GTiff compression codec (LZW, DEFLATE, ZSTD, ...), none if empty or
+    ///   NONE
+    std::string compression;
+
+    /// codec level (ZLEVEL, ZSTD_LEVEL or LZMA_PRESET), codec default if 0
+    int compression_level{0};
+
+    /// TIFF predictor (1: none, 2: horizontal, 3: floating point), codec
+    ///   default if 0
+    int predictor{0};
+
+    /// BIGTIFF creation option (YES, NO, IF_NEEDED, IF_SAFER), IF_SAFER for
+    ///   compressed outputs and GDAL default otherwise if empty
+    std::string bigtiff;
+
+    /// threads compressing the output blocks, compression is done by the
+    ///   writing thread if 0 or 1
+    unsigned int compression_threads{0};
+};
+
+/**
+ * \brief Generate the creation options of the output driver
+ *
+ * Layout and compression options only apply to GTiff outputs, they are
+ *   ignored with a warning for ENVI outputs.
+ *
+ * \param options output options
+ * \return creation options (NAME=VALUE)
+ * \throw sirius::Exception if an option is invalid
+ */
+std::vector<std::string> GenerateCreationOptions(const OutputOptions& options);
+
+/**
+ * \brief Parse an output format
+ * \param format_name GTiff or ENVI (case insensitive)
+ * \return GDAL driver name
+ * \throw sirius::Exception if the format is not supported
+ */
+std::string ParseOutputFormat(const std::string& format_name);
+
+/**
+ * \brief Output format is a raw format with a fixed pixel layout
+ *
+ * Pixel (row, col) of a single band raw output is stored at offset
+ *   (row * width + col) * pixel size of the data file, so that blocks can be
+ *   written concurrently at their position.
+ *
+ * \param options output options
+ * \return true if the output pixels can be written at computed offsets
+ */
+bool IsRawFormat(const OutputOptions& options);
+
+/**
+ * \brief Parse an output data type
+ * \param data_type_name UInt8 (or Byte), UInt16, Int16, Float32 or Float64
+ *        (case insensitive)
+ * \return GDAL data type
+ * \throw sirius::Exception if the data type is not supported
+ */
+GDALDataType ParseOutputDataType(const std::string& data_type_name);
+
+/**
+ * \brief Convert resampled pixels to the output data type
+ *
+ * Pixels are scaled and offset, rounded to the nearest integer for integer
+ *   types and saturated to the range of the output data type. NaN pixels
+ *   are converted to 0 for integer types.
+ *
+ * \param image resampled image
+ * \param options output data type, scale and offset
+ * \param output_data converted pixels (row major), resized to the image
+ */
+void ConvertToOutputType(const Image& image, const OutputOptions& options,
+                         std::vector<std::uint8_t>& output_data);
+
+/**
+ * \brief Convert resampled pixels to the output data type into a buffer
+ * \param image resampled image
+ * \param options output data type, scale and offset
+ * \param output_data converted pixels (row major), buffer of image cell
+ *        count x output pixel size bytes
+ */
+void ConvertToOutputType(const Image& image, const OutputOptions& options,
+                         std::uint8_t* output_data);
+
+/**
+ * \brief Compute a tile size matching the output blocks
+ *
+ * GTiff tile dimensions must be multiples of 16. The output block size is
+ *   used if it complies, so that each output block row covers full tile rows
+ *   which are written once, without going through the GDAL block cache.
+ *
+ * \param output_block_size size of a resampled stream block
+ * \return tile size, empty if the output block size does not comply
+ */
+Size ComputeTileSize(const Size& output_block_size);
+
+/**
+ * \brief Limit the memory used by the GDAL block cache
+ * \param max_size cache size in bytes
+ */
+void SetBlockCacheMaxSize(std::size_t max_size);
+
+}  // namespace gdal
+}  // namespace sirius
+
+#endif  // SIRIUS_GDAL_OUTPUT_OPTIONS_H_
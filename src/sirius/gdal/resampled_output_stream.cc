@@ -21,7 +21,22 @@
 
 #include "sirius/gdal/resampled_output_stream.h"
 
+#include <cmath>
+#include <cstring>
+
+#include <algorithm>
+#include <cerrno>
+#include <iterator>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif  // _WIN32
+
+#include "sirius/exception.h"
+
 #include "sirius/gdal/error_code.h"
+#include "sirius/gdal/shard.h"
 #include "sirius/gdal/wrapper.h"
 
 #include "sirius/utils/log.h"
@@ -29,50 +44,548 @@
 namespace sirius {
 namespace gdal {
 
-ResampledOutputStream::ResampledOutputStream(const std::string& input_path,
-                                             const std::string& output_path,
-                                             const ZoomRatio& zoom_ratio)
-    : zoom_ratio_(zoom_ratio) {
+namespace {
+
+constexpr char kSequentialSinkPrefix[] = "/vsistdout";
+constexpr char kVirtualFileSystemPrefix[] = "/vsi";
+
+#ifndef _WIN32
+/**
+ * \brief Write a buffer at an offset of a file, retrying partial writes
+ */
+std::error_code WriteAt(int file, const std::uint8_t* data, std::size_t size,
+                        off_t offset) {
+    while (size > 0) {
+        ssize_t written_size = ::pwrite(file, data, size, offset);
+        if (written_size < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return std::error_code(errno, std::system_category());
+        }
+        data += written_size;
+        size -= written_size;
+        offset += written_size;
+    }
+    return {};
+}
+#endif  // _WIN32
+
+bool IsVirtualFile(const std::string& path) {
+    return path.compare(0, std::strlen(kVirtualFileSystemPrefix),
+                        kVirtualFileSystemPrefix) == 0;
+}
+
+/**
+ * \brief Sync a local file to disk
+ *
+ * Files of GDAL virtual file systems are not synced
+ */
+std::error_code SyncFile(const std::string& path) {
+#ifndef _WIN32
+    if (IsVirtualFile(path)) {
+        return {};
+    }
+    // dirty pages of the file are synced whatever the descriptor used
+    int file = ::open(path.c_str(), O_RDONLY);
+    if (file < 0) {
+        return std::error_code(errno, std::system_category());
+    }
+    std::error_code ec;
+    if (::fsync(file) != 0) {
+        ec = std::error_code(errno, std::system_category());
+    }
+    ::close(file);
+    return ec;
+#else
+    return {};
+#endif  // _WIN32
+}
+
+}  // namespace
+
+ResampledOutputStream::ResampledOutputStream(
+      const std::string& input_path, const std::string& output_path,
+      const ZoomRatio& zoom_ratio, const Size& grid_size,
+      const OutputOptions& output_options, const ImageWindow& input_area,
+      BlockJournal* journal)
+    : output_path_(output_path),
+      zoom_ratio_(zoom_ratio),
+      grid_size_(grid_size),
+      output_options_(output_options),
+      pixel_size_(GDALGetDataTypeSizeBytes(output_options.data_type)),
+      is_sequential_sink_(IsSequentialSink(output_path)),
+      journal_(journal) {
     auto input_dataset = gdal::LoadDataset(input_path);
 
-    int output_h =
-          std::ceil(input_dataset->GetRasterYSize() * zoom_ratio_.ratio());
-    int output_w =
-          std::ceil(input_dataset->GetRasterXSize() * zoom_ratio_.ratio());
+    Size input_size(input_dataset->GetRasterYSize(),
+                    input_dataset->GetRasterXSize());
+    Size image_size = input_size * zoom_ratio_.ratio();
+    band_count_ = input_dataset->GetRasterCount();
+
+    output_size_ = image_size;
+    bool is_shard = !input_area.IsEmpty() && !(input_area.row == 0 &&
+                                                input_area.col == 0 &&
+                                                input_area.size == input_size);
+    if (is_shard) {
+        // area ends are block positions unless they reach the image end
+        auto to_output = [this](int position, int input_end, int output_end) {
+            if (position >= input_end) {
+                return output_end;
+            }
+            return static_cast<int>(std::floor(
+                  position * zoom_ratio_.input_resolution() /
+                  static_cast<double>(zoom_ratio_.output_resolution())));
+        };
+        output_origin_ = {
+              to_output(input_area.col, input_size.col, image_size.col),
+              to_output(input_area.row, input_size.row, image_size.row)};
+        output_size_ = {
+              to_output(input_area.row + input_area.size.row, input_size.row,
+                        image_size.row) -
+                    output_origin_.y,
+              to_output(input_area.col + input_area.size.col, input_size.col,
+                        image_size.col) -
+                    output_origin_.x};
+    }
+    int output_h = output_size_.row;
+    int output_w = output_size_.col;
+
+    bool is_raw_output = IsRawFormat(output_options);
+    if (is_raw_output && is_sequential_sink_) {
+        throw sirius::Exception(
+              "raw outputs cannot be written to a sequential sink");
+    }
+    if (journal_ != nullptr && is_sequential_sink_) {
+        throw sirius::Exception(
+              "written blocks cannot be journaled for a sequential sink");
+    }
+
+    auto options = output_options;
+    if (is_sequential_sink_ && options.tiled) {
+        LOG("resampled_output_stream", warn,
+            "streamable output cannot be tiled, strips are used");
+        options.tiled = false;
+    }
+    auto creation_options = GenerateCreationOptions(options);
+    if (is_sequential_sink_) {
+        // one row strips are complete after each block row so that they
+        //   can be flushed in order
+        creation_options.emplace_back("STREAMABLE_OUTPUT=YES");
+        creation_options.emplace_back("BLOCKYSIZE=1");
+        if (grid_size_.row <= 0 || grid_size_.col <= 0) {
+            LOG("resampled_output_stream", warn,
+                "blocks are not reordered, output to '{}' may fail",
+                output_path);
+        }
+    }
 
     auto geo_ref = gdal::ComputeResampledGeoReference(input_path, zoom_ratio);
-    output_dataset_ =
-          gdal::CreateDataset(output_path, output_w, output_h, 1, geo_ref);
-    LOG("resampled_output_stream", info, "resampled image '{}' ({}x{})",
-        output_path, output_h, output_w);
+    if (is_shard && geo_ref.is_initialized) {
+        auto& geo_transform = geo_ref.geo_transform;
+        geo_transform[0] += output_origin_.x * geo_transform[1] +
+                            output_origin_.y * geo_transform[2];
+        geo_transform[3] += output_origin_.x * geo_transform[4] +
+                            output_origin_.y * geo_transform[5];
+    }
+    bool is_resumed = journal_ != nullptr &&
+                      journal_->CompletedBlockCount() > 0 &&
+                      OpenResumedDataset(output_path);
+    if (!is_resumed) {
+        output_dataset_ = gdal::CreateDataset(
+              output_path, output_w, output_h, band_count_, geo_ref,
+              creation_options, output_options.data_type,
+              output_options.format);
+    }
+    LOG("resampled_output_stream", info,
+        "resampled image '{}' ({}x{}, {} bands, {})", output_path, output_h,
+        output_w, band_count_, GDALGetDataTypeName(output_options.data_type));
+    if (is_shard && !is_resumed) {
+        ImageWindow shard_window;
+        shard_window.row = output_origin_.y;
+        shard_window.col = output_origin_.x;
+        shard_window.size = output_size_;
+        SetShardMetadata(output_dataset_.get(), shard_window, image_size);
+        LOG("resampled_output_stream", info,
+            "shard of {}x{} pixels at ({},{}) of a {}x{} resampled image",
+            output_h, output_w, shard_window.row, shard_window.col,
+            image_size.row, image_size.col);
+    }
+
+#ifndef _WIN32
+    if (is_raw_output && !IsVirtualFile(output_path)) {
+        // the driver has written the header, pixels are written directly in
+        //   the data file which covers the whole image so that blocks can be
+        //   written in any order
+        output_dataset_.reset();
+        raw_file_ = ::open(output_path.c_str(), O_WRONLY);
+        off_t data_size = static_cast<off_t>(output_h) * output_w *
+                          pixel_size_ * band_count_;
+        if (raw_file_ < 0 || ::ftruncate(raw_file_, data_size) != 0) {
+            std::string error_message = std::strerror(errno);
+            if (raw_file_ >= 0) {
+                ::close(raw_file_);
+            }
+            throw sirius::Exception("cannot open raw data file '" +
+                                    output_path + "': " + error_message);
+        }
+        LOG("resampled_output_stream", info,
+            "blocks are written with positional writes in '{}'",
+            output_path);
+    }
+#endif  // _WIN32
+}
+
+ResampledOutputStream::~ResampledOutputStream() {
+    if (!pending_blocks_.empty()) {
+        LOG("resampled_output_stream", warn,
+            "{} blocks of incomplete block rows were not written in order",
+            pending_blocks_.size());
+        if (!is_sequential_sink_) {
+            for (const auto& pending_block : pending_blocks_) {
+                WriteBlock(pending_block.second);
+            }
+        }
+    }
+    if (journal_ != nullptr) {
+        Checkpoint();
+    }
+    if (block_count_ > 0) {
+        LOG("resampled_output_stream", info,
+            "{} blocks written with {} writes (max reorder buffer: {:.1f} MB)",
+            block_count_.load(), write_count_.load(),
+            max_pending_data_size_ / (1024. * 1024.));
+    }
+#ifndef _WIN32
+    if (raw_file_ >= 0 && ::close(raw_file_) != 0) {
+        LOG("resampled_output_stream", error,
+            "error while closing raw data file: {}", std::strerror(errno));
+    }
+#endif  // _WIN32
+    if (journal_ != nullptr && journal_->IsComplete()) {
+        // the output file is closed before its journal is removed
+        output_dataset_.reset();
+        journal_->Remove();
+    }
+}
+
+bool ResampledOutputStream::IsSequentialSink(const std::string& output_path) {
+    return output_path.compare(0, std::strlen(kSequentialSinkPrefix),
+                               kSequentialSinkPrefix) == 0;
+}
+
+void ResampledOutputStream::ConvertBlock(StreamBlock& block) const {
+    std::size_t band_data_size = block.buffer.size.CellCount() * pixel_size_;
+    block.output_data.resize(band_data_size * block.BandCount());
+    ConvertToOutputType(block.buffer, output_options_,
+                        block.output_data.data());
+    Buffer().swap(block.buffer.data);
+    for (std::size_t i = 0; i < block.extra_buffers.size(); ++i) {
+        ConvertToOutputType(block.extra_buffers[i], output_options_,
+                            block.output_data.data() +
+                                  (i + 1) * band_data_size);
+        Buffer().swap(block.extra_buffers[i].data);
+    }
 }
 
 void ResampledOutputStream::Write(StreamBlock&& block, std::error_code& ec) {
+    ++block_count_;
+    if (block.BandCount() != band_count_) {
+        LOG("resampled_output_stream", error,
+            "block ({},{}) has {} bands instead of {}", block.row_idx,
+            block.col_idx, block.BandCount(), band_count_);
+        ec = make_error_code(CPLE_IllegalArg);
+        return;
+    }
+    if (block.output_data.empty()) {
+        ConvertBlock(block);
+    }
+
+    if (raw_file_ >= 0) {
+        ec = WriteRawBlock(block);
+        if (ec) {
+            LOG("resampled_output_stream", error,
+                "could not write block ({},{}) in raw data file: {}",
+                block.row_idx, block.col_idx, ec.message());
+            return;
+        }
+        MarkWritten(block);
+        if (journal_ != nullptr && journal_->IsCheckpointDue()) {
+            Checkpoint();
+        }
+        return;
+    }
+
+    CPLErr err = CE_None;
+    if (grid_size_.row <= 0 || grid_size_.col <= 0 || block.index < 0) {
+        err = WriteBlock(block);
+    } else {
+        pending_data_size_ += block.output_data.size();
+        max_pending_data_size_ =
+              std::max(max_pending_data_size_, pending_data_size_);
+        pending_blocks_.emplace(block.index, std::move(block));
+
+        // write completed block rows in order
+        while (err == CE_None && next_block_row_ < grid_size_.row) {
+            int first_index = next_block_row_ * grid_size_.col;
+            auto first = pending_blocks_.lower_bound(first_index);
+            auto last =
+                  pending_blocks_.lower_bound(first_index + grid_size_.col);
+            // blocks written by previous runs are not received
+            if (std::distance(first, last) +
+                      CountCompletedBlocks(next_block_row_) <
+                grid_size_.col) {
+                break;
+            }
+            if (first != last) {
+                err = WriteBlockRow(next_block_row_);
+            }
+            ++next_block_row_;
+        }
+    }
+
+    if (err) {
+        LOG("resampled_output_stream", error,
+            "GDAL error: {} - could not write to the given dataset", err);
+        ec = make_error_code(err);
+        return;
+    }
+    if (journal_ != nullptr && journal_->IsCheckpointDue()) {
+        Checkpoint();
+    }
+    ec = make_error_code(CPLE_None);
+}
+
+Point ResampledOutputStream::ComputeOutputPosition(
+      const StreamBlock& block) const {
     int out_row_idx =
           std::floor(block.row_idx * zoom_ratio_.input_resolution() /
                      static_cast<double>(zoom_ratio_.output_resolution()));
     int out_col_idx =
           std::floor(block.col_idx * zoom_ratio_.input_resolution() /
                      static_cast<double>(zoom_ratio_.output_resolution()));
+    return {out_col_idx - output_origin_.x, out_row_idx - output_origin_.y};
+}
+
+std::error_code ResampledOutputStream::WriteRawBlock(
+      const StreamBlock& block) {
+#ifndef _WIN32
+    auto position = ComputeOutputPosition(block);
+    std::size_t line_size = output_size_.col * pixel_size_;
+    std::size_t block_line_size = block.buffer.size.col * pixel_size_;
+    off_t offset = static_cast<off_t>(position.y) * line_size +
+                   position.x * pixel_size_;
 
     LOG("resampled_output_stream", debug,
         "writing block ({},{}) to ({},{}) (size: {}x{})", block.row_idx,
-        block.col_idx, out_row_idx, out_col_idx, block.buffer.size.row,
+        block.col_idx, position.y, position.x, block.buffer.size.row,
         block.buffer.size.col);
 
-    CPLErr err = output_dataset_->GetRasterBand(1)->RasterIO(
-          GF_Write, out_col_idx, out_row_idx, block.buffer.size.col,
-          block.buffer.size.row, const_cast<double*>(block.buffer.data.data()),
-          block.buffer.size.col, block.buffer.size.row, GDT_Float64, 0, 0,
-          NULL);
-    if (err) {
-        LOG("resampled_output_stream", error,
-            "GDAL error: {} - could not write to the given dataset", err);
-        ec = make_error_code(err);
+    // bands are stored one after the other (BSQ)
+    std::size_t block_band_size = block.buffer.size.row * block_line_size;
+    off_t band_size = static_cast<off_t>(output_size_.row) * line_size;
+    for (int band = 0; band < band_count_; ++band) {
+        const std::uint8_t* band_data =
+              block.output_data.data() + band * block_band_size;
+        off_t band_offset = offset + band * band_size;
+        if (block_line_size == line_size) {
+            // full width block lines are contiguous in the data file
+            ++write_count_;
+            auto ec = WriteAt(raw_file_, band_data, block_band_size,
+                              band_offset);
+            if (ec) {
+                return ec;
+            }
+            continue;
+        }
+        for (int row = 0; row < block.buffer.size.row; ++row) {
+            ++write_count_;
+            auto ec = WriteAt(raw_file_, band_data + row * block_line_size,
+                              block_line_size, band_offset + row * line_size);
+            if (ec) {
+                return ec;
+            }
+        }
+    }
+    return {};
+#else
+    return std::make_error_code(std::errc::not_supported);
+#endif  // _WIN32
+}
+
+CPLErr ResampledOutputStream::WriteBlock(const StreamBlock& block) {
+    auto position = ComputeOutputPosition(block);
+
+    LOG("resampled_output_stream", debug,
+        "writing block ({},{}) to ({},{}) (size: {}x{})", block.row_idx,
+        block.col_idx, position.y, position.x, block.buffer.size.row,
+        block.buffer.size.col);
+
+    // output blocks do not overlap: fully covered native blocks can be
+    //   written directly
+    ++write_count_;
+    CPLErr err = gdal::WriteWindow(output_dataset_.get(), position.y,
+                                   position.x, block.buffer.size,
+                                   block.output_data.data(),
+                                   output_options_.data_type);
+    if (err == CE_None) {
+        MarkWritten(block);
+    }
+    return err;
+}
+
+CPLErr ResampledOutputStream::WriteBlockRow(int block_row) {
+    // blocks written by previous runs are missing from resumed block rows
+    auto first = pending_blocks_.lower_bound(block_row * grid_size_.col);
+    auto last = pending_blocks_.lower_bound((block_row + 1) * grid_size_.col);
+
+    // blocks can be merged if they share their output rows and cover
+    //   contiguous columns
+    auto row_position = ComputeOutputPosition(first->second);
+    int row_height = first->second.buffer.size.row;
+    int row_width = 0;
+    bool can_merge = true;
+    for (auto it = first; it != last && can_merge; ++it) {
+        auto position = ComputeOutputPosition(it->second);
+        can_merge = position.y == row_position.y &&
+                    it->second.buffer.size.row == row_height &&
+                    position.x == row_position.x + row_width;
+        row_width += it->second.buffer.size.col;
+    }
+
+    CPLErr err = CE_None;
+    if (can_merge) {
+        // bands are copied one after the other in the row buffer
+        std::size_t row_line_size = row_width * pixel_size_;
+        std::size_t row_band_size = row_height * row_line_size;
+        row_buffer_.resize(row_band_size * band_count_);
+        std::size_t line_offset = 0;
+        for (auto it = first; it != last; ++it) {
+            const auto& block = it->second;
+            std::size_t block_line_size = block.buffer.size.col * pixel_size_;
+            std::size_t block_band_size = row_height * block_line_size;
+            for (int band = 0; band < band_count_; ++band) {
+                for (int row = 0; row < row_height; ++row) {
+                    std::memcpy(row_buffer_.data() + band * row_band_size +
+                                      row * row_line_size + line_offset,
+                                block.output_data.data() +
+                                      band * block_band_size +
+                                      row * block_line_size,
+                                block_line_size);
+                }
+            }
+            line_offset += block_line_size;
+        }
+
+        LOG("resampled_output_stream", debug,
+            "writing block row {} to ({},{}) (size: {}x{})", block_row,
+            row_position.y, row_position.x, row_height, row_width);
+        ++write_count_;
+        err = gdal::WriteWindow(output_dataset_.get(), row_position.y,
+                                row_position.x, {row_height, row_width},
+                                row_buffer_.data(),
+                                output_options_.data_type);
+        for (auto it = first; it != last && err == CE_None; ++it) {
+            MarkWritten(it->second);
+        }
+    } else {
+        for (auto it = first; it != last && err == CE_None; ++it) {
+            err = WriteBlock(it->second);
+        }
+    }
+
+    for (auto it = first; it != last; ++it) {
+        pending_data_size_ -= it->second.output_data.size();
+    }
+    pending_blocks_.erase(first, last);
+
+    if (err == CE_None && is_sequential_sink_) {
+        // one row strips of this block row are complete
+        output_dataset_->FlushCache();
+    }
+    return err;
+}
+
+bool ResampledOutputStream::OpenResumedDataset(
+      const std::string& output_path) {
+    try {
+        output_dataset_ = gdal::LoadDataset(output_path, GA_Update);
+    } catch (const std::exception&) {
+        output_dataset_.reset();
+    }
+    if (output_dataset_ == nullptr ||
+        output_dataset_->GetRasterYSize() != output_size_.row ||
+        output_dataset_->GetRasterXSize() != output_size_.col ||
+        output_dataset_->GetRasterCount() != band_count_ ||
+        output_dataset_->GetRasterBand(1)->GetRasterDataType() !=
+              output_options_.data_type) {
+        LOG("resampled_output_stream", warn,
+            "output image '{}' does not match journal '{}', every block is "
+            "computed again",
+            output_path, journal_->Path());
+        output_dataset_.reset();
+        journal_->Reset();
+        return false;
+    }
+    LOG("resampled_output_stream", info,
+        "output image '{}' is updated ({} blocks already written)",
+        output_path, journal_->CompletedBlockCount());
+    return true;
+}
+
+void ResampledOutputStream::MarkWritten(const StreamBlock& block) {
+    if (journal_ != nullptr && block.index >= 0) {
+        journal_->MarkWritten(block.index);
+    }
+}
+
+int ResampledOutputStream::CountCompletedBlocks(int block_row) const {
+    if (journal_ == nullptr || journal_->CompletedBlockCount() == 0) {
+        return 0;
+    }
+    int count = 0;
+    for (int col = 0; col < grid_size_.col; ++col) {
+        count += journal_->IsCompleted(block_row * grid_size_.col + col);
+    }
+    return count;
+}
+
+void ResampledOutputStream::Checkpoint() {
+    std::unique_lock<std::mutex> lock(checkpoint_mutex_, std::try_to_lock);
+    if (!lock) {
         return;
     }
-    ec = make_error_code(CPLE_None);
+
+    // blocks taken before the flush are on disk after the sync
+    auto block_indices = journal_->TakeWrittenBlocks();
+    std::error_code ec;
+    if (raw_file_ >= 0) {
+#ifndef _WIN32
+        if (::fsync(raw_file_) != 0) {
+            ec = std::error_code(errno, std::system_category());
+        }
+#endif  // _WIN32
+    } else if (output_dataset_ != nullptr) {
+        ::CPLErrorReset();
+        output_dataset_->FlushCache();
+        if (::CPLGetLastErrorType() >= CE_Failure) {
+            ec = make_error_code(::CPLGetLastErrorNo());
+        }
+        // flushed pixels are in the page cache until the file is synced
+        if (!ec) {
+            ec = SyncFile(output_path_);
+        }
+    }
+    if (!ec) {
+        ec = journal_->Commit(block_indices);
+    }
+    if (ec) {
+        LOG("resampled_output_stream", warn,
+            "checkpoint failed, {} blocks will be computed again if the job "
+            "is resumed: {}",
+            block_indices.size(), ec.message());
+    }
 }
 
 }  // namespace gdal
-}  // namespace sirus
+}  // namespace sirius
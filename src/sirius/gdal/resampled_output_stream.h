@@ -22,10 +22,21 @@
 #ifndef SIRIUS_GDAL_RESAMPLED_OUTPUT_STREAM_H_
 #define SIRIUS_GDAL_RESAMPLED_OUTPUT_STREAM_H_
 
+#include <cstddef>
+#include <cstdint>
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
 #include <system_error>
+#include <vector>
 
 #include "sirius/types.h"
 
+#include "sirius/gdal/block_grid.h"
+#include "sirius/gdal/block_journal.h"
+#include "sirius/gdal/output_options.h"
 #include "sirius/gdal/stream_block.h"
 #include "sirius/gdal/types.h"
 
@@ -34,29 +45,190 @@ namespace gdal {
 
 /**
  * \brief Write a resampled image by block
+ *
+ * If the block grid is known, blocks are reordered: a block row is written
+ *   with a single wide write once all its blocks are computed, and rows are
+ *   written from top to bottom. The reorder buffer is not bounded by the
+ *   stream: writers bound it by counting buffered blocks (see
+ *   PendingBlockCount) as blocks in flight.
+ *
+ * Rows written in order allow to stream the output to sequential sinks
+ *   (/vsistdout/), which are created as streamable GTiff (strips only).
+ *
+ * The output image has the bands of the input image. Blocks hold all the
+ *   bands and are written with a single RasterIO call.
+ *
+ * If the blocks only cover an area of the input image (shard), the output
+ *   image only covers the resampled area. Its georeference is shifted
+ *   accordingly and its placement in the whole resampled image is stored in
+ *   its metadata (see AssembleShards).
+ *
+ * With a block journal, written blocks are marked in the journal and
+ *   checkpoints flush and sync the output file before committing them
+ *   (files of GDAL virtual file systems are only flushed). If the
+ *   journal resumes a previous run, the output image is opened in update
+ *   mode and the blocks of the journal are considered as written.
+ *
+ * Raw outputs (ENVI) have a fixed pixel layout: the driver only writes the
+ *   header file, and blocks are written in the data file with positional
+ *   writes at the offset of their lines, in any order and from any thread.
+ *
+ * \warning Write is not thread safe, unless SupportsConcurrentWrites
  */
 class ResampledOutputStream {
   public:
+    /**
+     * \brief Create the output image
+     * \param input_path input image path
+     * \param output_path output image path
+     * \param zoom_ratio zoom ratio
+     * \param grid_size number of blocks in each direction, blocks are written
+     *        as soon as they are received if empty
+     * \param output_options output layout and compression
+     * \param input_area area of the input image covered by the blocks, the
+     *        whole image if empty
+     * \param journal journal of the written blocks, indexed as the grid.
+     *        It must outlive the stream and is removed once every block is
+     *        written. No journal if null.
+     * \throw sirius::Exception if a journal is given for a sequential sink
+     */
     ResampledOutputStream(const std::string& input_path,
                           const std::string& output_path,
-                          const ZoomRatio& zoom_ratio);
+                          const ZoomRatio& zoom_ratio,
+                          const Size& grid_size = {0, 0},
+                          const OutputOptions& output_options = {},
+                          const ImageWindow& input_area = {},
+                          BlockJournal* journal = nullptr);
 
-    ~ResampledOutputStream() = default;
+    /**
+     * \brief Write the remaining buffered blocks
+     */
+    ~ResampledOutputStream();
     ResampledOutputStream(const ResampledOutputStream&) = delete;
     ResampledOutputStream& operator=(const ResampledOutputStream&) = delete;
     ResampledOutputStream(ResampledOutputStream&&) = delete;
     ResampledOutputStream& operator=(ResampledOutputStream&&) = delete;
 
+    /**
+     * \brief Convert a zoomed block to the output data type
+     *
+     * Conversion is thread safe so that it can be done by the thread which
+     *   computed the block. Bands are converted one after the other and the
+     *   resampled pixels are released.
+     *
+     * \param block block to convert
+     */
+    void ConvertBlock(StreamBlock& block) const;
+
     /**
      * \brief Write a zoomed block in the output file
+     *
+     * The block is converted to the output data type if needed
+     *
      * \param block block to write
      * \param ec error code if operation failed
      */
     void Write(StreamBlock&& block, std::error_code& ec);
 
+    /**
+     * \brief Blocks can be written concurrently
+     *
+     * Blocks of a raw output are written with positional writes in the data
+     *   file: they are not reordered and Write is thread safe.
+     *
+     * \return true if Write can be called from several threads
+     */
+    bool SupportsConcurrentWrites() const { return raw_file_ >= 0; }
+
+    /**
+     * \brief Blocks buffered until their block row is complete
+     *
+     * A block leaves the reorder buffer when its block row is written
+     *
+     * \return number of buffered blocks
+     */
+    std::size_t PendingBlockCount() const { return pending_blocks_.size(); }
+
+    /**
+     * \brief Output path is a sequential sink which requires ordered writes
+     * \param output_path output path
+     * \return true if output path is a sequential sink
+     */
+    static bool IsSequentialSink(const std::string& output_path);
+
+  private:
+    /**
+     * \brief Write a block at its position in the output image
+     */
+    CPLErr WriteBlock(const StreamBlock& block);
+
+    /**
+     * \brief Write the buffered blocks of a block row
+     *
+     * Blocks sharing the same output rows and covering contiguous columns
+     *   are copied into a row buffer and written at once
+     */
+    CPLErr WriteBlockRow(int block_row);
+
+    /**
+     * \brief Write a block in the raw data file at the offset of its lines
+     */
+    std::error_code WriteRawBlock(const StreamBlock& block);
+
+    /**
+     * \brief Output position of a block in the output image
+     */
+    Point ComputeOutputPosition(const StreamBlock& block) const;
+
+    /**
+     * \brief Open the output image of the resumed job in update mode
+     * \return false if the output image does not match, the journal is then
+     *         reset
+     */
+    bool OpenResumedDataset(const std::string& output_path);
+
+    /**
+     * \brief Mark a written block in the journal
+     */
+    void MarkWritten(const StreamBlock& block);
+
+    /**
+     * \brief Number of blocks of a block row written by previous runs
+     */
+    int CountCompletedBlocks(int block_row) const;
+
+    /**
+     * \brief Flush and sync the output file, then commit the written
+     *        blocks
+     *
+     * Only one writer checkpoints at a time, other writers skip it
+     */
+    void Checkpoint();
+
   private:
+    std::string output_path_;
     gdal::DatasetUPtr output_dataset_;
+    // data file of a raw output written with positional writes
+    int raw_file_ = -1;
+    Size output_size_;
+    // position of the output image in the whole resampled image
+    Point output_origin_;
+    int band_count_ = 1;
     ZoomRatio zoom_ratio_;
+    Size grid_size_;
+    OutputOptions output_options_;
+    std::size_t pixel_size_;
+    bool is_sequential_sink_;
+    // reorder buffer
+    std::map<int, StreamBlock> pending_blocks_;
+    int next_block_row_ = 0;
+    std::vector<std::uint8_t> row_buffer_;
+    std::size_t pending_data_size_ = 0;
+    std::size_t max_pending_data_size_ = 0;
+    std::atomic<int> write_count_{0};
+    std::atomic<int> block_count_{0};
+    BlockJournal* journal_ = nullptr;
+    std::mutex checkpoint_mutex_;
 };
 
 }  // namespace gdal
@@ -0,0 +1,281 @@
+/**
+ * Copyright (C) 2018 CS - Systemes d'Information (CS-SI)
+ *
+ * This file is part of Sirius
+ *
+ *     https://github.com/CS-SI/SIRIUS
+ *
+ * Sirius is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sirius is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Sirius.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "sirius/gdal/shard.h"
+
+#include <cstdio>
+
+#include <sstream>
+
+#include <cpl_conv.h>
+#include <cpl_string.h>
+
+#include "sirius/exception.h"
+
+#include "sirius/gdal/exception.h"
+#include "sirius/gdal/wrapper.h"
+
+#include "sirius/utils/log.h"
+
+namespace sirius {
+namespace gdal {
+
+namespace {
+
+constexpr char kShardWindowKey[] = "SIRIUS_SHARD_WINDOW";
+constexpr char kImageSizeKey[] = "SIRIUS_IMAGE_SIZE";
+constexpr char kVrtExtension[] = "vrt";
+
+std::string EscapeXml(const std::string& value) {
+    char* escaped = ::CPLEscapeString(value.c_str(), -1, CPLES_XML);
+    std::string result(escaped);
+    ::CPLFree(escaped);
+    return result;
+}
+
+/**
+ * \brief Absolute path of a shard so that the VRT does not depend on the
+ *   current directory
+ */
+std::string GetAbsolutePath(const std::string& path) {
+    if (!::CPLIsFilenameRelative(path.c_str())) {
+        return path;
+    }
+    char* current_dir = ::CPLGetCurrentDir();
+    if (current_dir == nullptr) {
+        return path;
+    }
+    std::string absolute_path =
+          ::CPLFormFilename(current_dir, path.c_str(), nullptr);
+    ::CPLFree(current_dir);
+    return absolute_path;
+}
+
+/**
+ * \brief Placement of a shard in the assembled image
+ */
+struct ShardInfo {
+    std::string path;
+    ImageWindow window;
+    Size image_size;
+    int band_count = 0;
+    GDALDataType data_type = GDT_Unknown;
+    GeoReference geo_ref;
+};
+
+ShardInfo LoadShardInfo(const std::string& shard_path) {
+    auto dataset = LoadDataset(shard_path);
+    ShardInfo shard;
+    shard.path = GetAbsolutePath(shard_path);
+    if (!GetShardMetadata(dataset.get(), shard.window, shard.image_size)) {
+        throw sirius::Exception("'" + shard_path + "' is not a shard");
+    }
+    shard.band_count = dataset->GetRasterCount();
+    shard.data_type = dataset->GetRasterBand(1)->GetRasterDataType();
+
+    std::vector<double> geo_transform(6);
+    if (dataset->GetGeoTransform(geo_transform.data()) == CE_None) {
+        // move the origin back to the top left corner of the whole image
+        geo_transform[0] -= shard.window.col * geo_transform[1] +
+                            shard.window.row * geo_transform[2];
+        geo_transform[3] -= shard.window.col * geo_transform[4] +
+                            shard.window.row * geo_transform[5];
+        shard.geo_ref = {geo_transform, dataset->GetProjectionRef()};
+    }
+    return shard;
+}
+
+bool AreOverlapping(const ImageWindow& lhs, const ImageWindow& rhs) {
+    return lhs.row < rhs.row + rhs.size.row &&
+           rhs.row < lhs.row + lhs.size.row &&
+           lhs.col < rhs.col + rhs.size.col &&
+           rhs.col < lhs.col + lhs.size.col;
+}
+
+bool IsInside(const ImageWindow& window, const Size& image_size) {
+    return window.row >= 0 && window.col >= 0 && window.size.row > 0 &&
+           window.size.col > 0 &&
+           window.row + window.size.row <= image_size.row &&
+           window.col + window.size.col <= image_size.col;
+}
+
+/**
+ * \brief VRT description of the assembled image
+ */
+std::string GenerateVrt(const std::vector<ShardInfo>& shards) {
+    const auto& first_shard = shards.front();
+    std::ostringstream vrt;
+    vrt.precision(17);
+    vrt << "<VRTDataset rasterXSize=\"" << first_shard.image_size.col
+        << "\" rasterYSize=\"" << first_shard.image_size.row << "\">";
+    const auto& geo_ref = first_shard.geo_ref;
+    if (geo_ref.is_initialized) {
+        if (!geo_ref.projection_ref.empty()) {
+            vrt << "<SRS>" << EscapeXml(geo_ref.projection_ref) << "</SRS>";
+        }
+        vrt << "<GeoTransform>";
+        for (std::size_t i = 0; i < geo_ref.geo_transform.size(); ++i) {
+            vrt << (i > 0 ? ", " : "") << geo_ref.geo_transform[i];
+        }
+        vrt << "</GeoTransform>";
+    }
+    for (int band = 1; band <= first_shard.band_count; ++band) {
+        vrt << "<VRTRasterBand dataType=\""
+            << ::GDALGetDataTypeName(first_shard.data_type) << "\" band=\""
+            << band << "\">";
+        for (const auto& shard : shards) {
+            const auto& window = shard.window;
+            vrt << "<SimpleSource><SourceFilename relativeToVRT=\"0\">"
+                << EscapeXml(shard.path) << "</SourceFilename>"
+                << "<SourceBand>" << band << "</SourceBand>"
+                << "<SrcRect xOff=\"0\" yOff=\"0\" xSize=\"" << window.size.col
+                << "\" ySize=\"" << window.size.row << "\"/>"
+                << "<DstRect xOff=\"" << window.col << "\" yOff=\""
+                << window.row << "\" xSize=\"" << window.size.col
+                << "\" ySize=\"" << window.size.row << "\"/>"
+                << "</SimpleSource>";
+        }
+        vrt << "</VRTRasterBand>";
+    }
+    vrt << "</VRTDataset>";
+    return vrt.str();
+}
+
+}  // namespace
+
+void SetShardMetadata(GDALDataset* dataset, const ImageWindow& window,
+                      const Size& image_size) {
+    std::string window_value =
+          std::to_string(window.row) + " " + std::to_string(window.col) +
+          " " + std::to_string(window.size.row) + " " +
+          std::to_string(window.size.col);
+    std::string image_size_value = std::to_string(image_size.row) + " " +
+                                   std::to_string(image_size.col);
+    dataset->SetMetadataItem(kShardWindowKey, window_value.c_str());
+    dataset->SetMetadataItem(kImageSizeKey, image_size_value.c_str());
+}
+
+bool GetShardMetadata(GDALDataset* dataset, ImageWindow& window,
+                      Size& image_size) {
+    const char* window_value = dataset->GetMetadataItem(kShardWindowKey);
+    const char* image_size_value = dataset->GetMetadataItem(kImageSizeKey);
+    if (window_value == nullptr || image_size_value == nullptr) {
+        return false;
+    }
+    return std::sscanf(window_value, "%d %d %d %d", &window.row, &window.col,
+                       &window.size.row, &window.size.col) == 4 &&
+           std::sscanf(image_size_value, "%d %d", &image_size.row,
+                       &image_size.col) == 2;
+}
+
+void AssembleShards(const std::vector<std::string>& shard_paths,
+                    const std::string& output_path,
+                    const OutputOptions& output_options) {
+    if (shard_paths.empty()) {
+        throw sirius::Exception("no shard to assemble");
+    }
+
+    std::vector<ShardInfo> shards;
+    long long covered_cell_count = 0;
+    for (const auto& shard_path : shard_paths) {
+        shards.push_back(LoadShardInfo(shard_path));
+        const auto& shard = shards.back();
+        const auto& first_shard = shards.front();
+        if (!(shard.image_size == first_shard.image_size) ||
+            shard.band_count != first_shard.band_count ||
+            shard.data_type != first_shard.data_type) {
+            throw sirius::Exception("'" + shard_path + "' and '" +
+                                    shard_paths.front() +
+                                    "' are not shards of the same image");
+        }
+        LOG("shard", debug, "shard '{}': {}x{} pixels at ({},{})", shard_path,
+            shard.window.size.row, shard.window.size.col, shard.window.row,
+            shard.window.col);
+        if (!IsInside(shard.window, shard.image_size)) {
+            throw sirius::Exception("'" + shard_path +
+                                    "' is outside the assembled image");
+        }
+        // shards computed with different block grids overlap
+        for (std::size_t i = 0; i + 1 < shards.size(); ++i) {
+            if (AreOverlapping(shards[i].window, shard.window)) {
+                throw sirius::Exception("'" + shard_path + "' and '" +
+                                        shard_paths[i] + "' overlap");
+            }
+        }
+        covered_cell_count +=
+              static_cast<long long>(shard.window.size.row) *
+              shard.window.size.col;
+    }
+    // shards do not overlap: they cover the image if their areas add up to
+    //   the image area
+    const auto& image_size = shards.front().image_size;
+    if (covered_cell_count !=
+        static_cast<long long>(image_size.row) * image_size.col) {
+        LOG("shard", error,
+            "shards cover {} pixels of the {}x{} image, some shards are "
+            "missing",
+            covered_cell_count, image_size.row, image_size.col);
+        throw sirius::Exception("shards do not cover the assembled image");
+    }
+
+    ::GDALAllRegister();
+    auto vrt_description = GenerateVrt(shards);
+    DatasetUPtr vrt_dataset(static_cast<GDALDataset*>(
+          ::GDALOpen(vrt_description.c_str(), GA_ReadOnly)));
+    if (vrt_dataset == nullptr) {
+        LOG("shard", error, "could not create the VRT of the shards");
+        throw gdal::Exception();
+    }
+
+    bool is_vrt_output =
+          EQUAL(::CPLGetExtension(output_path.c_str()), kVrtExtension);
+    std::string driver_name = is_vrt_output ? "VRT" : output_options.format;
+    std::vector<std::string> creation_options;
+    if (!is_vrt_output) {
+        creation_options = GenerateCreationOptions(output_options);
+    }
+    std::vector<const char*> options;
+    for (const auto& option : creation_options) {
+        options.push_back(option.c_str());
+    }
+    options.push_back(nullptr);
+
+    auto driver =
+          ::GetGDALDriverManager()->GetDriverByName(driver_name.c_str());
+    if (driver == nullptr) {
+        throw sirius::Exception("GDAL driver '" + driver_name +
+                                "' is not available");
+    }
+    LOG("shard", info, "assembling {} shards into '{}' ({}x{}, {})",
+        shards.size(), output_path, image_size.row, image_size.col,
+        driver_name);
+    DatasetUPtr output_dataset(driver->CreateCopy(
+          output_path.c_str(), vrt_dataset.get(), FALSE,
+          const_cast<char**>(options.data()), nullptr, nullptr));
+    if (output_dataset == nullptr) {
+        LOG("shard", error, "could not create the image file '{}'",
+            output_path);
+        throw gdal::Exception();
+    }
+}
+
+}  // namespace gdal
+}  // namespace sirius
@@ -0,0 +1,83 @@
+/**
+ * Copyright (C) 2018 CS - Systemes d'Information (CS-SI)
+ *
+ * This file is part of Sirius
+ *
+ *     https://github.com/CS-SI/SIRIUS
+ *
+ * Sirius is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sirius is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Sirius.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SIRIUS_GDAL_SHARD_H_
+#define SIRIUS_GDAL_SHARD_H_
+
+#include <string>
+#include <vector>
+
+#include "sirius/types.h"
+
+#include "sirius/gdal/block_grid.h"
+#include "sirius/gdal/output_options.h"
+#include "sirius/gdal/types.h"
+
+namespace sirius {
+namespace gdal {
+
+/**
+ * \brief Tag a dataset as a shard of a resampled image
+ *
+ * The window of the shard and the size of the whole image are stored in the
+ *   SIRIUS_SHARD_WINDOW and SIRIUS_IMAGE_SIZE metadata items
+ *
+ * \param dataset shard dataset
+ * \param window window of the shard in the whole image
+ * \param image_size size of the whole image
+ */
+void SetShardMetadata(GDALDataset* dataset, const ImageWindow& window,
+                      const Size& image_size);
+
+/**
+ * \brief Read the placement of a shard
+ * \param dataset shard dataset
+ * \param window window of the shard in the whole image
+ * \param image_size size of the whole image
+ * \return false if the dataset is not a shard
+ */
+bool GetShardMetadata(GDALDataset* dataset, ImageWindow& window,
+                      Size& image_size);
+
+/**
+ * \brief Assemble the shards of a resampled image
+ *
+ * Shard windows must tile the whole image: shards computed with different
+ *   block grids overlap or leave gaps and are rejected.
+ *
+ * A VRT places each shard at its window. If the output path has the .vrt
+ *   extension, the VRT is saved and references the shard files. Otherwise
+ *   the shards are copied into an image created with the output options.
+ *
+ * \param shard_paths shard images
+ * \param output_path assembled image path
+ * \param output_options output format, layout and compression
+ * \throw sirius::Exception if an image is not a shard, shards are not
+ *        parts of the same image, or their windows overlap or leave gaps
+ */
+void AssembleShards(const std::vector<std::string>& shard_paths,
+                    const std::string& output_path,
+                    const OutputOptions& output_options = {});
+
+}  // namespace gdal
+}  // namespace sirius
+
+#endif  // SIRIUS_GDAL_SHARD_H_
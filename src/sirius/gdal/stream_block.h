@@ -22,6 +22,10 @@
 #ifndef SIRIUS_GDAL_STREAM_H_
 #define SIRIUS_GDAL_STREAM_H_
 
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
 #include "sirius/image.h"
 
 namespace sirius {
@@ -56,11 +60,28 @@ struct StreamBlock {
     StreamBlock(StreamBlock&&) = default;
     StreamBlock& operator=(StreamBlock&&) = default;
 
+    /**
+     * \brief Number of bands of the block
+     * \return band count
+     */
+    int BandCount() const { return 1 + static_cast<int>(extra_buffers.size()); }
+
+    /// block image of the first band
     Image buffer{};
+    /// block images of the other bands of a multi-band image, same size as
+    ///   buffer
+    std::vector<Image> extra_buffers{};
     int row_idx = 0;
     int col_idx = 0;
     Padding padding{};
     bool is_initialized = false;
+    /// index of the block in the stream (row major order), -1 if unknown
+    int index = -1;
+    /// block pixels converted to the output data type, band after band.
+    ///   Buffer data are released once converted
+    std::vector<std::uint8_t> output_data{};
+    /// time the computed block was handed over to the writer
+    std::chrono::steady_clock::time_point handed_over_time{};
 };
 
 }  // namespace gdal
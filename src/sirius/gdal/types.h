@@ -25,6 +25,7 @@
 #include <memory>
 #include <type_traits>
 
+#include <cpl_virtualmem.h>
 #include <gdal.h>
 #include <gdal_priv.h>
 
@@ -40,9 +41,20 @@ struct DatasetDeleter {
     void operator()(::GDALDataset* dataset) { ::GDALClose(dataset); }
 };
 
+/**
+ * \brief Deleter of CPLVirtualMem for smart pointer
+ */
+struct VirtualMemDeleter {
+    void operator()(::CPLVirtualMem* virtual_mem) {
+        ::CPLVirtualMemFree(virtual_mem);
+    }
+};
+
 }  // namespace detail
 
 using DatasetUPtr = std::unique_ptr<::GDALDataset, detail::DatasetDeleter>;
+using VirtualMemUPtr =
+      std::unique_ptr<::CPLVirtualMem, detail::VirtualMemDeleter>;
 
 }  // namespace gdal
 }  // namespace sirius
@@ -21,13 +21,304 @@
 
 #include "sirius/gdal/wrapper.h"
 
+#include <algorithm>
+#include <future>
+#include <vector>
+
 #include "sirius/gdal/exception.h"
 
 #include "sirius/utils/log.h"
+#include "sirius/utils/thread_pool.h"
 
 namespace sirius {
 namespace gdal {
 
+namespace {
+
+// pixels converted by a conversion task
+constexpr std::size_t kConversionChunkSize = 1 << 20;
+
+/**
+ * \brief Native blocks of an axis fully covered by a window
+ *
+ * Blocks first to last (inclusive) cover pixels [begin, end). The range is
+ *   empty if first > last.
+ */
+struct CoveredBlocks {
+    int first;
+    int last;
+    int begin;
+    int end;
+};
+
+CoveredBlocks ComputeCoveredBlocks(int offset, int length, int block_size,
+                                   int raster_size) {
+    CoveredBlocks blocks;
+    blocks.first = (offset + block_size - 1) / block_size;
+    blocks.last = blocks.first - 1;
+    int window_end = offset + length;
+    for (int i = blocks.first; i * block_size < window_end; ++i) {
+        // edge block is clipped by the raster
+        if (std::min((i + 1) * block_size, raster_size) > window_end) {
+            break;
+        }
+        blocks.last = i;
+    }
+    blocks.begin = blocks.first * block_size;
+    blocks.end = std::min((blocks.last + 1) * block_size, raster_size);
+    return blocks;
+}
+
+CPLErr TransferRasterWindow(GDALRasterBand* band, GDALRWFlag flag,
+                            int row_idx, int col_idx, int h, int w,
+                            GByte* buffer, GDALDataType buffer_type,
+                            int buffer_w) {
+    if (h <= 0 || w <= 0) {
+        return CE_None;
+    }
+    int pixel_size = GDALGetDataTypeSizeBytes(buffer_type);
+    return band->RasterIO(flag, col_idx, row_idx, w, h, buffer, w, h,
+                          buffer_type, pixel_size,
+                          static_cast<GSpacing>(buffer_w) * pixel_size,
+                          nullptr);
+}
+
+CPLErr TransferWindow(GDALRasterBand* band, GDALRWFlag flag, int row_idx,
+                      int col_idx, const Size& size, GByte* buffer,
+                      GDALDataType buffer_type) {
+    int block_w = 0;
+    int block_h = 0;
+    band->GetBlockSize(&block_w, &block_h);
+    auto rows = ComputeCoveredBlocks(row_idx, size.row, block_h,
+                                     band->GetYSize());
+    auto cols = ComputeCoveredBlocks(col_idx, size.col, block_w,
+                                     band->GetXSize());
+
+    if (rows.first > rows.last || cols.first > cols.last) {
+        // no native block is fully covered
+        return TransferRasterWindow(band, flag, row_idx, col_idx, size.row,
+                                    size.col, buffer, buffer_type, size.col);
+    }
+
+    int pixel_size = GDALGetDataTypeSizeBytes(buffer_type);
+    auto window_ptr = [buffer, pixel_size, row_idx, col_idx, &size](int row,
+                                                                   int col) {
+        return buffer + (static_cast<std::size_t>(row - row_idx) * size.col +
+                         (col - col_idx)) *
+                              pixel_size;
+    };
+
+    // parts of the window around the covered blocks
+    CPLErr err = TransferRasterWindow(
+          band, flag, row_idx, col_idx, rows.begin - row_idx, size.col,
+          window_ptr(row_idx, col_idx), buffer_type, size.col);
+    if (err == CE_None) {
+        err = TransferRasterWindow(band, flag, rows.end, col_idx,
+                                   row_idx + size.row - rows.end, size.col,
+                                   window_ptr(rows.end, col_idx), buffer_type,
+                                   size.col);
+    }
+    if (err == CE_None) {
+        err = TransferRasterWindow(band, flag, rows.begin, col_idx,
+                                   rows.end - rows.begin,
+                                   cols.begin - col_idx,
+                                   window_ptr(rows.begin, col_idx),
+                                   buffer_type, size.col);
+    }
+    if (err == CE_None) {
+        err = TransferRasterWindow(band, flag, rows.begin, cols.end,
+                                   rows.end - rows.begin,
+                                   col_idx + size.col - cols.end,
+                                   window_ptr(rows.begin, cols.end),
+                                   buffer_type, size.col);
+    }
+    if (err != CE_None) {
+        return err;
+    }
+
+    // covered blocks
+    GDALDataType block_type = band->GetRasterDataType();
+    int type_size = GDALGetDataTypeSizeBytes(block_type);
+    std::vector<GByte> block_buffer(
+          static_cast<std::size_t>(block_w) * block_h * type_size, 0);
+    for (int block_row = rows.first; block_row <= rows.last; ++block_row) {
+        int first_row = block_row * block_h;
+        int valid_h = std::min(block_h, band->GetYSize() - first_row);
+        for (int block_col = cols.first; block_col <= cols.last; ++block_col) {
+            int first_col = block_col * block_w;
+            int valid_w = std::min(block_w, band->GetXSize() - first_col);
+
+            if (flag == GF_Read) {
+                err = band->ReadBlock(block_col, block_row,
+                                      block_buffer.data());
+                if (err != CE_None) {
+                    return err;
+                }
+            }
+            for (int row = 0; row < valid_h; ++row) {
+                GByte* block_row_ptr =
+                      block_buffer.data() +
+                      static_cast<std::size_t>(row) * block_w * type_size;
+                GByte* window_row_ptr = window_ptr(first_row + row, first_col);
+                if (flag == GF_Read) {
+                    GDALCopyWords(block_row_ptr, block_type, type_size,
+                                  window_row_ptr, buffer_type, pixel_size,
+                                  valid_w);
+                } else {
+                    GDALCopyWords(window_row_ptr, buffer_type, pixel_size,
+                                  block_row_ptr, block_type, type_size,
+                                  valid_w);
+                }
+            }
+            if (flag == GF_Write) {
+                err = band->WriteBlock(block_col, block_row,
+                                       block_buffer.data());
+                if (err != CE_None) {
+                    return err;
+                }
+            }
+        }
+    }
+    return CE_None;
+}
+
+/**
+ * \brief Transfer a window of all the bands of a dataset with one RasterIO
+ */
+CPLErr TransferBands(GDALDataset* dataset, GDALRWFlag flag, int row_idx,
+                     int col_idx, const Size& size, GByte* buffer,
+                     GDALDataType buffer_type) {
+    int band_count = dataset->GetRasterCount();
+    if (band_count == 1) {
+        return TransferWindow(dataset->GetRasterBand(1), flag, row_idx,
+                              col_idx, size, buffer, buffer_type);
+    }
+    if (size.row <= 0 || size.col <= 0) {
+        return CE_None;
+    }
+    int pixel_size = GDALGetDataTypeSizeBytes(buffer_type);
+    GSpacing line_space = static_cast<GSpacing>(size.col) * pixel_size;
+    return dataset->RasterIO(flag, col_idx, row_idx, size.col, size.row,
+                             buffer, size.col, size.row, buffer_type,
+                             band_count, nullptr, pixel_size, line_space,
+                             line_space * size.row, nullptr);
+}
+
+/**
+ * \brief Convert pixels to double
+ *
+ * Chunks of pixels are converted by the library thread pool
+ */
+void ConvertToDouble(const GByte* buffer, GDALDataType buffer_type,
+                     double* output, std::size_t pixel_count) {
+    int pixel_size = GDALGetDataTypeSizeBytes(buffer_type);
+    auto convert = [buffer, buffer_type, pixel_size, output](
+                         std::size_t begin, std::size_t end) {
+        GDALCopyWords(const_cast<GByte*>(buffer) + begin * pixel_size,
+                      buffer_type, pixel_size, output + begin, GDT_Float64,
+                      sizeof(double), static_cast<int>(end - begin));
+    };
+
+    auto& thread_pool = utils::ThreadPool::Instance();
+    std::vector<std::future<void>> futures;
+    for (std::size_t begin = kConversionChunkSize; begin < pixel_count;
+         begin += kConversionChunkSize) {
+        std::size_t end = std::min(begin + kConversionChunkSize, pixel_count);
+        futures.push_back(
+              thread_pool.Submit([&convert, begin, end]() {
+                  convert(begin, end);
+              }));
+    }
+    // first chunk is converted by the calling thread
+    convert(0, std::min(kConversionChunkSize, pixel_count));
+    for (auto& future : futures) {
+        thread_pool.Wait(future);
+        future.get();
+    }
+}
+
+/**
+ * \brief Read the first bands of a dataset
+ *
+ * Bands are read in their native data type with a single RasterIO call and
+ *   converted to double in parallel
+ */
+std::vector<Image> ReadImageBands(GDALDataset* dataset, int band_count,
+                                  const std::string& filepath) {
+    Size size = {dataset->GetRasterYSize(), dataset->GetRasterXSize()};
+    LOG("gdal", trace, "image size: {}x{} ({} bands)", size.row, size.col,
+        band_count);
+
+    std::vector<Image> bands;
+    std::size_t cell_count = size.CellCount();
+    GDALDataType data_type = dataset->GetRasterBand(1)->GetRasterDataType();
+    CPLErr err = CE_None;
+    if (band_count == 1 && data_type == GDT_Float64) {
+        bands.emplace_back(size);
+        err = dataset->GetRasterBand(1)->RasterIO(
+              GF_Read, 0, 0, size.col, size.row, bands[0].data.data(),
+              size.col, size.row, GDT_Float64, 0, 0);
+    } else {
+        // read in the native data type and convert in parallel
+        int pixel_size = GDALGetDataTypeSizeBytes(data_type);
+        std::vector<GByte> native_buffer(cell_count * band_count *
+                                         pixel_size);
+        err = dataset->RasterIO(GF_Read, 0, 0, size.col, size.row,
+                                native_buffer.data(), size.col, size.row,
+                                data_type, band_count, nullptr, 0, 0, 0,
+                                nullptr);
+        for (int band = 0; err == CE_None && band < band_count; ++band) {
+            bands.emplace_back(size);
+            ConvertToDouble(native_buffer.data() +
+                                  band * cell_count * pixel_size,
+                            data_type, bands.back().data.data(), cell_count);
+        }
+    }
+    if (err) {
+        LOG("gdal", error,
+            "GDAL error: {} - could not get image data from file '{}'", err,
+            filepath);
+        throw gdal::Exception();
+    }
+    return bands;
+}
+
+/**
+ * \brief Write images as the bands of a new dataset
+ */
+void WriteImageBands(const std::vector<const Image*>& bands,
+                     const std::string& output_filepath,
+                     const GeoReference& geoRef,
+                     const OutputOptions& output_options) {
+    LOG("gdal", trace, "saving image into '{}'", output_filepath);
+    const Size& size = bands.front()->size;
+
+    // TODO: basic save implementation, test only ATM
+    auto dataset = CreateDataset(
+          output_filepath, size.col, size.row, static_cast<int>(bands.size()),
+          geoRef, GenerateCreationOptions(output_options),
+          output_options.data_type, output_options.format);
+
+    std::size_t band_data_size =
+          size.CellCount() * GDALGetDataTypeSizeBytes(output_options.data_type);
+    std::vector<std::uint8_t> output_data(band_data_size * bands.size());
+    for (std::size_t band = 0; band < bands.size(); ++band) {
+        ConvertToOutputType(*bands[band], output_options,
+                            output_data.data() + band * band_data_size);
+    }
+    CPLErr err = dataset->RasterIO(
+          GF_Write, 0, 0, size.col, size.row, output_data.data(), size.col,
+          size.row, output_options.data_type, static_cast<int>(bands.size()),
+          nullptr, 0, 0, 0, nullptr);
+    if (err) {
+        LOG("image", error, "GDAL error: {} - could not write in file '{}'",
+            err, output_filepath);
+        throw gdal::Exception();
+    }
+}
+
+}  // namespace
+
 GeoReference::GeoReference()
     : geo_transform{0, 1, 0, 0, 0, 1},
       projection_ref(""),
@@ -39,7 +330,7 @@ GeoReference::GeoReference(const std::vector<double>& geo_trans,
       projection_ref(proj_ref),
       is_initialized(true) {}
 
-DatasetUPtr LoadDataset(const std::string& filepath) {
+DatasetUPtr LoadDataset(const std::string& filepath, GDALAccess access) {
     if (filepath.empty()) {
         LOG("gdal", debug, "no filepath provided");
         return {};
@@ -49,7 +340,7 @@ DatasetUPtr LoadDataset(const std::string& filepath) {
 
     LOG("gdal", trace, "loading dataset '{}'", filepath);
     DatasetUPtr dataset(
-          static_cast<GDALDataset*>(::GDALOpen(filepath.c_str(), GA_ReadOnly)));
+          static_cast<GDALDataset*>(::GDALOpen(filepath.c_str(), access)));
     if (dataset == nullptr) {
         LOG("gdal", error, "could not open the image file '{}'", filepath);
         throw gdal::Exception();
@@ -59,7 +350,10 @@ DatasetUPtr LoadDataset(const std::string& filepath) {
 }
 
 DatasetUPtr CreateDataset(const std::string& filepath, int w, int h,
-                          int n_bands, const GeoReference& geo_ref) {
+                          int n_bands, const GeoReference& geo_ref,
+                          const std::vector<std::string>& creation_options,
+                          GDALDataType data_type,
+                          const std::string& driver_name) {
     if (filepath.empty()) {
         LOG("gdal", debug, "no filepath provided");
         return {};
@@ -69,9 +363,22 @@ DatasetUPtr CreateDataset(const std::string& filepath, int w, int h,
 
     LOG("gdal", trace, "creating dataset '{}'", filepath);
 
-    auto driver = ::GetGDALDriverManager()->GetDriverByName("GTiff");
-    DatasetUPtr dataset(
-          driver->Create(filepath.c_str(), w, h, n_bands, GDT_Float32, NULL));
+    std::vector<const char*> options;
+    for (const auto& option : creation_options) {
+        LOG("gdal", debug, "creation option: {}", option);
+        options.push_back(option.c_str());
+    }
+    options.push_back(nullptr);
+
+    auto driver =
+          ::GetGDALDriverManager()->GetDriverByName(driver_name.c_str());
+    if (driver == nullptr) {
+        throw sirius::Exception("GDAL driver '" + driver_name +
+                                "' is not available");
+    }
+    DatasetUPtr dataset(driver->Create(filepath.c_str(), w, h, n_bands,
+                                       data_type,
+                                       const_cast<char**>(options.data())));
     if (dataset == nullptr) {
         LOG("gdal", error, "could not create the image file '{}'", filepath);
         throw gdal::Exception();
@@ -104,43 +411,84 @@ Image LoadImage(const std::string& filepath) {
 
     LOG("gdal", trace, "loading image '{}'", filepath);
     auto dataset = LoadDataset(filepath);
+    return std::move(ReadImageBands(dataset.get(), 1, filepath).front());
+}
 
-    Size tmp_size = {dataset->GetRasterYSize(), dataset->GetRasterXSize()};
-    LOG("gdal", trace, "image size: {}x{}", tmp_size.row, tmp_size.col);
-
-    Buffer tmp_buffer(tmp_size.row * tmp_size.col);
-
-    CPLErr err = dataset->GetRasterBand(1)->RasterIO(
-          GF_Read, 0, 0, tmp_size.col, tmp_size.row, tmp_buffer.data(),
-          tmp_size.col, tmp_size.row, GDT_Float64, 0, 0);
-    if (err) {
-        LOG("gdal", error,
-            "GDAL error: {} - could not get image data from file '{}'", err,
-            filepath);
-        throw gdal::Exception();
+std::vector<Image> LoadImageBands(const std::string& filepath) {
+    if (filepath.empty()) {
+        LOG("gdal", debug, "no filepath provided");
+        return {};
     }
 
-    return {tmp_size, std::move(tmp_buffer)};
+    LOG("gdal", trace, "loading image bands '{}'", filepath);
+    auto dataset = LoadDataset(filepath);
+    return ReadImageBands(dataset.get(), dataset->GetRasterCount(), filepath);
 }
 
 void SaveImage(const Image& image, const std::string& output_filepath,
-               const GeoReference& geoRef) {
-    LOG("gdal", trace, "saving image into '{}'", output_filepath);
+               const GeoReference& geoRef,
+               const OutputOptions& output_options) {
+    WriteImageBands({&image}, output_filepath, geoRef, output_options);
+}
 
-    // TODO: basic save implementation, test only ATM
-    auto dataset = CreateDataset(output_filepath, image.size.col,
-                                 image.size.row, 1, geoRef);
-
-    auto band = dataset->GetRasterBand(1);
-    CPLErr err =
-          band->RasterIO(GF_Write, 0, 0, image.size.col, image.size.row,
-                         const_cast<double*>(image.data.data()), image.size.col,
-                         image.size.row, GDT_Float64, 0, 0);
-    if (err) {
-        LOG("image", error, "GDAL error: {} - could not write in file '{}'",
-            err, output_filepath);
-        throw gdal::Exception();
+void SaveImage(const std::vector<Image>& bands,
+               const std::string& output_filepath, const GeoReference& geoRef,
+               const OutputOptions& output_options) {
+    if (bands.empty()) {
+        throw sirius::Exception("no band to save into '" + output_filepath +
+                                "'");
+    }
+    std::vector<const Image*> band_images;
+    for (const auto& band : bands) {
+        band_images.push_back(&band);
     }
+    WriteImageBands(band_images, output_filepath, geoRef, output_options);
+}
+
+Size GetNativeBlockSize(const std::string& filepath) {
+    auto dataset = LoadDataset(filepath);
+    int block_w = 0;
+    int block_h = 0;
+    dataset->GetRasterBand(1)->GetBlockSize(&block_w, &block_h);
+    return {block_h, block_w};
+}
+
+CPLErr ReadWindow(GDALRasterBand* band, int row_idx, int col_idx,
+                  const Size& size, double* buffer) {
+    return ReadWindow(band, row_idx, col_idx, size, buffer, GDT_Float64);
+}
+
+CPLErr ReadWindow(GDALRasterBand* band, int row_idx, int col_idx,
+                  const Size& size, void* buffer, GDALDataType buffer_type) {
+    return TransferWindow(band, GF_Read, row_idx, col_idx, size,
+                          static_cast<GByte*>(buffer), buffer_type);
+}
+
+CPLErr WriteWindow(GDALRasterBand* band, int row_idx, int col_idx,
+                   const Size& size, const double* buffer) {
+    return WriteWindow(band, row_idx, col_idx, size, buffer, GDT_Float64);
+}
+
+CPLErr WriteWindow(GDALRasterBand* band, int row_idx, int col_idx,
+                   const Size& size, const void* buffer,
+                   GDALDataType buffer_type) {
+    return TransferWindow(
+          band, GF_Write, row_idx, col_idx, size,
+          static_cast<GByte*>(const_cast<void*>(buffer)), buffer_type);
+}
+
+CPLErr ReadWindow(GDALDataset* dataset, int row_idx, int col_idx,
+                  const Size& size, void* buffer, GDALDataType buffer_type) {
+    return TransferBands(dataset, GF_Read, row_idx, col_idx, size,
+                         static_cast<GByte*>(buffer), buffer_type);
+}
+
+CPLErr WriteWindow(GDALDataset* dataset, int row_idx, int col_idx,
+                   const Size& size, const void* buffer,
+                   GDALDataType buffer_type) {
+    return TransferBands(
+          dataset, GF_Write, row_idx, col_idx, size,
+          static_cast<GByte*>(const_cast<void*>(buffer)), buffer_type);
 }
 
 GeoReference ComputeResampledGeoReference(const std::string& input_path,
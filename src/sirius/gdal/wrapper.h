@@ -23,7 +23,9 @@
 #define SIRIUS_GDAL_WRAPPER_H_
 
 #include <string>
+#include <vector>
 
+#include "sirius/gdal/output_options.h"
 #include "sirius/gdal/types.h"
 #include "sirius/image.h"
 
@@ -51,13 +53,174 @@ struct GeoReference {
 
 Image LoadImage(const std::string& filepath);
 
+/**
+ * \brief Load all the bands of an image
+ *
+ * Bands are read with a single RasterIO call
+ *
+ * \param filepath image path
+ * \return one image per band
+ * \throw sirius::gdal::Exception if the image cannot be read
+ */
+std::vector<Image> LoadImageBands(const std::string& filepath);
+
 void SaveImage(const Image& image, const std::string& output_filepath,
-               const GeoReference& geoRef = {});
+               const GeoReference& geoRef = {},
+               const OutputOptions& output_options = {});
+
+/**
+ * \brief Save images as the bands of a multi-band image
+ * \param bands band images, all of the same size
+ * \param output_filepath output path
+ * \param geoRef georeference of the image
+ * \param output_options output format and data type
+ * \throw sirius::gdal::Exception if the image cannot be written
+ */
+void SaveImage(const std::vector<Image>& bands,
+               const std::string& output_filepath,
+               const GeoReference& geoRef = {},
+               const OutputOptions& output_options = {});
 
-DatasetUPtr LoadDataset(const std::string& filepath);
+/**
+ * \brief Open a dataset
+ * \param filepath image path
+ * \param access read only or update access
+ * \return opened dataset
+ * \throw sirius::gdal::Exception if the dataset cannot be opened
+ */
+DatasetUPtr LoadDataset(const std::string& filepath,
+                        GDALAccess access = GA_ReadOnly);
 
-DatasetUPtr CreateDataset(const std::string& filepath, int w, int h,
-                          int n_bands, const GeoReference& geo_ref = {});
+/**
+ * \brief Create a dataset
+ * \param filepath output path
+ * \param w width
+ * \param h height
+ * \param n_bands number of bands
+ * \param geo_ref georeference of the dataset
+ * \param creation_options driver creation options (NAME=VALUE)
+ * \param data_type pixel data type
+ * \param driver_name GDAL driver of the dataset
+ * \return created dataset
+ * \throw sirius::gdal::Exception if the dataset cannot be created
+ */
+DatasetUPtr CreateDataset(
+      const std::string& filepath, int w, int h, int n_bands,
+      const GeoReference& geo_ref = {},
+      const std::vector<std::string>& creation_options = {},
+      GDALDataType data_type = GDT_Float32,
+      const std::string& driver_name = "GTiff");
+
+/**
+ * \brief Get the native block size (tile or strip) of an image
+ * \param filepath image path
+ * \return native block size of the first band
+ */
+Size GetNativeBlockSize(const std::string& filepath);
+
+/**
+ * \brief Read a window of a band
+ *
+ * Native blocks fully covered by the window are read with ReadBlock so that
+ *   they are decoded once and do not go through the GDAL block cache. The
+ *   remaining parts of the window are read with RasterIO.
+ *
+ * \param band band to read
+ * \param row_idx first row of the window
+ * \param col_idx first col of the window
+ * \param size window size
+ * \param buffer output buffer of size.row x size.col pixels
+ * \return GDAL error
+ */
+CPLErr ReadWindow(GDALRasterBand* band, int row_idx, int col_idx,
+                  const Size& size, double* buffer);
+
+/**
+ * \brief Read a window of a band into a buffer of any data type
+ *
+ * \param band band to read
+ * \param row_idx first row of the window
+ * \param col_idx first col of the window
+ * \param size window size
+ * \param buffer output buffer of size.row x size.col pixels
+ * \param buffer_type data type of the buffer pixels
+ * \return GDAL error
+ */
+CPLErr ReadWindow(GDALRasterBand* band, int row_idx, int col_idx,
+                  const Size& size, void* buffer, GDALDataType buffer_type);
+
+/**
+ * \brief Write a window of a band
+ *
+ * Native blocks fully covered by the window are written with WriteBlock, the
+ *   remaining parts of the window are written with RasterIO.
+ *
+ * \warning Native blocks fully covered by the window must not be written by
+ *          other windows since WriteBlock bypasses the GDAL block cache
+ *
+ * \param band band to write
+ * \param row_idx first row of the window
+ * \param col_idx first col of the window
+ * \param size window size
+ * \param buffer input buffer of size.row x size.col pixels
+ * \return GDAL error
+ */
+CPLErr WriteWindow(GDALRasterBand* band, int row_idx, int col_idx,
+                   const Size& size, const double* buffer);
+
+/**
+ * \brief Write a window of a band from a buffer of any data type
+ *
+ * Covered native blocks of the same data type as the buffer are copied
+ *   without conversion.
+ *
+ * \param band band to write
+ * \param row_idx first row of the window
+ * \param col_idx first col of the window
+ * \param size window size
+ * \param buffer input buffer of size.row x size.col pixels
+ * \param buffer_type data type of the buffer pixels
+ * \return GDAL error
+ */
+CPLErr WriteWindow(GDALRasterBand* band, int row_idx, int col_idx,
+                   const Size& size, const void* buffer,
+                   GDALDataType buffer_type);
+
+/**
+ * \brief Read a window of all the bands of a dataset
+ *
+ * Bands are read with a single RasterIO call into a band sequential buffer.
+ *   Single band datasets are read as a band (see ReadWindow of a band).
+ *
+ * \param dataset dataset to read
+ * \param row_idx first row of the window
+ * \param col_idx first col of the window
+ * \param size window size
+ * \param buffer output buffer of band count x size.row x size.col pixels
+ * \param buffer_type data type of the buffer pixels
+ * \return GDAL error
+ */
+CPLErr ReadWindow(GDALDataset* dataset, int row_idx, int col_idx,
+                  const Size& size, void* buffer, GDALDataType buffer_type);
+
+/**
+ * \brief Write a window of all the bands of a dataset
+ *
+ * Bands are written with a single RasterIO call from a band sequential
+ *   buffer. Single band datasets are written as a band (see WriteWindow of a
+ *   band).
+ *
+ * \param dataset dataset to write
+ * \param row_idx first row of the window
+ * \param col_idx first col of the window
+ * \param size window size
+ * \param buffer input buffer of band count x size.row x size.col pixels
+ * \param buffer_type data type of the buffer pixels
+ * \return GDAL error
+ */
+CPLErr WriteWindow(GDALDataset* dataset, int row_idx, int col_idx,
+                   const Size& size, const void* buffer,
+                   GDALDataType buffer_type);
 
 /**
  * \brief Compute resampled georeference information
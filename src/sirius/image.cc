@@ -25,11 +25,32 @@
 
 #include <algorithm>
 #include <utility>
+#include <vector>
 
 #include "sirius/utils/log.h"
 
 namespace sirius {
 
+namespace {
+
+/**
+ * \brief Index of the source sample mirrored at idx, margins may be larger
+ *        than the source length
+ * \param idx index relative to the first source sample
+ * \param length source length
+ * \return mirrored index in [0, length)
+ */
+int MirrorIndex(int idx, int length) {
+    int period = 2 * length;
+    idx %= period;
+    if (idx < 0) {
+        idx += period;
+    }
+    return (idx < length) ? idx : period - 1 - idx;
+}
+
+}  // namespace
+
 Padding::Padding(int i_top, int i_bottom, int i_left, int i_right,
                  PaddingType i_type)
     : top(i_top),
@@ -105,6 +126,24 @@ Image Image::CreateMirrorPaddedImage(const Padding& padding) const {
 
     Image result({row_count, col_count});
 
+    if (padding.top > size.row || padding.bottom > size.row ||
+        padding.left > size.col || padding.right > size.col) {
+        // margins larger than the image: mirror indices need to be folded
+        std::vector<int> col_indices(col_count);
+        for (int col = 0; col < col_count; ++col) {
+            col_indices[col] = MirrorIndex(col - padding.left, size.col);
+        }
+        for (int row = 0; row < row_count; ++row) {
+            int data_row_offset =
+                  MirrorIndex(row - padding.top, size.row) * size.col;
+            for (int col = 0; col < col_count; ++col) {
+                result.data[row * col_count + col] =
+                      data[data_row_offset + col_indices[col]];
+            }
+        }
+        return result;
+    }
+
     std::fill(result.data.begin(), result.data.end(), 0);
 
     // top mirroring
@@ -21,62 +21,248 @@
 
 #include "sirius/image_streamer.h"
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
 #include <future>
+#include <mutex>
+#include <sstream>
 #include <vector>
 
+#include "sirius/fftw/fftw.h"
+
 #include "sirius/gdal/stream_block.h"
 
-#include "sirius/utils/concurrent_queue.h"
+#include "sirius/utils/lock_free_queue.h"
 #include "sirius/utils/log.h"
+#include "sirius/utils/pipeline_metrics.h"
+#include "sirius/utils/thread_pool.h"
+#include "sirius/utils/trace.h"
 
 namespace sirius {
 
+namespace {
+
+/**
+ * \brief Use the output block size as default tile size
+ */
+gdal::OutputOptions ComputeStreamOutputOptions(
+      const gdal::OutputOptions& output_options, const Size& block_size,
+      const ZoomRatio& zoom_ratio) {
+    auto options = output_options;
+    if (!options.tiled || (options.tile_size.row > 0 &&
+                           options.tile_size.col > 0)) {
+        return options;
+    }
+
+    Size output_block_size(0, 0);
+    int input_resolution = zoom_ratio.input_resolution();
+    int output_resolution = zoom_ratio.output_resolution();
+    if ((block_size.row * input_resolution) % output_resolution == 0 &&
+        (block_size.col * input_resolution) % output_resolution == 0) {
+        output_block_size = {
+              block_size.row * input_resolution / output_resolution,
+              block_size.col * input_resolution / output_resolution};
+    }
+    options.tile_size = gdal::ComputeTileSize(output_block_size);
+    if (options.tile_size.row > 0) {
+        LOG("image_streamer", info, "output tiles match output blocks: {}x{}",
+            options.tile_size.row, options.tile_size.col);
+    } else {
+        LOG("image_streamer", warn,
+            "output block size is not a multiple of 16, default tile size is "
+            "used and tiles shared by block rows go through the GDAL block "
+            "cache");
+    }
+    return options;
+}
+
+/**
+ * \brief Cache hits and misses since a previous state of the cache
+ */
+utils::CacheStatistics ComputeCacheStatisticsSince(
+      const utils::CacheStatistics& statistics,
+      const utils::CacheStatistics& initial_statistics) {
+    utils::CacheStatistics delta;
+    delta.hit_count = statistics.hit_count - initial_statistics.hit_count;
+    delta.miss_count = statistics.miss_count - initial_statistics.miss_count;
+    return delta;
+}
+
+/**
+ * \brief Journal of the written blocks if checkpoints are requested
+ *
+ * The job description lists the parameters which define the stream blocks
+ *   and the output pixels (resampling description of the checkpoint options
+ *   included), so that the journal of another job is not resumed
+ */
+std::unique_ptr<gdal::BlockJournal> CreateJournal(
+      const gdal::CheckpointOptions& checkpoint_options,
+      const std::string& input_path, const gdal::InputStream& input_stream,
+      const Size& block_size, const ZoomRatio& zoom_ratio,
+      const FilterMetadata& filter_metadata, bool pad_edge_blocks,
+      const gdal::OutputOptions& output_options) {
+    if (checkpoint_options.journal_path.empty()) {
+        return {};
+    }
+    auto block_range = input_stream.BlockRange();
+    std::ostringstream job_description;
+    job_description.precision(17);
+    job_description << "input=" << input_path << " block=" << block_size.row
+                    << "x" << block_size.col
+                    << " margin=" << filter_metadata.margin_size.row << "x"
+                    << filter_metadata.margin_size.col
+                    << " padding=" << static_cast<int>(
+                                            filter_metadata.padding_type)
+                    << " pad_edges=" << pad_edge_blocks
+                    << " range=" << block_range.row << "," << block_range.col
+                    << "," << block_range.size.row << ","
+                    << block_range.size.col
+                    << " ratio=" << zoom_ratio.input_resolution() << ":"
+                    << zoom_ratio.output_resolution()
+                    << " format=" << output_options.format << " type="
+                    << ::GDALGetDataTypeName(output_options.data_type)
+                    << " scale=" << output_options.scale
+                    << " offset=" << output_options.offset;
+    if (!checkpoint_options.resampling_description.empty()) {
+        job_description << " " << checkpoint_options.resampling_description;
+    }
+    return std::make_unique<gdal::BlockJournal>(
+          checkpoint_options.journal_path, job_description.str(),
+          input_stream.BlockCount(), checkpoint_options.interval);
+}
+
+}  // namespace
+
 ImageStreamer::ImageStreamer(const std::string& input_path,
                              const std::string& output_path,
                              const Size& block_size,
                              const ZoomRatio& zoom_ratio,
                              const FilterMetadata& filter_metadata,
-                             unsigned int max_parallel_workers)
+                             unsigned int max_parallel_workers,
+                             bool pad_edge_blocks,
+                             unsigned int max_pending_blocks,
+                             const gdal::OutputOptions& output_options,
+                             const gdal::ImageWindow& block_range,
+                             const gdal::CheckpointOptions& checkpoint_options)
     : max_parallel_workers_(max_parallel_workers),
+      max_pending_blocks_(std::max(max_pending_blocks, max_parallel_workers)),
       block_size_(block_size),
       zoom_ratio_(zoom_ratio),
       input_stream_(input_path, block_size, filter_metadata.margin_size,
-                    filter_metadata.padding_type),
-      output_stream_(input_path, output_path, zoom_ratio) {}
+                    filter_metadata.padding_type, pad_edge_blocks,
+                    block_range),
+      journal_(CreateJournal(checkpoint_options, input_path, input_stream_,
+                             block_size, zoom_ratio, filter_metadata,
+                             pad_edge_blocks, output_options)),
+      output_stream_(input_path, output_path, zoom_ratio,
+                     input_stream_.GridSize(),
+                     ComputeStreamOutputOptions(output_options, block_size,
+                                                zoom_ratio),
+                     input_stream_.Area(), journal_.get()) {
+    // the output stream resets the journal if the output image is missing
+    if (journal_ != nullptr && journal_->CompletedBlockCount() > 0) {
+        input_stream_.SkipBlocks(journal_->CompletedBlocks());
+    }
+
+    // reordered blocks keep their slot until their block row is written: a
+    //   block row and the blocks being computed must fit in the slots
+    if (max_parallel_workers_ > 1 &&
+        !output_stream_.SupportsConcurrentWrites()) {
+        auto min_pending_blocks =
+              static_cast<unsigned int>(input_stream_.GridSize().col) +
+              max_parallel_workers_;
+        if (max_pending_blocks_ < min_pending_blocks) {
+            LOG("image_streamer", info,
+                "pending blocks raised to {} to hold a block row",
+                min_pending_blocks);
+            max_pending_blocks_ = min_pending_blocks;
+        }
+    }
+}
 
 void ImageStreamer::Stream(const IFrequencyResampler& frequency_resampler,
                            const Filter& filter) {
     LOG("image_streamer", info, "stream block size: {}x{}", block_size_.row,
         block_size_.col);
+    // stages computed by the streaming thread and the tasks it runs are
+    //   timed in the stream metrics
+    utils::PipelineMetricsScope metrics_scope(&metrics_);
+    metrics_.Start();
+    last_metrics_report_ = std::chrono::steady_clock::now();
+    initial_plan_cache_ = fftw::Fftw::Instance().PlanCacheStatistics();
+    initial_filter_cache_ = filter.FFTCacheStatistics();
+
     if (max_parallel_workers_ == 1) {
         RunMonothreadStream(frequency_resampler, filter);
     } else {
         RunMultithreadStream(frequency_resampler, filter);
     }
+
+    ReportMetrics(filter, true);
+    const auto& metrics = last_metrics_;
+    LOG("image_streamer", info,
+        "{} blocks written in {:.2f} s ({:.1f} blocks/s, read {:.1f} MB/s, "
+        "write {:.1f} MB/s)",
+        metrics.written_block_count, metrics.elapsed_s,
+        metrics.BlocksPerSecond(), metrics.ReadMBPerSecond(),
+        metrics.WriteMBPerSecond());
+}
+
+void ImageStreamer::SetMetricsCallback(utils::PipelineMetricsCallback callback,
+                                       std::chrono::milliseconds interval) {
+    metrics_callback_ = std::move(callback);
+    metrics_interval_ = interval;
 }
 
 void ImageStreamer::RunMonothreadStream(
       const IFrequencyResampler& frequency_resampler, const Filter& filter) {
     LOG("image_streamer", info, "start monothreaded streaming");
+    TRACE_BLOCK_SCOPE();
     while (!input_stream_.IsAtEnd()) {
         std::error_code read_ec;
-        auto block = input_stream_.Read(read_ec);
+        gdal::StreamBlock block;
+        {
+            // scoped trace events stay balanced if the read throws
+            TRACE_SCOPE("image_streamer", "read");
+            utils::StageTimer read_timer(utils::PipelineStage::kRead);
+            block = input_stream_.Read(read_ec);
+            read_timer.Stop();
+            TRACE_SET_BLOCK(block.index);
+        }
         if (read_ec) {
             LOG("image_streamer", error, "error while reading block: {}",
                 read_ec.message());
             break;
         }
+        metrics_.AddReadBlock();
+        metrics_.UpdateOccupancy(1, 0);
 
-        block.buffer = std::move(frequency_resampler.Compute(
-              zoom_ratio_, block.buffer, block.padding, filter));
+        ComputeBlock(frequency_resampler, filter, block, false);
+        {
+            TRACE_SCOPE("image_streamer", "convert");
+            utils::StageTimer convert_timer(utils::PipelineStage::kConvert);
+            output_stream_.ConvertBlock(block);
+        }
+        metrics_.AddComputedBlock();
+        metrics_.UpdateOccupancy(0, 1);
 
         std::error_code write_ec;
-        output_stream_.Write(std::move(block), write_ec);
+        std::size_t byte_count = block.output_data.size();
+        {
+            TRACE_SCOPE("image_streamer", "write");
+            utils::StageTimer write_timer(utils::PipelineStage::kWrite);
+            output_stream_.Write(std::move(block), write_ec);
+        }
         if (write_ec) {
             LOG("image_streamer", error, "error while writing block: {}",
                 write_ec.message());
             break;
         }
+        metrics_.AddWrittenBlock(byte_count);
+        metrics_.UpdateOccupancy(0, 0);
+        ReportMetrics(filter);
     }
     LOG("image_streamer", info, "end monothreaded streaming");
 }
@@ -85,117 +271,348 @@ void ImageStreamer::RunMultithreadStream(
       const IFrequencyResampler& frequency_resampler, const Filter& filter) {
     LOG("image_streamer", info, "start multithreaded streaming");
 
-    // use block queues
-    utils::ConcurrentQueue<gdal::StreamBlock> input_queue(
-          max_parallel_workers_);
-    utils::ConcurrentQueue<gdal::StreamBlock> output_queue(
-          max_parallel_workers_);
+    auto& thread_pool = utils::ThreadPool::Instance();
+    LOG("image_streamer", info,
+        "start zoom processing with {} parallel blocks ({} pending blocks) "
+        "on {} threads",
+        max_parallel_workers_, max_pending_blocks_, thread_pool.ThreadCount());
 
-    auto input_stream_task = [this, &input_queue]() {
-        LOG("image_streamer", info, "start reading blocks");
-        while (!input_stream_.IsAtEnd() && input_queue.IsActive()) {
-            std::error_code read_ec;
-            auto block = input_stream_.Read(read_ec);
-            if (read_ec) {
-                LOG("image_streamer", error, "error while reading block: {}",
-                    read_ec.message());
-                break;
-            }
+    // blocks read but not written yet (reordered blocks included) and
+    //   blocks being computed
+    std::mutex slot_mutex;
+    std::condition_variable slot_cond;
+    unsigned int pending_block_count = 0;
+    unsigned int computing_block_count = 0;
+    std::atomic<bool> has_error{false};
+
+    // computed blocks waiting to be written, at most one per slot
+    utils::LockFreeQueue<gdal::StreamBlock> output_queue(max_pending_blocks_);
+    std::atomic<unsigned int> unwritten_block_count{0};
+
+    // blocks being computed are in the input queue, computed blocks not
+    //   written yet are in the output queue. Workers writing their own
+    //   block release their slot before their worker.
+    auto update_occupancy = [this, &pending_block_count,
+                             &computing_block_count]() {
+        int output_block_count = static_cast<int>(pending_block_count) -
+                                 static_cast<int>(computing_block_count);
+        metrics_.UpdateOccupancy(static_cast<int>(computing_block_count),
+                                 std::max(output_block_count, 0));
+    };
+
+    auto release_slots = [&slot_mutex, &slot_cond, &pending_block_count,
+                          &update_occupancy](unsigned int count) {
+        {
+            std::lock_guard<std::mutex> lock(slot_mutex);
+            pending_block_count -= count;
+            update_occupancy();
+        }
+        slot_cond.notify_all();
+    };
+
+    auto release_worker = [&slot_mutex, &slot_cond, &computing_block_count,
+                           &update_occupancy]() {
+        {
+            std::lock_guard<std::mutex> lock(slot_mutex);
+            --computing_block_count;
+            update_occupancy();
+        }
+        slot_cond.notify_all();
+    };
+
+    auto is_slot_available = [this, &pending_block_count,
+                              &computing_block_count]() {
+        return pending_block_count < max_pending_blocks_ &&
+               computing_block_count < max_parallel_workers_;
+    };
+
+    // write errors and exceptions (memory exhaustion while buffering a
+    //   block row) stop the stream
+    auto write_output_block = [this, &has_error](gdal::StreamBlock&& block) {
+        TRACE_SCOPE("image_streamer", "write");
+        std::error_code write_ec;
+        std::size_t byte_count = block.output_data.size();
+        utils::StageTimer write_timer(utils::PipelineStage::kWrite);
+        try {
+            output_stream_.Write(std::move(block), write_ec);
+        } catch (const std::exception& e) {
+            LOG("image_streamer", error, "exception while writing block: {}",
+                e.what());
+            has_error = true;
+            return;
+        }
+        write_timer.Stop();
+        if (write_ec) {
+            LOG("image_streamer", error, "error while writing block: {}",
+                write_ec.message());
+            has_error = true;
+        } else {
+            metrics_.AddWrittenBlock(byte_count);
+        }
+    };
 
-            std::error_code push_input_ec;
-            input_queue.Push(std::move(block), push_input_ec);
-            if (push_input_ec) {
+    // only one task writes at a time: the task which hands over the first
+    //   unwritten block becomes the writer and writes blocks until every
+    //   handed over block is written, the other tasks just hand over their
+    //   blocks. Blocks buffered by the output stream until their block row
+    //   is complete keep their slot. After an error, the writer keeps
+    //   popping handed over blocks and drops them.
+    auto hand_over_block = [this, &output_queue, &unwritten_block_count,
+                            &has_error, &release_slots,
+                            &write_output_block](gdal::StreamBlock&& block) {
+        std::error_code push_ec;
+        block.handed_over_time = std::chrono::steady_clock::now();
+        TRACE_ASYNC_BEGIN("image_streamer", "queue_wait", block.index);
+        output_queue.Push(std::move(block), push_ec);
+        if (push_ec) {
+            // a block which is not pushed is left untouched
+            TRACE_ASYNC_END("image_streamer", "queue_wait", block.index);
+            LOG("image_streamer", error,
+                "cannot push computed block into output queue: {}",
+                push_ec.message());
+            has_error = true;
+            release_slots(1);
+            return;
+        }
+        if (unwritten_block_count.fetch_add(1) != 0) {
+            // current writer will handle this block
+            return;
+        }
+
+        unsigned int remaining_count = 1;
+        while (remaining_count > 0) {
+            // counted blocks are already in the queue
+            std::error_code pop_ec;
+            std::vector<gdal::StreamBlock> blocks;
+            try {
+                blocks = output_queue.PopBatch(remaining_count, pop_ec);
+            } catch (const std::exception& e) {
+                // no block was popped: blocks left in the queue are never
+                //   written but the error stops the stream
                 LOG("image_streamer", error,
-                    "cannot push input block into input queue: {}",
-                    push_input_ec.message());
-                break;
+                    "exception while popping computed blocks: {}", e.what());
+                has_error = true;
+                return;
+            }
+            std::size_t buffered_count = output_stream_.PendingBlockCount();
+            for (auto& computed_block : blocks) {
+                TRACE_ASYNC_END("image_streamer", "queue_wait",
+                                computed_block.index);
+                if (has_error) {
+                    // block is dropped
+                    continue;
+                }
+                metrics_.Record(utils::PipelineStage::kQueueWait,
+                                std::chrono::steady_clock::now() -
+                                      computed_block.handed_over_time);
+                TRACE_SET_BLOCK(computed_block.index);
+                write_output_block(std::move(computed_block));
             }
+            auto written_count = static_cast<unsigned int>(blocks.size());
+            release_slots(static_cast<unsigned int>(
+                  written_count + buffered_count -
+                  output_stream_.PendingBlockCount()));
+            remaining_count =
+                  unwritten_block_count.fetch_sub(written_count) -
+                  written_count;
         }
-        input_queue.Deactivate();
-        LOG("image_streamer", info, "end reading blocks");
     };
 
-    auto worker_task = [this, &input_queue, &output_queue, &frequency_resampler,
-                        &filter]() {
+    // blocks of raw outputs are written at their offset by the tasks which
+    //   computed them, without going through a single writer
+    auto write_block = [&release_slots,
+                        &write_output_block](gdal::StreamBlock&& block) {
+        write_output_block(std::move(block));
+        release_slots(1);
+    };
+    bool has_concurrent_writes = output_stream_.SupportsConcurrentWrites();
+    if (has_concurrent_writes) {
+        LOG("image_streamer", info, "blocks are written by their workers");
+    }
+
+    // each task reads a block with its own dataset handle, computes and
+    //   hands it over to the writer (or writes it). Tasks pull block indices
+    //   from the shared input stream iterator.
+    auto block_task = [this, &frequency_resampler, &filter, &has_error,
+                       &release_slots, &release_worker, &hand_over_block,
+                       &write_block, has_concurrent_writes]() {
+        // tasks may run on any thread of the pool
+        utils::PipelineMetricsScope metrics_scope(&metrics_);
+        TRACE_BLOCK_SCOPE();
+        gdal::StreamBlock block;
         try {
-            while (input_queue.CanPop()) {
-                std::error_code pop_input_ec;
-                auto block = input_queue.Pop(pop_input_ec);
-                if (pop_input_ec) {
-                    // no more block to process
-                    LOG("image_streamer", debug,
-                        "cannot pop input block from input queue: {}",
-                        pop_input_ec.message());
-                    break;
-                }
+            std::error_code read_ec;
+            {
+                // scoped trace events stay balanced if the read throws
+                TRACE_SCOPE("image_streamer", "read");
+                utils::StageTimer read_timer(utils::PipelineStage::kRead);
+                block = input_stream_.Read(read_ec);
+                read_timer.Stop();
+                TRACE_SET_BLOCK(block.index);
+            }
+            if (read_ec) {
+                LOG("image_streamer", error, "error while reading block: {}",
+                    read_ec.message());
+                has_error = true;
+                release_worker();
+                release_slots(1);
+                return;
+            }
 
-                block.buffer = std::move(frequency_resampler.Compute(
-                      zoom_ratio_, block.buffer, block.padding, filter));
+            metrics_.AddReadBlock();
 
-                std::error_code push_output_ec;
-                output_queue.Push(std::move(block), push_output_ec);
-                if (push_output_ec) {
-                    LOG("image_streamer", error,
-                        "cannot push computed block into output queue: {}",
-                        push_output_ec.message());
-                    break;
-                }
+            ComputeBlock(frequency_resampler, filter, block, true);
+            // the writer only copies converted pixels
+            {
+                TRACE_SCOPE("image_streamer", "convert");
+                utils::StageTimer convert_timer(
+                      utils::PipelineStage::kConvert);
+                output_stream_.ConvertBlock(block);
             }
+            metrics_.AddComputedBlock();
         } catch (const std::exception& e) {
             LOG("image_streamer", error, "exception while processing block: {}",
                 e.what());
-            input_queue.Deactivate();
-            output_queue.Deactivate();
+            has_error = true;
+            release_worker();
+            release_slots(1);
+            return;
         }
+        if (has_concurrent_writes) {
+            write_block(std::move(block));
+            release_worker();
+            return;
+        }
+        release_worker();
+        hand_over_block(std::move(block));
     };
 
-    auto output_stream_task = [this, &output_queue]() {
-        LOG("image_streamer", info, "start writing blocks");
-        while (output_queue.CanPop()) {
-            std::error_code pop_output_ec;
-            std::error_code write_ec;
-            auto block = output_queue.Pop(pop_output_ec);
-            if (pop_output_ec) {
-                // no more block to process
-                break;
+    std::vector<std::future<void>> block_task_futures;
+    int block_count = input_stream_.StreamedBlockCount();
+    // after an error, reordered blocks may never release their slot
+    auto can_submit = [&has_error, &is_slot_available]() {
+        return has_error || is_slot_available();
+    };
+    for (int i = 0; i < block_count && !has_error; ++i) {
+        // bound the number of blocks in memory, help the pool meanwhile
+        std::unique_lock<std::mutex> lock(slot_mutex);
+        while (!can_submit()) {
+            lock.unlock();
+            bool has_run_task = thread_pool.RunPendingTask();
+            lock.lock();
+            if (!has_run_task) {
+                TRACE_SCOPE("image_streamer", "wait_slot");
+                slot_cond.wait(lock, can_submit);
             }
-            output_stream_.Write(std::move(block), write_ec);
-            if (write_ec) {
-                LOG("image_streamer", error, "error while writing block: {}",
-                    write_ec.message());
-                output_queue.DeactivateAndClear();
+        }
+        if (has_error) {
+            break;
+        }
+        ++pending_block_count;
+        ++computing_block_count;
+        update_occupancy();
+        lock.unlock();
+
+        block_task_futures.push_back(thread_pool.Submit(block_task));
+        ReportMetrics(filter);
+    }
+
+    // block tasks reference the locals of this function: wait for all of
+    //   them before forwarding the first error
+    std::exception_ptr error;
+    for (auto& block_task_future : block_task_futures) {
+        thread_pool.Wait(block_task_future);
+        try {
+            block_task_future.get();
+        } catch (...) {
+            if (!error) {
+                error = std::current_exception();
             }
         }
-        output_queue.Deactivate();
-        LOG("image_streamer", info, "end writing blocks");
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    LOG("image_streamer", info, "end zoom processing");
+    LOG("image_streamer", info, "end multithreaded streaming");
+}
+
+void ImageStreamer::ComputeBlock(const IFrequencyResampler& frequency_resampler,
+                                 const Filter& filter,
+                                 gdal::StreamBlock& block,
+                                 bool parallel_bands) const {
+    // band tasks time their stages in the metrics of the calling thread
+    auto* metrics = utils::PipelineMetrics::Current();
+    auto compute_band = [this, &frequency_resampler, &filter, &block,
+                         metrics](Image& band) {
+        utils::PipelineMetricsScope metrics_scope(metrics);
+        TRACE_BLOCK_SCOPE();
+        TRACE_SET_BLOCK(block.index);
+        TRACE_SCOPE("image_streamer", "compute_band");
+        band = frequency_resampler.Compute(zoom_ratio_, band, block.padding,
+                                           filter);
     };
 
-    auto output_task_future =
-          std::async(std::launch::async, output_stream_task);
-    auto input_task_future = std::async(std::launch::async, input_stream_task);
+    auto& thread_pool = utils::ThreadPool::Instance();
+    std::vector<std::future<void>> band_futures;
+    for (auto& band : block.extra_buffers) {
+        if (parallel_bands) {
+            band_futures.push_back(thread_pool.Submit(
+                  [&compute_band, &band]() { compute_band(band); }));
+        } else {
+            compute_band(band);
+        }
+    }
 
-    LOG("image_streamer", info, "start zoom processing with {} workers",
-        max_parallel_workers_);
-    using WorkerTasks = std::vector<std::future<void>>;
-    WorkerTasks worker_task_futures;
-    for (unsigned int i = 0; i < max_parallel_workers_; ++i) {
-        worker_task_futures.push_back(
-              std::async(std::launch::async, worker_task));
+    // band tasks reference the block: wait for all of them before
+    //   forwarding the first error
+    std::exception_ptr error;
+    try {
+        compute_band(block.buffer);
+    } catch (...) {
+        error = std::current_exception();
     }
-    for (auto& worker_task_future : worker_task_futures) {
+    for (auto& band_future : band_futures) {
+        thread_pool.Wait(band_future);
         try {
-            // wait end of task or error
-            worker_task_future.get();
-        } catch (const std::exception& e) {
-            LOG("image_streamer", error, "exception on worker task: {}",
-                e.what());
+            band_future.get();
+        } catch (...) {
+            if (!error) {
+                error = std::current_exception();
+            }
         }
     }
-    LOG("image_streamer", info, "end zoom processing");
-    output_queue.Deactivate();
-    output_task_future.get();
-    input_task_future.get();
-    LOG("image_streamer", info, "end multithreaded streaming");
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+utils::PipelineMetricsSnapshot ImageStreamer::CollectMetrics(
+      const Filter& filter) const {
+    auto metrics = metrics_.Snapshot();
+    auto input_statistics = input_stream_.Statistics();
+    metrics.requested_pixel_count = input_statistics.requested_pixel_count;
+    metrics.read_pixel_count = input_statistics.read_pixel_count;
+    metrics.read_byte_count =
+          input_statistics.read_pixel_count * input_statistics.pixel_size;
+    metrics.fft_plan_cache = ComputeCacheStatisticsSince(
+          fftw::Fftw::Instance().PlanCacheStatistics(), initial_plan_cache_);
+    metrics.filter_cache = ComputeCacheStatisticsSince(
+          filter.FFTCacheStatistics(), initial_filter_cache_);
+    return metrics;
+}
+
+void ImageStreamer::ReportMetrics(const Filter& filter, bool force) {
+    auto now = std::chrono::steady_clock::now();
+    if (!force && (!metrics_callback_ ||
+                   now - last_metrics_report_ < metrics_interval_)) {
+        return;
+    }
+    last_metrics_report_ = now;
+    last_metrics_ = CollectMetrics(filter);
+    if (metrics_callback_) {
+        metrics_callback_(last_metrics_);
+    }
 }
 
 }  // namespace sirius
@@ -22,13 +22,19 @@
 #ifndef SIRIUS_IMAGE_STREAMER_H_
 #define SIRIUS_IMAGE_STREAMER_H_
 
+#include <chrono>
+#include <memory>
+
 #include "sirius/filter.h"
 #include "sirius/i_frequency_resampler.h"
 
+#include "sirius/gdal/block_journal.h"
 #include "sirius/gdal/input_stream.h"
 #include "sirius/gdal/resampled_output_stream.h"
 #include "sirius/gdal/wrapper.h"
 
+#include "sirius/utils/pipeline_metrics.h"
+
 namespace sirius {
 
 /**
@@ -47,11 +53,30 @@ class ImageStreamer {
      * \param padding_type filter padding type
      * \param max_parallel_workers max parallel workers to compute the zoom on
      *        stream blocks
+     * \param pad_edge_blocks pad edge blocks to the nominal block size
+     * \param max_pending_blocks max blocks in flight (read, computed or
+     *        waiting to be written), 0 or less than max_parallel_workers
+     *        means max_parallel_workers. Reordered blocks waiting for their
+     *        block row are in flight: with several workers, it is raised to
+     *        one block row plus max_parallel_workers.
+     * \param output_options output layout and compression, tiles match the
+     *        output blocks if no tile size is given
+     * \param block_range range of the block grid to stream (shard), the
+     *        output image only covers the resampled blocks of the range. The
+     *        whole grid is streamed if empty.
+     * \param checkpoint_options journal of the written blocks. If the
+     *        journal of a previous run of the same job exists, the output
+     *        image is updated and the journaled blocks are skipped.
      */
     ImageStreamer(const std::string& input_path, const std::string& output_path,
                   const Size& block_size, const ZoomRatio& zoom_ratio,
                   const FilterMetadata& filter_metadata,
-                  unsigned int max_parallel_workers);
+                  unsigned int max_parallel_workers,
+                  bool pad_edge_blocks = false,
+                  unsigned int max_pending_blocks = 0,
+                  const gdal::OutputOptions& output_options = {},
+                  const gdal::ImageWindow& block_range = {},
+                  const gdal::CheckpointOptions& checkpoint_options = {});
 
     /**
      * \brief Stream the input image, compute the resampling and stream
@@ -63,6 +88,32 @@ class ImageStreamer {
     void Stream(const IFrequencyResampler& frequency_resampler,
                 const Filter& filter);
 
+    /**
+     * \brief Receive live metrics while streaming
+     *
+     * The callback is called by the streaming thread, at most once per
+     *   interval, and once at the end of the stream
+     *
+     * \param callback metrics callback, none if empty
+     * \param interval minimal time between two calls
+     */
+    void SetMetricsCallback(
+          utils::PipelineMetricsCallback callback,
+          std::chrono::milliseconds interval = std::chrono::seconds(1));
+
+    /**
+     * \brief Metrics of the last stream
+     *
+     * Stage latencies, block counts and throughputs, queue occupancy and
+     *   cache hits. FFTW plan cache is shared by the process: its hits
+     *   include the ones of concurrent computations.
+     *
+     * \return pipeline metrics
+     */
+    const utils::PipelineMetricsSnapshot& Metrics() const {
+        return last_metrics_;
+    }
+
   private:
     /**
      * \brief Stream image in monothreading mode
@@ -79,11 +130,13 @@ class ImageStreamer {
     /**
      * \brief Stream image in multithreading mode
      *
-     * One thread will generate input blocks and feed an input queue
-     * One thread will consume resampled blocks from an output queue and write
-     *   them in the output file
-     * max_parallel_tasks threads will consume input blocks from an input queue,
-     *   compute the resampled blocks and feed an output queue
+     * The calling thread schedules one task per block on the library thread
+     *   pool. A task reads the next input block with its own dataset handle,
+     *   computes the resampled block and writes it in the output file, or
+     *   hands it over to the task which is currently writing. Blocks of raw
+     *   outputs are written concurrently by their tasks. At most
+     *   max_parallel_workers blocks are computed at the same time and at most
+     *   max_pending_blocks blocks are in flight.
      *
      * \param frequency_resampler frequency zoom to apply on stream block
      * \param filter filter to apply on stream block
@@ -91,12 +144,52 @@ class ImageStreamer {
     void RunMultithreadStream(const IFrequencyResampler& frequency_resampler,
                               const Filter& filter);
 
+    /**
+     * \brief Resample every band of a block
+     *
+     * Bands share the block size, hence the FFTW plans and the filter
+     *   spectrum. The first band is computed by the calling thread.
+     *
+     * \param frequency_resampler frequency zoom to apply on the bands
+     * \param filter filter to apply on the bands
+     * \param block block to resample
+     * \param parallel_bands other bands are computed by the thread pool
+     */
+    void ComputeBlock(const IFrequencyResampler& frequency_resampler,
+                      const Filter& filter, gdal::StreamBlock& block,
+                      bool parallel_bands) const;
+
+    /**
+     * \brief Collect the pipeline metrics and the cache statistics
+     * \param filter streamed filter
+     */
+    utils::PipelineMetricsSnapshot CollectMetrics(const Filter& filter) const;
+
+    /**
+     * \brief Send the metrics to the callback if the interval has elapsed
+     * \param filter streamed filter
+     * \param force ignore the interval
+     */
+    void ReportMetrics(const Filter& filter, bool force = false);
+
   private:
     unsigned int max_parallel_workers_;
+    unsigned int max_pending_blocks_;
     Size block_size_;
     ZoomRatio zoom_ratio_;
     gdal::InputStream input_stream_;
+    // journal outlives the output stream which removes it once complete
+    std::unique_ptr<gdal::BlockJournal> journal_;
     gdal::ResampledOutputStream output_stream_;
+
+    utils::PipelineMetrics metrics_;
+    utils::PipelineMetricsSnapshot last_metrics_;
+    utils::PipelineMetricsCallback metrics_callback_;
+    std::chrono::milliseconds metrics_interval_{std::chrono::seconds(1)};
+    std::chrono::steady_clock::time_point last_metrics_report_;
+    // cache statistics at the start of the stream
+    utils::CacheStatistics initial_plan_cache_;
+    utils::CacheStatistics initial_filter_cache_;
 };
 
 }  // namespace sirius
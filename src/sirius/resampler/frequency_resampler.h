@@ -53,14 +53,6 @@ class FrequencyResampler final
     Image Compute(const ZoomRatio& ratio, const Image& input,
                   const Padding& image_padding,
                   const Filter& filter = {}) const override;
-
-  private:
-    Image UnpadImage(const ZoomRatio& zoom_ratio, const Image& original_image,
-                     const Image& zoomed_image, const Padding& image_padding,
-                     const Filter& filter) const;
-
-    Image DecimateImage(const Image& zoomed_image,
-                        const ZoomRatio& zoom_ratio) const;
 };
 
 }  // namespace resampler
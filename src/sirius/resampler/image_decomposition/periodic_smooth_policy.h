@@ -25,6 +25,8 @@
 #include "sirius/filter.h"
 #include "sirius/image.h"
 
+#include "sirius/resampler/output_window.h"
+
 namespace sirius {
 namespace resampler {
 
@@ -37,10 +39,8 @@ template <class ZoomStrategy>
 class ImageDecompositionPeriodicSmoothPolicy : private ZoomStrategy {
   public:
     Image DecomposeAndZoom(int zoom, const Image& even_image,
-                           const Filter& filter) const;
-
-  private:
-    Image Interpolate2D(int zoom, const Image& even_image) const;
+                           const Filter& filter,
+                           const OutputWindow& output_window) const;
 };
 
 }  // namespace resampler
@@ -29,13 +29,21 @@
 #include "sirius/fftw/wrapper.h"
 
 #include "sirius/utils/gsl.h"
+#include "sirius/utils/pipeline_metrics.h"
+#include "sirius/utils/trace.h"
 
 namespace sirius {
 namespace resampler {
 
 template <class ZoomStrategy>
 Image ImageDecompositionPeriodicSmoothPolicy<ZoomStrategy>::DecomposeAndZoom(
-      int zoom, const Image& image, const Filter& filter) const {
+      int zoom, const Image& image, const Filter& filter,
+      const OutputWindow& output_window) const {
+    // zoom of the periodic part is timed by the zoom strategy
+    utils::StageTimer decomposition_timer(
+          utils::PipelineStage::kDecomposition);
+    TRACE_BEGIN("periodic_smooth_decomposition", "decomposition");
+
     // 1) compute intensity changes between two opposite borders
     LOG("periodic_smooth_decomposition", trace, "compute intensity changes");
     Image border_intensity_changes(image.size);
@@ -141,110 +149,28 @@ Image ImageDecompositionPeriodicSmoothPolicy<ZoomStrategy>::DecomposeAndZoom(
     // 7) apply zoom on periodic part
     LOG("periodic_smooth_decomposition", trace, "zoom periodic part");
     // method inherited from ZoomStrategy
+    decomposition_timer.Pause();
+    TRACE_END("periodic_smooth_decomposition", "decomposition");
     auto zoomed_image = this->Zoom(zoom, periodic_part_image, filter);
+    decomposition_timer.Resume();
+    TRACE_BEGIN("periodic_smooth_decomposition", "smooth_part_ifft");
 
     // 7) ifft smooth part
     LOG("periodic_smooth_decomposition", trace, "smooth part IFFT");
     auto smooth_part_image = fftw::IFFT(image.size, std::move(smooth_part_fft));
+    decomposition_timer.Stop();
+    TRACE_END("periodic_smooth_decomposition", "smooth_part_ifft");
 
-    // 8) normalize smooth_part_image
-    LOG("periodic_smooth_decomposition", trace, "normalize smooth image part");
-    int image_cell_count = image.CellCount();
-    std::for_each(
-          smooth_part_image.data.begin(), smooth_part_image.data.end(),
-          [image_cell_count](double& cell) { cell /= image_cell_count; });
-
-    // 9) interpolate 2d smooth part image
-    LOG("periodic_smooth_decomposition", trace,
-        "interpolate smooth image part");
-    auto interpolated_smooth_image = Interpolate2D(zoom, smooth_part_image);
-
-    // 10) normalize periodic_part_image
+    // 8) normalize and sum periodic and interpolated smooth parts in the
+    //    output window. Periodic part is scaled twice by the image cell
+    //    count (IFFT and zoom), smooth part is scaled once (IFFT)
     LOG("periodic_smooth_decomposition", trace,
-        "normalize periodic image part");
-    std::for_each(
-          zoomed_image.data.begin(), zoomed_image.data.end(),
-          [image_cell_count](double& cell) { cell /= image_cell_count; });
-
-    // 11) sum periodic and smooth parts
-    LOG("periodic_smooth_decomposition", trace,
-        "sum periodic and smooth image parts");
-    Image output_image(zoomed_image.size);
-    for (int i = 0; i < zoomed_image.size.row; i++) {
-        for (int j = 0; j < zoomed_image.size.col; j++) {
-            output_image.Set(i, j, zoomed_image.Get(i, j) +
-                                         interpolated_smooth_image.Get(i, j));
-        }
-    }
-
-    return output_image;
-}
-
-template <class ZoomStrategy>
-Image ImageDecompositionPeriodicSmoothPolicy<ZoomStrategy>::Interpolate2D(
-      int zoom, const Image& image) const {
-    Image interpolated_im(image.size * zoom);
-
-    std::vector<double> BLN_kernel(4, 0);
-    Size img_mirror_size(image.size.row + 1, image.size.col + 1);
-
-    std::vector<double> img_mirror(img_mirror_size.CellCount(), 0);
-    auto img_mirror_span = gsl::as_multi_span(img_mirror);
-    for (int i = 0; i < image.size.row; i++) {
-        for (int j = 0; j < image.size.col; j++) {
-            img_mirror_span[i * (image.size.col + 1) + j] = image.Get(i, j);
-        }
-    }
-
-    // duplicate last row
-    for (int j = 0; j < image.size.col + 1; j++) {
-        img_mirror_span[image.size.row * (image.size.col + 1) + j] =
-              img_mirror_span[(image.size.row - 1) * (image.size.col + 1) + j];
-    }
-
-    // duplicate last col
-    for (int i = 0; i < image.size.row + 1; i++) {
-        img_mirror_span[(i + 1) * (image.size.col + 1) - 1] =
-              img_mirror_span[(i + 1) * (image.size.col + 1) - 2];
-    }
-
-    for (int fx = 0; fx < zoom; fx++) {
-        for (int fy = 0; fy < zoom; fy++) {
-            BLN_kernel[0] = (1 - fx / static_cast<double>(zoom)) *
-                            (1 - fy / static_cast<double>(zoom));
-            BLN_kernel[1] = (1 - fx / static_cast<double>(zoom)) *
-                            (fy / static_cast<double>(zoom));
-            BLN_kernel[2] = (fx / static_cast<double>(zoom)) *
-                            (1 - fy / static_cast<double>(zoom));
-            BLN_kernel[3] = (fx / static_cast<double>(zoom)) *
-                            (fy / static_cast<double>(zoom));
-
-            // convolve. BLN_kernel is already flipped
-            for (int i = fx; i < image.size.row * zoom; i += zoom) {
-                for (int j = fy; j < image.size.col * zoom; j += zoom) {
-                    interpolated_im.Set(
-                          i, j,
-                          img_mirror_span[(i / zoom) * (image.size.col + 1) +
-                                          (j / zoom)] *
-                                      BLN_kernel[0] +
-                                img_mirror_span[(i / zoom + 1) *
-                                                      (image.size.col + 1) +
-                                                (j / zoom)] *
-                                      BLN_kernel[2] +
-                                img_mirror_span[(i / zoom) *
-                                                      (image.size.col + 1) +
-                                                (j / zoom + 1)] *
-                                      BLN_kernel[1] +
-                                img_mirror_span[(i / zoom + 1) *
-                                                      (image.size.col + 1) +
-                                                (j / zoom + 1)] *
-                                      BLN_kernel[3]);
-                }
-            }
-        }
-    }
-
-    return interpolated_im;
+        "sum periodic and interpolated smooth image parts");
+    TRACE_SCOPE("periodic_smooth_decomposition", "extract_output_window");
+    double image_cell_count = image.CellCount();
+    return ExtractOutputWindow(
+          zoomed_image, 1.0 / (image_cell_count * image_cell_count),
+          smooth_part_image, zoom, 1.0 / image_cell_count, output_window);
 }
 
 }  // namespace resampler
@@ -25,6 +25,8 @@
 #include "sirius/filter.h"
 #include "sirius/image.h"
 
+#include "sirius/resampler/output_window.h"
+
 namespace sirius {
 namespace resampler {
 
@@ -35,7 +37,8 @@ template <class ZoomStrategy>
 class ImageDecompositionRegularPolicy : private ZoomStrategy {
   public:
     Image DecomposeAndZoom(int zoom, const Image& padded_image,
-                           const Filter& filter) const;
+                           const Filter& filter,
+                           const OutputWindow& output_window) const;
 };
 
 }  // namespace resampler
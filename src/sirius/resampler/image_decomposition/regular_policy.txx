@@ -24,15 +24,23 @@
 
 #include "sirius/resampler/image_decomposition/regular_policy.h"
 
+#include "sirius/utils/trace.h"
+
 namespace sirius {
 namespace resampler {
 
 template <class ZoomStrategy>
 Image ImageDecompositionRegularPolicy<ZoomStrategy>::DecomposeAndZoom(
-      int zoom, const Image& padded_image, const Filter& filter) const {
+      int zoom, const Image& padded_image, const Filter& filter,
+      const OutputWindow& output_window) const {
     // method inherited from ZoomStrategy
     LOG("regular_decomposition", trace, "zoom image");
-    return this->Zoom(zoom, padded_image, filter);
+    auto zoomed_image = this->Zoom(zoom, padded_image, filter);
+
+    LOG("regular_decomposition", trace, "extract output window");
+    TRACE_SCOPE("regular_decomposition", "extract_output_window");
+    return ExtractOutputWindow(zoomed_image, 1.0 / padded_image.CellCount(),
+                               output_window);
 }
 
 }  // namespace resampler
@@ -0,0 +1,147 @@
+/**
+ * Copyright (C) 2018 CS - Systemes d'Information (CS-SI)
+ *
+ * This file is part of Sirius
+ *
+ *     https://github.com/CS-SI/SIRIUS
+ *
+ * Sirius is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sirius is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Sirius.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "sirius/resampler/output_window.h"
+
+#include <cmath>
+
+#include <algorithm>
+#include <vector>
+
+#include "sirius/utils/pipeline_metrics.h"
+
+namespace sirius {
+namespace resampler {
+
+OutputWindow ComputeOutputWindow(const ZoomRatio& zoom_ratio,
+                                 const Size& input_size,
+                                 const Padding& image_padding,
+                                 const Size& filter_padding_size) {
+    // input is already padded for the filter on sides without image padding
+    Size unpadded_size = input_size;
+    if (image_padding.top == 0) {
+        unpadded_size.row -= filter_padding_size.row;
+    }
+    if (image_padding.bottom == 0) {
+        unpadded_size.row -= filter_padding_size.row;
+    }
+    if (image_padding.left == 0) {
+        unpadded_size.col -= filter_padding_size.col;
+    }
+    if (image_padding.right == 0) {
+        unpadded_size.col -= filter_padding_size.col;
+    }
+
+    int zoom = zoom_ratio.input_resolution();
+    int stride = zoom_ratio.output_resolution();
+
+    OutputWindow window;
+    window.row_offset = filter_padding_size.row * zoom;
+    window.col_offset = filter_padding_size.col * zoom;
+    window.stride = stride;
+    window.size.row = static_cast<int>(
+          std::ceil(unpadded_size.row * zoom / static_cast<double>(stride)));
+    window.size.col = static_cast<int>(
+          std::ceil(unpadded_size.col * zoom / static_cast<double>(stride)));
+    return window;
+}
+
+Image ExtractOutputWindow(const Image& zoomed_image, double scale,
+                          const OutputWindow& window) {
+    utils::StageTimer epilogue_timer(utils::PipelineStage::kEpilogue);
+    Image output_image(window.size);
+
+    for (int row = 0; row < window.size.row; ++row) {
+        const double* src =
+              zoomed_image.data.data() +
+              (window.row_offset + row * window.stride) *
+                    zoomed_image.size.col +
+              window.col_offset;
+        double* dst = output_image.data.data() + row * window.size.col;
+        if (window.stride == 1) {
+            for (int col = 0; col < window.size.col; ++col) {
+                dst[col] = src[col] * scale;
+            }
+        } else {
+            for (int col = 0; col < window.size.col; ++col) {
+                dst[col] = src[col * window.stride] * scale;
+            }
+        }
+    }
+
+    return output_image;
+}
+
+Image ExtractOutputWindow(const Image& zoomed_image, double scale,
+                          const Image& low_res_image, int zoom,
+                          double low_res_scale, const OutputWindow& window) {
+    utils::StageTimer epilogue_timer(utils::PipelineStage::kEpilogue);
+    Image output_image(window.size);
+
+    // interpolation coordinates of the retained cols
+    std::vector<int> left_cols(window.size.col);
+    std::vector<int> right_cols(window.size.col);
+    std::vector<double> right_weights(window.size.col);
+    for (int col = 0; col < window.size.col; ++col) {
+        int zoomed_col = window.col_offset + col * window.stride;
+        left_cols[col] = zoomed_col / zoom;
+        right_cols[col] =
+              std::min(left_cols[col] + 1, low_res_image.size.col - 1);
+        right_weights[col] = (zoomed_col % zoom) / static_cast<double>(zoom);
+    }
+
+    // low resolution row interpolated vertically
+    std::vector<double> low_res_row(low_res_image.size.col);
+
+    for (int row = 0; row < window.size.row; ++row) {
+        int zoomed_row = window.row_offset + row * window.stride;
+        int top_row = zoomed_row / zoom;
+        int bottom_row = std::min(top_row + 1, low_res_image.size.row - 1);
+        double bottom_weight = (zoomed_row % zoom) / static_cast<double>(zoom);
+        double top_weight = 1. - bottom_weight;
+
+        const double* top_src =
+              low_res_image.data.data() + top_row * low_res_image.size.col;
+        const double* bottom_src =
+              low_res_image.data.data() + bottom_row * low_res_image.size.col;
+        for (int col = 0; col < low_res_image.size.col; ++col) {
+            low_res_row[col] = (top_src[col] * top_weight +
+                                bottom_src[col] * bottom_weight) *
+                               low_res_scale;
+        }
+
+        const double* src = zoomed_image.data.data() +
+                            zoomed_row * zoomed_image.size.col +
+                            window.col_offset;
+        double* dst = output_image.data.data() + row * window.size.col;
+        for (int col = 0; col < window.size.col; ++col) {
+            double right_weight = right_weights[col];
+            dst[col] = src[col * window.stride] * scale +
+                       low_res_row[left_cols[col]] * (1. - right_weight) +
+                       low_res_row[right_cols[col]] * right_weight;
+        }
+    }
+
+    return output_image;
+}
+
+}  // namespace resampler
+}  // namespace sirius
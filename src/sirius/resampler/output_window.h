@@ -0,0 +1,95 @@
+/**
+ * Copyright (C) 2018 CS - Systemes d'Information (CS-SI)
+ *
+ * This file is part of Sirius
+ *
+ *     https://github.com/CS-SI/SIRIUS
+ *
+ * Sirius is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sirius is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Sirius.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SIRIUS_RESAMPLER_OUTPUT_WINDOW_H_
+#define SIRIUS_RESAMPLER_OUTPUT_WINDOW_H_
+
+#include "sirius/image.h"
+#include "sirius/types.h"
+
+namespace sirius {
+namespace resampler {
+
+/**
+ * \brief Region of a zoomed padded image which is kept as resampled output
+ *
+ * Output pixel (i, j) is the zoomed image pixel
+ *   (row_offset + i * stride, col_offset + j * stride)
+ */
+struct OutputWindow {
+    int row_offset = 0;
+    int col_offset = 0;
+    Size size{0, 0};
+    int stride = 1;
+};
+
+/**
+ * \brief Compute the output window of a zoomed padded image
+ *
+ * The window removes the filter margins from the zoomed image and decimates
+ *   it by the output resolution
+ *
+ * \param zoom_ratio zoom ratio
+ * \param input_size size of the image before padding
+ * \param image_padding padding added to the input image
+ * \param filter_padding_size filter margins
+ * \return output window
+ */
+OutputWindow ComputeOutputWindow(const ZoomRatio& zoom_ratio,
+                                 const Size& input_size,
+                                 const Padding& image_padding,
+                                 const Size& filter_padding_size);
+
+/**
+ * \brief Scale and extract the output window of a zoomed image in one pass
+ * \param zoomed_image unnormalized zoomed image
+ * \param scale factor applied to zoomed image pixels
+ * \param window output window
+ * \return output image
+ */
+Image ExtractOutputWindow(const Image& zoomed_image, double scale,
+                          const OutputWindow& window);
+
+/**
+ * \brief Scale a zoomed image, add the bilinear interpolation of a low
+ *        resolution image and extract the output window in one pass
+ *
+ * Low resolution image is interpolated row by row, only on the retained
+ *   pixels. Its last row and col are duplicated to interpolate the
+ *   bottom and right borders.
+ *
+ * \param zoomed_image unnormalized zoomed image
+ * \param scale factor applied to zoomed image pixels
+ * \param low_res_image unnormalized image to interpolate, zoomed image size
+ *        is low_res_image size * zoom
+ * \param zoom zoom factor of the interpolation
+ * \param low_res_scale factor applied to interpolated pixels
+ * \param window output window
+ * \return output image
+ */
+Image ExtractOutputWindow(const Image& zoomed_image, double scale,
+                          const Image& low_res_image, int zoom,
+                          double low_res_scale, const OutputWindow& window);
+
+}  // namespace resampler
+}  // namespace sirius
+
+#endif  // SIRIUS_RESAMPLER_OUTPUT_WINDOW_H_
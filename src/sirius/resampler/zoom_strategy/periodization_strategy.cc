@@ -21,7 +21,7 @@
 
 #include "sirius/resampler/zoom_strategy/periodization_strategy.h"
 
-#include <algorithm>
+#include <cstring>
 
 #include "sirius/exception.h"
 
@@ -29,22 +29,110 @@
 #include "sirius/fftw/types.h"
 #include "sirius/fftw/wrapper.h"
 
-#include "sirius/utils/gsl.h"
 #include "sirius/utils/log.h"
+#include "sirius/utils/pipeline_metrics.h"
+#include "sirius/utils/trace.h"
 
 namespace sirius {
 namespace resampler {
 
+namespace {
+
+/**
+ * \brief Copy a spectrum row followed by its first coefficients in reverse
+ *        order
+ * \param src_row source spectrum row
+ * \param col_count source row length
+ * \param mirror_count count of mirrored coefficients appended after the row
+ * \param dst_row zoomed spectrum row
+ */
+void CopyPeriodizedRow(const ::fftw_complex* src_row, int col_count,
+                       int mirror_count, ::fftw_complex* dst_row) {
+    std::memcpy(dst_row, src_row, col_count * sizeof(::fftw_complex));
+    ::fftw_complex* mirror_row = dst_row + col_count;
+    for (int col = 0; col < mirror_count; ++col) {
+        mirror_row[col][0] = src_row[col_count - 1 - col][0];
+        mirror_row[col][1] = src_row[col_count - 1 - col][1];
+    }
+}
+
+/**
+ * \brief Periodize a half spectrum into a zero initialized zoomed spectrum
+ *
+ * Each source row is copied (with its mirrored coefficients) at the top and
+ *   at the bottom of the zoomed spectrum. If zoom is greater than 2, rows are
+ *   also copied, in reverse order, under the top rows and above the bottom
+ *   rows. With zoom 3, both reversed copies overlap with the same values so
+ *   they are written once.
+ *
+ * \tparam kZoom zoom factor known at compile time, 0 for any zoom factor
+ * \param zoom zoom factor (used if kZoom is 0)
+ * \param fft source half spectrum
+ * \param fft_size source half spectrum size
+ * \param zoomed_fft zoomed half spectrum
+ * \param zoomed_fft_size zoomed half spectrum size
+ */
+template <int kZoom>
+void PeriodizeSpectrum(int zoom, const ::fftw_complex* fft,
+                       const Size& fft_size, ::fftw_complex* zoomed_fft,
+                       const Size& zoomed_fft_size) {
+    const int actual_zoom = (kZoom > 0) ? kZoom : zoom;
+    const int row_count = fft_size.row;
+    const int col_count = fft_size.col;
+    const int zoomed_row_count = zoomed_fft_size.row;
+    const int zoomed_col_count = zoomed_fft_size.col;
+
+    for (int row = 0; row < row_count; ++row) {
+        const ::fftw_complex* src_row = fft + row * col_count;
+
+        // top and bottom copies
+        CopyPeriodizedRow(src_row, col_count, col_count - 1,
+                          zoomed_fft + row * zoomed_col_count);
+        CopyPeriodizedRow(
+              src_row, col_count, col_count - 1,
+              zoomed_fft +
+                    (zoomed_row_count - row_count + row) * zoomed_col_count);
+
+        if (actual_zoom < 3) {
+            continue;
+        }
+
+        // reversed copy above the bottom copy
+        CopyPeriodizedRow(
+              src_row, col_count, col_count,
+              zoomed_fft + (zoomed_row_count - row_count - 1 - row) *
+                                 zoomed_col_count);
+
+        // reversed copy under the top copy (first row is not copied)
+        if (actual_zoom != 3 && row > 0) {
+            CopyPeriodizedRow(
+                  src_row, col_count, col_count,
+                  zoomed_fft + (2 * row_count - 1 - row) * zoomed_col_count);
+        }
+    }
+}
+
+}  // namespace
+
 Image PeriodizationZoomStrategy::Zoom(int zoom, const Image& padded_image,
                                       const Filter& filter) const {
     // 1) FFT image
     LOG("periodization_zoom", trace, "compute image FFT");
+    TRACE_BEGIN("periodization_zoom", "fft");
+    utils::StageTimer fft_timer(utils::PipelineStage::kForwardFFT);
     auto fft_image = fftw::FFT(padded_image);
+    fft_timer.Stop();
+    TRACE_END("periodization_zoom", "fft");
 
     fftw::ComplexUPtr zoomed_fft;
     // 2) zoom FFT
     LOG("periodization_zoom", trace, "periodize FFT");
+    TRACE_BEGIN("periodization_zoom", "periodize_fft");
+    utils::StageTimer expansion_timer(
+          utils::PipelineStage::kSpectrumExpansion);
     zoomed_fft = PeriodizeFFT(zoom, padded_image, std::move(fft_image));
+    expansion_timer.Stop();
+    TRACE_END("periodization_zoom", "periodize_fft");
 
     Size zoomed_size{padded_image.size.row * zoom,
                      padded_image.size.col * zoom};
@@ -52,19 +140,17 @@ Image PeriodizationZoomStrategy::Zoom(int zoom, const Image& padded_image,
     if (filter.IsLoaded()) {
         // 3) Filter zoomed FFT
         LOG("periodization_zoom", trace, "apply filter");
+        TRACE_SCOPE("periodization_zoom", "filter");
+        utils::StageTimer filter_timer(utils::PipelineStage::kFilter);
         zoomed_fft = filter.Process(zoomed_size, std::move(zoomed_fft));
     }
 
     // 4) IFFT zoomed FFT
+    // normalization is left to the output window extraction
     LOG("periodization_zoom", trace, "compute image IFFT");
-    auto zoomed_image = fftw::IFFT(zoomed_size, std::move(zoomed_fft));
-
-    // 5) Normalize zoomed image
-    LOG("periodization_zoom", trace, "normalize image");
-    int pixel_count = padded_image.CellCount();
-    std::for_each(zoomed_image.data.begin(), zoomed_image.data.end(),
-                  [pixel_count](double& pixel) { pixel /= pixel_count; });
-    return zoomed_image;
+    TRACE_SCOPE("periodization_zoom", "ifft");
+    utils::StageTimer ifft_timer(utils::PipelineStage::kInverseFFT);
+    return fftw::IFFT(zoomed_size, std::move(zoomed_fft));
 }
 
 fftw::ComplexUPtr PeriodizationZoomStrategy::PeriodizeFFT(
@@ -74,108 +160,29 @@ fftw::ComplexUPtr PeriodizationZoomStrategy::PeriodizeFFT(
         return image_fft;
     }
 
-    int image_row_count = image.size.row;
-    int image_col_count = image.size.col;
-
-    int fft_row_count = image_row_count;
-    int fft_col_count = (image_col_count / 2) + 1;
-
-    int zoomed_row_count = image_row_count * zoom;
-    int zoomed_col_count = image_col_count * zoom;
-    int fft_zoomed_row_count = zoomed_row_count;
-    int fft_zoomed_col_count = zoomed_col_count / 2 + 1;
-
-    Size zoomed_fft_size(fft_zoomed_row_count, fft_zoomed_col_count);
+    Size fft_size(image.size.row, image.size.col / 2 + 1);
+    Size zoomed_fft_size(image.size.row * zoom,
+                         (image.size.col * zoom) / 2 + 1);
     auto zoomed_fft = fftw::CreateComplex(zoomed_fft_size);
 
-    auto image_fft_span = utils::MakeSmartPtrArraySpan(image_fft, image.size);
-    auto zoomed_fft_span =
-          utils::MakeSmartPtrArraySpan(zoomed_fft, zoomed_fft_size);
-    for (int row = 0; row < fft_row_count; ++row) {
-        int bottom_row = (fft_zoomed_row_count - fft_row_count + row) *
-                         fft_zoomed_col_count;
-        for (int col = 0; col < fft_col_count; ++col) {
-            int fft_idx = row * fft_col_count + col;
-            int top_left_idx = row * fft_zoomed_col_count + col;
-            int bottom_left_idx = bottom_row + col;
-            int top_right_idx =
-                  row * fft_zoomed_col_count + 2 * fft_col_count - col - 2;
-            int bottom_right_idx = bottom_row + 2 * fft_col_count - col - 2;
-
-            int top_bottom_left_idx =
-                  top_left_idx +
-                  2 * (fft_row_count - row - 1) * fft_zoomed_col_count;
-            int top_bottom_right_idx =
-                  top_right_idx +
-                  (2 * (fft_row_count - row) - 1) * fft_zoomed_col_count + 1;
-
-            int bottom_top_left_idx =
-                  (fft_zoomed_row_count - fft_row_count - 1 - row) *
-                        fft_zoomed_col_count +
-                  col;
-            int bottom_top_right_idx =
-                  bottom_top_left_idx + 2 * (fft_col_count - col) - 1;
-
-            double real_val = image_fft_span[fft_idx][0];
-            double im_val = image_fft_span[fft_idx][1];
-
-            // copy top left corner
-            zoomed_fft_span[top_left_idx][0] = real_val;
-            zoomed_fft_span[top_left_idx][1] = im_val;
-
-            // copy bottom left corner
-            zoomed_fft_span[bottom_left_idx][0] = real_val;
-            zoomed_fft_span[bottom_left_idx][1] = im_val;
-
-            if (zoom != 2) {
-                // copy to the top bottom left corner
-                if (row == fft_row_count - 1) {
-                    zoomed_fft_span[top_bottom_left_idx][0] = real_val;
-                    zoomed_fft_span[top_bottom_left_idx][1] = im_val;
-                } else {
-                    double tmp_real_val =
-                          image_fft_span[(row + 1) * fft_col_count + col][0];
-                    double tmp_im_val =
-                          image_fft_span[(row + 1) * fft_col_count + col][1];
-                    zoomed_fft_span[top_bottom_left_idx][0] = tmp_real_val;
-                    zoomed_fft_span[top_bottom_left_idx][1] = tmp_im_val;
-                }
-
-                // copy to the top bottom right corner
-                if (top_bottom_right_idx <
-                    fft_zoomed_col_count * (2 * fft_row_count - 1)) {
-                    zoomed_fft_span[top_bottom_right_idx][0] = real_val;
-                    zoomed_fft_span[top_bottom_right_idx][1] = im_val;
-                }
-
-                // copy to the bottom top right corner
-                zoomed_fft_span[bottom_top_right_idx][0] = real_val;
-                zoomed_fft_span[bottom_top_right_idx][1] = im_val;
-
-                // copy to the bottom top left corner
-                zoomed_fft_span[bottom_top_left_idx][0] = real_val;
-                zoomed_fft_span[bottom_top_left_idx][1] = im_val;
-            }
-
-            if (col == fft_col_count - 1) {
-                // duplicate extreme right pixel of each source spectrum row
-                zoomed_fft_span[top_right_idx][0] = real_val;
-                zoomed_fft_span[top_right_idx][1] = im_val;
-
-                zoomed_fft_span[bottom_right_idx][0] = real_val;
-                zoomed_fft_span[bottom_right_idx][1] = im_val;
-            } else {
-                double right_real_val = image_fft_span[fft_idx + 1][0];
-                double right_im_val = image_fft_span[fft_idx + 1][1];
-                // copy top right corner
-                zoomed_fft_span[top_right_idx][0] = right_real_val;
-                zoomed_fft_span[top_right_idx][1] = right_im_val;
-
-                // copy bottom right corner
-                zoomed_fft_span[bottom_right_idx][0] = right_real_val;
-                zoomed_fft_span[bottom_right_idx][1] = right_im_val;
-            }
-        }
+    // common zoom factors use kernels with compile time row layout
+    switch (zoom) {
+        case 2:
+            PeriodizeSpectrum<2>(zoom, image_fft.get(), fft_size,
+                                 zoomed_fft.get(), zoomed_fft_size);
+            break;
+        case 3:
+            PeriodizeSpectrum<3>(zoom, image_fft.get(), fft_size,
+                                 zoomed_fft.get(), zoomed_fft_size);
+            break;
+        case 4:
+            PeriodizeSpectrum<4>(zoom, image_fft.get(), fft_size,
+                                 zoomed_fft.get(), zoomed_fft_size);
+            break;
+        default:
+            PeriodizeSpectrum<0>(zoom, image_fft.get(), fft_size,
+                                 zoomed_fft.get(), zoomed_fft_size);
+            break;
     }
 
     return zoomed_fft;
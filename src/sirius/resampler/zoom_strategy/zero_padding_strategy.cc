@@ -21,7 +21,8 @@
 
 #include "sirius/resampler/zoom_strategy/zero_padding_strategy.h"
 
-#include <algorithm>
+#include <cmath>
+#include <cstring>
 
 #include "sirius/fftw/exception.h"
 #include "sirius/fftw/fftw.h"
@@ -30,8 +31,9 @@
 
 #include "sirius/exception.h"
 
-#include "sirius/utils/gsl.h"
 #include "sirius/utils/log.h"
+#include "sirius/utils/pipeline_metrics.h"
+#include "sirius/utils/trace.h"
 
 namespace sirius {
 namespace resampler {
@@ -41,11 +43,20 @@ Image ZeroPaddingZoomStrategy::Zoom(int zoom, const Image& padded_image,
     // 1) FFT image
     LOG("zero_padding_zoom", trace, "compute image FFT {}x{}",
         padded_image.size.row, padded_image.size.col);
+    TRACE_BEGIN("zero_padding_zoom", "fft");
+    utils::StageTimer fft_timer(utils::PipelineStage::kForwardFFT);
     auto image_fft = fftw::FFT(padded_image);
+    fft_timer.Stop();
+    TRACE_END("zero_padding_zoom", "fft");
 
     // 2) zoom FFT
     LOG("zero_padding_zoom", trace, "zero pad FFT");
+    TRACE_BEGIN("zero_padding_zoom", "zero_pad_fft");
+    utils::StageTimer expansion_timer(
+          utils::PipelineStage::kSpectrumExpansion);
     auto zoomed_fft = ZeroPadFFT(zoom, padded_image, std::move(image_fft));
+    expansion_timer.Stop();
+    TRACE_END("zero_padding_zoom", "zero_pad_fft");
 
     Size zoomed_size{padded_image.size.row * zoom,
                      padded_image.size.col * zoom};
@@ -53,19 +64,17 @@ Image ZeroPaddingZoomStrategy::Zoom(int zoom, const Image& padded_image,
     if (filter.IsLoaded()) {
         // 3) Filter zoomed FFT
         LOG("zero_padding_zoom", trace, "apply filter");
+        TRACE_SCOPE("zero_padding_zoom", "filter");
+        utils::StageTimer filter_timer(utils::PipelineStage::kFilter);
         zoomed_fft = filter.Process(zoomed_size, std::move(zoomed_fft));
     }
 
     // 4) IFFT zoomed FFT
+    // normalization is left to the output window extraction
     LOG("zero_padding_zoom", trace, "compute image IFFT");
-    auto zoomed_image = fftw::IFFT(zoomed_size, std::move(zoomed_fft));
-
-    // 5) Normalize zoomed image
-    LOG("zero_padding_zoom", trace, "normalize image");
-    int pixel_count = padded_image.CellCount();
-    std::for_each(zoomed_image.data.begin(), zoomed_image.data.end(),
-                  [pixel_count](double& pixel) { pixel /= pixel_count; });
-    return zoomed_image;
+    TRACE_SCOPE("zero_padding_zoom", "ifft");
+    utils::StageTimer ifft_timer(utils::PipelineStage::kInverseFFT);
+    return fftw::IFFT(zoomed_size, std::move(zoomed_fft));
 }
 
 fftw::ComplexUPtr ZeroPaddingZoomStrategy::ZeroPadFFT(
@@ -75,19 +84,12 @@ fftw::ComplexUPtr ZeroPaddingZoomStrategy::ZeroPadFFT(
         return image_fft;
     }
 
-    int image_row_count = image.size.row;
-    int image_col_count = image.size.col;
-    int half_row_count = std::ceil(image_row_count / 2.0);
+    int fft_row_count = image.size.row;
+    int fft_col_count = (image.size.col / 2) + 1;
+    int half_row_count = std::ceil(fft_row_count / 2.0);
 
-    int fft_row_count = image_row_count;
-    int fft_col_count = (image_col_count / 2) + 1;
-
-    int zoomed_row_count = image_row_count * zoom;
-    int zoomed_col_count = image_col_count * zoom;
-    int fft_zoomed_row_count = zoomed_row_count;
-    int fft_zoomed_col_count = zoomed_col_count / 2 + 1;
-
-    Size zoomed_fft_size(fft_zoomed_row_count, fft_zoomed_col_count);
+    Size zoomed_fft_size(fft_row_count * zoom,
+                         (image.size.col * zoom) / 2 + 1);
     auto zoomed_fft = fftw::CreateComplex(zoomed_fft_size);
 
     // zero padding zoom
@@ -96,33 +98,13 @@ fftw::ComplexUPtr ZeroPaddingZoomStrategy::ZeroPadFFT(
     //   and (half_row_count, fft_row_count, 0, fft_col_count)
     //   - copy first block in top-left corner of zoomed_fft
     //   - copy second block in bottom left corner of zoomed_fft
-
-    int pixel_index = 0;
-    int zoomed_row = 0;
-    int zoomed_col = 0;
-    int zoomed_pixel_index = 0;
-
-    auto image_fft_span = utils::MakeSmartPtrArraySpan(image_fft, image.size);
-    auto zoomed_fft_span =
-          utils::MakeSmartPtrArraySpan(zoomed_fft, zoomed_fft_size);
+    std::size_t row_byte_count = fft_col_count * sizeof(::fftw_complex);
     for (int row = 0; row < fft_row_count; ++row) {
-        for (int col = 0; col < fft_col_count; ++col) {
-            pixel_index = row * fft_col_count + col;
-
-            if (row < half_row_count) {
-                zoomed_row = row;
-            } else {
-                zoomed_row = zoomed_row_count - (fft_row_count - row);
-            }
-            zoomed_col = col;
-            zoomed_pixel_index = zoomed_row * fft_zoomed_col_count + zoomed_col;
-
-            // copy complex number from image_fft to zoomed_fft
-            zoomed_fft_span[zoomed_pixel_index][0] =
-                  image_fft_span[pixel_index][0];
-            zoomed_fft_span[zoomed_pixel_index][1] =
-                  image_fft_span[pixel_index][1];
-        }
+        int zoomed_row = (row < half_row_count)
+                               ? row
+                               : zoomed_fft_size.row - (fft_row_count - row);
+        std::memcpy(zoomed_fft.get() + zoomed_row * zoomed_fft_size.col,
+                    image_fft.get() + row * fft_col_count, row_byte_count);
     }
 
     return zoomed_fft;
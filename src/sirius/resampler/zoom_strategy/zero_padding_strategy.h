@@ -35,6 +35,14 @@ namespace resampler {
  */
 class ZeroPaddingZoomStrategy {
   public:
+    /**
+     * \brief Zoom a padded image in the frequency domain
+     * \param zoom zoom factor
+     * \param padded_image image to zoom
+     * \param filter optional filter to apply on the zoomed spectrum
+     * \return unnormalized zoomed image (pixels are scaled by the padded
+     *         image cell count)
+     */
     Image Zoom(int zoom, const Image& padded_image, const Filter& filter) const;
 
   private:
@@ -0,0 +1,97 @@
+/**
+ * Copyright (C) 2018 CS - Systemes d'Information (CS-SI)
+ *
+ * This file is part of Sirius
+ *
+ *     https://github.com/CS-SI/SIRIUS
+ *
+ * Sirius is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sirius is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Sirius.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "sirius/utils/batch_manifest.h"
+
+#include <fstream>
+#include <sstream>
+
+#include "sirius/exception.h"
+
+#include "sirius/utils/log.h"
+
+namespace sirius {
+namespace utils {
+
+namespace {
+
+std::string Trim(const std::string& value) {
+    auto begin = value.find_first_not_of(" \t\r");
+    if (begin == std::string::npos) {
+        return {};
+    }
+    auto end = value.find_last_not_of(" \t\r");
+    return value.substr(begin, end - begin + 1);
+}
+
+}  // namespace
+
+std::vector<BatchEntry> ParseBatchManifest(std::istream& manifest) {
+    std::vector<BatchEntry> entries;
+    std::string line;
+    int line_number = 0;
+    while (std::getline(manifest, line)) {
+        ++line_number;
+        line = Trim(line);
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        std::vector<std::string> paths;
+        if (line.find('\t') != std::string::npos) {
+            std::istringstream fields(line);
+            std::string field;
+            while (std::getline(fields, field, '\t')) {
+                field = Trim(field);
+                if (!field.empty()) {
+                    paths.push_back(field);
+                }
+            }
+        } else {
+            std::istringstream fields(line);
+            std::string field;
+            while (fields >> field) {
+                paths.push_back(field);
+            }
+        }
+        if (paths.size() != 2) {
+            throw Exception("invalid batch manifest line " +
+                            std::to_string(line_number) +
+                            ": expected input and output paths");
+        }
+        entries.push_back({paths[0], paths[1]});
+    }
+    return entries;
+}
+
+std::vector<BatchEntry> LoadBatchManifest(const std::string& manifest_path) {
+    std::ifstream manifest(manifest_path);
+    if (!manifest) {
+        throw Exception("cannot read batch manifest '" + manifest_path + "'");
+    }
+    auto entries = ParseBatchManifest(manifest);
+    LOG("batch_manifest", debug, "{} images in batch manifest '{}'",
+        entries.size(), manifest_path);
+    return entries;
+}
+
+}  // namespace utils
+}  // namespace sirius
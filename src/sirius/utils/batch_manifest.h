@@ -0,0 +1,65 @@
+/**
+ * Copyright (C) 2018 CS - Systemes d'Information (CS-SI)
+ *
+ * This file is part of Sirius
+ *
+ *     https://github.com/CS-SI/SIRIUS
+ *
+ * Sirius is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sirius is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Sirius.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SIRIUS_UTILS_BATCH_MANIFEST_H_
+#define SIRIUS_UTILS_BATCH_MANIFEST_H_
+
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace sirius {
+namespace utils {
+
+/**
+ * \brief Input and output images of a batch
+ */
+struct BatchEntry {
+    std::string input_path;
+    std::string output_path;
+};
+
+/**
+ * \brief Parse a batch manifest
+ *
+ * The manifest has one input and output pair per line. Paths are separated
+ *   by a tab, or by spaces if the line has no tab so that paths with spaces
+ *   can be used in tab separated manifests. Blank lines and lines starting
+ *   with '#' are ignored.
+ *
+ * \param manifest manifest content
+ * \return entries in manifest order
+ * \throw sirius::Exception if a line does not have exactly two paths
+ */
+std::vector<BatchEntry> ParseBatchManifest(std::istream& manifest);
+
+/**
+ * \brief Load a batch manifest file
+ * \param manifest_path manifest path
+ * \return entries in manifest order
+ * \throw sirius::Exception if the file cannot be read or is invalid
+ */
+std::vector<BatchEntry> LoadBatchManifest(const std::string& manifest_path);
+
+}  // namespace utils
+}  // namespace sirius
+
+#endif  // SIRIUS_UTILS_BATCH_MANIFEST_H_
@@ -0,0 +1,254 @@
+/**
+ * Copyright (C) 2018 CS - Systemes d'Information (CS-SI)
+ *
+ * This file is part of Sirius
+ *
+ *     https://github.com/CS-SI/SIRIUS
+ *
+ * Sirius is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sirius is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Sirius.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SIRIUS_UTILS_LOCK_FREE_QUEUE_H_
+#define SIRIUS_UTILS_LOCK_FREE_QUEUE_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <vector>
+
+namespace sirius {
+namespace utils {
+
+/**
+ * \brief Lock free bounded concurrent queue
+ *
+ * LockFreeQueue is a multi-producer multi-consumer ring buffer with the same
+ *   Push/Pop/Deactivate semantics as ConcurrentQueue. Producers and consumers
+ *   only synchronize through atomic operations on the ring buffer cells.
+ *   Blocking operations spin for a short time before parking the calling
+ *   thread on a condition variable.
+ *
+ * This implementation is based on the bounded MPMC queue of Dmitry Vyukov
+ *   http://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+ *
+ * \warning Push and Pop methods may block.
+ */
+template <typename T>
+class LockFreeQueue {
+  public:
+    /**
+     * \brief Instanciate a lock free queue with a maximum size
+     *
+     * The queue is active after instantiation
+     *
+     * \param max_queue_size limit the queue size (rounded up to the next power
+     *        of two)
+     */
+    LockFreeQueue(std::size_t max_queue_size = 16);
+    ~LockFreeQueue() = default;
+
+    LockFreeQueue(const LockFreeQueue&) = delete;
+    LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+    LockFreeQueue(LockFreeQueue&&) = delete;
+    LockFreeQueue& operator=(LockFreeQueue&&) = delete;
+
+    /**
+     * \brief Push an element in the queue
+     *
+     * \param element to push to the queue
+     * \param ec return status
+     *
+     * \warning This method may block until there is an available spot
+     * \warning If the queue is not active, the element will be dropped and ec
+     *          is set
+     */
+    void Push(T&& element, std::error_code& ec);
+
+    /**
+     * \brief Push several elements in the queue
+     *
+     * Contiguous spots are reserved with a single atomic operation when
+     *   possible
+     *
+     * \param elements elements to push to the queue
+     * \param ec return status
+     *
+     * \warning This method may block until all the elements are pushed
+     * \warning If the queue is deactivated, the remaining elements will be
+     *          dropped and ec is set
+     */
+    void PushBatch(std::vector<T>&& elements, std::error_code& ec);
+
+    /**
+     * \brief Pop an element from the queue
+     *
+     * \param ec return status
+     * \return An available element from the queue
+     *
+     * \warning This method may block until there is an element to pop
+     * \warning If no element is available and the queue is not active,
+     *          this method returns a default constructed element and ec is set
+     */
+    T Pop(std::error_code& ec);
+
+    /**
+     * \brief Pop several elements from the queue
+     *
+     * \param max_count maximum number of elements to pop
+     * \param ec return status
+     * \return between 1 and max_count elements
+     *
+     * \warning This method may block until there is an element to pop
+     * \warning If no element is available and the queue is not active,
+     *          this method returns no element and ec is set
+     */
+    std::vector<T> PopBatch(std::size_t max_count, std::error_code& ec);
+
+    /**
+     * \brief Try to push an element without blocking
+     *
+     * \param element to push to the queue, left untouched on failure
+     * \return true if the element was pushed
+     */
+    bool TryPush(T&& element);
+
+    /**
+     * \brief Try to pop an element without blocking
+     *
+     * \param element popped element
+     * \return true if an element was popped
+     */
+    bool TryPop(T& element);
+
+    /**
+     * \brief Get queue size
+     *
+     * \return Approximate queue size
+     */
+    std::size_t Size() const;
+
+    /**
+     * \brief Get queue capacity
+     *
+     * \return Queue capacity
+     */
+    std::size_t Capacity() const { return capacity_; }
+
+    /**
+     * \brief Queue is empty
+     *
+     * \return true if queue is empty
+     */
+    bool Empty() const;
+
+    /**
+     * \brief Elements can be popped from the queue
+     *
+     * \return boolean
+     */
+    bool CanPop() const;
+
+    /**
+     * \brief Activate the queue
+     *
+     * The queue will be able to receive new elements
+     */
+    void Activate();
+
+    /**
+     * \brief Deactivate the queue
+     *
+     * The queue will not be able to receive new elements
+     */
+    void Deactivate();
+
+    /**
+     * \brief Deactivate the queue and clear its content
+     *
+     * The queue will not be able to receive new elements and its content will
+     * be erased
+     */
+    void DeactivateAndClear();
+
+    /**
+     * \brief Can the queue be filled with new elements
+     *
+     * \return true if the queue is still active
+     */
+    bool IsActive() const;
+
+  private:
+    /**
+     * \brief Ring buffer cell
+     *
+     * The sequence tells the state of the cell for a given position:
+     *   sequence == position: free for the producer of this position
+     *   sequence == position + 1: ready for the consumer of this position
+     */
+    struct Cell {
+        std::atomic<std::size_t> sequence;
+        T element;
+    };
+
+    /**
+     * \brief Move up to count elements into the queue without blocking
+     * \return number of pushed elements
+     */
+    std::size_t TryPushRange(T* elements, std::size_t count);
+
+    /**
+     * \brief Move up to max_count elements out of the queue without blocking
+     * \return number of popped elements
+     */
+    std::size_t TryPopRange(std::vector<T>& elements, std::size_t max_count);
+
+    bool IsFrontReady() const;
+
+    bool IsBackFree() const;
+
+    template <typename Predicate>
+    void Wait(std::condition_variable& cond,
+              std::atomic<unsigned int>& waiting_count, Predicate is_ready);
+
+    void Notify(std::condition_variable& cond,
+                std::atomic<unsigned int>& waiting_count);
+
+  private:
+    static constexpr std::size_t kCacheLineSize = 64;
+
+    std::size_t capacity_;
+    std::size_t mask_;
+    std::unique_ptr<Cell[]> cells_;
+
+    alignas(kCacheLineSize) std::atomic<std::size_t> enqueue_position_{0};
+    alignas(kCacheLineSize) std::atomic<std::size_t> dequeue_position_{0};
+    alignas(kCacheLineSize) std::atomic<bool> is_active_{true};
+
+    // parking of blocked producers and consumers
+    std::mutex park_mutex_;
+    std::condition_variable push_cond_;
+    std::condition_variable pop_cond_;
+    std::atomic<unsigned int> push_waiting_count_{0};
+    std::atomic<unsigned int> pop_waiting_count_{0};
+};
+
+}  // namespace utils
+}  // namespace sirius
+
+#include "sirius/utils/lock_free_queue.txx"
+
+#endif  // SIRIUS_UTILS_LOCK_FREE_QUEUE_H_
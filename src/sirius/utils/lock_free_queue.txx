@@ -0,0 +1,371 @@
+/**
+ * Copyright (C) 2018 CS - Systemes d'Information (CS-SI)
+ *
+ * This file is part of Sirius
+ *
+ *     https://github.com/CS-SI/SIRIUS
+ *
+ * Sirius is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sirius is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Sirius.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SIRIUS_UTILS_LOCK_FREE_QUEUE_TXX_
+#define SIRIUS_UTILS_LOCK_FREE_QUEUE_TXX_
+
+#include <algorithm>
+#include <thread>
+
+#include "sirius/utils/concurrent_queue_error_code.h"
+
+namespace sirius {
+namespace utils {
+
+namespace detail {
+
+// number of polling attempts before parking a blocked thread
+constexpr int kLockFreeQueueSpinCount = 64;
+// number of polling attempts without yielding the CPU
+constexpr int kLockFreeQueueBusySpinCount = 16;
+
+inline std::size_t NextPowerOfTwo(std::size_t value) {
+    std::size_t power = 1;
+    while (power < value) {
+        power <<= 1;
+    }
+    return power;
+}
+
+}  // namespace detail
+
+template <typename T>
+LockFreeQueue<T>::LockFreeQueue(std::size_t max_queue_size)
+    : capacity_(detail::NextPowerOfTwo(
+            std::max<std::size_t>(max_queue_size, 2))),
+      mask_(capacity_ - 1),
+      cells_(new Cell[capacity_]) {
+    for (std::size_t i = 0; i < capacity_; ++i) {
+        cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+template <typename T>
+void LockFreeQueue<T>::Push(T&& element, std::error_code& ec) {
+    while (true) {
+        if (!is_active_) {
+            // drop element
+            ec = make_error_code(ConcurrentQueueErrorCode::kQueueIsNotActive);
+            return;
+        }
+        if (TryPushRange(&element, 1) == 1) {
+            ec = make_error_code(ConcurrentQueueErrorCode::kSuccess);
+            Notify(pop_cond_, pop_waiting_count_);
+            return;
+        }
+        Wait(push_cond_, push_waiting_count_,
+             [this]() { return IsBackFree() || !is_active_; });
+    }
+}
+
+template <typename T>
+void LockFreeQueue<T>::PushBatch(std::vector<T>&& elements,
+                                 std::error_code& ec) {
+    std::size_t pushed_count = 0;
+    while (pushed_count < elements.size()) {
+        if (!is_active_) {
+            // drop remaining elements
+            ec = make_error_code(ConcurrentQueueErrorCode::kQueueIsNotActive);
+            return;
+        }
+        std::size_t count = TryPushRange(elements.data() + pushed_count,
+                                         elements.size() - pushed_count);
+        if (count > 0) {
+            pushed_count += count;
+            Notify(pop_cond_, pop_waiting_count_);
+            continue;
+        }
+        Wait(push_cond_, push_waiting_count_,
+             [this]() { return IsBackFree() || !is_active_; });
+    }
+    ec = make_error_code(ConcurrentQueueErrorCode::kSuccess);
+}
+
+template <typename T>
+T LockFreeQueue<T>::Pop(std::error_code& ec) {
+    T element{};
+    while (true) {
+        // check activity before popping so that no element pushed before
+        //   deactivation is missed
+        bool is_active = is_active_;
+        if (TryPop(element)) {
+            ec = make_error_code(ConcurrentQueueErrorCode::kSuccess);
+            return element;
+        }
+        if (!is_active) {
+            ec = make_error_code(ConcurrentQueueErrorCode::kQueueIsNotActive);
+            return {};
+        }
+        Wait(pop_cond_, pop_waiting_count_,
+             [this]() { return IsFrontReady() || !is_active_; });
+    }
+}
+
+template <typename T>
+std::vector<T> LockFreeQueue<T>::PopBatch(std::size_t max_count,
+                                          std::error_code& ec) {
+    std::vector<T> elements;
+    elements.reserve(std::min(max_count, capacity_));
+    while (true) {
+        bool is_active = is_active_;
+        if (TryPopRange(elements, max_count) > 0) {
+            ec = make_error_code(ConcurrentQueueErrorCode::kSuccess);
+            Notify(push_cond_, push_waiting_count_);
+            return elements;
+        }
+        if (!is_active) {
+            ec = make_error_code(ConcurrentQueueErrorCode::kQueueIsNotActive);
+            return elements;
+        }
+        Wait(pop_cond_, pop_waiting_count_,
+             [this]() { return IsFrontReady() || !is_active_; });
+    }
+}
+
+template <typename T>
+bool LockFreeQueue<T>::TryPush(T&& element) {
+    if (!is_active_ || TryPushRange(&element, 1) == 0) {
+        return false;
+    }
+    Notify(pop_cond_, pop_waiting_count_);
+    return true;
+}
+
+template <typename T>
+bool LockFreeQueue<T>::TryPop(T& element) {
+    std::size_t position = dequeue_position_.load(std::memory_order_relaxed);
+    while (true) {
+        Cell& cell = cells_[position & mask_];
+        std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        auto diff = static_cast<std::ptrdiff_t>(sequence - (position + 1));
+        if (diff == 0) {
+            if (dequeue_position_.compare_exchange_weak(
+                      position, position + 1, std::memory_order_relaxed)) {
+                element = std::move(cell.element);
+                cell.sequence.store(position + capacity_,
+                                    std::memory_order_release);
+                Notify(push_cond_, push_waiting_count_);
+                return true;
+            }
+        } else if (diff < 0) {
+            // empty
+            return false;
+        } else {
+            // another consumer got this position
+            position = dequeue_position_.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+template <typename T>
+std::size_t LockFreeQueue<T>::TryPushRange(T* elements, std::size_t count) {
+    std::size_t position = enqueue_position_.load(std::memory_order_relaxed);
+    std::size_t reserved_count = 0;
+    while (true) {
+        // count free contiguous cells from position
+        reserved_count = 0;
+        while (reserved_count < count && reserved_count < capacity_) {
+            std::size_t cell_position = position + reserved_count;
+            std::size_t sequence = cells_[cell_position & mask_].sequence.load(
+                  std::memory_order_acquire);
+            if (sequence != cell_position) {
+                break;
+            }
+            ++reserved_count;
+        }
+
+        if (reserved_count == 0) {
+            std::size_t sequence = cells_[position & mask_].sequence.load(
+                  std::memory_order_acquire);
+            if (static_cast<std::ptrdiff_t>(sequence - position) < 0) {
+                // full
+                return 0;
+            }
+            // another producer got this position
+            position = enqueue_position_.load(std::memory_order_relaxed);
+            continue;
+        }
+
+        // cells cannot be reserved by another producer as long as the
+        //   enqueue position has not moved
+        if (enqueue_position_.compare_exchange_weak(
+                  position, position + reserved_count,
+                  std::memory_order_relaxed)) {
+            break;
+        }
+    }
+
+    for (std::size_t i = 0; i < reserved_count; ++i) {
+        Cell& cell = cells_[(position + i) & mask_];
+        cell.element = std::move(elements[i]);
+        cell.sequence.store(position + i + 1, std::memory_order_release);
+    }
+    return reserved_count;
+}
+
+template <typename T>
+std::size_t LockFreeQueue<T>::TryPopRange(std::vector<T>& elements,
+                                          std::size_t max_count) {
+    std::size_t position = dequeue_position_.load(std::memory_order_relaxed);
+    std::size_t reserved_count = 0;
+    while (true) {
+        // count ready contiguous cells from position
+        reserved_count = 0;
+        while (reserved_count < max_count && reserved_count < capacity_) {
+            std::size_t cell_position = position + reserved_count;
+            std::size_t sequence = cells_[cell_position & mask_].sequence.load(
+                  std::memory_order_acquire);
+            if (sequence != cell_position + 1) {
+                break;
+            }
+            ++reserved_count;
+        }
+
+        if (reserved_count == 0) {
+            std::size_t sequence = cells_[position & mask_].sequence.load(
+                  std::memory_order_acquire);
+            if (static_cast<std::ptrdiff_t>(sequence - (position + 1)) < 0) {
+                // empty
+                return 0;
+            }
+            // another consumer got this position
+            position = dequeue_position_.load(std::memory_order_relaxed);
+            continue;
+        }
+
+        if (dequeue_position_.compare_exchange_weak(
+                  position, position + reserved_count,
+                  std::memory_order_relaxed)) {
+            break;
+        }
+    }
+
+    for (std::size_t i = 0; i < reserved_count; ++i) {
+        Cell& cell = cells_[(position + i) & mask_];
+        elements.emplace_back(std::move(cell.element));
+        cell.sequence.store(position + i + capacity_,
+                            std::memory_order_release);
+    }
+    return reserved_count;
+}
+
+template <typename T>
+std::size_t LockFreeQueue<T>::Size() const {
+    std::size_t dequeue_position = dequeue_position_.load();
+    std::size_t enqueue_position = enqueue_position_.load();
+    return enqueue_position > dequeue_position
+                 ? enqueue_position - dequeue_position
+                 : 0;
+}
+
+template <typename T>
+bool LockFreeQueue<T>::Empty() const {
+    return Size() == 0;
+}
+
+template <typename T>
+bool LockFreeQueue<T>::CanPop() const {
+    return !Empty() || is_active_;
+}
+
+template <typename T>
+void LockFreeQueue<T>::Activate() {
+    {
+        std::lock_guard<std::mutex> lock(park_mutex_);
+        is_active_ = true;
+    }
+    push_cond_.notify_all();
+    pop_cond_.notify_all();
+}
+
+template <typename T>
+void LockFreeQueue<T>::Deactivate() {
+    {
+        std::lock_guard<std::mutex> lock(park_mutex_);
+        is_active_ = false;
+    }
+    push_cond_.notify_all();
+    pop_cond_.notify_all();
+}
+
+template <typename T>
+void LockFreeQueue<T>::DeactivateAndClear() {
+    Deactivate();
+    T element;
+    while (TryPop(element)) {
+    }
+}
+
+template <typename T>
+bool LockFreeQueue<T>::IsActive() const {
+    return is_active_;
+}
+
+template <typename T>
+bool LockFreeQueue<T>::IsFrontReady() const {
+    std::size_t position = dequeue_position_.load();
+    return cells_[position & mask_].sequence.load() == position + 1;
+}
+
+template <typename T>
+bool LockFreeQueue<T>::IsBackFree() const {
+    std::size_t position = enqueue_position_.load();
+    return cells_[position & mask_].sequence.load() == position;
+}
+
+template <typename T>
+template <typename Predicate>
+void LockFreeQueue<T>::Wait(std::condition_variable& cond,
+                            std::atomic<unsigned int>& waiting_count,
+                            Predicate is_ready) {
+    // spin first: the other side is usually about to make progress
+    for (int i = 0; i < detail::kLockFreeQueueSpinCount; ++i) {
+        if (is_ready()) {
+            return;
+        }
+        if (i >= detail::kLockFreeQueueBusySpinCount) {
+            std::this_thread::yield();
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(park_mutex_);
+    ++waiting_count;
+    cond.wait(lock, is_ready);
+    --waiting_count;
+}
+
+template <typename T>
+void LockFreeQueue<T>::Notify(std::condition_variable& cond,
+                              std::atomic<unsigned int>& waiting_count) {
+    // pairs with the waiting count increment of Wait: either the waiter sees
+    //   the new state or this thread sees the waiter
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting_count.load() > 0) {
+        // waiter is either before its predicate check or parked
+        { std::lock_guard<std::mutex> lock(park_mutex_); }
+        cond.notify_all();
+    }
+}
+
+}  // namespace utils
+}  // namespace sirius
+
+#endif  // SIRIUS_UTILS_LOCK_FREE_QUEUE_TXX_
@@ -40,6 +40,8 @@ LoggerManager& LoggerManager::Instance() {
 }
 
 void LoggerManager::SetLogLevel(spdlog::level::level_enum level) {
+    // channels created later get the new level
+    std::lock_guard<std::mutex> lock(loggers_mutex_);
     log_level_ = level;
     spdlog::set_level(level);
 }
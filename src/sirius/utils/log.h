@@ -35,6 +35,18 @@
 namespace sirius {
 namespace utils {
 
+/**
+ * \brief Levels of the LOG macro
+ */
+namespace log_level {
+constexpr auto trace = spdlog::level::trace;
+constexpr auto debug = spdlog::level::debug;
+constexpr auto info = spdlog::level::info;
+constexpr auto warn = spdlog::level::warn;
+constexpr auto error = spdlog::level::err;
+constexpr auto critical = spdlog::level::critical;
+}  // namespace log_level
+
 class LoggerManager {
   public:
     using Logger = spdlog::logger;
@@ -43,7 +55,21 @@ class LoggerManager {
   public:
     static LoggerManager& Instance();
 
+    /**
+     * \brief Set the level of every channel, created or not
+     * \param level log level
+     */
     void SetLogLevel(spdlog::level::level_enum level);
+
+    /**
+     * \brief Get the logger of a channel, create it on first use
+     *
+     * Loggers live as long as the manager, so that LOG call sites resolve
+     *   their channel once
+     *
+     * \param channel channel name
+     * \return channel logger
+     */
     Logger* Get(const std::string& channel);
 
   private:
@@ -61,8 +87,18 @@ class LoggerManager {
 #define LOG_SET_LEVEL_ENUM(lvl_enum) \
     sirius::utils::LoggerManager::Instance().SetLogLevel(lvl_enum)
 #define LOG_SET_LEVEL(lvl) LOG_SET_LEVEL_ENUM(spdlog::level::lvl)
-#define LOG(channel, level, ...) \
-    sirius::utils::LoggerManager::Instance().Get(channel)->level(__VA_ARGS__)
+// the channel logger is resolved once per call site and the level is checked
+//   before the message arguments are evaluated: a discarded message costs
+//   neither a lock nor a channel lookup
+#define LOG(channel, level, ...)                                     \
+    do {                                                             \
+        static auto* const sirius_channel_logger =                   \
+              sirius::utils::LoggerManager::Instance().Get(channel); \
+        if (sirius_channel_logger->should_log(                       \
+                  sirius::utils::log_level::level)) {                \
+            sirius_channel_logger->level(__VA_ARGS__);               \
+        }                                                            \
+    } while (false)
 
 #else
 
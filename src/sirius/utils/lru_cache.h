@@ -22,6 +22,8 @@
 #ifndef SIRIUS_UTILS_LRU_CACHE_H_
 #define SIRIUS_UTILS_LRU_CACHE_H_
 
+#include <atomic>
+#include <cstdint>
 #include <list>
 #include <map>
 #include <mutex>
@@ -31,6 +33,21 @@
 namespace sirius {
 namespace utils {
 
+/**
+ * \brief Hits and misses of a cache
+ */
+struct CacheStatistics {
+    std::uint64_t hit_count = 0;
+    std::uint64_t miss_count = 0;
+
+    double HitRate() const {
+        auto request_count = hit_count + miss_count;
+        return request_count > 0
+                     ? static_cast<double>(hit_count) / request_count
+                     : 0.;
+    }
+};
+
 /**
  * \brief LRU cache
  */
@@ -60,8 +77,10 @@ class LRUCache {
         if (elements_.count(key) > 0) {
             ordered_keys_.remove(key);
             ordered_keys_.push_front(key);
+            ++hit_count_;
             return elements_[key];
         }
+        ++miss_count_;
         return {};
     }
 
@@ -129,10 +148,23 @@ class LRUCache {
      */
     std::size_t Size() { return elements_.size(); }
 
+    /**
+     * \brief Get the hits and misses of Get since the cache creation
+     * \return cache statistics
+     */
+    CacheStatistics Statistics() const {
+        CacheStatistics statistics;
+        statistics.hit_count = hit_count_;
+        statistics.miss_count = miss_count_;
+        return statistics;
+    }
+
   private:
     std::mutex cache_mutex_;
     std::list<Key> ordered_keys_;
     std::map<Key, Value> elements_;
+    std::atomic<std::uint64_t> hit_count_{0};
+    std::atomic<std::uint64_t> miss_count_{0};
 };
 
 }  // namespace utils
@@ -0,0 +1,332 @@
+/**
+ * Copyright (C) 2018 CS - Systemes d'Information (CS-SI)
+ *
+ * This file is part of Sirius
+ *
+ *     https://github.com/CS-SI/SIRIUS
+ *
+ * Sirius is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sirius is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Sirius.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "sirius/utils/memory_budget.h"
+
+#include <cctype>
+#include <cmath>
+
+#include <algorithm>
+#include <vector>
+
+#include "sirius/exception.h"
+
+#include "sirius/utils/log.h"
+#include "sirius/utils/numeric.h"
+
+namespace sirius {
+namespace utils {
+
+namespace {
+
+// doubles allocated per padded block cell: read buffer, padded image,
+//   periodic plus smooth decomposition and forward spectrum
+constexpr double kPaddedCellBuffers = 9.;
+
+// doubles allocated per zoomed cell: zoomed spectrum, zoomed periodic and
+//   smooth parts
+constexpr double kZoomedCellBuffers = 3.;
+
+// filter spectra cached for nominal, right edge, bottom edge and corner
+//   blocks
+constexpr int kFilterCacheEntryCount = 4;
+
+// square block lengths tried by the tuner
+constexpr int kCandidateBlockLengths[] = {64, 128, 256, 512, 1024, 2048, 4096};
+
+// per block overhead (I/O requests, task scheduling, plan and filter cache
+//   lookups) expressed in FFT cost unit
+const double kBlockOverheadCost = EstimateFFTCost({128, 128});
+
+int CeilDiv(int a, int b) { return (a + b - 1) / b; }
+
+Size ComputePaddedSize(const Size& block_size, const Size& margin_size) {
+    return {block_size.row + 2 * margin_size.row,
+            block_size.col + 2 * margin_size.col};
+}
+
+unsigned int ComputeBlockCount(const Size& image_size, const Size& block_size) {
+    return static_cast<unsigned int>(CeilDiv(image_size.row, block_size.row)) *
+           static_cast<unsigned int>(CeilDiv(image_size.col, block_size.col));
+}
+
+/**
+ * \brief Largest worker count and pending blocks of a block size which fit
+ *        in the budget, no worker if one block does not fit
+ */
+StreamParameters FitWorkers(const StreamMemoryModel& model,
+                            std::size_t max_memory, unsigned int max_workers,
+                            const Size& block_size) {
+    StreamParameters parameters;
+    parameters.block_size = block_size;
+    unsigned int block_count =
+          ComputeBlockCount(model.image_size(), block_size);
+    unsigned int workers = std::min(max_workers, block_count);
+    while (workers > 0 &&
+           model.PeakMemory(block_size, workers, workers) > max_memory) {
+        --workers;
+    }
+    parameters.parallel_workers = workers;
+    if (workers == 0) {
+        parameters.max_pending_blocks = 0;
+        return parameters;
+    }
+    unsigned int pending_blocks =
+          std::max(std::min(2 * workers, block_count), workers);
+    while (pending_blocks > workers &&
+           model.PeakMemory(block_size, workers, pending_blocks) >
+                 max_memory) {
+        --pending_blocks;
+    }
+    parameters.max_pending_blocks = pending_blocks;
+    parameters.peak_memory =
+          model.PeakMemory(block_size, workers, pending_blocks);
+    return parameters;
+}
+
+}  // namespace
+
+StreamMemoryModel::StreamMemoryModel(const Size& image_size,
+                                     const ZoomRatio& zoom_ratio,
+                                     const Size& margin_size, bool has_filter,
+                                     bool pad_edge_blocks,
+                                     std::size_t output_pixel_size,
+                                     std::size_t input_pixel_size,
+                                     int band_count)
+    : image_size_(image_size),
+      zoom_ratio_(zoom_ratio),
+      margin_size_(margin_size),
+      has_filter_(has_filter),
+      pad_edge_blocks_(pad_edge_blocks),
+      output_pixel_size_(output_pixel_size),
+      input_pixel_size_(input_pixel_size),
+      band_count_(band_count) {}
+
+std::size_t StreamMemoryModel::BlockComputeMemory(
+      const Size& block_size) const {
+    double padded_cell_count =
+          ComputePaddedSize(block_size, margin_size_).CellCount();
+    double zoom = zoom_ratio_.input_resolution();
+    double zoomed_cell_count = zoom * zoom * padded_cell_count;
+    double ratio = zoom_ratio_.ratio();
+    double output_cell_count =
+          std::ceil(block_size.row * ratio) * std::ceil(block_size.col * ratio);
+    // resampled bands and their conversion to the output data type, bands
+    //   may be computed at the same time
+    return static_cast<std::size_t>(
+                 kPaddedCellBuffers * padded_cell_count +
+                 kZoomedCellBuffers * zoomed_cell_count + output_cell_count) *
+                 sizeof(double) * band_count_ +
+           BlockOutputMemory(block_size);
+}
+
+std::size_t StreamMemoryModel::BlockOutputMemory(
+      const Size& block_size) const {
+    double ratio = zoom_ratio_.ratio();
+    return static_cast<std::size_t>(std::ceil(block_size.row * ratio) *
+                                    std::ceil(block_size.col * ratio)) *
+           output_pixel_size_ * band_count_;
+}
+
+std::size_t StreamMemoryModel::FilterCacheMemory(
+      const Size& block_size) const {
+    if (!has_filter_) {
+        return 0;
+    }
+    double padded_cell_count =
+          ComputePaddedSize(block_size, margin_size_).CellCount();
+    double zoom = zoom_ratio_.input_resolution();
+    // half spectrum of complex values
+    std::size_t entry_memory = static_cast<std::size_t>(
+                                     zoom * zoom * padded_cell_count) *
+                               sizeof(double);
+    return (pad_edge_blocks_ ? 1 : kFilterCacheEntryCount) * entry_memory;
+}
+
+std::size_t StreamMemoryModel::ReorderBufferMemory(
+      const Size& block_size) const {
+    // buffered blocks above the pending blocks (at most a block row since
+    //   pending blocks are not less than the workers) and row buffer
+    auto grid_col_count = static_cast<std::size_t>(
+          CeilDiv(image_size_.col, block_size.col));
+    return 2 * grid_col_count * BlockOutputMemory(block_size);
+}
+
+std::size_t StreamMemoryModel::StripCacheMemory(
+      const Size& block_size, unsigned int max_pending_blocks) const {
+    if (margin_size_.row <= 0 && margin_size_.col <= 0) {
+        return 0;
+    }
+    // strips overlapped by a block row and strips of the block rows in
+    //   flight
+    int grid_col_count = CeilDiv(image_size_.col, block_size.col);
+    int strip_count =
+          CeilDiv(block_size.row + 2 * margin_size_.row, block_size.row) + 1 +
+          CeilDiv(static_cast<int>(max_pending_blocks), grid_col_count);
+    strip_count =
+          std::min(strip_count, CeilDiv(image_size_.row, block_size.row));
+    return static_cast<std::size_t>(strip_count) * block_size.row *
+           image_size_.col * input_pixel_size_ * band_count_;
+}
+
+std::size_t StreamMemoryModel::PeakMemory(
+      const Size& block_size, unsigned int parallel_workers,
+      unsigned int max_pending_blocks) const {
+    return parallel_workers * BlockComputeMemory(block_size) +
+           max_pending_blocks * BlockOutputMemory(block_size) +
+           FilterCacheMemory(block_size) + ReorderBufferMemory(block_size) +
+           StripCacheMemory(block_size, max_pending_blocks);
+}
+
+StreamParameters TuneStreamParameters(const StreamMemoryModel& model,
+                                      std::size_t max_memory,
+                                      unsigned int max_workers,
+                                      const Size& alignment,
+                                      bool resize_blocks) {
+    auto image_size = model.image_size();
+    auto zoom_ratio = model.zoom_ratio();
+    auto margin_size = model.margin_size();
+    max_workers = std::max(max_workers, 1u);
+
+    // candidates are ordered by increasing size
+    std::vector<Size> candidates;
+    for (int length : kCandidateBlockLengths) {
+        Size block_size(std::min(length, image_size.row),
+                        std::min(length, image_size.col));
+        if (resize_blocks) {
+            block_size = GenerateFFTFriendlySize(block_size, zoom_ratio,
+                                                 margin_size, alignment);
+        } else if (zoom_ratio.IsRealZoom()) {
+            block_size = GenerateZoomCompliantSize(block_size, zoom_ratio);
+        }
+        if (std::find(candidates.begin(), candidates.end(), block_size) ==
+            candidates.end()) {
+            candidates.push_back(block_size);
+        }
+    }
+
+    StreamParameters best_parameters;
+    double best_throughput = 0.;
+    for (const auto& block_size : candidates) {
+        auto parameters =
+              FitWorkers(model, max_memory, max_workers, block_size);
+        unsigned int workers = parameters.parallel_workers;
+        if (workers == 0) {
+            continue;
+        }
+        unsigned int pending_blocks = parameters.max_pending_blocks;
+
+        auto padded_size = ComputePaddedSize(block_size, margin_size);
+        Size zoomed_size(padded_size.row * zoom_ratio.input_resolution(),
+                         padded_size.col * zoom_ratio.input_resolution());
+        double cost_per_pixel =
+              (EstimateFFTCost(padded_size) + EstimateFFTCost(zoomed_size) +
+               kBlockOverheadCost) /
+              block_size.CellCount();
+        double throughput = workers / cost_per_pixel;
+        LOG("memory_budget", debug,
+            "block {}x{}: {} workers, {} pending blocks, {:.1f} MB, "
+            "throughput {:.3g}",
+            block_size.row, block_size.col, workers, pending_blocks,
+            model.PeakMemory(block_size, workers, pending_blocks) /
+                  (1024. * 1024.),
+            throughput);
+        if (throughput > best_throughput) {
+            best_throughput = throughput;
+            best_parameters.block_size = block_size;
+            best_parameters.parallel_workers = workers;
+            best_parameters.max_pending_blocks = pending_blocks;
+        }
+    }
+
+    if (best_throughput == 0.) {
+        best_parameters.block_size = candidates.front();
+        best_parameters.parallel_workers = 1;
+        best_parameters.max_pending_blocks = 1;
+        LOG("memory_budget", warn,
+            "memory budget of {:.1f} MB is too small for stream mode",
+            max_memory / (1024. * 1024.));
+    }
+    best_parameters.peak_memory =
+          model.PeakMemory(best_parameters.block_size,
+                           best_parameters.parallel_workers,
+                           best_parameters.max_pending_blocks);
+    return best_parameters;
+}
+
+StreamParameters TuneStreamWorkers(const StreamMemoryModel& model,
+                                   std::size_t max_memory,
+                                   unsigned int max_workers,
+                                   const Size& block_size) {
+    auto parameters = FitWorkers(model, max_memory,
+                                 std::max(max_workers, 1u), block_size);
+    if (parameters.parallel_workers == 0) {
+        parameters.parallel_workers = 1;
+        parameters.max_pending_blocks = 1;
+        parameters.peak_memory = model.PeakMemory(block_size, 1, 1);
+        LOG("memory_budget", warn,
+            "memory budget of {:.1f} MB is too small for a {}x{} block",
+            max_memory / (1024. * 1024.), block_size.row, block_size.col);
+    }
+    return parameters;
+}
+
+std::size_t ParseMemorySize(const std::string& memory_string) {
+    std::size_t unit_pos = 0;
+    double value = 0.;
+    try {
+        value = std::stod(memory_string, &unit_pos);
+    } catch (const std::exception&) {
+        throw Exception("invalid memory size");
+    }
+    if (!std::isfinite(value) || value <= 0.) {
+        throw Exception("invalid memory size");
+    }
+
+    std::string unit;
+    for (auto c : memory_string.substr(unit_pos)) {
+        unit.push_back(
+              static_cast<char>(std::toupper(static_cast<unsigned char>(c))));
+    }
+    if (unit.size() == 2 && unit[0] != 'B' && unit[1] == 'B') {
+        unit.pop_back();
+    }
+
+    double unit_size = 1024. * 1024.;
+    if (unit == "B") {
+        unit_size = 1.;
+    } else if (unit == "K") {
+        unit_size = 1024.;
+    } else if (unit.empty() || unit == "M") {
+        unit_size = 1024. * 1024.;
+    } else if (unit == "G") {
+        unit_size = 1024. * 1024. * 1024.;
+    } else if (unit == "T") {
+        unit_size = 1024. * 1024. * 1024. * 1024.;
+    } else {
+        throw Exception("invalid memory size unit");
+    }
+    return static_cast<std::size_t>(value * unit_size);
+}
+
+}  // namespace utils
+}  // namespace sirius
@@ -0,0 +1,219 @@
+/**
+ * Copyright (C) 2018 CS - Systemes d'Information (CS-SI)
+ *
+ * This file is part of Sirius
+ *
+ *     https://github.com/CS-SI/SIRIUS
+ *
+ * Sirius is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sirius is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Sirius.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef SIRIUS_UTILS_MEMORY_BUDGET_H_
+#define SIRIUS_UTILS_MEMORY_BUDGET_H_
+
+#include <cstddef>
+#include <string>
+
+#include "sirius/types.h"
+
+namespace sirius {
+namespace utils {
+
+/**
+ * \brief Stream parameters selected for a memory budget
+ */
+struct StreamParameters {
+    /// stream block size
+    Size block_size;
+    /// blocks computed at the same time
+    unsigned int parallel_workers = 1;
+    /// blocks in flight (read, computed or waiting to be written)
+    unsigned int max_pending_blocks = 1;
+    /// predicted peak memory (bytes)
+    std::size_t peak_memory = 0;
+};
+
+/**
+ * \brief Coarse model of the memory used by stream mode
+ *
+ * Memory sizes are in bytes. They are upper bounds of the buffers allocated
+ *   while streaming: padded input block, image decomposition, spectra and
+ *   zoomed image of each computed block, filter spectrum cache, computed
+ *   blocks waiting to be written, output reorder buffer and input strip
+ *   cache.
+ */
+class StreamMemoryModel {
+  public:
+    /**
+     * \brief Instanciate a memory model for a stream
+     * \param image_size input image size
+     * \param zoom_ratio zoom ratio
+     * \param margin_size block margin size (filter padding)
+     * \param has_filter a filter spectrum is computed for each block size
+     * \param pad_edge_blocks all padded blocks share the same size
+     * \param output_pixel_size size of a pixel converted to the output data
+     *        type
+     * \param input_pixel_size size of an input pixel in its native data
+     *        type
+     * \param band_count number of bands of a block, the filter spectrum is
+     *        shared by the bands
+     */
+    StreamMemoryModel(const Size& image_size, const ZoomRatio& zoom_ratio,
+                      const Size& margin_size, bool has_filter,
+                      bool pad_edge_blocks = false,
+                      std::size_t output_pixel_size = sizeof(double),
+                      std::size_t input_pixel_size = sizeof(double),
+                      int band_count = 1);
+
+    /**
+     * \brief Peak memory used to compute one block
+     * \param block_size stream block size
+     * \return memory size
+     */
+    std::size_t BlockComputeMemory(const Size& block_size) const;
+
+    /**
+     * \brief Memory of a computed block converted to the output data type,
+     *        waiting to be written
+     * \param block_size stream block size
+     * \return memory size
+     */
+    std::size_t BlockOutputMemory(const Size& block_size) const;
+
+    /**
+     * \brief Memory of the filter spectrum cache
+     *
+     * Filter spectrum is cached for each padded block size (nominal, right
+     *   edge, bottom edge and corner blocks)
+     *
+     * \param block_size stream block size
+     * \return memory size
+     */
+    std::size_t FilterCacheMemory(const Size& block_size) const;
+
+    /**
+     * \brief Memory of the output reorder buffer
+     *
+     * Computed blocks are buffered until their block row is complete, then
+     *   copied into a row buffer. Buffered blocks are in flight and pending
+     *   blocks are raised to one block row plus the workers: the blocks
+     *   above the pending blocks fit in one block row.
+     *
+     * \param block_size stream block size
+     * \return memory size
+     */
+    std::size_t ReorderBufferMemory(const Size& block_size) const;
+
+    /**
+     * \brief Memory of the input strips kept to share block margins
+     *
+     * Strips are kept in the native data type of the input image
+     *
+     * \param block_size stream block size
+     * \param max_pending_blocks blocks in flight
+     * \return memory size
+     */
+    std::size_t StripCacheMemory(const Size& block_size,
+                                 unsigned int max_pending_blocks) const;
+
+    /**
+     * \brief Predicted peak memory of a stream
+     * \param block_size stream block size
+     * \param parallel_workers blocks computed at the same time
+     * \param max_pending_blocks blocks in flight
+     * \return memory size
+     */
+    std::size_t PeakMemory(const Size& block_size,
+                           unsigned int parallel_workers,
+                           unsigned int max_pending_blocks) const;
+
+    Size image_size() const { return image_size_; }
+    ZoomRatio zoom_ratio() const { return zoom_ratio_; }
+    Size margin_size() const { return margin_size_; }
+
+  private:
+    Size image_size_;
+    ZoomRatio zoom_ratio_;
+    Size margin_size_;
+    bool has_filter_;
+    bool pad_edge_blocks_;
+    std::size_t output_pixel_size_;
+    std::size_t input_pixel_size_;
+    int band_count_;
+};
+
+/**
+ * \brief Select stream parameters which maximize the predicted throughput
+ *        without exceeding a memory budget
+ *
+ * Square candidate blocks are resized like regular stream blocks. For each
+ *   candidate, the largest worker count that fits in the budget is kept and
+ *   the throughput is predicted from the FFT cost per useful pixel. Pending
+ *   blocks are raised up to twice the worker count when the budget allows it
+ *   so that computation overlaps with writing.
+ *
+ * If no candidate fits in the budget, the smallest candidate is computed by
+ *   a single worker.
+ *
+ * \param model stream memory model
+ * \param max_memory memory budget (bytes)
+ * \param max_workers maximum worker count
+ * \param alignment block dimensions should be multiple of alignment
+ * \param resize_blocks resize candidates to FFT friendly sizes
+ * \return selected stream parameters
+ */
+StreamParameters TuneStreamParameters(const StreamMemoryModel& model,
+                                      std::size_t max_memory,
+                                      unsigned int max_workers,
+                                      const Size& alignment = {1, 1},
+                                      bool resize_blocks = true);
+
+/**
+ * \brief Select the workers and pending blocks of a fixed block size which
+ *        fit in a memory budget
+ *
+ * Used when the block size must not depend on the host resources (shards
+ *   and windows are computed on the block grid). Pending blocks are raised
+ *   like in TuneStreamParameters. If one block does not fit in the budget,
+ *   it is computed by a single worker.
+ *
+ * \param model stream memory model
+ * \param max_memory memory budget (bytes)
+ * \param max_workers maximum worker count
+ * \param block_size stream block size
+ * \return selected stream parameters
+ */
+StreamParameters TuneStreamWorkers(const StreamMemoryModel& model,
+                                   std::size_t max_memory,
+                                   unsigned int max_workers,
+                                   const Size& block_size);
+
+/**
+ * \brief Parse a memory size
+ *
+ * Allowed format is a positive number followed by an optional unit: K, M, G
+ *   or T (powers of 1024, case insensitive, optional trailing B). Unitless
+ *   values are in megabytes.
+ *
+ * \param memory_string memory size as a string (ex: 512M, 4G, 1.5G)
+ * \return memory size in bytes
+ * \throw sirius::Exception if the string is not a valid memory size
+ */
+std::size_t ParseMemorySize(const std::string& memory_string);
+
+}  // namespace utils
+}  // namespace sirius
+
+#endif  // SIRIUS_UTILS_MEMORY_BUDGET_H_
@@ -24,6 +24,7 @@
 #include <cmath>
 
 #include <algorithm>
+#include <limits>
 #include <utility>
 
 #include "sirius/utils/log.h"
@@ -31,6 +32,63 @@
 namespace sirius {
 namespace utils {
 
+namespace {
+
+// maximal block growth allowed when looking for FFT friendly sizes
+constexpr double kMaxBlockGrowth = 1.125;
+
+// per element cost of radix 2, 3, 5 and 7 passes (relative to radix 2)
+constexpr int kFFTFriendlyRadices[] = {2, 3, 5, 7};
+constexpr double kFFTRadixCosts[] = {1.0, 1.7, 2.6, 3.2};
+
+double EstimateFFTCostFactor(int n) {
+    double cost = 0.;
+    for (int i = 0; i < 4; ++i) {
+        while (n % kFFTFriendlyRadices[i] == 0) {
+            n /= kFFTFriendlyRadices[i];
+            cost += kFFTRadixCosts[i];
+        }
+    }
+    // remaining prime factors are computed with generic codelets
+    for (int p = 11; n > 1 && p * p <= n; p += 2) {
+        while (n % p == 0) {
+            n /= p;
+            cost += p;
+        }
+    }
+    if (n > 1) {
+        cost += n;
+    }
+    return cost;
+}
+
+/**
+ * \brief List FFT friendly block lengths for one dimension
+ * \param length requested block length
+ * \param margin margin length
+ * \param step block lengths must be multiple of step
+ * \return candidate block lengths
+ */
+std::vector<int> GenerateFFTFriendlyLengths(int length, int margin, int step) {
+    std::vector<int> candidates;
+    int first = ((length + step - 1) / step) * step;
+    int last = std::max(static_cast<int>(std::ceil(length * kMaxBlockGrowth)),
+                        first);
+    // widen the search window until a candidate is found
+    while (candidates.empty() && last <= 4 * std::max(length, step)) {
+        for (int l = first; l <= last; l += step) {
+            if (IsFFTFriendlySize(l + 2 * margin)) {
+                candidates.push_back(l);
+            }
+        }
+        first = last + step - (last % step);
+        last = static_cast<int>(std::ceil(last * kMaxBlockGrowth)) + step;
+    }
+    return candidates;
+}
+
+}  // namespace
+
 int Gcd(int a, int b) {
     a = std::abs(a);
     b = std::abs(b);
@@ -246,6 +304,86 @@ Size GenerateZoomCompliantSize(const Size& size, const ZoomRatio& zoom_r) {
     return {h, w};
 }
 
+bool IsFFTFriendlySize(int n) {
+    if (n <= 0) {
+        return false;
+    }
+    for (int radix : kFFTFriendlyRadices) {
+        while (n % radix == 0) {
+            n /= radix;
+        }
+    }
+    return n == 1;
+}
+
+double EstimateFFTCost(const Size& size) {
+    return static_cast<double>(size.CellCount()) *
+           (EstimateFFTCostFactor(size.row) + EstimateFFTCostFactor(size.col));
+}
+
+Size GenerateFFTFriendlySize(const Size& size, const ZoomRatio& zoom_r,
+                             const Size& padding_size, const Size& alignment) {
+    // real zoom: block must be a multiple of output resolution
+    int step = zoom_r.IsRealZoom() ? zoom_r.output_resolution() : 1;
+    int row_step = step;
+    int col_step = step;
+    if (alignment.row > 1 && alignment.row <= size.row) {
+        row_step = step * alignment.row / Gcd(step, alignment.row);
+    }
+    if (alignment.col > 1 && alignment.col <= size.col) {
+        col_step = step * alignment.col / Gcd(step, alignment.col);
+    }
+    auto row_candidates =
+          GenerateFFTFriendlyLengths(size.row, padding_size.row, row_step);
+    auto col_candidates =
+          GenerateFFTFriendlyLengths(size.col, padding_size.col, col_step);
+    if (row_candidates.empty() && row_step != step) {
+        LOG("numeric", warn,
+            "Could not find FFT friendly block height aligned on {}. "
+            "Alignment is ignored",
+            alignment.row);
+        row_candidates =
+              GenerateFFTFriendlyLengths(size.row, padding_size.row, step);
+    }
+    if (col_candidates.empty() && col_step != step) {
+        LOG("numeric", warn,
+            "Could not find FFT friendly block width aligned on {}. "
+            "Alignment is ignored",
+            alignment.col);
+        col_candidates =
+              GenerateFFTFriendlyLengths(size.col, padding_size.col, step);
+    }
+
+    if (row_candidates.empty() || col_candidates.empty()) {
+        LOG("numeric", warn,
+            "Could not find FFT friendly block size. Initial size will be "
+            "used");
+        return zoom_r.IsRealZoom() ? GenerateZoomCompliantSize(size, zoom_r)
+                                   : size;
+    }
+
+    Size best_size = size;
+    double best_cost = std::numeric_limits<double>::max();
+    int res_in = zoom_r.input_resolution();
+    for (int row : row_candidates) {
+        for (int col : col_candidates) {
+            Size padded_size(row + 2 * padding_size.row,
+                             col + 2 * padding_size.col);
+            Size zoomed_size(padded_size.row * res_in,
+                             padded_size.col * res_in);
+            double cost = (EstimateFFTCost(padded_size) +
+                           EstimateFFTCost(zoomed_size)) /
+                          (static_cast<double>(row) * col);
+            if (cost < best_cost) {
+                best_cost = cost;
+                best_size = {row, col};
+            }
+        }
+    }
+
+    return best_size;
+}
+
 std::vector<double> ComputeFFTFreq(const int n_samples, const bool half) {
     std::vector<double> freq;
 
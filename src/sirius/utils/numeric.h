@@ -90,6 +90,51 @@ Size GenerateDyadicSize(const Size& size, const int res_in,
  */
 Size GenerateZoomCompliantSize(const Size& size, const ZoomRatio& zoom_r);
 
+/**
+ * \brief Check if FFTW can transform a signal of the given length with its
+ *        fast codelets only (length is a 2^a.3^b.5^c.7^d product)
+ * \param n signal length
+ * \return true if n only has 2, 3, 5 or 7 as prime factors
+ */
+bool IsFFTFriendlySize(int n);
+
+/**
+ * \brief Predict the relative cost of a 2D FFT
+ *
+ * Cost is modeled as N.sum(w(p)) where N is the number of elements and w(p)
+ *   the per element cost of a radix p pass. Large prime factors are penalized
+ *   since FFTW falls back on generic algorithms for them.
+ *
+ * \param size dimensions of the transform
+ * \return predicted cost (arbitrary unit, only relevant for comparisons)
+ */
+double EstimateFFTCost(const Size& size);
+
+/**
+ * \brief Resize given block dimensions so that the padded block
+ *        (block + 2 * margins) is 2^a.3^b.5^c.7^d sized
+ *
+ * Candidate blocks are searched slightly above the requested size. The
+ *   selected block minimizes the predicted cost of the forward FFT of the
+ *   padded block and of the inverse FFT of the zoomed block per useful pixel.
+ *   If zoom is real, block dimensions are kept multiple of the output
+ *   resolution.
+ *
+ * Block dimensions are also kept multiple of the alignment (typically the
+ *   native tile size of the input image) so that blocks start on tile
+ *   boundaries. Alignment dimensions larger than the requested size are
+ *   ignored. If no aligned candidate is found, alignment is dropped.
+ *
+ * \param size requested block size
+ * \param zoom_r zoom ratio
+ * \param padding_size size of the margins
+ * \param alignment block dimensions should be multiple of alignment
+ * \return optimized block size
+ */
+Size GenerateFFTFriendlySize(const Size& size, const ZoomRatio& zoom_r,
+                             const Size& padding_size,
+                             const Size& alignment = {1, 1});
+
 /**
  * \brief Create coordinates vector
  * \param x_min beginning of x axis
@@ -0,0 +1,383 @@
+/**
+ * Copyright (C) 2018 CS - Systemes d'Information (CS-SI)
+ *
+ * This file is part of Sirius
+ *
+ *     https://github.com/CS-SI/SIRIUS
+ *
+ * Sirius is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sirius is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Sirius.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "sirius/utils/pipeline_metrics.h"
+
+#include <cmath>
+#include <cstdio>
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+#include "sirius/exception.h"
+
+#include "sirius/utils/log.h"
+
+namespace sirius {
+namespace utils {
+
+namespace {
+
+constexpr std::uint64_t kUnsetMinNs = std::numeric_limits<std::uint64_t>::max();
+
+thread_local PipelineMetrics* current_metrics = nullptr;
+
+// names of the stages, in PipelineStage order
+constexpr const char* kPipelineStageNames[] = {"read",
+                                               "queue_wait",
+                                               "decomposition",
+                                               "forward_fft",
+                                               "spectrum_expansion",
+                                               "filter",
+                                               "inverse_fft",
+                                               "epilogue",
+                                               "convert",
+                                               "write"};
+
+static_assert(sizeof(kPipelineStageNames) / sizeof(kPipelineStageNames[0]) ==
+                    kPipelineStageCount,
+              "every pipeline stage needs a name");
+
+double NsToMs(std::uint64_t ns) { return ns / 1e6; }
+
+/**
+ * \brief Histogram bucket of a latency: floor(log2(us))
+ */
+std::size_t ComputeBucketIndex(std::uint64_t ns) {
+    std::uint64_t us = ns / 1000;
+    std::size_t bucket_index = 0;
+    while (us > 1 && bucket_index + 1 < StageMetrics::kBucketCount) {
+        us >>= 1;
+        ++bucket_index;
+    }
+    return bucket_index;
+}
+
+/**
+ * \brief Upper bound of a histogram bucket in us
+ */
+double BucketUpperBoundUs(std::size_t bucket_index) {
+    return std::ldexp(1., static_cast<int>(bucket_index) + 1);
+}
+
+std::string EscapeJson(const std::string& value) {
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (char c : value) {
+        switch (c) {
+            case '"':
+                escaped += "\\\"";
+                break;
+            case '\\':
+                escaped += "\\\\";
+                break;
+            case '\n':
+                escaped += "\\n";
+                break;
+            case '\r':
+                escaped += "\\r";
+                break;
+            case '\t':
+                escaped += "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char code[7];
+                    std::snprintf(code, sizeof(code), "\\u%04x", c);
+                    escaped += code;
+                } else {
+                    escaped += c;
+                }
+                break;
+        }
+    }
+    return escaped;
+}
+
+void WriteCacheJson(std::ostringstream& json,
+                    const CacheStatistics& statistics) {
+    json << "{\"hits\": " << statistics.hit_count
+         << ", \"misses\": " << statistics.miss_count
+         << ", \"hit_rate\": " << statistics.HitRate() << "}";
+}
+
+void WriteStageJson(std::ostringstream& json, const StageMetrics& stage) {
+    json << "{\"count\": " << stage.count
+         << ", \"total_ms\": " << stage.total_ms
+         << ", \"mean_ms\": " << stage.MeanMs()
+         << ", \"min_ms\": " << stage.min_ms
+         << ", \"max_ms\": " << stage.max_ms
+         << ", \"p50_ms\": " << stage.PercentileMs(50.)
+         << ", \"p90_ms\": " << stage.PercentileMs(90.)
+         << ", \"p99_ms\": " << stage.PercentileMs(99.)
+         << ", \"histogram_us\": [";
+    // [upper bound (us), count] of the non empty buckets
+    bool is_first = true;
+    for (std::size_t i = 0; i < stage.histogram.size(); ++i) {
+        if (stage.histogram[i] == 0) {
+            continue;
+        }
+        json << (is_first ? "" : ", ") << "[" << BucketUpperBoundUs(i)
+             << ", " << stage.histogram[i] << "]";
+        is_first = false;
+    }
+    json << "]}";
+}
+
+}  // namespace
+
+const char* PipelineStageName(PipelineStage stage) {
+    auto stage_index = static_cast<std::size_t>(stage);
+    if (stage_index >= kPipelineStageCount) {
+        return "unknown";
+    }
+    return kPipelineStageNames[stage_index];
+}
+
+double StageMetrics::PercentileMs(double percentile) const {
+    if (count == 0) {
+        return 0.;
+    }
+    auto rank = static_cast<std::uint64_t>(
+          std::ceil(std::min(std::max(percentile, 0.), 100.) / 100. * count));
+    rank = std::max<std::uint64_t>(rank, 1);
+    std::uint64_t cumulated_count = 0;
+    for (std::size_t i = 0; i < histogram.size(); ++i) {
+        cumulated_count += histogram[i];
+        if (cumulated_count >= rank) {
+            return std::min(BucketUpperBoundUs(i) / 1000., max_ms);
+        }
+    }
+    return max_ms;
+}
+
+constexpr std::chrono::milliseconds PipelineMetrics::kOccupancySamplePeriod;
+constexpr std::size_t PipelineMetrics::kMaxOccupancySampleCount;
+
+PipelineMetrics::PipelineMetrics() { Start(); }
+
+PipelineMetrics* PipelineMetrics::Current() { return current_metrics; }
+
+void PipelineMetrics::Start() {
+    for (auto& stage : stages_) {
+        stage.count = 0;
+        stage.total_ns = 0;
+        stage.min_ns = kUnsetMinNs;
+        stage.max_ns = 0;
+        for (auto& bucket : stage.histogram) {
+            bucket = 0;
+        }
+    }
+    read_block_count_ = 0;
+    computed_block_count_ = 0;
+    written_block_count_ = 0;
+    written_byte_count_ = 0;
+
+    std::lock_guard<std::mutex> lock(occupancy_mutex_);
+    start_time_ = Clock::now();
+    last_occupancy_update_ = start_time_;
+    last_occupancy_sample_ = start_time_;
+    input_blocks_ = 0;
+    output_blocks_ = 0;
+    input_occupancy_ = {};
+    output_occupancy_ = {};
+    input_block_time_ = 0.;
+    output_block_time_ = 0.;
+    occupancy_samples_.clear();
+}
+
+void PipelineMetrics::Record(PipelineStage stage,
+                             std::chrono::nanoseconds duration) {
+    auto& counters = stages_[static_cast<std::size_t>(stage)];
+    auto ns = static_cast<std::uint64_t>(std::max<std::int64_t>(
+          std::chrono::nanoseconds(duration).count(), 0));
+    ++counters.count;
+    counters.total_ns += ns;
+    ++counters.histogram[ComputeBucketIndex(ns)];
+
+    auto min_ns = counters.min_ns.load();
+    while (ns < min_ns && !counters.min_ns.compare_exchange_weak(min_ns, ns)) {
+    }
+    auto max_ns = counters.max_ns.load();
+    while (ns > max_ns && !counters.max_ns.compare_exchange_weak(max_ns, ns)) {
+    }
+}
+
+void PipelineMetrics::UpdateOccupancy(int input_blocks, int output_blocks) {
+    auto now = Clock::now();
+    std::lock_guard<std::mutex> lock(occupancy_mutex_);
+    double elapsed_s =
+          std::chrono::duration<double>(now - last_occupancy_update_).count();
+    input_block_time_ += input_blocks_ * elapsed_s;
+    output_block_time_ += output_blocks_ * elapsed_s;
+    last_occupancy_update_ = now;
+    input_blocks_ = input_blocks;
+    output_blocks_ = output_blocks;
+    input_occupancy_.max_blocks =
+          std::max(input_occupancy_.max_blocks, input_blocks);
+    output_occupancy_.max_blocks =
+          std::max(output_occupancy_.max_blocks, output_blocks);
+
+    if ((occupancy_samples_.empty() ||
+         now - last_occupancy_sample_ >= kOccupancySamplePeriod) &&
+        occupancy_samples_.size() < kMaxOccupancySampleCount) {
+        last_occupancy_sample_ = now;
+        OccupancySample sample;
+        sample.time_s =
+              std::chrono::duration<double>(now - start_time_).count();
+        sample.input_blocks = input_blocks;
+        sample.output_blocks = output_blocks;
+        occupancy_samples_.push_back(sample);
+    }
+}
+
+PipelineMetricsSnapshot PipelineMetrics::Snapshot() const {
+    PipelineMetricsSnapshot snapshot;
+    for (std::size_t i = 0; i < kPipelineStageCount; ++i) {
+        const auto& counters = stages_[i];
+        auto& stage = snapshot.stages[i];
+        stage.count = counters.count;
+        stage.total_ms = NsToMs(counters.total_ns);
+        auto min_ns = counters.min_ns.load();
+        stage.min_ms = min_ns == kUnsetMinNs ? 0. : NsToMs(min_ns);
+        stage.max_ms = NsToMs(counters.max_ns);
+        for (std::size_t j = 0; j < StageMetrics::kBucketCount; ++j) {
+            stage.histogram[j] = counters.histogram[j];
+        }
+    }
+    snapshot.read_block_count = read_block_count_;
+    snapshot.computed_block_count = computed_block_count_;
+    snapshot.written_block_count = written_block_count_;
+    snapshot.written_byte_count = written_byte_count_;
+
+    auto now = Clock::now();
+    std::lock_guard<std::mutex> lock(occupancy_mutex_);
+    snapshot.elapsed_s =
+          std::chrono::duration<double>(now - start_time_).count();
+    double elapsed_since_update_s =
+          std::chrono::duration<double>(now - last_occupancy_update_).count();
+    snapshot.input_occupancy = input_occupancy_;
+    snapshot.output_occupancy = output_occupancy_;
+    if (snapshot.elapsed_s > 0.) {
+        snapshot.input_occupancy.mean_blocks =
+              (input_block_time_ + input_blocks_ * elapsed_since_update_s) /
+              snapshot.elapsed_s;
+        snapshot.output_occupancy.mean_blocks =
+              (output_block_time_ + output_blocks_ * elapsed_since_update_s) /
+              snapshot.elapsed_s;
+    }
+    snapshot.occupancy_samples = occupancy_samples_;
+    return snapshot;
+}
+
+PipelineMetricsScope::PipelineMetricsScope(PipelineMetrics* metrics)
+    : previous_metrics_(current_metrics) {
+    current_metrics = metrics;
+}
+
+PipelineMetricsScope::~PipelineMetricsScope() {
+    current_metrics = previous_metrics_;
+}
+
+std::string ToJson(const PipelineMetricsSnapshot& snapshot) {
+    std::ostringstream json;
+    json.precision(6);
+    json << "{\"elapsed_s\": " << snapshot.elapsed_s;
+    json << ", \"blocks\": {\"read\": " << snapshot.read_block_count
+         << ", \"computed\": " << snapshot.computed_block_count
+         << ", \"written\": " << snapshot.written_block_count << "}";
+    json << ", \"bytes\": {\"read\": " << snapshot.read_byte_count
+         << ", \"written\": " << snapshot.written_byte_count << "}";
+    json << ", \"throughput\": {\"blocks_per_s\": "
+         << snapshot.BlocksPerSecond()
+         << ", \"read_mb_per_s\": " << snapshot.ReadMBPerSecond()
+         << ", \"write_mb_per_s\": " << snapshot.WriteMBPerSecond() << "}";
+
+    json << ", \"stages\": {";
+    for (std::size_t i = 0; i < kPipelineStageCount; ++i) {
+        json << (i > 0 ? ", " : "") << "\""
+             << PipelineStageName(static_cast<PipelineStage>(i)) << "\": ";
+        WriteStageJson(json, snapshot.stages[i]);
+    }
+    json << "}";
+
+    json << ", \"queues\": {\"input\": {\"max_blocks\": "
+         << snapshot.input_occupancy.max_blocks
+         << ", \"mean_blocks\": " << snapshot.input_occupancy.mean_blocks
+         << "}, \"output\": {\"max_blocks\": "
+         << snapshot.output_occupancy.max_blocks
+         << ", \"mean_blocks\": " << snapshot.output_occupancy.mean_blocks
+         << "}, \"samples\": [";
+    // [time (s), input blocks, output blocks]
+    for (std::size_t i = 0; i < snapshot.occupancy_samples.size(); ++i) {
+        const auto& sample = snapshot.occupancy_samples[i];
+        json << (i > 0 ? ", " : "") << "[" << sample.time_s << ", "
+             << sample.input_blocks << ", " << sample.output_blocks << "]";
+    }
+    json << "]}";
+
+    json << ", \"caches\": {\"fft_plan\": ";
+    WriteCacheJson(json, snapshot.fft_plan_cache);
+    json << ", \"filter\": ";
+    WriteCacheJson(json, snapshot.filter_cache);
+    double strip_saving =
+          snapshot.requested_pixel_count > snapshot.read_pixel_count
+                ? static_cast<double>(snapshot.requested_pixel_count -
+                                      snapshot.read_pixel_count) /
+                        snapshot.requested_pixel_count
+                : 0.;
+    json << ", \"strip\": {\"requested_pixels\": "
+         << snapshot.requested_pixel_count
+         << ", \"read_pixels\": " << snapshot.read_pixel_count
+         << ", \"saved_ratio\": " << strip_saving << "}}";
+    json << "}";
+    return json.str();
+}
+
+void WriteMetricsReport(const std::string& report_path,
+                        const std::vector<MetricsReportEntry>& entries) {
+    std::ofstream report(report_path, std::ios::binary | std::ios::trunc);
+    if (!report) {
+        throw sirius::Exception("cannot create metrics report '" +
+                                report_path + "'");
+    }
+    report << "{\"images\": [\n";
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+        const auto& entry = entries[i];
+        report << "{\"input\": \"" << EscapeJson(entry.input_path)
+               << "\", \"output\": \"" << EscapeJson(entry.output_path)
+               << "\", \"metrics\": " << ToJson(entry.metrics) << "}"
+               << (i + 1 < entries.size() ? "," : "") << "\n";
+    }
+    report << "]}\n";
+    report.flush();
+    if (!report) {
+        throw sirius::Exception("cannot write metrics report '" +
+                                report_path + "'");
+    }
+    LOG("pipeline_metrics", info, "metrics report written in '{}'",
+        report_path);
+}
+
+}  // namespace utils
+}  // namespace sirius
@@ -0,0 +1,376 @@
+/**
+ * Copyright (C) 2018 CS - Systemes d'Information (CS-SI)
+ *
+ * This file is part of Sirius
+ *
+ *     https://github.com/CS-SI/SIRIUS
+ *
+ * Sirius is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sirius is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Sirius.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SIRIUS_UTILS_PIPELINE_METRICS_H_
+#define SIRIUS_UTILS_PIPELINE_METRICS_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "sirius/utils/lru_cache.h"
+
+namespace sirius {
+namespace utils {
+
+/**
+ * \brief Stages of the stream pipeline
+ */
+enum class PipelineStage {
+    /// read of the input block
+    kRead = 0,
+    /// computed block waiting for the writer
+    kQueueWait,
+    /// periodic plus smooth decomposition, zoom of the periodic part
+    ///   excluded
+    kDecomposition,
+    /// FFT of the image to zoom
+    kForwardFFT,
+    /// periodization or zero padding of the spectrum
+    kSpectrumExpansion,
+    /// filter applied to the zoomed spectrum
+    kFilter,
+    /// IFFT of the zoomed spectrum
+    kInverseFFT,
+    /// output window extraction and normalization
+    kEpilogue,
+    /// conversion to the output data type
+    kConvert,
+    /// write of the output block (reorder buffer included)
+    kWrite,
+    kCount
+};
+
+constexpr std::size_t kPipelineStageCount =
+      static_cast<std::size_t>(PipelineStage::kCount);
+
+/**
+ * \brief Name of a stage in metrics reports
+ */
+const char* PipelineStageName(PipelineStage stage);
+
+/**
+ * \brief Latency statistics of a stage
+ *
+ * Latencies are counted in power of two buckets of microseconds: bucket i
+ *   holds latencies in [2^i, 2^(i+1)) us, bucket 0 also holds latencies
+ *   below 1 us. Percentiles are the upper bound of their bucket.
+ */
+struct StageMetrics {
+    static constexpr std::size_t kBucketCount = 32;
+
+    std::uint64_t count = 0;
+    double total_ms = 0.;
+    double min_ms = 0.;
+    double max_ms = 0.;
+    std::array<std::uint64_t, kBucketCount> histogram{};
+
+    double MeanMs() const { return count > 0 ? total_ms / count : 0.; }
+
+    /**
+     * \brief Estimated percentile
+     * \param percentile percentile in [0, 100]
+     * \return latency in ms
+     */
+    double PercentileMs(double percentile) const;
+};
+
+/**
+ * \brief Blocks in the pipeline at a given time
+ */
+struct OccupancySample {
+    /// seconds since the start of the run
+    double time_s = 0.;
+    /// blocks submitted and not computed yet
+    int input_blocks = 0;
+    /// computed blocks not written yet
+    int output_blocks = 0;
+};
+
+/**
+ * \brief Occupancy statistics of a pipeline queue
+ */
+struct OccupancyMetrics {
+    int max_blocks = 0;
+    /// time weighted mean
+    double mean_blocks = 0.;
+};
+
+/**
+ * \brief Metrics of a stream run at a given time
+ */
+struct PipelineMetricsSnapshot {
+    double elapsed_s = 0.;
+
+    std::uint64_t read_block_count = 0;
+    std::uint64_t computed_block_count = 0;
+    std::uint64_t written_block_count = 0;
+    /// bytes read from the input dataset
+    std::uint64_t read_byte_count = 0;
+    /// bytes written in the output dataset
+    std::uint64_t written_byte_count = 0;
+
+    std::array<StageMetrics, kPipelineStageCount> stages{};
+
+    OccupancyMetrics input_occupancy;
+    OccupancyMetrics output_occupancy;
+    std::vector<OccupancySample> occupancy_samples;
+
+    /// FFTW plan cache
+    CacheStatistics fft_plan_cache;
+    /// filter spectrum cache
+    CacheStatistics filter_cache;
+    /// pixels requested by the blocks (margins included) and pixels read
+    ///   from the dataset, the other ones are copied from the strip cache
+    std::uint64_t requested_pixel_count = 0;
+    std::uint64_t read_pixel_count = 0;
+
+    const StageMetrics& Stage(PipelineStage stage) const {
+        return stages[static_cast<std::size_t>(stage)];
+    }
+
+    double BlocksPerSecond() const {
+        return elapsed_s > 0. ? written_block_count / elapsed_s : 0.;
+    }
+
+    double ReadMBPerSecond() const {
+        return elapsed_s > 0. ? read_byte_count / (1024. * 1024.) / elapsed_s
+                              : 0.;
+    }
+
+    double WriteMBPerSecond() const {
+        return elapsed_s > 0.
+                     ? written_byte_count / (1024. * 1024.) / elapsed_s
+                     : 0.;
+    }
+};
+
+/**
+ * \brief Callback receiving live metrics of a run
+ */
+using PipelineMetricsCallback =
+      std::function<void(const PipelineMetricsSnapshot&)>;
+
+/**
+ * \brief Counters and latency histograms of a stream pipeline
+ *
+ * Stages are timed by StageTimer on the threads attached to the metrics
+ *   with a PipelineMetricsScope, so that the resampler does not depend on
+ *   the stream. Counters and histograms are lock free, occupancy samples
+ *   are taken at most every kOccupancySamplePeriod.
+ */
+class PipelineMetrics {
+  public:
+    static constexpr std::chrono::milliseconds kOccupancySamplePeriod{100};
+    static constexpr std::size_t kMaxOccupancySampleCount = 10000;
+
+    PipelineMetrics();
+    ~PipelineMetrics() = default;
+
+    // non copyable
+    PipelineMetrics(const PipelineMetrics&) = delete;
+    PipelineMetrics& operator=(const PipelineMetrics&) = delete;
+    // non moveable
+    PipelineMetrics(PipelineMetrics&&) = delete;
+    PipelineMetrics& operator=(PipelineMetrics&&) = delete;
+
+    /**
+     * \brief Metrics attached to the calling thread
+     * \return metrics, null if the thread is not attached to any metrics
+     */
+    static PipelineMetrics* Current();
+
+    /**
+     * \brief Reset the metrics and start the run clock
+     */
+    void Start();
+
+    /**
+     * \brief Add a latency to a stage
+     * \param stage pipeline stage
+     * \param duration stage latency
+     */
+    void Record(PipelineStage stage, std::chrono::nanoseconds duration);
+
+    void AddReadBlock() { ++read_block_count_; }
+    void AddComputedBlock() { ++computed_block_count_; }
+    void AddWrittenBlock(std::size_t byte_count) {
+        ++written_block_count_;
+        written_byte_count_ += byte_count;
+    }
+
+    /**
+     * \brief Update the occupancy of the pipeline queues
+     * \param input_blocks blocks submitted and not computed yet
+     * \param output_blocks computed blocks not written yet
+     */
+    void UpdateOccupancy(int input_blocks, int output_blocks);
+
+    /**
+     * \brief Current metrics, without input and cache statistics which are
+     *   owned by the stream
+     */
+    PipelineMetricsSnapshot Snapshot() const;
+
+  private:
+    struct StageCounters {
+        std::atomic<std::uint64_t> count{0};
+        std::atomic<std::uint64_t> total_ns{0};
+        std::atomic<std::uint64_t> min_ns{0};
+        std::atomic<std::uint64_t> max_ns{0};
+        std::array<std::atomic<std::uint64_t>, StageMetrics::kBucketCount>
+              histogram;
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    Clock::time_point start_time_;
+    std::array<StageCounters, kPipelineStageCount> stages_;
+    std::atomic<std::uint64_t> read_block_count_{0};
+    std::atomic<std::uint64_t> computed_block_count_{0};
+    std::atomic<std::uint64_t> written_block_count_{0};
+    std::atomic<std::uint64_t> written_byte_count_{0};
+
+    mutable std::mutex occupancy_mutex_;
+    Clock::time_point last_occupancy_update_;
+    Clock::time_point last_occupancy_sample_;
+    int input_blocks_ = 0;
+    int output_blocks_ = 0;
+    OccupancyMetrics input_occupancy_;
+    OccupancyMetrics output_occupancy_;
+    // block count integrated over time (block.s)
+    double input_block_time_ = 0.;
+    double output_block_time_ = 0.;
+    std::vector<OccupancySample> occupancy_samples_;
+};
+
+/**
+ * \brief Attach the calling thread to metrics during the scope
+ */
+class PipelineMetricsScope {
+  public:
+    /**
+     * \param metrics metrics to attach, null detaches the thread
+     */
+    explicit PipelineMetricsScope(PipelineMetrics* metrics);
+    ~PipelineMetricsScope();
+
+    PipelineMetricsScope(const PipelineMetricsScope&) = delete;
+    PipelineMetricsScope& operator=(const PipelineMetricsScope&) = delete;
+    PipelineMetricsScope(PipelineMetricsScope&&) = delete;
+    PipelineMetricsScope& operator=(PipelineMetricsScope&&) = delete;
+
+  private:
+    PipelineMetrics* previous_metrics_;
+};
+
+/**
+ * \brief Time a stage until destruction or Stop
+ *
+ * The clock is only read if the calling thread is attached to metrics.
+ *   Pause and Resume exclude nested stages.
+ */
+class StageTimer {
+  public:
+    explicit StageTimer(PipelineStage stage)
+        : metrics_(PipelineMetrics::Current()), stage_(stage) {
+        if (metrics_ != nullptr) {
+            start_time_ = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~StageTimer() { Stop(); }
+
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+    StageTimer(StageTimer&&) = delete;
+    StageTimer& operator=(StageTimer&&) = delete;
+
+    void Pause() {
+        if (metrics_ != nullptr && !is_paused_) {
+            elapsed_ += std::chrono::steady_clock::now() - start_time_;
+            is_paused_ = true;
+        }
+    }
+
+    void Resume() {
+        if (metrics_ != nullptr && is_paused_) {
+            start_time_ = std::chrono::steady_clock::now();
+            is_paused_ = false;
+        }
+    }
+
+    /**
+     * \brief Record the stage latency, once
+     */
+    void Stop() {
+        if (metrics_ == nullptr) {
+            return;
+        }
+        Pause();
+        metrics_->Record(stage_, elapsed_);
+        metrics_ = nullptr;
+    }
+
+  private:
+    PipelineMetrics* metrics_;
+    PipelineStage stage_;
+    std::chrono::steady_clock::time_point start_time_;
+    std::chrono::nanoseconds elapsed_{0};
+    bool is_paused_ = false;
+};
+
+/**
+ * \brief Metrics of a run in JSON
+ * \param snapshot metrics
+ * \return JSON object
+ */
+std::string ToJson(const PipelineMetricsSnapshot& snapshot);
+
+/**
+ * \brief Metrics of a resampled image
+ */
+struct MetricsReportEntry {
+    std::string input_path;
+    std::string output_path;
+    PipelineMetricsSnapshot metrics;
+};
+
+/**
+ * \brief Write the JSON report of the resampled images
+ * \param report_path report path
+ * \param entries metrics of the images
+ * \throw sirius::Exception if the report cannot be written
+ */
+void WriteMetricsReport(const std::string& report_path,
+                        const std::vector<MetricsReportEntry>& entries);
+
+}  // namespace utils
+}  // namespace sirius
+
+#endif  // SIRIUS_UTILS_PIPELINE_METRICS_H_
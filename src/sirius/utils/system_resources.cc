@@ -0,0 +1,320 @@
+/**
+ * Copyright (C) 2018 CS - Systemes d'Information (CS-SI)
+ *
+ * This file is part of Sirius
+ *
+ *     https://github.com/CS-SI/SIRIUS
+ *
+ * Sirius is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sirius is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Sirius.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "sirius/utils/system_resources.h"
+
+#include <cmath>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "sirius/utils/log.h"
+
+namespace sirius {
+namespace utils {
+
+namespace {
+
+// cgroup v1 reports huge values (close to 2^63) when memory is unlimited
+constexpr std::size_t kUnlimitedMemoryThreshold = std::size_t(1) << 60;
+
+std::string JoinPath(const std::string& lhs, const std::string& rhs) {
+    std::string path = lhs;
+    while (!path.empty() && path.back() == '/') {
+        path.pop_back();
+    }
+    std::size_t rhs_begin = 0;
+    while (rhs_begin < rhs.size() && rhs[rhs_begin] == '/') {
+        ++rhs_begin;
+    }
+    if (rhs_begin == rhs.size()) {
+        return path.empty() ? "/" : path;
+    }
+    return path + "/" + rhs.substr(rhs_begin);
+}
+
+std::string ParentPath(const std::string& path) {
+    auto pos = path.find_last_of('/');
+    if (pos == std::string::npos || pos == 0) {
+        return "/";
+    }
+    return path.substr(0, pos);
+}
+
+bool ReadFirstLine(const std::string& path, std::string& line) {
+    std::ifstream file(path);
+    if (!file || !std::getline(file, line)) {
+        return false;
+    }
+    return true;
+}
+
+bool ParseSize(const std::string& value_string, std::size_t& value) {
+    try {
+        std::size_t pos = 0;
+        long long parsed_value = std::stoll(value_string, &pos);
+        if (parsed_value < 0) {
+            return false;
+        }
+        value = static_cast<std::size_t>(parsed_value);
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+// cgroup of the process for a v1 controller or for v2 (empty controller)
+std::string ReadProcessCgroup(const std::string& root_path,
+                              const std::string& controller) {
+    std::ifstream file(JoinPath(root_path, "proc/self/cgroup"));
+    std::string line;
+    while (std::getline(file, line)) {
+        // format is hierarchy-ID:controller-list:cgroup-path
+        auto first_colon = line.find(':');
+        auto second_colon = line.find(':', first_colon + 1);
+        if (first_colon == std::string::npos ||
+            second_colon == std::string::npos) {
+            continue;
+        }
+        std::string controllers =
+              line.substr(first_colon + 1, second_colon - first_colon - 1);
+        std::string cgroup_path = line.substr(second_colon + 1);
+        if (controller.empty()) {
+            if (controllers.empty()) {
+                return cgroup_path;
+            }
+            continue;
+        }
+        std::stringstream controller_stream(controllers);
+        std::string name;
+        while (std::getline(controller_stream, name, ',')) {
+            if (name == controller) {
+                return cgroup_path;
+            }
+        }
+    }
+    return "/";
+}
+
+// cgroup v1 file of the process, falls back on the root of the mounted
+//   hierarchy (containers only see their own cgroup)
+bool ReadCgroupV1File(const std::string& cgroup_root,
+                      const std::vector<std::string>& mount_names,
+                      const std::string& cgroup_path,
+                      const std::string& file_name, std::string& line) {
+    for (const auto& mount_name : mount_names) {
+        auto mount_path = JoinPath(cgroup_root, mount_name);
+        if (ReadFirstLine(
+                  JoinPath(JoinPath(mount_path, cgroup_path), file_name),
+                  line) ||
+            ReadFirstLine(JoinPath(mount_path, file_name), line)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void DetectCgroupV2Limits(const std::string& root_path,
+                          const std::string& cgroup_root,
+                          SystemResources& resources,
+                          unsigned int& cpuset_count) {
+    resources.cgroup_version = 2;
+    auto cgroup_path = ReadProcessCgroup(root_path, "");
+
+    // limits of the parent cgroups also apply
+    std::string relative_path = cgroup_path;
+    bool is_cpuset_found = false;
+    while (true) {
+        auto cgroup_dir = JoinPath(cgroup_root, relative_path);
+        std::string line;
+        if (ReadFirstLine(JoinPath(cgroup_dir, "cpu.max"), line)) {
+            std::stringstream cpu_max(line);
+            std::string quota_string;
+            std::string period_string;
+            cpu_max >> quota_string >> period_string;
+            std::size_t quota = 0;
+            std::size_t period = 0;
+            if (quota_string != "max" && ParseSize(quota_string, quota) &&
+                ParseSize(period_string, period) && period > 0) {
+                double cpu_quota = static_cast<double>(quota) / period;
+                if (resources.cpu_quota == 0. ||
+                    cpu_quota < resources.cpu_quota) {
+                    resources.cpu_quota = cpu_quota;
+                }
+            }
+        }
+        if (ReadFirstLine(JoinPath(cgroup_dir, "memory.max"), line)) {
+            std::size_t memory_limit = 0;
+            if (line != "max" && ParseSize(line, memory_limit) &&
+                (resources.memory_limit == 0 ||
+                 memory_limit < resources.memory_limit)) {
+                resources.memory_limit = memory_limit;
+            }
+        }
+        // effective cpuset of the deepest cgroup already accounts for its
+        //   parents
+        if (!is_cpuset_found &&
+            ReadFirstLine(JoinPath(cgroup_dir, "cpuset.cpus.effective"),
+                          line) &&
+            !line.empty()) {
+            cpuset_count = ParseCpuList(line);
+            is_cpuset_found = cpuset_count > 0;
+        }
+        if (relative_path.empty() || relative_path == "/") {
+            break;
+        }
+        relative_path = ParentPath(relative_path);
+    }
+}
+
+void DetectCgroupV1Limits(const std::string& root_path,
+                          const std::string& cgroup_root,
+                          SystemResources& resources,
+                          unsigned int& cpuset_count) {
+    std::string line;
+    auto cpu_cgroup = ReadProcessCgroup(root_path, "cpu");
+    std::vector<std::string> cpu_mounts = {"cpu", "cpu,cpuacct",
+                                           "cpuacct,cpu"};
+    std::string period_line;
+    if (ReadCgroupV1File(cgroup_root, cpu_mounts, cpu_cgroup,
+                         "cpu.cfs_quota_us", line) &&
+        ReadCgroupV1File(cgroup_root, cpu_mounts, cpu_cgroup,
+                         "cpu.cfs_period_us", period_line)) {
+        resources.cgroup_version = 1;
+        // quota is -1 if unlimited
+        std::size_t quota = 0;
+        std::size_t period = 0;
+        if (ParseSize(line, quota) && ParseSize(period_line, period) &&
+            quota > 0 && period > 0) {
+            resources.cpu_quota = static_cast<double>(quota) / period;
+        }
+    }
+
+    auto memory_cgroup = ReadProcessCgroup(root_path, "memory");
+    if (ReadCgroupV1File(cgroup_root, {"memory"}, memory_cgroup,
+                         "memory.limit_in_bytes", line)) {
+        resources.cgroup_version = 1;
+        std::size_t memory_limit = 0;
+        if (ParseSize(line, memory_limit) &&
+            memory_limit < kUnlimitedMemoryThreshold) {
+            resources.memory_limit = memory_limit;
+        }
+    }
+
+    auto cpuset_cgroup = ReadProcessCgroup(root_path, "cpuset");
+    if (ReadCgroupV1File(cgroup_root, {"cpuset"}, cpuset_cgroup,
+                         "cpuset.cpus", line)) {
+        resources.cgroup_version = 1;
+        cpuset_count = ParseCpuList(line);
+    }
+}
+
+}  // namespace
+
+unsigned int ParseCpuList(const std::string& cpu_list) {
+    unsigned int cpu_count = 0;
+    std::stringstream cpu_list_stream(cpu_list);
+    std::string range;
+    while (std::getline(cpu_list_stream, range, ',')) {
+        if (range.empty()) {
+            continue;
+        }
+        try {
+            auto dash = range.find('-');
+            int first = std::stoi(range);
+            int last = first;
+            if (dash != std::string::npos) {
+                last = std::stoi(range.substr(dash + 1));
+            }
+            if (first < 0 || last < first) {
+                return 0;
+            }
+            cpu_count += static_cast<unsigned int>(last - first + 1);
+        } catch (const std::exception&) {
+            return 0;
+        }
+    }
+    return cpu_count;
+}
+
+SystemResources DetectSystemResources(const std::string& root_path) {
+    SystemResources resources;
+
+    std::string line;
+    unsigned int host_cpu_count = 0;
+    if (ReadFirstLine(JoinPath(root_path, "sys/devices/system/cpu/online"),
+                      line)) {
+        host_cpu_count = ParseCpuList(line);
+    }
+    if (host_cpu_count == 0) {
+        host_cpu_count = std::thread::hardware_concurrency();
+    }
+    resources.host_cpu_count = std::max(host_cpu_count, 1u);
+
+    std::ifstream meminfo(JoinPath(root_path, "proc/meminfo"));
+    while (std::getline(meminfo, line)) {
+        std::stringstream meminfo_line(line);
+        std::string key;
+        std::size_t value_kb = 0;
+        if (meminfo_line >> key >> value_kb && key == "MemTotal:") {
+            resources.physical_memory = value_kb * 1024;
+            break;
+        }
+    }
+
+    unsigned int cpuset_count = 0;
+    auto cgroup_root = JoinPath(root_path, "sys/fs/cgroup");
+    if (std::ifstream(JoinPath(cgroup_root, "cgroup.controllers"))) {
+        DetectCgroupV2Limits(root_path, cgroup_root, resources, cpuset_count);
+    } else {
+        DetectCgroupV1Limits(root_path, cgroup_root, resources, cpuset_count);
+    }
+
+    resources.cpu_count = resources.host_cpu_count;
+    if (cpuset_count > 0) {
+        resources.cpu_count = std::min(resources.cpu_count, cpuset_count);
+    }
+    if (resources.cpu_quota > 0.) {
+        auto quota_cpu_count = static_cast<unsigned int>(
+              std::max(std::ceil(resources.cpu_quota), 1.));
+        resources.cpu_count = std::min(resources.cpu_count, quota_cpu_count);
+    }
+    if (resources.physical_memory > 0 &&
+        resources.memory_limit >= resources.physical_memory) {
+        // limit above the host memory is not a limit
+        resources.memory_limit = 0;
+    }
+
+    LOG("system_resources", debug,
+        "host: {} CPUs, {} MB, cgroup v{}: CPU quota {}, cpuset {} CPUs, "
+        "memory limit {} MB",
+        resources.host_cpu_count, resources.physical_memory / (1024 * 1024),
+        resources.cgroup_version, resources.cpu_quota, cpuset_count,
+        resources.memory_limit / (1024 * 1024));
+    return resources;
+}
+
+}  // namespace utils
+}  // namespace sirius
@@ -0,0 +1,79 @@
+/**
+ * Copyright (C) 2018 CS - Systemes d'Information (CS-SI)
+ *
+ * This file is part of Sirius
+ *
+ *     https://github.com/CS-SI/SIRIUS
+ *
+ * Sirius is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sirius is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Sirius.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef SIRIUS_UTILS_SYSTEM_RESOURCES_H_
+#define SIRIUS_UTILS_SYSTEM_RESOURCES_H_
+
+#include <cstddef>
+#include <string>
+
+namespace sirius {
+namespace utils {
+
+/**
+ * \brief CPU and memory resources available to the process
+ */
+struct SystemResources {
+    /// CPUs usable by the process (host CPUs limited by the cgroup CPU quota
+    ///   and cpuset)
+    unsigned int cpu_count = 1;
+    /// online CPUs of the host
+    unsigned int host_cpu_count = 1;
+    /// cgroup CPU quota in CPUs (0 if unlimited)
+    double cpu_quota = 0.;
+    /// physical memory of the host in bytes (0 if unknown)
+    std::size_t physical_memory = 0;
+    /// cgroup memory limit in bytes (0 if unlimited)
+    std::size_t memory_limit = 0;
+    /// cgroup version (0 if no cgroup hierarchy was found)
+    int cgroup_version = 0;
+};
+
+/**
+ * \brief Detect CPU and memory resources available to the process
+ *
+ * Host resources are read from /sys/devices/system/cpu/online and
+ *   /proc/meminfo. In containers, the CPU quota (cpu.max or
+ *   cpu.cfs_quota_us/cpu.cfs_period_us), the cpuset and the memory limit
+ *   (memory.max or memory.limit_in_bytes) are read from the cgroup v2 or v1
+ *   hierarchy mounted in /sys/fs/cgroup. The cgroup of the process is read
+ *   from /proc/self/cgroup. Limits of the parent cgroups are also applied for
+ *   cgroup v2.
+ *
+ * Missing or unreadable files are ignored.
+ *
+ * \param root_path path prepended to the system files (for tests)
+ * \return detected resources
+ */
+SystemResources DetectSystemResources(const std::string& root_path = "/");
+
+/**
+ * \brief Parse a Linux CPU list (ex: 0-3,8,10-11)
+ * \param cpu_list CPU list
+ * \return number of CPUs in the list, 0 if the list is invalid
+ */
+unsigned int ParseCpuList(const std::string& cpu_list);
+
+}  // namespace utils
+}  // namespace sirius
+
+#endif  // SIRIUS_UTILS_SYSTEM_RESOURCES_H_
@@ -0,0 +1,173 @@
+/**
+ * Copyright (C) 2018 CS - Systemes d'Information (CS-SI)
+ *
+ * This file is part of Sirius
+ *
+ *     https://github.com/CS-SI/SIRIUS
+ *
+ * Sirius is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sirius is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Sirius.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "sirius/utils/thread_pool.h"
+
+#include <algorithm>
+
+#include "sirius/utils/log.h"
+#include "sirius/utils/system_resources.h"
+
+namespace sirius {
+namespace utils {
+
+namespace {
+
+// pool and queue index of the worker running in the current thread
+thread_local ThreadPool* tls_pool = nullptr;
+thread_local unsigned int tls_worker_index = 0;
+
+// worker count of the shared pool, 0 means detected CPU count
+std::atomic<unsigned int> default_thread_count{0};
+
+unsigned int GetDefaultThreadCount() {
+    unsigned int thread_count = default_thread_count;
+    if (thread_count == 0) {
+        thread_count = DetectSystemResources().cpu_count;
+    }
+    return thread_count;
+}
+
+}  // namespace
+
+ThreadPool& ThreadPool::Instance() {
+    static ThreadPool instance(GetDefaultThreadCount());
+    return instance;
+}
+
+void ThreadPool::SetDefaultThreadCount(unsigned int thread_count) {
+    default_thread_count = thread_count;
+}
+
+ThreadPool::ThreadPool(unsigned int thread_count) {
+    thread_count = std::max(thread_count, 1u);
+    for (unsigned int i = 0; i < thread_count; ++i) {
+        queues_.emplace_back(new TaskQueue());
+    }
+    for (unsigned int i = 0; i < thread_count; ++i) {
+        threads_.emplace_back([this, i]() { RunWorker(i); });
+    }
+    LOG("thread_pool", debug, "thread pool started with {} workers",
+        thread_count);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        is_stopped_ = true;
+    }
+    wake_cond_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+bool ThreadPool::RunPendingTask() {
+    Task task;
+    if (!PopTask(task)) {
+        return false;
+    }
+    task();
+    return true;
+}
+
+void ThreadPool::Schedule(Task&& task) {
+    unsigned int queue_index;
+    if (tls_pool == this) {
+        // keep tasks spawned by a worker local to this worker
+        queue_index = tls_worker_index;
+    } else {
+        queue_index = next_queue_++ % queues_.size();
+    }
+
+    {
+        // counter is updated under lock so that no wake up can be missed.
+        //   It is updated before the task is published so that a popped
+        //   task is always counted and the counter never goes below 0.
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        ++pending_task_count_;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queues_[queue_index]->mutex);
+        queues_[queue_index]->tasks.emplace_back(std::move(task));
+    }
+    wake_cond_.notify_one();
+}
+
+bool ThreadPool::PopTask(Task& task) {
+    if (pending_task_count_ == 0) {
+        return false;
+    }
+
+    std::size_t queue_count = queues_.size();
+    unsigned int first_queue = (tls_pool == this) ? tls_worker_index : 0;
+
+    // own queue: most recent task first
+    if (tls_pool == this) {
+        auto& own_queue = *queues_[first_queue];
+        std::lock_guard<std::mutex> lock(own_queue.mutex);
+        if (!own_queue.tasks.empty()) {
+            task = std::move(own_queue.tasks.back());
+            own_queue.tasks.pop_back();
+            --pending_task_count_;
+            return true;
+        }
+    }
+
+    // steal the oldest task of another queue
+    for (std::size_t i = 0; i < queue_count; ++i) {
+        auto& queue = *queues_[(first_queue + i) % queue_count];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            --pending_task_count_;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::RunWorker(unsigned int worker_index) {
+    tls_pool = this;
+    tls_worker_index = worker_index;
+
+    while (true) {
+        Task task;
+        if (PopTask(task)) {
+            task();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        wake_cond_.wait(lock, [this]() {
+            return is_stopped_ || pending_task_count_ > 0;
+        });
+        if (is_stopped_ && pending_task_count_ == 0) {
+            break;
+        }
+    }
+}
+
+}  // namespace utils
+}  // namespace sirius
@@ -0,0 +1,163 @@
+/**
+ * Copyright (C) 2018 CS - Systemes d'Information (CS-SI)
+ *
+ * This file is part of Sirius
+ *
+ *     https://github.com/CS-SI/SIRIUS
+ *
+ * Sirius is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sirius is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Sirius.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SIRIUS_UTILS_THREAD_POOL_H_
+#define SIRIUS_UTILS_THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace sirius {
+namespace utils {
+
+/**
+ * \brief Work stealing thread pool
+ *
+ * Each worker owns a task queue. Workers run their own tasks in LIFO order
+ *   and steal tasks from the front of the other queues when they are idle.
+ *   Tasks submitted from a worker are pushed into its own queue, other tasks
+ *   are dispatched in a round robin way.
+ *
+ * The library owns a shared instance (see Instance()) so that threads are
+ *   created once and reused by all the resampling stages.
+ */
+class ThreadPool {
+  public:
+    /**
+     * \brief Get the shared thread pool of the library
+     *
+     * The shared pool has one worker per CPU available to the process (see
+     *   DetectSystemResources) unless SetDefaultThreadCount was called before
+     *   its first use
+     *
+     * \return ThreadPool instance
+     */
+    static ThreadPool& Instance();
+
+    /**
+     * \brief Set the number of workers of the shared pool
+     *
+     * \param thread_count number of workers, 0 to use the CPU count
+     *
+     * \warning Only effective before the first call to Instance()
+     */
+    static void SetDefaultThreadCount(unsigned int thread_count);
+
+    /**
+     * \brief Instanciate a thread pool and start its workers
+     * \param thread_count number of workers (at least 1)
+     */
+    explicit ThreadPool(unsigned int thread_count);
+
+    /**
+     * \brief Run pending tasks and join workers
+     */
+    ~ThreadPool();
+
+    // not copyable
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    // not moveable
+    ThreadPool(ThreadPool&&) = delete;
+    ThreadPool& operator=(ThreadPool&&) = delete;
+
+    /**
+     * \brief Schedule a task
+     *
+     * \param function callable to run
+     * \return future of the function result, exceptions thrown by the
+     *         function are forwarded to the future
+     */
+    template <typename Function>
+    std::future<std::result_of_t<std::decay_t<Function>()>> Submit(
+          Function&& function);
+
+    /**
+     * \brief Run one pending task in the calling thread
+     *
+     * Useful to make progress instead of blocking while waiting for tasks
+     *   submitted to this pool.
+     *
+     * \return true if a task was run
+     */
+    bool RunPendingTask();
+
+    /**
+     * \brief Wait for a future while running pending tasks
+     *
+     * Prevents deadlocks when a task waits for tasks scheduled on the same
+     *   pool
+     *
+     * \param future future to wait for
+     */
+    template <typename T>
+    void Wait(const std::future<T>& future);
+
+    /**
+     * \brief Number of workers
+     * \return number of workers
+     */
+    unsigned int ThreadCount() const {
+        return static_cast<unsigned int>(threads_.size());
+    }
+
+  private:
+    using Task = std::function<void()>;
+
+    /**
+     * \brief Task queue of a worker
+     */
+    struct TaskQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void Schedule(Task&& task);
+
+    bool PopTask(Task& task);
+
+    void RunWorker(unsigned int worker_index);
+
+  private:
+    std::vector<std::unique_ptr<TaskQueue>> queues_;
+    std::vector<std::thread> threads_;
+    std::atomic<unsigned int> next_queue_{0};
+    // tasks counted before they are published in a queue
+    std::atomic<std::size_t> pending_task_count_{0};
+    std::mutex wake_mutex_;
+    std::condition_variable wake_cond_;
+    bool is_stopped_{false};
+};
+
+}  // namespace utils
+}  // namespace sirius
+
+#include "sirius/utils/thread_pool.txx"
+
+#endif  // SIRIUS_UTILS_THREAD_POOL_H_
@@ -0,0 +1,56 @@
+/**
+ * Copyright (C) 2018 CS - Systemes d'Information (CS-SI)
+ *
+ * This file is part of Sirius
+ *
+ *     https://github.com/CS-SI/SIRIUS
+ *
+ * Sirius is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sirius is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Sirius.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SIRIUS_UTILS_THREAD_POOL_TXX_
+#define SIRIUS_UTILS_THREAD_POOL_TXX_
+
+#include <chrono>
+
+namespace sirius {
+namespace utils {
+
+template <typename Function>
+std::future<std::result_of_t<std::decay_t<Function>()>> ThreadPool::Submit(
+      Function&& function) {
+    using Result = std::result_of_t<std::decay_t<Function>()>;
+
+    // std::function requires a copyable callable
+    auto task = std::make_shared<std::packaged_task<Result()>>(
+          std::forward<Function>(function));
+    auto future = task->get_future();
+    Schedule([task]() { (*task)(); });
+    return future;
+}
+
+template <typename T>
+void ThreadPool::Wait(const std::future<T>& future) {
+    while (future.wait_for(std::chrono::seconds(0)) !=
+           std::future_status::ready) {
+        if (!RunPendingTask()) {
+            future.wait_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+}  // namespace utils
+}  // namespace sirius
+
+#endif  // SIRIUS_UTILS_THREAD_POOL_TXX_
@@ -0,0 +1,158 @@
+/**
+ * Copyright (C) 2018 CS - Systemes d'Information (CS-SI)
+ *
+ * This file is part of Sirius
+ *
+ *     https://github.com/CS-SI/SIRIUS
+ *
+ * Sirius is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sirius is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Sirius.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "sirius/utils/trace.h"
+
+#ifdef SIRIUS_ENABLE_TRACING
+
+#include <cstdio>
+
+#include <fstream>
+
+#include "sirius/exception.h"
+
+#include "sirius/utils/log.h"
+
+namespace sirius {
+namespace utils {
+
+namespace {
+
+struct ThreadTraceState {
+    void* events = nullptr;
+    int session = -1;
+    int block_index = -1;
+};
+
+thread_local ThreadTraceState thread_trace_state;
+
+}  // namespace
+
+constexpr std::size_t TraceRecorder::kDefaultMaxEventCount;
+
+TraceRecorder& TraceRecorder::Instance() {
+    static TraceRecorder recorder;
+    return recorder;
+}
+
+void TraceRecorder::Start(std::size_t max_event_count) {
+    std::lock_guard<std::mutex> lock(threads_mutex_);
+    threads_.clear();
+    ++session_;
+    max_event_count_ = max_event_count;
+    start_time_ = std::chrono::steady_clock::now();
+    is_recording_ = true;
+    LOG("trace", info, "block processing trace started");
+}
+
+void TraceRecorder::SetCurrentBlock(int block_index) {
+    thread_trace_state.block_index = block_index;
+}
+
+int TraceRecorder::CurrentBlock() { return thread_trace_state.block_index; }
+
+TraceRecorder::ThreadEvents* TraceRecorder::GetThreadEvents() {
+    auto& state = thread_trace_state;
+    if (state.session == session_.load(std::memory_order_relaxed)) {
+        return static_cast<ThreadEvents*>(state.events);
+    }
+    std::lock_guard<std::mutex> lock(threads_mutex_);
+    threads_.push_back(std::make_unique<ThreadEvents>());
+    auto* thread_events = threads_.back().get();
+    thread_events->thread_id = static_cast<int>(threads_.size());
+    state.events = thread_events;
+    state.session = session_;
+    return thread_events;
+}
+
+void TraceRecorder::Append(char phase, const char* category,
+                           const char* name, std::int64_t id) {
+    auto time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         std::chrono::steady_clock::now() - start_time_)
+                         .count();
+    auto* thread_events = GetThreadEvents();
+    std::lock_guard<std::mutex> lock(thread_events->mutex);
+    if (thread_events->events.size() >= max_event_count_) {
+        ++thread_events->dropped_event_count;
+        return;
+    }
+    thread_events->events.push_back({category, name, phase,
+                                     thread_trace_state.block_index, id,
+                                     static_cast<std::int64_t>(time_ns)});
+}
+
+void TraceRecorder::Write(const std::string& path) {
+    std::ofstream trace(path, std::ios::binary | std::ios::trunc);
+    if (!trace) {
+        throw sirius::Exception("cannot create trace '" + path + "'");
+    }
+
+    char time_us[32];
+    std::size_t event_count = 0;
+    std::size_t dropped_event_count = 0;
+    trace << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    std::lock_guard<std::mutex> lock(threads_mutex_);
+    bool is_first = true;
+    for (const auto& thread_events : threads_) {
+        std::lock_guard<std::mutex> events_lock(thread_events->mutex);
+        int tid = thread_events->thread_id;
+        trace << (is_first ? "" : ",\n")
+              << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+                 "\"tid\": "
+              << tid << ", \"args\": {\"name\": \"thread " << tid << "\"}}";
+        is_first = false;
+        for (const auto& event : thread_events->events) {
+            std::snprintf(time_us, sizeof(time_us), "%.3f",
+                          event.time_ns / 1000.);
+            trace << ",\n{\"name\": \"" << event.name << "\", \"cat\": \""
+                  << event.category << "\", \"ph\": \"" << event.phase
+                  << "\", \"ts\": " << time_us << ", \"pid\": 1, \"tid\": "
+                  << tid;
+            if (event.phase == 'b' || event.phase == 'e') {
+                trace << ", \"id\": " << event.id;
+            }
+            if (event.block_index >= 0) {
+                trace << ", \"args\": {\"block\": " << event.block_index
+                      << "}";
+            }
+            trace << "}";
+        }
+        event_count += thread_events->events.size();
+        dropped_event_count += thread_events->dropped_event_count;
+    }
+    trace << "\n]}\n";
+    trace.flush();
+    if (!trace) {
+        throw sirius::Exception("cannot write trace '" + path + "'");
+    }
+    if (dropped_event_count > 0) {
+        LOG("trace", warn,
+            "{} events dropped: more than {} events recorded by a thread",
+            dropped_event_count, max_event_count_);
+    }
+    LOG("trace", info, "{} trace events of {} threads written in '{}'",
+        event_count, threads_.size(), path);
+}
+
+}  // namespace utils
+}  // namespace sirius
+
+#endif  // SIRIUS_ENABLE_TRACING
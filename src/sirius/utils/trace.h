@@ -0,0 +1,229 @@
+/**
+ * Copyright (C) 2018 CS - Systemes d'Information (CS-SI)
+ *
+ * This file is part of Sirius
+ *
+ *     https://github.com/CS-SI/SIRIUS
+ *
+ * Sirius is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sirius is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Sirius.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SIRIUS_UTILS_TRACE_H_
+#define SIRIUS_UTILS_TRACE_H_
+
+#ifdef SIRIUS_ENABLE_TRACING
+
+#include <cstddef>
+#include <cstdint>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace sirius {
+namespace utils {
+
+/**
+ * \brief Recorder of block processing events in the Chrome trace event
+ *   format
+ *
+ * Events are appended to a buffer owned by the recording thread and tagged
+ *   with the block the thread is processing. Categories are log channels
+ *   and names are stage names: both must be string literals.
+ *
+ * Start and Write must not be called while blocks are processed.
+ */
+class TraceRecorder {
+  public:
+    /// events kept per thread, next events are dropped
+    static constexpr std::size_t kDefaultMaxEventCount = 1 << 20;
+
+    static TraceRecorder& Instance();
+
+    /**
+     * \brief Clear the recorded events and start recording
+     * \param max_event_count events kept per thread
+     */
+    void Start(std::size_t max_event_count = kDefaultMaxEventCount);
+
+    /**
+     * \brief Stop recording, recorded events are kept
+     */
+    void Stop() { is_recording_ = false; }
+
+    bool IsRecording() const {
+        return is_recording_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * \brief Record an event if recording
+     * \param phase Chrome trace phase: 'B' begin, 'E' end, 'b' async begin,
+     *        'e' async end
+     * \param category log channel
+     * \param name stage name
+     * \param id id of an async event
+     */
+    void Record(char phase, const char* category, const char* name,
+                std::int64_t id = 0) {
+        if (IsRecording()) {
+            Append(phase, category, name, id);
+        }
+    }
+
+    /**
+     * \brief Set the block processed by the calling thread
+     * \param block_index block index, -1 if none
+     */
+    static void SetCurrentBlock(int block_index);
+
+    /**
+     * \brief Block processed by the calling thread
+     */
+    static int CurrentBlock();
+
+    /**
+     * \brief Write the recorded events in a Chrome trace JSON file
+     * \param path trace path
+     * \throw sirius::Exception if the trace cannot be written
+     */
+    void Write(const std::string& path);
+
+  private:
+    struct Event {
+        const char* category;
+        const char* name;
+        char phase;
+        int block_index;
+        std::int64_t id;
+        std::int64_t time_ns;
+    };
+
+    struct ThreadEvents {
+        int thread_id = 0;
+        // only locked by the recording thread, and by Write
+        std::mutex mutex;
+        std::vector<Event> events;
+        std::size_t dropped_event_count = 0;
+    };
+
+    TraceRecorder() = default;
+
+    // not copyable
+    TraceRecorder(const TraceRecorder&) = delete;
+    TraceRecorder& operator=(const TraceRecorder&) = delete;
+    // not moveable
+    TraceRecorder(TraceRecorder&&) = delete;
+    TraceRecorder& operator=(TraceRecorder&&) = delete;
+
+    void Append(char phase, const char* category, const char* name,
+                std::int64_t id);
+
+    /**
+     * \brief Buffer of the calling thread, registered on first use
+     */
+    ThreadEvents* GetThreadEvents();
+
+  private:
+    std::atomic<bool> is_recording_{false};
+    // a new session invalidates the buffers cached by the threads
+    std::atomic<int> session_{0};
+    std::chrono::steady_clock::time_point start_time_;
+    std::size_t max_event_count_ = kDefaultMaxEventCount;
+
+    std::mutex threads_mutex_;
+    std::vector<std::unique_ptr<ThreadEvents>> threads_;
+};
+
+/**
+ * \brief Begin and end events of a scope
+ */
+class TraceScope {
+  public:
+    TraceScope(const char* category, const char* name)
+        : category_(category), name_(name) {
+        TraceRecorder::Instance().Record('B', category_, name_);
+    }
+
+    ~TraceScope() { TraceRecorder::Instance().Record('E', category_, name_); }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+    TraceScope(TraceScope&&) = delete;
+    TraceScope& operator=(TraceScope&&) = delete;
+
+  private:
+    const char* category_;
+    const char* name_;
+};
+
+/**
+ * \brief Restore the block of the calling thread at the end of the scope
+ *
+ * Tasks run by a thread waiting for other tasks do not change the block of
+ *   the waiting task
+ */
+class TraceBlockScope {
+  public:
+    TraceBlockScope() : previous_block_(TraceRecorder::CurrentBlock()) {}
+
+    ~TraceBlockScope() { TraceRecorder::SetCurrentBlock(previous_block_); }
+
+    TraceBlockScope(const TraceBlockScope&) = delete;
+    TraceBlockScope& operator=(const TraceBlockScope&) = delete;
+    TraceBlockScope(TraceBlockScope&&) = delete;
+    TraceBlockScope& operator=(TraceBlockScope&&) = delete;
+
+  private:
+    int previous_block_;
+};
+
+}  // namespace utils
+}  // namespace sirius
+
+#define SIRIUS_TRACE_CONCAT_IMPL(a, b) a##b
+#define SIRIUS_TRACE_CONCAT(a, b) SIRIUS_TRACE_CONCAT_IMPL(a, b)
+
+#define TRACE_BEGIN(channel, name) \
+    sirius::utils::TraceRecorder::Instance().Record('B', channel, name)
+#define TRACE_END(channel, name) \
+    sirius::utils::TraceRecorder::Instance().Record('E', channel, name)
+#define TRACE_SCOPE(channel, name)                                     \
+    sirius::utils::TraceScope SIRIUS_TRACE_CONCAT(trace_scope_, __LINE__)( \
+          channel, name)
+#define TRACE_ASYNC_BEGIN(channel, name, id) \
+    sirius::utils::TraceRecorder::Instance().Record('b', channel, name, id)
+#define TRACE_ASYNC_END(channel, name, id) \
+    sirius::utils::TraceRecorder::Instance().Record('e', channel, name, id)
+#define TRACE_BLOCK_SCOPE()        \
+    sirius::utils::TraceBlockScope \
+          SIRIUS_TRACE_CONCAT(trace_block_scope_, __LINE__)
+#define TRACE_SET_BLOCK(block_index) \
+    sirius::utils::TraceRecorder::SetCurrentBlock(block_index)
+
+#else
+
+#define TRACE_BEGIN(channel, name)
+#define TRACE_END(channel, name)
+#define TRACE_SCOPE(channel, name)
+#define TRACE_ASYNC_BEGIN(channel, name, id)
+#define TRACE_ASYNC_END(channel, name, id)
+#define TRACE_BLOCK_SCOPE()
+#define TRACE_SET_BLOCK(block_index)
+
+#endif  // SIRIUS_ENABLE_TRACING
+
+#endif  // SIRIUS_UTILS_TRACE_H_
@@ -0,0 +1,188 @@
+/**
+ * Copyright (C) 2018 CS - Systemes d'Information (CS-SI)
+ *
+ * This file is part of Sirius
+ *
+ *     https://github.com/CS-SI/SIRIUS
+ *
+ * Sirius is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sirius is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Sirius.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <catch/catch.hpp>
+
+#include <algorithm>
+#include <vector>
+
+#include "sirius/gdal/block_grid.h"
+
+namespace {
+
+struct BlockPosition {
+    int row;
+    int col;
+};
+
+// block positions generated by the former sequential InputStream iteration
+std::vector<BlockPosition> ComputeSequentialPositions(
+      const sirius::Size& image, const sirius::Size& block,
+      const sirius::Size& margin) {
+    std::vector<BlockPosition> positions;
+    int row_idx = 0;
+    int col_idx = 0;
+    bool is_ended = false;
+    while (!is_ended) {
+        positions.push_back({row_idx, col_idx});
+        bool is_last_row = row_idx + block.row + margin.row >= image.row;
+        bool is_last_col = col_idx >= image.col - block.col - margin.col;
+        is_ended = is_last_row && is_last_col;
+        if (is_last_col) {
+            col_idx = 0;
+            row_idx += (row_idx == 0) ? block.row - margin.row : block.row;
+        } else {
+            col_idx += (col_idx == 0) ? block.col - margin.col : block.col;
+        }
+    }
+    return positions;
+}
+
+}  // namespace
+
+TEST_CASE("block grid - geometry", "[sirius]") {
+    struct Config {
+        sirius::Size image;
+        sirius::Size block;
+        sirius::Size margin;
+    };
+    std::vector<Config> configs = {
+          {{150, 130}, {40, 40}, {0, 0}},   {{150, 130}, {40, 40}, {5, 5}},
+          {{150, 130}, {40, 48}, {10, 12}}, {{100, 90}, {30, 24}, {7, 3}},
+          {{128, 128}, {64, 64}, {0, 0}},   {{129, 127}, {32, 32}, {4, 4}},
+          {{50, 60}, {50, 60}, {0, 0}},     {{61, 70}, {21, 22}, {20, 20}}};
+
+    for (const auto& config : configs) {
+        for (bool pad_edge_blocks : {false, true}) {
+            sirius::gdal::BlockGrid grid(config.image, config.block,
+                                         config.margin,
+                                         sirius::PaddingType::kMirrorPadding,
+                                         pad_edge_blocks);
+            auto positions = ComputeSequentialPositions(
+                  config.image, config.block, config.margin);
+            REQUIRE(grid.BlockCount() == static_cast<int>(positions.size()));
+
+            std::vector<int> coverage(config.image.CellCount(), 0);
+            for (int i = 0; i < grid.BlockCount(); ++i) {
+                std::error_code ec;
+                auto geometry = grid.GetBlockGeometry(i, ec);
+                REQUIRE(!ec);
+                REQUIRE(geometry.read_row_idx == positions[i].row);
+                REQUIRE(geometry.read_col_idx == positions[i].col);
+
+                // read region is inside the image
+                REQUIRE(geometry.read_row_idx + geometry.read_size.row <=
+                        config.image.row);
+                REQUIRE(geometry.read_col_idx + geometry.read_size.col <=
+                        config.image.col);
+
+                // useful area of the block (without margins)
+                int useful_row_end = std::min(
+                      geometry.row_idx + config.block.row, config.image.row);
+                int useful_col_end = std::min(
+                      geometry.col_idx + config.block.col, config.image.col);
+                for (int r = geometry.row_idx; r < useful_row_end; ++r) {
+                    for (int c = geometry.col_idx; c < useful_col_end; ++c) {
+                        ++coverage[r * config.image.col + c];
+                    }
+                }
+            }
+
+            // every image pixel is covered at least once
+            REQUIRE(std::all_of(coverage.begin(), coverage.end(),
+                                [](int count) { return count >= 1; }));
+        }
+    }
+}
+
+TEST_CASE("block grid - invalid", "[sirius]") {
+    REQUIRE_THROWS(sirius::gdal::BlockGrid({100, 100}, {0, 10}, {0, 0},
+                                           sirius::PaddingType::kZeroPadding));
+
+    sirius::gdal::BlockGrid grid({100, 100}, {60, 60}, {30, 30},
+                                 sirius::PaddingType::kZeroPadding);
+    std::error_code ec;
+    // padded block is bigger than the image
+    grid.GetBlockGeometry(0, ec);
+    REQUIRE(ec);
+
+    sirius::gdal::BlockGrid valid_grid({100, 100}, {30, 30}, {5, 5},
+                                       sirius::PaddingType::kZeroPadding);
+    valid_grid.GetBlockGeometry(valid_grid.BlockCount(), ec);
+    REQUIRE(ec);
+    valid_grid.GetBlockGeometry(-1, ec);
+    REQUIRE(ec);
+}
+
+TEST_CASE("block grid - block ranges", "[sirius]") {
+    // 4x4 blocks covering rows [0, 40), [40, 80), [80, 120), [120, 150)
+    sirius::gdal::BlockGrid grid({150, 130}, {40, 40}, {5, 5},
+                                 sirius::PaddingType::kMirrorPadding);
+    REQUIRE(grid.GridSize() == sirius::Size(4, 4));
+
+    // shards split block rows and cover the image without overlap
+    int next_row = 0;
+    for (int shard_index = 0; shard_index < 3; ++shard_index) {
+        auto range = grid.ComputeShardRange(shard_index, 3);
+        REQUIRE(range.col == 0);
+        REQUIRE(range.size.col == 4);
+        auto area = grid.ComputeRangeArea(range);
+        REQUIRE(area.row == next_row);
+        REQUIRE(area.col == 0);
+        REQUIRE(area.size.col == 130);
+        next_row = area.row + area.size.row;
+    }
+    REQUIRE(next_row == 150);
+    REQUIRE(grid.ComputeShardRange(2, 3).size.row == 2);
+    REQUIRE_THROWS(grid.ComputeShardRange(0, 5));
+    REQUIRE_THROWS(grid.ComputeShardRange(3, 3));
+    REQUIRE_THROWS(grid.ComputeShardRange(-1, 2));
+    REQUIRE_THROWS(grid.ComputeShardRange(0, 0));
+
+    sirius::gdal::ImageWindow window;
+    window.row = 45;
+    window.col = 0;
+    window.size = {30, 10};
+    auto range = grid.ComputeCoveringRange(window);
+    REQUIRE(range.row == 1);
+    REQUIRE(range.col == 0);
+    REQUIRE(range.size == sirius::Size(1, 1));
+
+    window.row = 70;
+    window.col = 75;
+    window.size = {80, 55};
+    range = grid.ComputeCoveringRange(window);
+    REQUIRE(range.row == 1);
+    REQUIRE(range.col == 1);
+    REQUIRE(range.size == sirius::Size(3, 3));
+    auto area = grid.ComputeRangeArea(range);
+    REQUIRE(area.row == 40);
+    REQUIRE(area.col == 40);
+    REQUIRE(area.size == sirius::Size(110, 90));
+
+    window.size = {81, 10};
+    REQUIRE_THROWS(grid.ComputeCoveringRange(window));
+
+    auto whole_area = grid.ComputeRangeArea({});
+    REQUIRE(whole_area.row == 0);
+    REQUIRE(whole_area.col == 0);
+    REQUIRE(whole_area.size == sirius::Size(150, 130));
+}
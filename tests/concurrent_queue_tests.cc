@@ -22,12 +22,15 @@
 #include <catch/catch.hpp>
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <future>
 #include <list>
 #include <mutex>
 #include <vector>
 
 #include "sirius/utils/concurrent_queue.h"
+#include "sirius/utils/lock_free_queue.h"
 #include "sirius/utils/log.h"
 
 TEST_CASE("concurrent queue - monothread push pop", "[sirius]") {
@@ -167,3 +170,245 @@ TEST_CASE("concurrent queue - multithreaded push pop", "[sirius]") {
     REQUIRE(result_values_t2.size() == 0);
     REQUIRE(result_values_t3.size() == 0);
 }
+
+TEST_CASE("lock free queue - monothread push pop", "[sirius]") {
+    sirius::utils::LockFreeQueue<int> queue(5);
+    std::error_code push_ec;
+    std::error_code pop_ec;
+
+    // capacity is rounded up to a power of two
+    REQUIRE(queue.Capacity() == 8);
+
+    std::vector<int> values = {1, 2, 3, 4, 5};
+    REQUIRE(queue.IsActive());
+
+    for (auto val : values) {
+        queue.Push(std::move(val), push_ec);
+        REQUIRE(!push_ec);
+    }
+    REQUIRE(queue.Size() == values.size());
+
+    queue.Deactivate();
+
+    REQUIRE(!queue.IsActive());
+    for (auto val : values) {
+        // single producer: elements are popped in order
+        REQUIRE(queue.Pop(pop_ec) == val);
+        REQUIRE(!pop_ec);
+    }
+    REQUIRE(queue.Empty());
+    queue.Push(0, push_ec);
+    REQUIRE(push_ec);
+    queue.Pop(pop_ec);
+    REQUIRE(pop_ec);
+}
+
+TEST_CASE("lock free queue - try push pop", "[sirius]") {
+    sirius::utils::LockFreeQueue<int> queue(4);
+
+    for (int i = 0; i < 4; ++i) {
+        REQUIRE(queue.TryPush(std::move(i)));
+    }
+    // full
+    REQUIRE(!queue.TryPush(4));
+
+    int val = -1;
+    REQUIRE(queue.TryPop(val));
+    REQUIRE(val == 0);
+    REQUIRE(queue.TryPush(4));
+
+    queue.DeactivateAndClear();
+    REQUIRE(queue.Empty());
+    REQUIRE(!queue.TryPop(val));
+    REQUIRE(!queue.CanPop());
+}
+
+TEST_CASE("lock free queue - batch push pop", "[sirius]") {
+    sirius::utils::LockFreeQueue<int> queue(8);
+    std::error_code push_ec;
+    std::error_code pop_ec;
+
+    queue.PushBatch({1, 2, 3, 4, 5}, push_ec);
+    REQUIRE(!push_ec);
+    REQUIRE(queue.Size() == 5);
+
+    auto values = queue.PopBatch(3, pop_ec);
+    REQUIRE(!pop_ec);
+    REQUIRE(values == std::vector<int>({1, 2, 3}));
+
+    values = queue.PopBatch(10, pop_ec);
+    REQUIRE(!pop_ec);
+    REQUIRE(values == std::vector<int>({4, 5}));
+
+    // batch larger than the queue capacity is pushed while popping
+    std::vector<int> batch(100);
+    for (int i = 0; i < 100; ++i) {
+        batch[i] = i;
+    }
+    auto push_future = std::async(std::launch::async, [&queue, &batch]() {
+        std::error_code ec;
+        queue.PushBatch(std::move(batch), ec);
+        queue.Deactivate();
+        return ec;
+    });
+
+    std::vector<int> result;
+    while (queue.CanPop()) {
+        auto popped_values = queue.PopBatch(7, pop_ec);
+        if (pop_ec) {
+            break;
+        }
+        REQUIRE(popped_values.size() <= 7);
+        result.insert(result.end(), popped_values.begin(),
+                      popped_values.end());
+    }
+    REQUIRE(!push_future.get());
+    REQUIRE(result.size() == 100);
+    for (int i = 0; i < 100; ++i) {
+        REQUIRE(result[i] == i);
+    }
+}
+
+TEST_CASE("lock free queue - deactivate wakes blocked threads", "[sirius]") {
+    sirius::utils::LockFreeQueue<int> queue(2);
+
+    auto pop_future = std::async(std::launch::async, [&queue]() {
+        std::error_code ec;
+        queue.Pop(ec);
+        return ec;
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    queue.Deactivate();
+    REQUIRE(pop_future.get());
+}
+
+TEST_CASE("lock free queue - multithreaded push pop", "[sirius]") {
+    sirius::utils::LockFreeQueue<int> queue(4);
+    static const int kValuesSize = 10000;
+    static const int kProducerCount = 3;
+    static const int kConsumerCount = 3;
+
+    auto push_task = [&queue](int producer_index) {
+        std::error_code push_ec;
+        for (int i = 0; i < kValuesSize; ++i) {
+            if (i % 2 == 0) {
+                queue.Push(producer_index * kValuesSize + i, push_ec);
+            } else {
+                queue.PushBatch({producer_index * kValuesSize + i}, push_ec);
+            }
+            if (push_ec) {
+                LOG("tests", error, "push ec");
+            }
+        }
+    };
+
+    std::vector<std::atomic<int>> pop_counts(kProducerCount * kValuesSize);
+    for (auto& pop_count : pop_counts) {
+        pop_count = 0;
+    }
+    auto pop_task = [&queue, &pop_counts](bool use_batch) {
+        while (queue.CanPop()) {
+            std::error_code pop_ec;
+            std::vector<int> values;
+            if (use_batch) {
+                values = queue.PopBatch(3, pop_ec);
+            } else {
+                values.push_back(queue.Pop(pop_ec));
+            }
+            if (pop_ec) {
+                return;
+            }
+            for (auto val : values) {
+                ++pop_counts[val];
+            }
+        }
+    };
+
+    std::vector<std::future<void>> push_futures;
+    std::vector<std::future<void>> pop_futures;
+    for (int i = 0; i < kConsumerCount; ++i) {
+        pop_futures.push_back(
+              std::async(std::launch::async, pop_task, i % 2 == 0));
+    }
+    for (int i = 0; i < kProducerCount; ++i) {
+        push_futures.push_back(std::async(std::launch::async, push_task, i));
+    }
+
+    for (auto& push_future : push_futures) {
+        push_future.get();
+    }
+    // if the queue remains active, pop operations will hang forever
+    queue.Deactivate();
+    for (auto& pop_future : pop_futures) {
+        pop_future.get();
+    }
+
+    // every value popped exactly once
+    REQUIRE(std::all_of(pop_counts.begin(), pop_counts.end(),
+                        [](const std::atomic<int>& c) { return c == 1; }));
+}
+
+namespace {
+
+template <typename Queue>
+double MeasureQueueThroughput(int producer_count, int consumer_count,
+                              int values_per_producer) {
+    Queue queue(8);
+
+    auto push_task = [&queue, values_per_producer]() {
+        std::error_code push_ec;
+        for (int i = 0; i < values_per_producer; ++i) {
+            queue.Push(std::move(i), push_ec);
+        }
+    };
+    auto pop_task = [&queue]() {
+        while (queue.CanPop()) {
+            std::error_code pop_ec;
+            queue.Pop(pop_ec);
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::future<void>> futures;
+    for (int i = 0; i < consumer_count; ++i) {
+        futures.push_back(std::async(std::launch::async, pop_task));
+    }
+    std::vector<std::future<void>> push_futures;
+    for (int i = 0; i < producer_count; ++i) {
+        push_futures.push_back(std::async(std::launch::async, push_task));
+    }
+    for (auto& future : push_futures) {
+        future.get();
+    }
+    queue.Deactivate();
+    for (auto& future : futures) {
+        future.get();
+    }
+    std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - start;
+
+    return producer_count * values_per_producer / elapsed.count();
+}
+
+}  // namespace
+
+// hidden benchmark, run with: concurrent_queue_tests "[benchmark]"
+TEST_CASE("concurrent queue - throughput benchmark", "[.][benchmark]") {
+    LOG_SET_LEVEL(info);
+    static const int kValuesPerProducer = 200000;
+
+    for (int thread_count : {1, 2, 4, 8}) {
+        double mutex_throughput =
+              MeasureQueueThroughput<sirius::utils::ConcurrentQueue<int>>(
+                    thread_count, thread_count, kValuesPerProducer);
+        double lock_free_throughput =
+              MeasureQueueThroughput<sirius::utils::LockFreeQueue<int>>(
+                    thread_count, thread_count, kValuesPerProducer);
+        LOG("tests", info,
+            "{} producers / {} consumers: ConcurrentQueue {:.3g} op/s, "
+            "LockFreeQueue {:.3g} op/s",
+            thread_count, thread_count, mutex_throughput,
+            lock_free_throughput);
+    }
+}
@@ -19,8 +19,12 @@
  * along with Sirius.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <cmath>
+
+#include <algorithm>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include <catch/catch.hpp>
 
@@ -29,6 +33,8 @@
 
 #include "sirius/frequency_resampler_factory.h"
 
+#include "sirius/resampler/output_window.h"
+
 #include "sirius/gdal/exception.h"
 #include "sirius/gdal/wrapper.h"
 
@@ -36,6 +42,137 @@
 
 #include "utils.h"
 
+namespace {
+
+// band limited periodic image: its zero padding zoom is exact
+double TrigonometricValue(double row, double col, const sirius::Size& size) {
+    return 10. + 3. * std::cos(2. * M_PI * (row + 0.5) / size.row) +
+           2. * std::cos(4. * M_PI * (col + 0.5) / size.col);
+}
+
+sirius::Image CreateTrigonometricImage(const sirius::Size& size) {
+    sirius::Image image(size);
+    for (int row = 0; row < size.row; ++row) {
+        for (int col = 0; col < size.col; ++col) {
+            image.Set(row, col, TrigonometricValue(row, col, size));
+        }
+    }
+    return image;
+}
+
+sirius::Size ComputeZoomedSize(const sirius::Size& size,
+                               const sirius::ZoomRatio& zoom_ratio) {
+    return {static_cast<int>(std::ceil(size.row * zoom_ratio.ratio())),
+            static_cast<int>(std::ceil(size.col * zoom_ratio.ratio()))};
+}
+
+const std::vector<sirius::ZoomRatio> kReferenceZoomRatios = {
+      sirius::ZoomRatio::Create(2, 1), sirius::ZoomRatio::Create(3, 1),
+      sirius::ZoomRatio::Create(4, 1), sirius::ZoomRatio::Create(5, 1),
+      sirius::ZoomRatio::Create(3, 2), sirius::ZoomRatio::Create(7, 4)};
+
+// zero padding zoom is the trigonometric interpolation of the image:
+//   output pixel (i, j) is the image sampled at (i, j) / zoom ratio
+void CheckZeroPaddingZoom(sirius::ImageDecompositionPolicies policy) {
+    auto freq_resampler = sirius::FrequencyResamplerFactory::Create(
+          policy, sirius::FrequencyZoomStrategies::kZeroPadding);
+
+    sirius::Size image_size(9, 10);
+    sirius::Image constant_image(image_size);
+    for (auto& value : constant_image.data) {
+        value = 42.5;
+    }
+    auto trigonometric_image = CreateTrigonometricImage(image_size);
+
+    for (const auto& zoom_ratio : kReferenceZoomRatios) {
+        INFO("zoom ratio " << zoom_ratio.input_resolution() << ":"
+                           << zoom_ratio.output_resolution());
+        auto output_size = ComputeZoomedSize(image_size, zoom_ratio);
+
+        auto output = freq_resampler->Compute(zoom_ratio, constant_image, {});
+        REQUIRE(output.size == output_size);
+        for (auto value : output.data) {
+            REQUIRE(value == Approx(42.5).margin(1e-9));
+        }
+
+        output = freq_resampler->Compute(zoom_ratio, trigonometric_image, {});
+        REQUIRE(output.size == output_size);
+        double step = 1. / zoom_ratio.ratio();
+        for (int row = 0; row < output_size.row; ++row) {
+            for (int col = 0; col < output_size.col; ++col) {
+                REQUIRE(output.Get(row, col) ==
+                        Approx(TrigonometricValue(row * step, col * step,
+                                                  image_size))
+                              .margin(1e-9));
+            }
+        }
+    }
+}
+
+// zoom interpolates the image: output pixels on the input grid are equal to
+//   the input pixels, whatever the image and the decomposition policy
+void CheckInterpolation(sirius::ImageDecompositionPolicies policy,
+                        sirius::FrequencyZoomStrategies strategy) {
+    auto freq_resampler =
+          sirius::FrequencyResamplerFactory::Create(policy, strategy);
+
+    // borders of the image do not match, odd sizes avoid Nyquist
+    //   coefficients which zero padding does not split
+    sirius::Image image({9, 11});
+    for (int row = 0; row < image.size.row; ++row) {
+        for (int col = 0; col < image.size.col; ++col) {
+            image.Set(row, col, row * 3. + col * 0.5 + row * col * 0.1);
+        }
+    }
+
+    for (const auto& zoom_ratio : kReferenceZoomRatios) {
+        INFO("zoom ratio " << zoom_ratio.input_resolution() << ":"
+                           << zoom_ratio.output_resolution());
+        auto output = freq_resampler->Compute(zoom_ratio, image, {});
+        REQUIRE(output.size == ComputeZoomedSize(image.size, zoom_ratio));
+
+        // input pixel (i, j) is output pixel (i, j) * zoom ratio when it is
+        //   not decimated
+        int input_step = zoom_ratio.output_resolution();
+        int output_step = zoom_ratio.input_resolution();
+        for (int row = 0; row < image.size.row; row += input_step) {
+            for (int col = 0; col < image.size.col; col += input_step) {
+                REQUIRE(output.Get(row / input_step * output_step,
+                                   col / input_step * output_step) ==
+                        Approx(image.Get(row, col)).margin(1e-9));
+            }
+        }
+    }
+}
+
+double ComputeMean(const sirius::Image& image) {
+    double sum = 0.;
+    for (auto value : image.data) {
+        sum += value;
+    }
+    return sum / image.CellCount();
+}
+
+// periodization is not an interpolation without filter: spectrum copies
+//   change the pixel values but the mean of the image is kept
+void CheckPeriodizationZoom(sirius::ImageDecompositionPolicies policy,
+                            const sirius::Image& image) {
+    auto freq_resampler = sirius::FrequencyResamplerFactory::Create(
+          policy, sirius::FrequencyZoomStrategies::kPeriodization);
+
+    // zoom 2, 3 and 4 have dedicated spectrum expansion kernels
+    for (int zoom = 2; zoom <= 5; ++zoom) {
+        INFO("zoom " << zoom);
+        auto zoom_ratio = sirius::ZoomRatio::Create(zoom, 1);
+        auto output = freq_resampler->Compute(zoom_ratio, image, {});
+        REQUIRE(output.size == image.size * zoom);
+        REQUIRE(ComputeMean(output) ==
+                Approx(ComputeMean(image)).margin(1e-9));
+    }
+}
+
+}  // namespace
+
 TEST_CASE("frequency resampler - factory", "[sirius]") {
     auto classic_zero_padding_resampler =
           sirius::FrequencyResamplerFactory::Create(
@@ -502,3 +639,200 @@ TEST_CASE("frequency resampler - example", "[sirius]") {
     sirius::Image zoomed_image_2_1 = freq_resampler->Compute(
           zoom_ratio_2_1, image, sinc_filter.padding(), sinc_filter);
 }
+
+TEST_CASE("frequency resampler - output window", "[sirius]") {
+    LOG_SET_LEVEL(trace);
+
+    SECTION("compute window") {
+        auto zoom_ratio = sirius::ZoomRatio::Create(3, 2);
+        sirius::Size filter_padding_size(2, 3);
+
+        // input padded for the filter on every side
+        auto window = sirius::resampler::ComputeOutputWindow(
+              zoom_ratio, {14, 13}, {}, filter_padding_size);
+        REQUIRE(window.row_offset == 6);
+        REQUIRE(window.col_offset == 9);
+        REQUIRE(window.stride == 2);
+        REQUIRE(window.size == sirius::Size(15, 11));
+
+        // image padding added by the resampler on every side
+        window = sirius::resampler::ComputeOutputWindow(
+              zoom_ratio, {10, 7}, {2, 2, 3, 3}, filter_padding_size);
+        REQUIRE(window.row_offset == 6);
+        REQUIRE(window.col_offset == 9);
+        REQUIRE(window.stride == 2);
+        REQUIRE(window.size == sirius::Size(15, 11));
+
+        // image padding only added at the top and on the left
+        window = sirius::resampler::ComputeOutputWindow(
+              zoom_ratio, {12, 10}, {2, 0, 3, 0}, filter_padding_size);
+        REQUIRE(window.size == sirius::Size(15, 11));
+    }
+
+    sirius::Image zoomed_image({6, 8});
+    for (int row = 0; row < zoomed_image.size.row; ++row) {
+        for (int col = 0; col < zoomed_image.size.col; ++col) {
+            zoomed_image.Set(row, col, row * 10. + col);
+        }
+    }
+
+    SECTION("extract window") {
+        sirius::resampler::OutputWindow window;
+        window.row_offset = 1;
+        window.col_offset = 1;
+        window.size = {3, 4};
+
+        auto output =
+              sirius::resampler::ExtractOutputWindow(zoomed_image, 2., window);
+        REQUIRE(output.size == window.size);
+        for (int row = 0; row < window.size.row; ++row) {
+            for (int col = 0; col < window.size.col; ++col) {
+                REQUIRE(output.Get(row, col) ==
+                        Approx(2. * zoomed_image.Get(1 + row, 1 + col)));
+            }
+        }
+    }
+
+    SECTION("extract decimated window") {
+        sirius::resampler::OutputWindow window;
+        window.row_offset = 1;
+        window.col_offset = 2;
+        window.size = {3, 3};
+        window.stride = 2;
+
+        auto output =
+              sirius::resampler::ExtractOutputWindow(zoomed_image, 0.5, window);
+        REQUIRE(output.size == window.size);
+        for (int row = 0; row < window.size.row; ++row) {
+            for (int col = 0; col < window.size.col; ++col) {
+                REQUIRE(output.Get(row, col) ==
+                        Approx(0.5 * zoomed_image.Get(1 + 2 * row,
+                                                      2 + 2 * col)));
+            }
+        }
+    }
+
+    // low resolution image is linear, its bilinear interpolation is exact
+    //   except on the bottom and right borders where its last row and col
+    //   are duplicated
+    sirius::Image low_res_image({3, 4});
+    for (int row = 0; row < low_res_image.size.row; ++row) {
+        for (int col = 0; col < low_res_image.size.col; ++col) {
+            low_res_image.Set(row, col, row * 12. + col * 3.);
+        }
+    }
+    auto interpolated_value = [](double zoomed_row, double zoomed_col) {
+        return std::min(zoomed_row / 2., 2.) * 12. +
+               std::min(zoomed_col / 2., 3.) * 3.;
+    };
+
+    SECTION("extract window with bilinear interpolation") {
+        sirius::resampler::OutputWindow window;
+        window.size = zoomed_image.size;
+
+        auto output = sirius::resampler::ExtractOutputWindow(
+              zoomed_image, 2., low_res_image, 2, 0.5, window);
+        REQUIRE(output.size == window.size);
+        for (int row = 0; row < window.size.row; ++row) {
+            for (int col = 0; col < window.size.col; ++col) {
+                REQUIRE(output.Get(row, col) ==
+                        Approx(2. * zoomed_image.Get(row, col) +
+                               0.5 * interpolated_value(row, col)));
+            }
+        }
+    }
+
+    SECTION("extract decimated window with bilinear interpolation") {
+        sirius::resampler::OutputWindow window;
+        window.row_offset = 1;
+        window.col_offset = 1;
+        window.size = {3, 4};
+        window.stride = 2;
+
+        auto output = sirius::resampler::ExtractOutputWindow(
+              zoomed_image, 2., low_res_image, 2, 0.5, window);
+        REQUIRE(output.size == window.size);
+        for (int row = 0; row < window.size.row; ++row) {
+            for (int col = 0; col < window.size.col; ++col) {
+                int zoomed_row = 1 + 2 * row;
+                int zoomed_col = 1 + 2 * col;
+                REQUIRE(output.Get(row, col) ==
+                        Approx(2. * zoomed_image.Get(zoomed_row, zoomed_col) +
+                               0.5 * interpolated_value(zoomed_row,
+                                                        zoomed_col)));
+            }
+        }
+    }
+}
+
+TEST_CASE("frequency resampler - classic - zero padding reference values",
+          "[sirius]") {
+    LOG_SET_LEVEL(trace);
+
+    CheckZeroPaddingZoom(sirius::ImageDecompositionPolicies::kRegular);
+}
+
+TEST_CASE(
+      "frequency resampler - periodic smooth - zero padding reference values",
+      "[sirius]") {
+    LOG_SET_LEVEL(trace);
+
+    // smooth part of a periodic image is null
+    CheckZeroPaddingZoom(sirius::ImageDecompositionPolicies::kPeriodicSmooth);
+
+    CheckInterpolation(sirius::ImageDecompositionPolicies::kPeriodicSmooth,
+                       sirius::FrequencyZoomStrategies::kZeroPadding);
+}
+
+TEST_CASE("frequency resampler - periodization reference values",
+          "[sirius]") {
+    LOG_SET_LEVEL(trace);
+
+    sirius::Image constant_image({9, 10});
+    for (auto& value : constant_image.data) {
+        value = 42.5;
+    }
+    auto trigonometric_image = CreateTrigonometricImage({9, 10});
+
+    SECTION("classic decomposition") {
+        CheckPeriodizationZoom(sirius::ImageDecompositionPolicies::kRegular,
+                               constant_image);
+        CheckPeriodizationZoom(sirius::ImageDecompositionPolicies::kRegular,
+                               trigonometric_image);
+        CheckPeriodizationZoom(sirius::ImageDecompositionPolicies::kRegular,
+                               sirius::tests::CreateDummyImage({8, 11}));
+    }
+
+    SECTION("periodic smooth decomposition") {
+        CheckPeriodizationZoom(
+              sirius::ImageDecompositionPolicies::kPeriodicSmooth,
+              constant_image);
+        CheckPeriodizationZoom(
+              sirius::ImageDecompositionPolicies::kPeriodicSmooth,
+              trigonometric_image);
+    }
+
+    SECTION("smooth part of a periodic image is null") {
+        auto regular_resampler = sirius::FrequencyResamplerFactory::Create(
+              sirius::ImageDecompositionPolicies::kRegular,
+              sirius::FrequencyZoomStrategies::kPeriodization);
+        auto periodic_smooth_resampler =
+              sirius::FrequencyResamplerFactory::Create(
+                    sirius::ImageDecompositionPolicies::kPeriodicSmooth,
+                    sirius::FrequencyZoomStrategies::kPeriodization);
+
+        for (int zoom = 2; zoom <= 5; ++zoom) {
+            INFO("zoom " << zoom);
+            auto zoom_ratio = sirius::ZoomRatio::Create(zoom, 1);
+            auto regular_output = regular_resampler->Compute(
+                  zoom_ratio, trigonometric_image, {});
+            auto periodic_smooth_output = periodic_smooth_resampler->Compute(
+                  zoom_ratio, trigonometric_image, {});
+            REQUIRE(periodic_smooth_output.size == regular_output.size);
+            for (int i = 0; i < regular_output.CellCount(); ++i) {
+                REQUIRE(periodic_smooth_output.data[i] ==
+                        Approx(regular_output.data[i]).margin(1e-9));
+            }
+        }
+    }
+}
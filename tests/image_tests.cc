@@ -19,6 +19,8 @@
  * along with Sirius.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <vector>
+
 #include <catch/catch.hpp>
 
 #include "sirius/image.h"
@@ -209,6 +211,27 @@ TEST_CASE("Image - Mirror pad image", "[image]") {
 
         sirius::tests::CheckMirrorPaddingImage(input, output, padding);
     }
+
+    SECTION("Padding larger than image") {
+        sirius::Padding padding(2, 12, 0, 7,
+                                sirius::PaddingType::kMirrorPadding);
+        auto output = input.CreateMirrorPaddedImage(padding);
+
+        REQUIRE(output.size.row == 19);
+        REQUIRE(output.size.col == 12);
+        // image is mirrored back and forth: ... 1 0 | 0 1 2 3 4 | 4 3 2 1 0 |
+        // 0 1 ...
+        std::vector<int> row_indices = {1, 0, 0, 1, 2, 3, 4, 4, 3, 2,
+                                        1, 0, 0, 1, 2, 3, 4, 4, 3};
+        std::vector<int> col_indices = {0, 1, 2, 3, 4, 4,
+                                        3, 2, 1, 0, 0, 1};
+        for (int row = 0; row < output.size.row; ++row) {
+            for (int col = 0; col < output.size.col; ++col) {
+                REQUIRE(output.Get(row, col) ==
+                        input.Get(row_indices[row], col_indices[col]));
+            }
+        }
+    }
 }
 
 TEST_CASE("Image - load empty path", "[sirius]") {
@@ -268,6 +291,76 @@ TEST_CASE("Image - load well-formed image", "[sirius]") {
     REQUIRE(image.IsLoaded());
 }
 
+TEST_CASE("GDAL - read and write windows", "[sirius]") {
+    LOG_SET_LEVEL(trace);
+
+    // tiled image with partial edge tiles
+    ::GDALAllRegister();
+    auto driver = ::GetGDALDriverManager()->GetDriverByName("GTiff");
+    const char* options[] = {"TILED=YES", "BLOCKXSIZE=16", "BLOCKYSIZE=16",
+                             nullptr};
+    sirius::gdal::DatasetUPtr dataset(
+          driver->Create("/vsimem/sirius_window_tests.tif", 50, 70, 1,
+                         GDT_Float32, const_cast<char**>(options)));
+    REQUIRE(dataset != nullptr);
+    auto band = dataset->GetRasterBand(1);
+    sirius::Size image_size(70, 50);
+
+    auto pixel_value = [](int row, int col) { return row * 100. + col; };
+
+    // write non overlapping windows, some of them cover whole tiles
+    std::vector<int> row_cuts = {0, 5, 37, 64, 70};
+    std::vector<int> col_cuts = {0, 16, 48, 50};
+    for (std::size_t i = 0; i + 1 < row_cuts.size(); ++i) {
+        for (std::size_t j = 0; j + 1 < col_cuts.size(); ++j) {
+            sirius::Size window_size(row_cuts[i + 1] - row_cuts[i],
+                                     col_cuts[j + 1] - col_cuts[j]);
+            std::vector<double> buffer(window_size.CellCount());
+            for (int row = 0; row < window_size.row; ++row) {
+                for (int col = 0; col < window_size.col; ++col) {
+                    buffer[row * window_size.col + col] = pixel_value(
+                          row_cuts[i] + row, col_cuts[j] + col);
+                }
+            }
+            REQUIRE(sirius::gdal::WriteWindow(band, row_cuts[i], col_cuts[j],
+                                              window_size,
+                                              buffer.data()) == CE_None);
+        }
+    }
+    dataset->FlushCache();
+
+    std::vector<double> image(image_size.CellCount());
+    REQUIRE(band->RasterIO(GF_Read, 0, 0, image_size.col, image_size.row,
+                           image.data(), image_size.col, image_size.row,
+                           GDT_Float64, 0, 0, nullptr) == CE_None);
+    for (int row = 0; row < image_size.row; ++row) {
+        for (int col = 0; col < image_size.col; ++col) {
+            REQUIRE(image[row * image_size.col + col] ==
+                    pixel_value(row, col));
+        }
+    }
+
+    // read windows with and without fully covered tiles
+    std::vector<std::vector<int>> windows = {{0, 0, 70, 50},
+                                             {3, 5, 40, 40},
+                                             {16, 16, 32, 32},
+                                             {60, 40, 10, 10},
+                                             {10, 10, 4, 4}};
+    for (const auto& window : windows) {
+        sirius::Size window_size(window[2], window[3]);
+        std::vector<double> buffer(window_size.CellCount(), -1.);
+        REQUIRE(sirius::gdal::ReadWindow(band, window[0], window[1],
+                                         window_size,
+                                         buffer.data()) == CE_None);
+        for (int row = 0; row < window_size.row; ++row) {
+            for (int col = 0; col < window_size.col; ++col) {
+                REQUIRE(buffer[row * window_size.col + col] ==
+                        pixel_value(window[0] + row, window[1] + col));
+            }
+        }
+    }
+}
+
 namespace sirius {
 namespace tests {
 
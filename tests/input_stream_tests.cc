@@ -0,0 +1,427 @@
+/**
+ * Copyright (C) 2018 CS - Systemes d'Information (CS-SI)
+ *
+ * This file is part of Sirius
+ *
+ *     https://github.com/CS-SI/SIRIUS
+ *
+ * Sirius is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sirius is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Sirius.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <catch/catch.hpp>
+
+#include <map>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "sirius/gdal/block_grid.h"
+#include "sirius/gdal/input_stream.h"
+#include "sirius/gdal/wrapper.h"
+
+#include "sirius/utils/log.h"
+
+namespace {
+
+// bands only differ by a fractional part
+double PixelValue(int row, int col, int band = 0) {
+    return row * 1000. + col + band * 0.25;
+}
+
+void CreateImage(const std::string& path, const sirius::Size& image_size,
+                 GDALDataType data_type = GDT_Float64,
+                 const std::string& driver_name = "GTiff",
+                 int band_count = 1) {
+    ::GDALAllRegister();
+    auto driver =
+          ::GetGDALDriverManager()->GetDriverByName(driver_name.c_str());
+    sirius::gdal::DatasetUPtr dataset(driver->Create(
+          path.c_str(), image_size.col, image_size.row, band_count,
+          data_type, nullptr));
+    REQUIRE(dataset != nullptr);
+
+    std::vector<double> image(image_size.CellCount());
+    for (int band = 0; band < band_count; ++band) {
+        for (int row = 0; row < image_size.row; ++row) {
+            for (int col = 0; col < image_size.col; ++col) {
+                image[row * image_size.col + col] =
+                      PixelValue(row, col, band);
+            }
+        }
+        REQUIRE(dataset->GetRasterBand(band + 1)->RasterIO(
+                      GF_Write, 0, 0, image_size.col, image_size.row,
+                      image.data(), image_size.col, image_size.row,
+                      GDT_Float64, 0, 0, nullptr) == CE_None);
+    }
+}
+
+// block content must be the read window of its geometry
+void CheckBlock(const sirius::gdal::StreamBlock& block,
+                const sirius::gdal::BlockGrid& block_grid, int block_index) {
+    std::error_code ec;
+    auto geometry = block_grid.GetBlockGeometry(block_index, ec);
+    REQUIRE(!ec);
+    REQUIRE(block.row_idx == geometry.row_idx);
+    REQUIRE(block.col_idx == geometry.col_idx);
+    for (int band = 0; band < block.BandCount(); ++band) {
+        const auto& buffer =
+              band == 0 ? block.buffer : block.extra_buffers[band - 1];
+        REQUIRE(buffer.size == geometry.read_size);
+        for (int row = 0; row < geometry.read_size.row; ++row) {
+            for (int col = 0; col < geometry.read_size.col; ++col) {
+                REQUIRE(buffer.Get(row, col) ==
+                        PixelValue(geometry.read_row_idx + row,
+                                   geometry.read_col_idx + col, band));
+            }
+        }
+    }
+}
+
+}  // namespace
+
+TEST_CASE("Input stream - margins are read once", "[sirius]") {
+    LOG_SET_LEVEL(trace);
+
+    std::string path = "/vsimem/sirius_input_stream_tests.tif";
+    sirius::Size image_size(70, 50);
+    CreateImage(path, image_size);
+
+    struct Config {
+        sirius::Size block;
+        sirius::Size margin;
+        bool pad_edge_blocks;
+    };
+    std::vector<Config> configs = {{{16, 16}, {4, 4}, false},
+                                   {{16, 16}, {4, 4}, true},
+                                   {{10, 20}, {0, 3}, false},
+                                   {{7, 9}, {5, 0}, false},
+                                   {{32, 32}, {8, 8}, true}};
+
+    for (const auto& config : configs) {
+        sirius::gdal::BlockGrid block_grid(image_size, config.block,
+                                           config.margin,
+                                           sirius::PaddingType::kMirrorPadding,
+                                           config.pad_edge_blocks);
+        sirius::gdal::InputStream input_stream(
+              path, config.block, config.margin,
+              sirius::PaddingType::kMirrorPadding, config.pad_edge_blocks);
+        REQUIRE(input_stream.BlockCount() == block_grid.BlockCount());
+
+        for (int i = 0; i < input_stream.BlockCount(); ++i) {
+            std::error_code ec;
+            auto block = input_stream.Read(ec);
+            REQUIRE(!ec);
+            CheckBlock(block, block_grid, i);
+        }
+        REQUIRE(input_stream.IsAtEnd());
+
+        // each source pixel is read once
+        auto statistics = input_stream.Statistics();
+        REQUIRE(statistics.read_pixel_count ==
+                static_cast<std::size_t>(image_size.CellCount()));
+        REQUIRE(statistics.requested_pixel_count >
+                statistics.read_pixel_count);
+    }
+
+    ::VSIUnlink(path.c_str());
+}
+
+TEST_CASE("Input stream - skipped blocks", "[sirius]") {
+    LOG_SET_LEVEL(trace);
+
+    std::string path = "/vsimem/sirius_input_stream_skipped_tests.tif";
+    sirius::Size image_size(70, 50);
+    sirius::Size block_size(16, 16);
+    sirius::Size margin_size(4, 4);
+    CreateImage(path, image_size);
+
+    sirius::gdal::BlockGrid block_grid(image_size, block_size, margin_size,
+                                       sirius::PaddingType::kMirrorPadding);
+    sirius::gdal::InputStream input_stream(
+          path, block_size, margin_size, sirius::PaddingType::kMirrorPadding);
+    int grid_col_count = input_stream.GridSize().col;
+
+    // first two block rows and a block of the third one are already written
+    std::vector<bool> skipped_blocks(input_stream.BlockCount(), false);
+    for (int i = 0; i < 2 * grid_col_count; ++i) {
+        skipped_blocks[i] = true;
+    }
+    skipped_blocks[2 * grid_col_count + 1] = true;
+    input_stream.SkipBlocks(skipped_blocks);
+    REQUIRE(input_stream.StreamedBlockCount() ==
+            input_stream.BlockCount() - 2 * grid_col_count - 1);
+
+    for (int i = 0; i < input_stream.StreamedBlockCount(); ++i) {
+        std::error_code ec;
+        auto block = input_stream.Read(ec);
+        REQUIRE(!ec);
+        REQUIRE(!skipped_blocks[block.index]);
+        CheckBlock(block, block_grid, block.index);
+    }
+    REQUIRE(input_stream.IsAtEnd());
+
+    // first strip is only used by skipped blocks
+    auto statistics = input_stream.Statistics();
+    REQUIRE(statistics.read_pixel_count ==
+            static_cast<std::size_t>((image_size.row - block_size.row) *
+                                     image_size.col));
+
+    ::VSIUnlink(path.c_str());
+}
+
+TEST_CASE("Input stream - block range", "[sirius]") {
+    LOG_SET_LEVEL(trace);
+
+    std::string path = "/vsimem/sirius_input_stream_range_tests.tif";
+    sirius::Size image_size(70, 50);
+    sirius::Size block_size(16, 16);
+    sirius::Size margin_size(4, 4);
+    CreateImage(path, image_size);
+
+    sirius::gdal::BlockGrid block_grid(image_size, block_size, margin_size,
+                                       sirius::PaddingType::kMirrorPadding);
+    // 2x2 blocks in the middle of a 5x4 grid
+    sirius::gdal::ImageWindow block_range;
+    block_range.row = 1;
+    block_range.col = 1;
+    block_range.size = {2, 2};
+    sirius::gdal::InputStream input_stream(
+          path, block_size, margin_size, sirius::PaddingType::kMirrorPadding,
+          false, block_range);
+    REQUIRE(input_stream.BlockCount() == 4);
+
+    int grid_col_count = block_grid.GridSize().col;
+    for (int i = 0; i < input_stream.BlockCount(); ++i) {
+        std::error_code ec;
+        auto block = input_stream.Read(ec);
+        REQUIRE(!ec);
+        REQUIRE(block.index == i);
+        CheckBlock(block, block_grid,
+                   (block_range.row + i / 2) * grid_col_count +
+                         block_range.col + i % 2);
+    }
+    REQUIRE(input_stream.IsAtEnd());
+
+    // strips only cover the read windows of the range: rows [12, 52) and
+    //   columns [12, 50)
+    auto statistics = input_stream.Statistics();
+    REQUIRE(statistics.read_pixel_count ==
+            static_cast<std::size_t>(40 * 38));
+    REQUIRE(statistics.requested_pixel_count ==
+            static_cast<std::size_t>(2 * 24 * 24 + 2 * 24 * 22));
+
+    ::VSIUnlink(path.c_str());
+}
+
+TEST_CASE("Input stream - concurrent reads", "[sirius]") {
+    LOG_SET_LEVEL(info);
+
+    std::string path = "/vsimem/sirius_input_stream_concurrent_tests.tif";
+    sirius::Size image_size(200, 150);
+    CreateImage(path, image_size);
+
+    sirius::Size block_size(16, 16);
+    sirius::Size margin_size(5, 5);
+    sirius::gdal::BlockGrid block_grid(image_size, block_size, margin_size,
+                                       sirius::PaddingType::kMirrorPadding);
+    sirius::gdal::InputStream input_stream(
+          path, block_size, margin_size, sirius::PaddingType::kMirrorPadding);
+
+    std::vector<std::vector<sirius::gdal::StreamBlock>> thread_blocks(4);
+    std::vector<std::thread> threads;
+    for (auto& blocks : thread_blocks) {
+        threads.emplace_back([&input_stream, &blocks]() {
+            std::error_code ec;
+            while (true) {
+                auto block = input_stream.Read(ec);
+                if (ec) {
+                    break;
+                }
+                blocks.push_back(std::move(block));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    // blocks are identified by their position in the image
+    std::map<std::pair<int, int>, int> block_indices;
+    for (int i = 0; i < block_grid.BlockCount(); ++i) {
+        std::error_code ec;
+        auto geometry = block_grid.GetBlockGeometry(i, ec);
+        REQUIRE(!ec);
+        block_indices[{geometry.row_idx, geometry.col_idx}] = i;
+    }
+
+    std::size_t block_count = 0;
+    for (const auto& blocks : thread_blocks) {
+        for (const auto& block : blocks) {
+            auto it = block_indices.find({block.row_idx, block.col_idx});
+            REQUIRE(it != block_indices.end());
+            CheckBlock(block, block_grid, it->second);
+            block_indices.erase(it);
+        }
+        block_count += blocks.size();
+    }
+    REQUIRE(block_indices.empty());
+    REQUIRE(block_count ==
+            static_cast<std::size_t>(input_stream.BlockCount()));
+    REQUIRE(input_stream.Statistics().read_pixel_count ==
+            static_cast<std::size_t>(image_size.CellCount()));
+
+    ::VSIUnlink(path.c_str());
+}
+
+TEST_CASE("Input stream - native data type", "[sirius]") {
+    LOG_SET_LEVEL(debug);
+
+    // pixel values fit in 16 bits
+    std::string path = "/vsimem/sirius_input_stream_uint16_tests.tif";
+    sirius::Size image_size(60, 50);
+    CreateImage(path, image_size, GDT_UInt16);
+
+    // strips are kept as UInt16 and converted by the readers
+    for (const auto& margin_size : {sirius::Size(4, 4), sirius::Size(0, 0)}) {
+        sirius::Size block_size(16, 16);
+        sirius::gdal::BlockGrid block_grid(image_size, block_size, margin_size,
+                                           sirius::PaddingType::kMirrorPadding);
+        sirius::gdal::InputStream input_stream(
+              path, block_size, margin_size,
+              sirius::PaddingType::kMirrorPadding);
+        for (int i = 0; i < input_stream.BlockCount(); ++i) {
+            std::error_code ec;
+            auto block = input_stream.Read(ec);
+            REQUIRE(!ec);
+            CheckBlock(block, block_grid, i);
+        }
+    }
+
+    auto image = sirius::gdal::LoadImage(path);
+    REQUIRE(image.size == image_size);
+    for (int row = 0; row < image_size.row; ++row) {
+        for (int col = 0; col < image_size.col; ++col) {
+            REQUIRE(image.Get(row, col) == PixelValue(row, col));
+        }
+    }
+
+    ::VSIUnlink(path.c_str());
+}
+
+TEST_CASE("Input stream - raw image", "[sirius]") {
+    LOG_SET_LEVEL(debug);
+
+    // raw images are memory mapped when GDAL can map their file, blocks
+    //   must be the same either way
+    std::string path = "/vsimem/sirius_input_stream_raw_tests.img";
+    sirius::Size image_size(60, 50);
+    CreateImage(path, image_size, GDT_UInt16, "ENVI");
+
+    sirius::Size block_size(16, 16);
+    sirius::Size margin_size(4, 4);
+    sirius::gdal::BlockGrid block_grid(image_size, block_size, margin_size,
+                                       sirius::PaddingType::kMirrorPadding);
+    sirius::gdal::InputStream input_stream(
+          path, block_size, margin_size, sirius::PaddingType::kMirrorPadding);
+
+    std::vector<std::thread> threads;
+    std::vector<std::vector<sirius::gdal::StreamBlock>> thread_blocks(3);
+    for (auto& blocks : thread_blocks) {
+        threads.emplace_back([&input_stream, &blocks]() {
+            std::error_code ec;
+            while (true) {
+                auto block = input_stream.Read(ec);
+                if (ec) {
+                    break;
+                }
+                blocks.push_back(std::move(block));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::size_t block_count = 0;
+    for (const auto& blocks : thread_blocks) {
+        for (const auto& block : blocks) {
+            CheckBlock(block, block_grid, block.index);
+        }
+        block_count += blocks.size();
+    }
+    REQUIRE(block_count ==
+            static_cast<std::size_t>(input_stream.BlockCount()));
+
+    ::VSIUnlink(path.c_str());
+}
+
+TEST_CASE("Input stream - multi-band image", "[sirius]") {
+    LOG_SET_LEVEL(debug);
+
+    constexpr int kBandCount = 3;
+    sirius::Size image_size(60, 50);
+    sirius::Size block_size(16, 16);
+
+    // strips, dataset reads and mapped bands hold every band of a block
+    struct Config {
+        std::string path;
+        std::string driver_name;
+        GDALDataType data_type;
+        sirius::Size margin;
+    };
+    std::vector<Config> configs = {
+          {"/vsimem/sirius_input_stream_bands.tif", "GTiff", GDT_Float64,
+           {4, 4}},
+          {"/vsimem/sirius_input_stream_bands.tif", "GTiff", GDT_Float64,
+           {0, 0}},
+          {"/vsimem/sirius_input_stream_bands.tif", "GTiff", GDT_Float32,
+           {0, 0}},
+          {"/vsimem/sirius_input_stream_bands.img", "ENVI", GDT_Float32,
+           {4, 4}}};
+
+    for (const auto& config : configs) {
+        CreateImage(config.path, image_size, config.data_type,
+                    config.driver_name, kBandCount);
+        sirius::gdal::BlockGrid block_grid(image_size, block_size,
+                                           config.margin,
+                                           sirius::PaddingType::kMirrorPadding);
+        sirius::gdal::InputStream input_stream(
+              config.path, block_size, config.margin,
+              sirius::PaddingType::kMirrorPadding);
+        REQUIRE(input_stream.BandCount() == kBandCount);
+
+        for (int i = 0; i < input_stream.BlockCount(); ++i) {
+            std::error_code ec;
+            auto block = input_stream.Read(ec);
+            REQUIRE(!ec);
+            REQUIRE(block.BandCount() == kBandCount);
+            CheckBlock(block, block_grid, i);
+        }
+        if (config.margin.row > 0 && config.driver_name == "GTiff") {
+            // strips are read once for all the bands
+            REQUIRE(input_stream.Statistics().read_pixel_count ==
+                    static_cast<std::size_t>(image_size.CellCount()) *
+                          kBandCount);
+        }
+
+        auto bands = sirius::gdal::LoadImageBands(config.path);
+        REQUIRE(bands.size() == kBandCount);
+        for (int band = 0; band < kBandCount; ++band) {
+            REQUIRE(bands[band].size == image_size);
+            REQUIRE(bands[band].Get(7, 9) == PixelValue(7, 9, band));
+        }
+
+        ::VSIUnlink(config.path.c_str());
+    }
+}
@@ -0,0 +1,799 @@
+/**
+ * Copyright (C) 2018 CS - Systemes d'Information (CS-SI)
+ *
+ * This file is part of Sirius
+ *
+ *     https://github.com/CS-SI/SIRIUS
+ *
+ * Sirius is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sirius is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Sirius.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <catch/catch.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "sirius/exception.h"
+
+#include "sirius/gdal/block_journal.h"
+#include "sirius/gdal/output_options.h"
+#include "sirius/gdal/resampled_output_stream.h"
+#include "sirius/gdal/shard.h"
+#include "sirius/gdal/wrapper.h"
+
+#include "sirius/utils/log.h"
+
+namespace {
+
+constexpr int kBlockSize = 16;
+
+// bands only differ by a fractional part
+double PixelValue(int row, int col, int band = 0) {
+    return row * 100. + col + band * 0.25;
+}
+
+// block of the output image at the given grid position (1:1 zoom)
+sirius::gdal::StreamBlock CreateBlock(const sirius::Size& image_size,
+                                      const sirius::Size& grid_size,
+                                      int index, int band_count = 1) {
+    int row_idx = (index / grid_size.col) * kBlockSize;
+    int col_idx = (index % grid_size.col) * kBlockSize;
+    sirius::Size size(std::min(kBlockSize, image_size.row - row_idx),
+                      std::min(kBlockSize, image_size.col - col_idx));
+    std::vector<sirius::Image> buffers;
+    for (int band = 0; band < band_count; ++band) {
+        buffers.emplace_back(size);
+        for (int row = 0; row < size.row; ++row) {
+            for (int col = 0; col < size.col; ++col) {
+                buffers.back().Set(
+                      row, col,
+                      PixelValue(row_idx + row, col_idx + col, band));
+            }
+        }
+    }
+    sirius::gdal::StreamBlock block(std::move(buffers.front()), row_idx,
+                                    col_idx, {});
+    block.extra_buffers.assign(std::make_move_iterator(buffers.begin() + 1),
+                               std::make_move_iterator(buffers.end()));
+    block.index = index;
+    return block;
+}
+
+void CreateInputImage(const std::string& path, const sirius::Size& size,
+                      int band_count = 1) {
+    ::GDALAllRegister();
+    auto driver = ::GetGDALDriverManager()->GetDriverByName("GTiff");
+    sirius::gdal::DatasetUPtr dataset(
+          driver->Create(path.c_str(), size.col, size.row, band_count,
+                         GDT_Float32, nullptr));
+    REQUIRE(dataset != nullptr);
+}
+
+void CheckOutputImage(const std::string& path, const sirius::Size& size,
+                      const sirius::Size& written_grid_size,
+                      int band_count = 1) {
+    auto dataset = sirius::gdal::LoadDataset(path);
+    REQUIRE(dataset->GetRasterYSize() == size.row);
+    REQUIRE(dataset->GetRasterXSize() == size.col);
+    REQUIRE(dataset->GetRasterCount() == band_count);
+    int written_rows =
+          std::min(written_grid_size.row * kBlockSize, size.row);
+    std::vector<double> image(size.CellCount());
+    for (int band = 0; band < band_count; ++band) {
+        REQUIRE(dataset->GetRasterBand(band + 1)->RasterIO(
+                      GF_Read, 0, 0, size.col, size.row, image.data(),
+                      size.col, size.row, GDT_Float64, 0, 0,
+                      nullptr) == CE_None);
+        for (int row = 0; row < written_rows; ++row) {
+            for (int col = 0; col < size.col; ++col) {
+                REQUIRE(image[row * size.col + col] ==
+                        PixelValue(row, col, band));
+            }
+        }
+    }
+}
+
+}  // namespace
+
+TEST_CASE("Resampled output stream - ordered block rows", "[sirius]") {
+    LOG_SET_LEVEL(debug);
+
+    std::string input_path = "/vsimem/sirius_output_stream_input.tif";
+    std::string output_path = "/vsimem/sirius_output_stream_output.tif";
+    sirius::Size image_size(70, 50);
+    sirius::Size grid_size(5, 4);
+    CreateInputImage(input_path, image_size);
+
+    std::vector<int> indices(grid_size.CellCount());
+    for (int i = 0; i < grid_size.CellCount(); ++i) {
+        indices[i] = i;
+    }
+
+    SECTION("blocks in order") {
+        sirius::gdal::ResampledOutputStream output_stream(
+              input_path, output_path, sirius::ZoomRatio(), grid_size);
+        for (int index : indices) {
+            std::error_code ec;
+            output_stream.Write(CreateBlock(image_size, grid_size, index), ec);
+            REQUIRE(!ec);
+        }
+    }
+
+    SECTION("shuffled blocks") {
+        // blocks finish in any order within a window of in flight blocks
+        std::mt19937 generator(42);
+        for (std::size_t i = 0; i < indices.size(); i += 6) {
+            std::shuffle(indices.begin() + i,
+                         indices.begin() + std::min(i + 6, indices.size()),
+                         generator);
+        }
+        sirius::gdal::ResampledOutputStream output_stream(
+              input_path, output_path, sirius::ZoomRatio(), grid_size);
+        for (int index : indices) {
+            std::error_code ec;
+            output_stream.Write(CreateBlock(image_size, grid_size, index), ec);
+            REQUIRE(!ec);
+        }
+    }
+
+    SECTION("blocks without grid") {
+        std::reverse(indices.begin(), indices.end());
+        sirius::gdal::ResampledOutputStream output_stream(
+              input_path, output_path, sirius::ZoomRatio());
+        for (int index : indices) {
+            std::error_code ec;
+            output_stream.Write(CreateBlock(image_size, grid_size, index), ec);
+            REQUIRE(!ec);
+        }
+    }
+
+    SECTION("tiled and compressed output") {
+        sirius::gdal::OutputOptions output_options;
+        output_options.tiled = true;
+        output_options.tile_size = {kBlockSize, kBlockSize};
+        output_options.compression = "deflate";
+        std::reverse(indices.begin(), indices.end());
+        {
+            sirius::gdal::ResampledOutputStream output_stream(
+                  input_path, output_path, sirius::ZoomRatio(), grid_size,
+                  output_options);
+            for (int index : indices) {
+                std::error_code ec;
+                output_stream.Write(
+                      CreateBlock(image_size, grid_size, index), ec);
+                REQUIRE(!ec);
+            }
+        }
+        auto dataset = sirius::gdal::LoadDataset(output_path);
+        int block_w = 0;
+        int block_h = 0;
+        dataset->GetRasterBand(1)->GetBlockSize(&block_w, &block_h);
+        REQUIRE(block_w == kBlockSize);
+        REQUIRE(block_h == kBlockSize);
+    }
+
+    SECTION("integer output converted by the computing threads") {
+        sirius::gdal::OutputOptions output_options;
+        output_options.data_type = GDT_UInt16;
+        {
+            sirius::gdal::ResampledOutputStream output_stream(
+                  input_path, output_path, sirius::ZoomRatio(), grid_size,
+                  output_options);
+            for (int index : indices) {
+                auto block = CreateBlock(image_size, grid_size, index);
+                output_stream.ConvertBlock(block);
+                REQUIRE(block.buffer.data.empty());
+                REQUIRE(block.output_data.size() ==
+                        block.buffer.size.CellCount() * sizeof(std::uint16_t));
+                std::error_code ec;
+                output_stream.Write(std::move(block), ec);
+                REQUIRE(!ec);
+            }
+        }
+        auto dataset = sirius::gdal::LoadDataset(output_path);
+        REQUIRE(dataset->GetRasterBand(1)->GetRasterDataType() == GDT_UInt16);
+    }
+
+    SECTION("incomplete block row") {
+        // buffered blocks are written when the stream is destroyed
+        sirius::gdal::ResampledOutputStream output_stream(
+              input_path, output_path, sirius::ZoomRatio(), grid_size);
+        for (int index : indices) {
+            if (index == grid_size.CellCount() - grid_size.col) {
+                continue;
+            }
+            std::error_code ec;
+            output_stream.Write(CreateBlock(image_size, grid_size, index), ec);
+            REQUIRE(!ec);
+        }
+    }
+
+    CheckOutputImage(output_path, image_size, {grid_size.row - 1, 0});
+
+    ::VSIUnlink(output_path.c_str());
+    ::VSIUnlink(input_path.c_str());
+}
+
+TEST_CASE("Resampled output stream - bounded reorder buffer", "[sirius]") {
+    LOG_SET_LEVEL(debug);
+
+    std::string input_path = "/vsimem/sirius_output_stream_input.tif";
+    std::string output_path = "/vsimem/sirius_output_stream_output.tif";
+    sirius::Size image_size(70, 50);
+    sirius::Size grid_size(5, 4);
+    CreateInputImage(input_path, image_size);
+
+    // streamer slots: one block row plus one worker. Buffered blocks keep
+    //   their slot until they leave the reorder buffer.
+    int slot_count = grid_size.col + 1;
+    {
+        sirius::gdal::ResampledOutputStream output_stream(
+              input_path, output_path, sirius::ZoomRatio(), grid_size);
+        int used_slot_count = 0;
+        std::size_t max_buffered_count = 0;
+        auto write = [&](int index) {
+            std::size_t buffered_count = output_stream.PendingBlockCount();
+            std::error_code ec;
+            output_stream.Write(CreateBlock(image_size, grid_size, index), ec);
+            REQUIRE(!ec);
+            used_slot_count -= static_cast<int>(
+                  1 + buffered_count - output_stream.PendingBlockCount());
+            max_buffered_count = std::max(max_buffered_count,
+                                          output_stream.PendingBlockCount());
+        };
+
+        // block 0 is computed last: the next blocks are admitted while
+        //   a slot is available
+        used_slot_count = 1;
+        int next_index = 1;
+        while (next_index < grid_size.CellCount() &&
+               used_slot_count < slot_count) {
+            ++used_slot_count;
+            write(next_index++);
+        }
+        REQUIRE(next_index == slot_count);
+        REQUIRE(output_stream.PendingBlockCount() ==
+                static_cast<std::size_t>(slot_count - 1));
+
+        // block 0 completes block row 0, its slots are released
+        write(0);
+        REQUIRE(output_stream.PendingBlockCount() == 1);
+        REQUIRE(used_slot_count == 1);
+
+        for (; next_index < grid_size.CellCount(); ++next_index) {
+            ++used_slot_count;
+            REQUIRE(used_slot_count <= slot_count);
+            write(next_index);
+        }
+        REQUIRE(output_stream.PendingBlockCount() == 0);
+        REQUIRE(used_slot_count == 0);
+        REQUIRE(max_buffered_count ==
+                static_cast<std::size_t>(slot_count - 1));
+    }
+
+    CheckOutputImage(output_path, image_size, grid_size);
+
+    ::VSIUnlink(output_path.c_str());
+    ::VSIUnlink(input_path.c_str());
+}
+
+TEST_CASE("Resampled output stream - raw output", "[sirius]") {
+    LOG_SET_LEVEL(debug);
+
+    std::string input_path = "/vsimem/sirius_output_stream_raw_input.tif";
+    sirius::Size image_size(70, 50);
+    CreateInputImage(input_path, image_size);
+
+    sirius::gdal::OutputOptions output_options;
+    output_options.format = "ENVI";
+    output_options.data_type = GDT_UInt16;
+
+    SECTION("blocks written concurrently at their offset") {
+        std::string output_path = "./output/sirius_output_stream_raw.img";
+        sirius::Size grid_size(5, 4);
+        std::vector<int> indices(grid_size.CellCount());
+        for (int i = 0; i < grid_size.CellCount(); ++i) {
+            indices[i] = i;
+        }
+        std::shuffle(indices.begin(), indices.end(), std::mt19937(42));
+        {
+            sirius::gdal::ResampledOutputStream output_stream(
+                  input_path, output_path, sirius::ZoomRatio(), grid_size,
+                  output_options);
+            REQUIRE(output_stream.SupportsConcurrentWrites());
+
+            constexpr int kThreadCount = 3;
+            std::vector<std::thread> threads;
+            std::vector<int> error_counts(kThreadCount, 0);
+            for (int thread_idx = 0; thread_idx < kThreadCount;
+                 ++thread_idx) {
+                threads.emplace_back([&, thread_idx]() {
+                    for (std::size_t i = thread_idx; i < indices.size();
+                         i += kThreadCount) {
+                        std::error_code ec;
+                        output_stream.Write(
+                              CreateBlock(image_size, grid_size, indices[i]),
+                              ec);
+                        error_counts[thread_idx] += ec ? 1 : 0;
+                    }
+                });
+            }
+            for (auto& thread : threads) {
+                thread.join();
+            }
+            REQUIRE(std::count(error_counts.begin(), error_counts.end(), 0) ==
+                    kThreadCount);
+        }
+        CheckOutputImage(output_path, image_size, grid_size);
+    }
+
+    SECTION("virtual raw output is written through GDAL") {
+        std::string output_path = "/vsimem/sirius_output_stream_raw.img";
+        sirius::Size grid_size(5, 4);
+        {
+            sirius::gdal::ResampledOutputStream output_stream(
+                  input_path, output_path, sirius::ZoomRatio(), grid_size,
+                  output_options);
+            REQUIRE_FALSE(output_stream.SupportsConcurrentWrites());
+            for (int i = 0; i < grid_size.CellCount(); ++i) {
+                std::error_code ec;
+                output_stream.Write(CreateBlock(image_size, grid_size, i),
+                                    ec);
+                REQUIRE(!ec);
+            }
+        }
+        CheckOutputImage(output_path, image_size, grid_size);
+        ::VSIUnlink(output_path.c_str());
+    }
+
+    SECTION("raw output cannot be streamed to a sequential sink") {
+        REQUIRE_THROWS_AS(
+              sirius::gdal::ResampledOutputStream(
+                    input_path, "/vsistdout/", sirius::ZoomRatio(), {5, 4},
+                    output_options),
+              sirius::Exception);
+    }
+
+    ::VSIUnlink(input_path.c_str());
+}
+
+TEST_CASE("Resampled output stream - multi-band output", "[sirius]") {
+    LOG_SET_LEVEL(debug);
+
+    constexpr int kBandCount = 3;
+    std::string input_path = "/vsimem/sirius_output_stream_bands_input.tif";
+    sirius::Size image_size(70, 50);
+    sirius::Size grid_size(5, 4);
+    CreateInputImage(input_path, image_size, kBandCount);
+
+    std::vector<int> indices(grid_size.CellCount());
+    for (int i = 0; i < grid_size.CellCount(); ++i) {
+        indices[i] = i;
+    }
+    std::reverse(indices.begin(), indices.end());
+
+    auto write_blocks = [&](const std::string& output_path,
+                            const sirius::Size& stream_grid_size,
+                            const sirius::gdal::OutputOptions& options) {
+        sirius::gdal::ResampledOutputStream output_stream(
+              input_path, output_path, sirius::ZoomRatio(), stream_grid_size,
+              options);
+        for (int index : indices) {
+            auto block =
+                  CreateBlock(image_size, grid_size, index, kBandCount);
+            output_stream.ConvertBlock(block);
+            REQUIRE(block.output_data.size() ==
+                    block.buffer.size.CellCount() * kBandCount *
+                          sizeof(float));
+            std::error_code ec;
+            output_stream.Write(std::move(block), ec);
+            REQUIRE(!ec);
+        }
+
+        // blocks must have every band of the output image
+        std::error_code ec;
+        output_stream.Write(CreateBlock(image_size, grid_size, 0), ec);
+        REQUIRE(ec);
+    };
+
+    sirius::gdal::OutputOptions output_options;
+    SECTION("block rows") {
+        std::string output_path = "/vsimem/sirius_output_stream_bands.tif";
+        write_blocks(output_path, grid_size, output_options);
+        CheckOutputImage(output_path, image_size, grid_size, kBandCount);
+        ::VSIUnlink(output_path.c_str());
+    }
+
+    SECTION("blocks without grid") {
+        std::string output_path = "/vsimem/sirius_output_stream_bands.tif";
+        write_blocks(output_path, {0, 0}, output_options);
+        CheckOutputImage(output_path, image_size, grid_size, kBandCount);
+        ::VSIUnlink(output_path.c_str());
+    }
+
+    SECTION("raw output") {
+        std::string output_path = "./output/sirius_output_stream_bands.img";
+        output_options.format = "ENVI";
+        write_blocks(output_path, grid_size, output_options);
+        CheckOutputImage(output_path, image_size, grid_size, kBandCount);
+    }
+
+    ::VSIUnlink(input_path.c_str());
+}
+
+TEST_CASE("Resampled output stream - shards", "[sirius]") {
+    LOG_SET_LEVEL(debug);
+
+    std::string input_path = "/vsimem/sirius_output_stream_shard_input.tif";
+    std::vector<std::string> shard_paths = {
+          "/vsimem/sirius_output_stream_shard_1.tif",
+          "/vsimem/sirius_output_stream_shard_2.tif"};
+    sirius::Size image_size(70, 50);
+    sirius::Size grid_size(5, 4);
+    CreateInputImage(input_path, image_size);
+
+    // first shard covers block rows [0, 3), second one block rows [3, 5)
+    std::vector<int> first_block_rows = {0, 3, 5};
+    for (std::size_t shard = 0; shard < shard_paths.size(); ++shard) {
+        int begin_row = first_block_rows[shard];
+        int end_row = first_block_rows[shard + 1];
+        sirius::gdal::ImageWindow input_area;
+        input_area.row = begin_row * kBlockSize;
+        input_area.size = {
+              std::min(end_row * kBlockSize, image_size.row) - input_area.row,
+              image_size.col};
+        sirius::Size shard_grid_size(end_row - begin_row, grid_size.col);
+
+        sirius::gdal::ResampledOutputStream output_stream(
+              input_path, shard_paths[shard], sirius::ZoomRatio(),
+              shard_grid_size, {}, input_area);
+        for (int i = 0; i < shard_grid_size.CellCount(); ++i) {
+            auto block = CreateBlock(image_size, grid_size,
+                                     begin_row * grid_size.col + i);
+            // blocks are indexed in the shard
+            block.index = i;
+            std::error_code ec;
+            output_stream.Write(std::move(block), ec);
+            REQUIRE(!ec);
+        }
+    }
+
+    auto shard_dataset = sirius::gdal::LoadDataset(shard_paths[1]);
+    REQUIRE(shard_dataset->GetRasterYSize() == 22);
+    REQUIRE(shard_dataset->GetRasterXSize() == image_size.col);
+    sirius::gdal::ImageWindow shard_window;
+    sirius::Size shard_image_size;
+    REQUIRE(sirius::gdal::GetShardMetadata(shard_dataset.get(), shard_window,
+                                           shard_image_size));
+    REQUIRE(shard_window.row == 48);
+    REQUIRE(shard_window.col == 0);
+    REQUIRE(shard_window.size == sirius::Size(22, 50));
+    REQUIRE(shard_image_size == image_size);
+    shard_dataset.reset();
+
+    SECTION("assembled image") {
+        std::string output_path = "/vsimem/sirius_output_stream_shards.tif";
+        sirius::gdal::AssembleShards(shard_paths, output_path);
+        CheckOutputImage(output_path, image_size, grid_size);
+        ::VSIUnlink(output_path.c_str());
+    }
+
+    SECTION("assembled VRT") {
+        std::string output_path = "/vsimem/sirius_output_stream_shards.vrt";
+        sirius::gdal::AssembleShards(shard_paths, output_path);
+        CheckOutputImage(output_path, image_size, grid_size);
+        ::VSIUnlink(output_path.c_str());
+    }
+
+    SECTION("overlapping shards") {
+        REQUIRE_THROWS_AS(
+              sirius::gdal::AssembleShards(
+                    {shard_paths[0], shard_paths[1], shard_paths[1]},
+                    "/vsimem/sirius_overlapping_shards.tif"),
+              sirius::Exception);
+    }
+
+    SECTION("missing shard") {
+        REQUIRE_THROWS_AS(
+              sirius::gdal::AssembleShards({shard_paths[0]},
+                                           "/vsimem/sirius_missing_shard.tif"),
+              sirius::Exception);
+    }
+
+    SECTION("images which are not shards") {
+        REQUIRE_THROWS_AS(
+              sirius::gdal::AssembleShards({input_path},
+                                           "/vsimem/sirius_not_shards.tif"),
+              sirius::Exception);
+    }
+
+    for (const auto& shard_path : shard_paths) {
+        ::VSIUnlink(shard_path.c_str());
+    }
+    ::VSIUnlink(input_path.c_str());
+}
+
+TEST_CASE("Resampled output stream - block journal", "[sirius]") {
+    LOG_SET_LEVEL(debug);
+
+    std::string journal_path = "./output/sirius_block_journal.journal";
+    std::string job_description = "input=test.tif block=16x16";
+    constexpr int kBlockCount = 10;
+    {
+        sirius::gdal::BlockJournal journal(journal_path, job_description,
+                                           kBlockCount);
+        REQUIRE(journal.CompletedBlockCount() == 0);
+        journal.MarkWritten(3);
+        journal.MarkWritten(1);
+        auto block_indices = journal.TakeWrittenBlocks();
+        REQUIRE(block_indices == std::vector<int>({3, 1}));
+        REQUIRE(journal.TakeWrittenBlocks().empty());
+        REQUIRE(!journal.Commit(block_indices));
+    }
+    {
+        // the job was stopped while writing a checkpoint
+        std::ofstream journal_file(journal_path, std::ios::app);
+        journal_file << "5";
+    }
+
+    SECTION("resumed journal") {
+        sirius::gdal::BlockJournal journal(journal_path, job_description,
+                                           kBlockCount);
+        REQUIRE(journal.CompletedBlockCount() == 2);
+        REQUIRE(journal.IsCompleted(1));
+        REQUIRE(journal.IsCompleted(3));
+        REQUIRE_FALSE(journal.IsCompleted(5));
+        REQUIRE_FALSE(journal.IsComplete());
+        journal.Reset();
+        REQUIRE(journal.CompletedBlockCount() == 0);
+    }
+
+    SECTION("journal of another job") {
+        sirius::gdal::BlockJournal journal(
+              journal_path, job_description + " ratio=2:1", kBlockCount);
+        REQUIRE(journal.CompletedBlockCount() == 0);
+    }
+
+    SECTION("checkpoint interval") {
+        sirius::gdal::BlockJournal journal(journal_path, job_description,
+                                           kBlockCount,
+                                           std::chrono::seconds(0));
+        REQUIRE(journal.IsCheckpointDue());
+        sirius::gdal::BlockJournal other_journal(
+              journal_path, job_description, kBlockCount,
+              std::chrono::seconds(3600));
+        REQUIRE_FALSE(other_journal.IsCheckpointDue());
+    }
+
+    std::remove(journal_path.c_str());
+}
+
+TEST_CASE("Resampled output stream - resumed output", "[sirius]") {
+    LOG_SET_LEVEL(debug);
+
+    std::string input_path = "/vsimem/sirius_output_stream_resumed_input.tif";
+    sirius::Size image_size(70, 50);
+    sirius::Size grid_size(5, 4);
+    CreateInputImage(input_path, image_size);
+
+    std::string output_path;
+    sirius::gdal::OutputOptions output_options;
+    SECTION("GeoTIFF output") {
+        output_path = "./output/sirius_output_stream_resumed.tif";
+    }
+    SECTION("raw output") {
+        output_path = "./output/sirius_output_stream_resumed.img";
+        output_options.format = "ENVI";
+    }
+    std::string journal_path = output_path + ".journal";
+    std::string job_description = "resumed output";
+    std::remove(journal_path.c_str());
+
+    {
+        sirius::gdal::BlockJournal journal(journal_path, job_description,
+                                           grid_size.CellCount());
+        sirius::gdal::ResampledOutputStream output_stream(
+              input_path, output_path, sirius::ZoomRatio(), grid_size,
+              output_options, {}, &journal);
+        // job is stopped in the third block row
+        for (int i = 0; i <= 2 * grid_size.col; ++i) {
+            std::error_code ec;
+            output_stream.Write(CreateBlock(image_size, grid_size, i), ec);
+            REQUIRE(!ec);
+        }
+    }
+
+    {
+        sirius::gdal::BlockJournal journal(journal_path, job_description,
+                                           grid_size.CellCount());
+        REQUIRE(journal.CompletedBlockCount() == 2 * grid_size.col + 1);
+        sirius::gdal::ResampledOutputStream output_stream(
+              input_path, output_path, sirius::ZoomRatio(), grid_size,
+              output_options, {}, &journal);
+        for (int i = 0; i < grid_size.CellCount(); ++i) {
+            if (journal.IsCompleted(i)) {
+                continue;
+            }
+            std::error_code ec;
+            output_stream.Write(CreateBlock(image_size, grid_size, i), ec);
+            REQUIRE(!ec);
+        }
+    }
+
+    // journal of a complete output is removed
+    REQUIRE_FALSE(std::ifstream(journal_path).good());
+    CheckOutputImage(output_path, image_size, grid_size);
+
+    ::VSIUnlink(input_path.c_str());
+}
+
+TEST_CASE("Resampled output stream - sequential sinks", "[sirius]") {
+    REQUIRE(sirius::gdal::ResampledOutputStream::IsSequentialSink(
+          "/vsistdout/"));
+    REQUIRE(sirius::gdal::ResampledOutputStream::IsSequentialSink(
+          "/vsistdout"));
+    REQUIRE_FALSE(sirius::gdal::ResampledOutputStream::IsSequentialSink(
+          "/tmp/output.tif"));
+    REQUIRE_FALSE(sirius::gdal::ResampledOutputStream::IsSequentialSink(
+          "/vsimem/output.tif"));
+}
+
+TEST_CASE("Output options - creation options", "[sirius]") {
+    LOG_SET_LEVEL(debug);
+
+    auto has_option = [](const std::vector<std::string>& options,
+                         const std::string& option) {
+        return std::find(options.begin(), options.end(), option) !=
+               options.end();
+    };
+
+    SECTION("default options") {
+        sirius::gdal::OutputOptions output_options;
+        REQUIRE(sirius::gdal::GenerateCreationOptions(output_options).empty());
+    }
+
+    SECTION("tiled output") {
+        sirius::gdal::OutputOptions output_options;
+        output_options.tiled = true;
+        auto options = sirius::gdal::GenerateCreationOptions(output_options);
+        REQUIRE(options.size() == 1);
+        REQUIRE(has_option(options, "TILED=YES"));
+
+        output_options.tile_size = {128, 512};
+        options = sirius::gdal::GenerateCreationOptions(output_options);
+        REQUIRE(has_option(options, "BLOCKXSIZE=512"));
+        REQUIRE(has_option(options, "BLOCKYSIZE=128"));
+
+        output_options.tile_size = {100, 512};
+        REQUIRE_THROWS_AS(
+              sirius::gdal::GenerateCreationOptions(output_options),
+              sirius::Exception);
+    }
+
+    SECTION("compressed output") {
+        sirius::gdal::OutputOptions output_options;
+        output_options.compression = "zstd";
+        output_options.compression_level = 9;
+        output_options.predictor = 3;
+        output_options.compression_threads = 4;
+        auto options = sirius::gdal::GenerateCreationOptions(output_options);
+        REQUIRE(has_option(options, "COMPRESS=ZSTD"));
+        REQUIRE(has_option(options, "ZSTD_LEVEL=9"));
+        REQUIRE(has_option(options, "PREDICTOR=3"));
+        REQUIRE(has_option(options, "NUM_THREADS=4"));
+        REQUIRE(has_option(options, "BIGTIFF=IF_SAFER"));
+
+        output_options.compression = "DEFLATE";
+        output_options.bigtiff = "yes";
+        options = sirius::gdal::GenerateCreationOptions(output_options);
+        REQUIRE(has_option(options, "ZLEVEL=9"));
+        REQUIRE(has_option(options, "BIGTIFF=YES"));
+
+        output_options.predictor = 4;
+        REQUIRE_THROWS_AS(
+              sirius::gdal::GenerateCreationOptions(output_options),
+              sirius::Exception);
+    }
+
+    SECTION("uncompressed output ignores compression settings") {
+        sirius::gdal::OutputOptions output_options;
+        output_options.compression = "NONE";
+        output_options.compression_threads = 4;
+        output_options.predictor = 2;
+        REQUIRE(sirius::gdal::GenerateCreationOptions(output_options).empty());
+    }
+
+    SECTION("raw output ignores layout options") {
+        sirius::gdal::OutputOptions output_options;
+        output_options.format = sirius::gdal::ParseOutputFormat("envi");
+        output_options.tiled = true;
+        output_options.compression = "LZW";
+        REQUIRE(output_options.format == "ENVI");
+        REQUIRE(sirius::gdal::IsRawFormat(output_options));
+        REQUIRE(sirius::gdal::GenerateCreationOptions(output_options).empty());
+
+        REQUIRE(sirius::gdal::ParseOutputFormat("gtiff") == "GTiff");
+        REQUIRE_THROWS_AS(sirius::gdal::ParseOutputFormat("PNG"),
+                          sirius::Exception);
+    }
+
+    SECTION("tile size from output blocks") {
+        REQUIRE(sirius::gdal::ComputeTileSize({512, 256}) ==
+                sirius::Size(512, 256));
+        REQUIRE(sirius::gdal::ComputeTileSize({500, 256}) ==
+                sirius::Size(0, 0));
+        REQUIRE(sirius::gdal::ComputeTileSize({0, 0}) == sirius::Size(0, 0));
+    }
+}
+
+TEST_CASE("Output options - output data type", "[sirius]") {
+    LOG_SET_LEVEL(debug);
+
+    REQUIRE(sirius::gdal::ParseOutputDataType("uint8") == GDT_Byte);
+    REQUIRE(sirius::gdal::ParseOutputDataType("Byte") == GDT_Byte);
+    REQUIRE(sirius::gdal::ParseOutputDataType("UInt16") == GDT_UInt16);
+    REQUIRE(sirius::gdal::ParseOutputDataType("Int16") == GDT_Int16);
+    REQUIRE(sirius::gdal::ParseOutputDataType("float32") == GDT_Float32);
+    REQUIRE(sirius::gdal::ParseOutputDataType("Float64") == GDT_Float64);
+    REQUIRE_THROWS_AS(sirius::gdal::ParseOutputDataType("CFloat32"),
+                      sirius::Exception);
+
+    sirius::Image image({1, 6});
+    image.data = {-10.4, 0.5, 99.6, 1000., 2.25,
+                  std::numeric_limits<double>::quiet_NaN()};
+    std::vector<std::uint8_t> output_data;
+    sirius::gdal::OutputOptions output_options;
+
+    SECTION("rounded and saturated unsigned integers") {
+        output_options.data_type = GDT_Byte;
+        sirius::gdal::ConvertToOutputType(image, output_options, output_data);
+        REQUIRE(output_data ==
+                std::vector<std::uint8_t>({0, 1, 100, 255, 2, 0}));
+    }
+
+    SECTION("scaled and offset signed integers") {
+        output_options.data_type = GDT_Int16;
+        output_options.scale = 100.;
+        output_options.offset = -50.;
+        sirius::gdal::ConvertToOutputType(image, output_options, output_data);
+        REQUIRE(output_data.size() == 6 * sizeof(std::int16_t));
+        std::vector<std::int16_t> pixels(6);
+        std::memcpy(pixels.data(), output_data.data(), output_data.size());
+        REQUIRE(pixels ==
+                std::vector<std::int16_t>({-1090, 0, 9910, 32767, 175, 0}));
+    }
+
+    SECTION("floating point") {
+        output_options.data_type = GDT_Float32;
+        sirius::gdal::ConvertToOutputType(image, output_options, output_data);
+        REQUIRE(output_data.size() == 6 * sizeof(float));
+        std::vector<float> pixels(6);
+        std::memcpy(pixels.data(), output_data.data(), output_data.size());
+        REQUIRE(pixels[0] == static_cast<float>(-10.4));
+        REQUIRE(pixels[4] == 2.25f);
+        REQUIRE(std::isnan(pixels[5]));
+    }
+}
@@ -0,0 +1,205 @@
+/**
+ * Copyright (C) 2018 CS - Systemes d'Information (CS-SI)
+ *
+ * This file is part of Sirius
+ *
+ *     https://github.com/CS-SI/SIRIUS
+ *
+ * Sirius is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sirius is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Sirius.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <catch/catch.hpp>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "sirius/utils/log.h"
+#include "sirius/utils/system_resources.h"
+
+namespace {
+
+/**
+ * \brief Temporary fake root file system
+ */
+class FakeRoot {
+  public:
+    FakeRoot() {
+        char path_template[] = "/tmp/sirius_resources_XXXXXX";
+        REQUIRE(::mkdtemp(path_template) != nullptr);
+        path_ = path_template;
+    }
+
+    ~FakeRoot() {
+        for (auto it = files_.rbegin(); it != files_.rend(); ++it) {
+            std::remove(it->c_str());
+        }
+        for (auto it = dirs_.rbegin(); it != dirs_.rend(); ++it) {
+            ::rmdir(it->c_str());
+        }
+        ::rmdir(path_.c_str());
+    }
+
+    FakeRoot(const FakeRoot&) = delete;
+    FakeRoot& operator=(const FakeRoot&) = delete;
+    FakeRoot(FakeRoot&&) = delete;
+    FakeRoot& operator=(FakeRoot&&) = delete;
+
+    void AddFile(const std::string& relative_path,
+                 const std::string& content) {
+        std::size_t pos = 0;
+        while ((pos = relative_path.find('/', pos + 1)) != std::string::npos) {
+            std::string dir = path_ + "/" + relative_path.substr(0, pos);
+            if (::mkdir(dir.c_str(), 0700) == 0) {
+                dirs_.push_back(dir);
+            }
+        }
+        std::string path = path_ + "/" + relative_path;
+        std::ofstream file(path);
+        file << content;
+        files_.push_back(path);
+    }
+
+    const std::string& path() const { return path_; }
+
+  private:
+    std::string path_;
+    std::vector<std::string> dirs_;
+    std::vector<std::string> files_;
+};
+
+constexpr std::size_t kMB = 1024 * 1024;
+
+}  // namespace
+
+TEST_CASE("system resources - cpu list", "[sirius]") {
+    REQUIRE(sirius::utils::ParseCpuList("0") == 1);
+    REQUIRE(sirius::utils::ParseCpuList("0-3") == 4);
+    REQUIRE(sirius::utils::ParseCpuList("0-3,8,10-11") == 7);
+    REQUIRE(sirius::utils::ParseCpuList("0-63\n") == 64);
+    REQUIRE(sirius::utils::ParseCpuList("") == 0);
+    REQUIRE(sirius::utils::ParseCpuList("a-b") == 0);
+    REQUIRE(sirius::utils::ParseCpuList("3-1") == 0);
+}
+
+TEST_CASE("system resources - host", "[sirius]") {
+    LOG_SET_LEVEL(debug);
+
+    FakeRoot root;
+    root.AddFile("sys/devices/system/cpu/online", "0-63\n");
+    root.AddFile("proc/meminfo",
+                 "MemTotal:       16384000 kB\nMemFree:  1000 kB\n");
+
+    auto resources = sirius::utils::DetectSystemResources(root.path());
+    REQUIRE(resources.host_cpu_count == 64);
+    REQUIRE(resources.cpu_count == 64);
+    REQUIRE(resources.cpu_quota == 0.);
+    REQUIRE(resources.physical_memory == 16384000ul * 1024);
+    REQUIRE(resources.memory_limit == 0);
+    REQUIRE(resources.cgroup_version == 0);
+}
+
+TEST_CASE("system resources - cgroup v2", "[sirius]") {
+    LOG_SET_LEVEL(debug);
+
+    FakeRoot root;
+    root.AddFile("sys/devices/system/cpu/online", "0-63\n");
+    root.AddFile("proc/meminfo", "MemTotal:       16384000 kB\n");
+    root.AddFile("sys/fs/cgroup/cgroup.controllers", "cpuset cpu memory\n");
+
+    SECTION("container cgroup namespace") {
+        root.AddFile("proc/self/cgroup", "0::/\n");
+        root.AddFile("sys/fs/cgroup/cpu.max", "400000 100000\n");
+        root.AddFile("sys/fs/cgroup/memory.max", "2147483648\n");
+        auto resources = sirius::utils::DetectSystemResources(root.path());
+        REQUIRE(resources.cgroup_version == 2);
+        REQUIRE(resources.cpu_quota == Approx(4.));
+        REQUIRE(resources.cpu_count == 4);
+        REQUIRE(resources.memory_limit == 2048 * kMB);
+    }
+
+    SECTION("fractional quota, parent limits and cpuset") {
+        root.AddFile("proc/self/cgroup", "0::/kubepods/pod1/container\n");
+        root.AddFile("sys/fs/cgroup/kubepods/pod1/container/cpu.max",
+                     "max 100000\n");
+        root.AddFile("sys/fs/cgroup/kubepods/pod1/container/memory.max",
+                     "max\n");
+        root.AddFile(
+              "sys/fs/cgroup/kubepods/pod1/container/cpuset.cpus.effective",
+              "0-7\n");
+        root.AddFile("sys/fs/cgroup/kubepods/pod1/cpu.max", "250000 100000\n");
+        root.AddFile("sys/fs/cgroup/kubepods/pod1/memory.max", "1073741824\n");
+        root.AddFile("sys/fs/cgroup/kubepods/memory.max", "4294967296\n");
+        auto resources = sirius::utils::DetectSystemResources(root.path());
+        REQUIRE(resources.cpu_quota == Approx(2.5));
+        REQUIRE(resources.cpu_count == 3);
+        REQUIRE(resources.memory_limit == 1024 * kMB);
+    }
+
+    SECTION("cpuset only") {
+        root.AddFile("proc/self/cgroup", "0::/\n");
+        root.AddFile("sys/fs/cgroup/cpu.max", "max 100000\n");
+        root.AddFile("sys/fs/cgroup/cpuset.cpus.effective", "0-1,4-5\n");
+        auto resources = sirius::utils::DetectSystemResources(root.path());
+        REQUIRE(resources.cpu_quota == 0.);
+        REQUIRE(resources.cpu_count == 4);
+        REQUIRE(resources.memory_limit == 0);
+    }
+}
+
+TEST_CASE("system resources - cgroup v1", "[sirius]") {
+    LOG_SET_LEVEL(debug);
+
+    FakeRoot root;
+    root.AddFile("sys/devices/system/cpu/online", "0-15\n");
+    root.AddFile("proc/meminfo", "MemTotal:       16384000 kB\n");
+    root.AddFile("proc/self/cgroup",
+                 "12:memory:/docker/abc\n"
+                 "5:cpu,cpuacct:/docker/abc\n"
+                 "3:cpuset:/docker/abc\n");
+
+    SECTION("limited container") {
+        // container only sees its own cgroup at the mount root
+        root.AddFile("sys/fs/cgroup/cpu,cpuacct/cpu.cfs_quota_us", "150000\n");
+        root.AddFile("sys/fs/cgroup/cpu,cpuacct/cpu.cfs_period_us",
+                     "100000\n");
+        root.AddFile("sys/fs/cgroup/memory/memory.limit_in_bytes",
+                     "536870912\n");
+        root.AddFile("sys/fs/cgroup/cpuset/cpuset.cpus", "0-7\n");
+        auto resources = sirius::utils::DetectSystemResources(root.path());
+        REQUIRE(resources.cgroup_version == 1);
+        REQUIRE(resources.cpu_quota == Approx(1.5));
+        REQUIRE(resources.cpu_count == 2);
+        REQUIRE(resources.memory_limit == 512 * kMB);
+    }
+
+    SECTION("unlimited container") {
+        root.AddFile("sys/fs/cgroup/cpu/docker/abc/cpu.cfs_quota_us", "-1\n");
+        root.AddFile("sys/fs/cgroup/cpu/docker/abc/cpu.cfs_period_us",
+                     "100000\n");
+        root.AddFile("sys/fs/cgroup/memory/docker/abc/memory.limit_in_bytes",
+                     "9223372036854771712\n");
+        auto resources = sirius::utils::DetectSystemResources(root.path());
+        REQUIRE(resources.cgroup_version == 1);
+        REQUIRE(resources.cpu_quota == 0.);
+        REQUIRE(resources.cpu_count == 16);
+        REQUIRE(resources.memory_limit == 0);
+    }
+}
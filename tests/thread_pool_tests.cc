@@ -0,0 +1,122 @@
+/**
+ * Copyright (C) 2018 CS - Systemes d'Information (CS-SI)
+ *
+ * This file is part of Sirius
+ *
+ *     https://github.com/CS-SI/SIRIUS
+ *
+ * Sirius is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Sirius is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Sirius.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <catch/catch.hpp>
+
+#include <atomic>
+#include <future>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "sirius/utils/log.h"
+#include "sirius/utils/thread_pool.h"
+
+TEST_CASE("thread pool - submit tasks", "[sirius]") {
+    LOG_SET_LEVEL(trace);
+    sirius::utils::ThreadPool thread_pool(4);
+    REQUIRE(thread_pool.ThreadCount() == 4);
+
+    std::vector<std::future<int>> futures;
+    for (int i = 0; i < 1000; ++i) {
+        futures.push_back(thread_pool.Submit([i]() { return i; }));
+    }
+
+    int sum = 0;
+    for (auto& future : futures) {
+        sum += future.get();
+    }
+    REQUIRE(sum == 999 * 1000 / 2);
+}
+
+TEST_CASE("thread pool - nested tasks", "[sirius]") {
+    LOG_SET_LEVEL(trace);
+    // single worker: nested tasks can only run if the waiting task helps
+    sirius::utils::ThreadPool thread_pool(1);
+
+    auto future = thread_pool.Submit([&thread_pool]() {
+        std::vector<std::future<int>> futures;
+        for (int i = 0; i < 100; ++i) {
+            futures.push_back(thread_pool.Submit([i]() { return i; }));
+        }
+        int sum = 0;
+        for (auto& nested_future : futures) {
+            thread_pool.Wait(nested_future);
+            sum += nested_future.get();
+        }
+        return sum;
+    });
+
+    REQUIRE(future.get() == 99 * 100 / 2);
+}
+
+TEST_CASE("thread pool - exception", "[sirius]") {
+    LOG_SET_LEVEL(trace);
+    sirius::utils::ThreadPool thread_pool(2);
+
+    auto future = thread_pool.Submit(
+          []() -> int { throw std::runtime_error("task error"); });
+    REQUIRE_THROWS_AS(future.get(), std::runtime_error);
+
+    // pool is still usable after a task failure
+    REQUIRE(thread_pool.Submit([]() { return 42; }).get() == 42);
+}
+
+TEST_CASE("thread pool - pending tasks on destruction", "[sirius]") {
+    LOG_SET_LEVEL(trace);
+    std::atomic<int> counter{0};
+    {
+        sirius::utils::ThreadPool thread_pool(2);
+        for (int i = 0; i < 100; ++i) {
+            thread_pool.Submit([&counter]() { ++counter; });
+        }
+    }
+    REQUIRE(counter == 100);
+}
+
+TEST_CASE("thread pool - concurrent submitters and helpers", "[sirius]") {
+    LOG_SET_LEVEL(trace);
+    std::atomic<int> counter{0};
+    {
+        // external threads submit tasks and run pending tasks while the
+        //   workers pop them: the pending task count must stay consistent
+        //   for the pool to stop
+        sirius::utils::ThreadPool thread_pool(2);
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 4; ++i) {
+            threads.emplace_back([&thread_pool, &counter]() {
+                std::vector<std::future<void>> futures;
+                for (int j = 0; j < 1000; ++j) {
+                    futures.push_back(
+                          thread_pool.Submit([&counter]() { ++counter; }));
+                    thread_pool.RunPendingTask();
+                }
+                for (auto& future : futures) {
+                    thread_pool.Wait(future);
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+    REQUIRE(counter == 4000);
+}
@@ -19,15 +19,28 @@
  * along with Sirius.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+
+#include <sstream>
+#include <string>
+#include <thread>
 #include <vector>
 
 #include <catch/catch.hpp>
 
+#include "sirius/exception.h"
 #include "sirius/types.h"
 
+#include "sirius/utils/batch_manifest.h"
 #include "sirius/utils/log.h"
 #include "sirius/utils/lru_cache.h"
+#include "sirius/utils/memory_budget.h"
 #include "sirius/utils/numeric.h"
+#include "sirius/utils/pipeline_metrics.h"
+#include "sirius/utils/trace.h"
 
 TEST_CASE("utils tests - gcd", "[sirius]") {
     REQUIRE(sirius::utils::Gcd(0, 0) == 0);
@@ -372,6 +385,12 @@ TEST_CASE("utils test - LRU cache", "[sirius]") {
 
     cache.Clear();
     REQUIRE(cache.Size() == 0);
+
+    REQUIRE(!cache.Get({9, 9}).value);
+    auto statistics = cache.Statistics();
+    REQUIRE(statistics.hit_count == 6);
+    REQUIRE(statistics.miss_count == 1);
+    REQUIRE(statistics.HitRate() == Approx(6. / 7.));
 }
 
 TEST_CASE("utils test - FFTFreq", "[sirius]") {
@@ -442,3 +461,363 @@ TEST_CASE("utils test - Meshgrid", "[sirius]") {
     REQUIRE(yy[10] == 2);
     REQUIRE(yy[11] == 2);
 }
+
+TEST_CASE("utils tests - FFT friendly size", "[sirius]") {
+    REQUIRE(sirius::utils::IsFFTFriendlySize(1));
+    REQUIRE(sirius::utils::IsFFTFriendlySize(1024));
+    REQUIRE(sirius::utils::IsFFTFriendlySize(1000));
+    REQUIRE(sirius::utils::IsFFTFriendlySize(2 * 3 * 5 * 7));
+    REQUIRE(!sirius::utils::IsFFTFriendlySize(0));
+    REQUIRE(!sirius::utils::IsFFTFriendlySize(11));
+    REQUIRE(!sirius::utils::IsFFTFriendlySize(1009));
+
+    REQUIRE(sirius::utils::EstimateFFTCost({1024, 1024}) <
+            sirius::utils::EstimateFFTCost({1009, 1009}));
+    REQUIRE(sirius::utils::EstimateFFTCost({512, 512}) <
+            sirius::utils::EstimateFFTCost({1000, 1000}));
+
+    sirius::Size padding_size(10, 15);
+    auto zoom_ratio = sirius::ZoomRatio::Create(2, 1);
+    auto size = sirius::utils::GenerateFFTFriendlySize({1000, 256}, zoom_ratio,
+                                                       padding_size);
+    REQUIRE(size.row >= 1000);
+    REQUIRE(size.col >= 256);
+    REQUIRE(sirius::utils::IsFFTFriendlySize(size.row + 2 * padding_size.row));
+    REQUIRE(sirius::utils::IsFFTFriendlySize(size.col + 2 * padding_size.col));
+
+    // real zoom: block size must be a multiple of the output resolution
+    zoom_ratio = sirius::ZoomRatio::Create(4, 3);
+    size = sirius::utils::GenerateFFTFriendlySize({1000, 256}, zoom_ratio,
+                                                  padding_size);
+    REQUIRE(size.row >= 1000);
+    REQUIRE(size.col >= 256);
+    REQUIRE(size.row % 3 == 0);
+    REQUIRE(size.col % 3 == 0);
+    REQUIRE(sirius::utils::IsFFTFriendlySize(size.row + 2 * padding_size.row));
+    REQUIRE(sirius::utils::IsFFTFriendlySize(size.col + 2 * padding_size.col));
+
+    // tile alignment: rows aligned on 16 pixel strips, tile width larger
+    // than the block is ignored
+    zoom_ratio = sirius::ZoomRatio::Create(2, 1);
+    size = sirius::utils::GenerateFFTFriendlySize({1000, 256}, zoom_ratio,
+                                                  padding_size, {16, 4096});
+    REQUIRE(size.row >= 1000);
+    REQUIRE(size.col >= 256);
+    REQUIRE(size.row % 16 == 0);
+    REQUIRE(sirius::utils::IsFFTFriendlySize(size.row + 2 * padding_size.row));
+    REQUIRE(sirius::utils::IsFFTFriendlySize(size.col + 2 * padding_size.col));
+
+    // tile alignment combined with real zoom
+    zoom_ratio = sirius::ZoomRatio::Create(4, 3);
+    size = sirius::utils::GenerateFFTFriendlySize({256, 256}, zoom_ratio,
+                                                  {0, 0}, {64, 64});
+    REQUIRE(size.row % 192 == 0);
+    REQUIRE(size.col % 192 == 0);
+    REQUIRE(sirius::utils::IsFFTFriendlySize(size.row));
+    REQUIRE(sirius::utils::IsFFTFriendlySize(size.col));
+}
+
+TEST_CASE("utils tests - memory budget", "[sirius]") {
+    LOG_SET_LEVEL(debug);
+
+    sirius::Size image_size(10000, 8000);
+    auto zoom_ratio = sirius::ZoomRatio::Create(2, 1);
+    sirius::Size padding_size(50, 50);
+    sirius::utils::StreamMemoryModel model(image_size, zoom_ratio,
+                                           padding_size, true);
+
+    // memory grows with block size, zoom and workers
+    sirius::Size block_size(256, 256);
+    REQUIRE(model.BlockComputeMemory(block_size) >
+            model.BlockOutputMemory(block_size));
+    REQUIRE(model.BlockOutputMemory(block_size) ==
+            512 * 512 * sizeof(double));
+    REQUIRE(model.BlockComputeMemory({512, 512}) >
+            model.BlockComputeMemory(block_size));
+    REQUIRE(model.PeakMemory(block_size, 4, 4) >
+            model.PeakMemory(block_size, 2, 2));
+    REQUIRE(model.PeakMemory(block_size, 2, 4) >
+            model.PeakMemory(block_size, 2, 2));
+    REQUIRE(model.StripCacheMemory(block_size, 4) > 0);
+    REQUIRE(model.ReorderBufferMemory(block_size) >
+            model.BlockOutputMemory(block_size));
+
+    sirius::utils::StreamMemoryModel zoom4_model(
+          image_size, sirius::ZoomRatio::Create(4, 1), padding_size, true);
+    REQUIRE(zoom4_model.BlockOutputMemory(block_size) ==
+            4 * model.BlockOutputMemory(block_size));
+
+    // blocks waiting to be written are converted to the output data type
+    sirius::utils::StreamMemoryModel uint16_model(
+          image_size, zoom_ratio, padding_size, true, false,
+          sizeof(std::uint16_t));
+    REQUIRE(uint16_model.BlockOutputMemory(block_size) ==
+            model.BlockOutputMemory(block_size) / 4);
+    REQUIRE(uint16_model.PeakMemory(block_size, 4, 8) <
+            model.PeakMemory(block_size, 4, 8));
+
+    // input strips are kept in the native data type
+    sirius::utils::StreamMemoryModel uint16_input_model(
+          image_size, zoom_ratio, padding_size, true, false, sizeof(double),
+          sizeof(std::uint16_t));
+    REQUIRE(uint16_input_model.StripCacheMemory(block_size, 4) ==
+            model.StripCacheMemory(block_size, 4) / 4);
+
+    // no filter, no margin: no filter spectrum nor strip cache
+    sirius::utils::StreamMemoryModel no_filter_model(image_size, zoom_ratio,
+                                                     {0, 0}, false);
+    REQUIRE(no_filter_model.FilterCacheMemory(block_size) == 0);
+    REQUIRE(no_filter_model.StripCacheMemory(block_size, 4) == 0);
+
+    // tuned parameters fit in the budget
+    for (std::size_t max_memory_mb : {64, 256, 1024, 8192}) {
+        std::size_t max_memory = max_memory_mb * 1024 * 1024;
+        auto parameters =
+              sirius::utils::TuneStreamParameters(model, max_memory, 8);
+        REQUIRE(parameters.peak_memory <= max_memory);
+        REQUIRE(parameters.parallel_workers >= 1);
+        REQUIRE(parameters.parallel_workers <= 8);
+        REQUIRE(parameters.max_pending_blocks >= parameters.parallel_workers);
+        REQUIRE(parameters.max_pending_blocks <=
+                2 * parameters.parallel_workers);
+        REQUIRE(parameters.peak_memory ==
+                model.PeakMemory(parameters.block_size,
+                                 parameters.parallel_workers,
+                                 parameters.max_pending_blocks));
+    }
+
+    // larger budget allows more workers
+    auto small_budget =
+          sirius::utils::TuneStreamParameters(model, 64 * 1024 * 1024, 8);
+    auto large_budget =
+          sirius::utils::TuneStreamParameters(model, 8192ul * 1024 * 1024, 8);
+    REQUIRE(large_budget.parallel_workers >= small_budget.parallel_workers);
+    REQUIRE(large_budget.parallel_workers == 8);
+
+    // too small budget: smallest block, one worker
+    auto tiny_budget = sirius::utils::TuneStreamParameters(model, 1024, 8);
+    REQUIRE(tiny_budget.parallel_workers == 1);
+    REQUIRE(tiny_budget.max_pending_blocks == 1);
+    REQUIRE(tiny_budget.block_size.row <= 128);
+
+    // small image: blocks are limited to the image size
+    sirius::utils::StreamMemoryModel small_image_model(
+          {100, 80}, zoom_ratio, {0, 0}, false);
+    auto small_image = sirius::utils::TuneStreamParameters(
+          small_image_model, 1024 * 1024 * 1024, 8, {1, 1}, false);
+    REQUIRE(small_image.block_size.row <= 100);
+    REQUIRE(small_image.block_size.col <= 80);
+
+    // fixed block size: only workers and pending blocks are tuned
+    sirius::Size fixed_block_size(300, 200);
+    auto fixed_block = sirius::utils::TuneStreamWorkers(
+          model, 1024 * 1024 * 1024, 8, fixed_block_size);
+    REQUIRE(fixed_block.block_size == fixed_block_size);
+    REQUIRE(fixed_block.parallel_workers >= 1);
+    REQUIRE(fixed_block.peak_memory <= 1024 * 1024 * 1024);
+    REQUIRE(fixed_block.peak_memory ==
+            model.PeakMemory(fixed_block_size, fixed_block.parallel_workers,
+                             fixed_block.max_pending_blocks));
+    auto tiny_fixed_block =
+          sirius::utils::TuneStreamWorkers(model, 1024, 8, fixed_block_size);
+    REQUIRE(tiny_fixed_block.block_size == fixed_block_size);
+    REQUIRE(tiny_fixed_block.parallel_workers == 1);
+    REQUIRE(tiny_fixed_block.max_pending_blocks == 1);
+}
+
+TEST_CASE("utils tests - parse memory size", "[sirius]") {
+    REQUIRE(sirius::utils::ParseMemorySize("512") == 512 * 1024 * 1024);
+    REQUIRE(sirius::utils::ParseMemorySize("512M") == 512 * 1024 * 1024);
+    REQUIRE(sirius::utils::ParseMemorySize("512mb") == 512 * 1024 * 1024);
+    REQUIRE(sirius::utils::ParseMemorySize("4G") == 4ul * 1024 * 1024 * 1024);
+    REQUIRE(sirius::utils::ParseMemorySize("1.5G") ==
+            1536ul * 1024 * 1024);
+    REQUIRE(sirius::utils::ParseMemorySize("64K") == 64 * 1024);
+    REQUIRE(sirius::utils::ParseMemorySize("100B") == 100);
+
+    REQUIRE_THROWS_AS(sirius::utils::ParseMemorySize(""), sirius::Exception);
+    REQUIRE_THROWS_AS(sirius::utils::ParseMemorySize("abc"),
+                      sirius::Exception);
+    REQUIRE_THROWS_AS(sirius::utils::ParseMemorySize("-1G"),
+                      sirius::Exception);
+    REQUIRE_THROWS_AS(sirius::utils::ParseMemorySize("12X"),
+                      sirius::Exception);
+}
+
+TEST_CASE("utils tests - batch manifest", "[sirius]") {
+    std::istringstream manifest(
+          "# input output\n"
+          "\n"
+          "in/a.tif out/a.tif\n"
+          "  in/b.tif   out/b.tif  \r\n"
+          "in/scene c.tif\tout/scene c.tif\n");
+    auto entries = sirius::utils::ParseBatchManifest(manifest);
+    REQUIRE(entries.size() == 3);
+    REQUIRE(entries[0].input_path == "in/a.tif");
+    REQUIRE(entries[0].output_path == "out/a.tif");
+    REQUIRE(entries[1].input_path == "in/b.tif");
+    REQUIRE(entries[1].output_path == "out/b.tif");
+    REQUIRE(entries[2].input_path == "in/scene c.tif");
+    REQUIRE(entries[2].output_path == "out/scene c.tif");
+
+    std::istringstream missing_output("in/a.tif out/a.tif\nin/b.tif\n");
+    REQUIRE_THROWS_AS(sirius::utils::ParseBatchManifest(missing_output),
+                      sirius::Exception);
+    std::istringstream extra_path("in/a.tif out/a.tif out/b.tif\n");
+    REQUIRE_THROWS_AS(sirius::utils::ParseBatchManifest(extra_path),
+                      sirius::Exception);
+
+    REQUIRE_THROWS_AS(
+          sirius::utils::LoadBatchManifest("/nonexistent/manifest.txt"),
+          sirius::Exception);
+}
+
+TEST_CASE("utils tests - pipeline metrics", "[sirius]") {
+    using sirius::utils::PipelineStage;
+    sirius::utils::PipelineMetrics metrics;
+
+    // stages are not timed outside of a metrics scope
+    REQUIRE(sirius::utils::PipelineMetrics::Current() == nullptr);
+    {
+        sirius::utils::StageTimer timer(PipelineStage::kFilter);
+    }
+    REQUIRE(metrics.Snapshot().Stage(PipelineStage::kFilter).count == 0);
+
+    {
+        sirius::utils::PipelineMetricsScope scope(&metrics);
+        REQUIRE(sirius::utils::PipelineMetrics::Current() == &metrics);
+        sirius::utils::StageTimer timer(PipelineStage::kFilter);
+        timer.Pause();
+        timer.Resume();
+        timer.Stop();
+        // stopped timer is recorded once
+        timer.Stop();
+    }
+    REQUIRE(sirius::utils::PipelineMetrics::Current() == nullptr);
+    REQUIRE(metrics.Snapshot().Stage(PipelineStage::kFilter).count == 1);
+
+    // 90 latencies of 10 us and 10 latencies of 1 ms
+    for (int i = 0; i < 90; ++i) {
+        metrics.Record(PipelineStage::kForwardFFT,
+                       std::chrono::microseconds(10));
+    }
+    for (int i = 0; i < 10; ++i) {
+        metrics.Record(PipelineStage::kForwardFFT,
+                       std::chrono::milliseconds(1));
+    }
+    metrics.AddReadBlock();
+    metrics.AddComputedBlock();
+    metrics.AddWrittenBlock(1024 * 1024);
+    metrics.UpdateOccupancy(2, 1);
+    metrics.UpdateOccupancy(1, 3);
+
+    auto snapshot = metrics.Snapshot();
+    const auto& fft = snapshot.Stage(PipelineStage::kForwardFFT);
+    REQUIRE(fft.count == 100);
+    REQUIRE(fft.total_ms == Approx(10.9));
+    REQUIRE(fft.MeanMs() == Approx(0.109));
+    REQUIRE(fft.min_ms == Approx(0.01));
+    REQUIRE(fft.max_ms == Approx(1.));
+    // [8, 16) us and [512, 1024) us buckets
+    REQUIRE(fft.histogram[3] == 90);
+    REQUIRE(fft.histogram[9] == 10);
+    REQUIRE(fft.PercentileMs(50.) == Approx(0.016));
+    REQUIRE(fft.PercentileMs(90.) == Approx(0.016));
+    REQUIRE(fft.PercentileMs(99.) == Approx(1.));
+    REQUIRE(snapshot.Stage(PipelineStage::kWrite).PercentileMs(50.) == 0.);
+
+    REQUIRE(snapshot.read_block_count == 1);
+    REQUIRE(snapshot.computed_block_count == 1);
+    REQUIRE(snapshot.written_block_count == 1);
+    REQUIRE(snapshot.written_byte_count == 1024 * 1024);
+    REQUIRE(snapshot.input_occupancy.max_blocks == 2);
+    REQUIRE(snapshot.output_occupancy.max_blocks == 3);
+    REQUIRE(snapshot.occupancy_samples.size() >= 1);
+    REQUIRE(snapshot.occupancy_samples.front().input_blocks == 2);
+
+    auto json = sirius::utils::ToJson(snapshot);
+    REQUIRE(json.front() == '{');
+    REQUIRE(json.back() == '}');
+    REQUIRE(json.find("\"forward_fft\": {\"count\": 100") !=
+            std::string::npos);
+    REQUIRE(json.find("\"written\": 1048576") != std::string::npos);
+    REQUIRE(json.find("\"fft_plan\"") != std::string::npos);
+
+    metrics.Start();
+    REQUIRE(metrics.Snapshot().Stage(PipelineStage::kForwardFFT).count == 0);
+
+    REQUIRE_THROWS_AS(sirius::utils::WriteMetricsReport(
+                            "/nonexistent/report.json", {}),
+                      sirius::Exception);
+}
+
+#ifdef SIRIUS_ENABLE_TRACING
+TEST_CASE("utils tests - trace", "[sirius]") {
+    auto& trace_recorder = sirius::utils::TraceRecorder::Instance();
+    // events are not recorded before start
+    TRACE_BEGIN("utils_tests", "ignored");
+
+    trace_recorder.Start();
+    REQUIRE(trace_recorder.IsRecording());
+    {
+        TRACE_BLOCK_SCOPE();
+        TRACE_SET_BLOCK(3);
+        REQUIRE(sirius::utils::TraceRecorder::CurrentBlock() == 3);
+        TRACE_SCOPE("utils_tests", "compute");
+        TRACE_ASYNC_BEGIN("utils_tests", "queue_wait", 3);
+        std::thread writer([]() {
+            TRACE_ASYNC_END("utils_tests", "queue_wait", 3);
+            TRACE_SCOPE("utils_tests", "write");
+        });
+        writer.join();
+    }
+    REQUIRE(sirius::utils::TraceRecorder::CurrentBlock() == -1);
+    trace_recorder.Stop();
+    TRACE_BEGIN("utils_tests", "ignored");
+
+    std::string trace_path = "./output/utils_tests_trace.json";
+    trace_recorder.Write(trace_path);
+    std::ifstream trace_file(trace_path);
+    std::string trace((std::istreambuf_iterator<char>(trace_file)),
+                      std::istreambuf_iterator<char>());
+    REQUIRE(trace.find("\"traceEvents\"") != std::string::npos);
+    REQUIRE(trace.find("ignored") == std::string::npos);
+    REQUIRE(trace.find("\"name\": \"compute\", \"cat\": \"utils_tests\", "
+                       "\"ph\": \"B\"") != std::string::npos);
+    REQUIRE(trace.find("\"ph\": \"E\"") != std::string::npos);
+    REQUIRE(trace.find("\"ph\": \"b\"") != std::string::npos);
+    REQUIRE(trace.find("\"id\": 3") != std::string::npos);
+    REQUIRE(trace.find("\"args\": {\"block\": 3}") != std::string::npos);
+    // recording thread and writer thread
+    REQUIRE(trace.find("\"tid\": 2") != std::string::npos);
+
+    REQUIRE_THROWS_AS(trace_recorder.Write("/nonexistent/trace.json"),
+                      sirius::Exception);
+}
+#endif  // SIRIUS_ENABLE_TRACING
+
+#ifdef SIRIUS_ENABLE_LOGS
+TEST_CASE("utils tests - log level check", "[sirius]") {
+    int evaluation_count = 0;
+    auto count = [&evaluation_count]() { return ++evaluation_count; };
+
+    // arguments of discarded messages are not evaluated
+    LOG_SET_LEVEL(info);
+    LOG("utils_tests", trace, "discarded message {}", count());
+    REQUIRE(evaluation_count == 0);
+    LOG("utils_tests", info, "logged message {}", count());
+    REQUIRE(evaluation_count == 1);
+
+    // level changes apply to the loggers resolved by the call sites
+    LOG_SET_LEVEL(trace);
+    for (int i = 0; i < 2; ++i) {
+        LOG("utils_tests", trace, "logged message {}", count());
+    }
+    REQUIRE(evaluation_count == 3);
+    LOG_SET_LEVEL(err);
+    LOG("utils_tests", warn, "discarded message {}", count());
+    LOG("utils_tests", error, "logged message {}", count());
+    REQUIRE(evaluation_count == 4);
+    LOG_SET_LEVEL(info);
+}
+#endif  // SIRIUS_ENABLE_LOGS